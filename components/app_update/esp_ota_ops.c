@@ -48,6 +48,8 @@ typedef struct ota_ops_entry_ {
     const esp_partition_t *part;
     uint32_t erased_size;
     uint32_t wrote_size;
+    bool need_erase;            /* Sectors are erased by esp_ota_write() */
+    uint32_t erased_end;        /* End of the erased range, when need_erase is set */
     uint8_t partial_bytes;
     uint8_t partial_data[16];
     LIST_ENTRY(ota_ops_entry_) entries;
@@ -123,7 +125,9 @@ esp_err_t esp_ota_begin(const esp_partition_t *partition, size_t image_size, esp
     }
 
     // If input image size is 0 or OTA_SIZE_UNKNOWN, erase entire partition
-    if ((image_size == 0) || (image_size == OTA_SIZE_UNKNOWN)) {
+    if (image_size == OTA_WITH_SEQUENTIAL_WRITES) {
+        ret = ESP_OK;
+    } else if ((image_size == 0) || (image_size == OTA_SIZE_UNKNOWN)) {
         ret = esp_partition_erase_range(partition, 0, partition->size);
     } else {
         ret = esp_partition_erase_range(partition, 0, (image_size / SPI_FLASH_SEC_SIZE + 1) * SPI_FLASH_SEC_SIZE);
@@ -140,7 +144,10 @@ esp_err_t esp_ota_begin(const esp_partition_t *partition, size_t image_size, esp
 
     LIST_INSERT_HEAD(&s_ota_ops_entries_head, new_entry, entries);
 
-    if ((image_size == 0) || (image_size == OTA_SIZE_UNKNOWN)) {
+    if (image_size == OTA_WITH_SEQUENTIAL_WRITES) {
+        new_entry->erased_size = partition->size;
+        new_entry->need_erase = true;
+    } else if ((image_size == 0) || (image_size == OTA_SIZE_UNKNOWN)) {
         new_entry->erased_size = partition->size;
     } else {
         new_entry->erased_size = image_size;
@@ -152,6 +159,76 @@ esp_err_t esp_ota_begin(const esp_partition_t *partition, size_t image_size, esp
     return ESP_OK;
 }
 
+esp_err_t esp_ota_resume(const esp_partition_t *partition, size_t image_offset, esp_ota_handle_t *out_handle)
+{
+    ota_ops_entry_t *new_entry;
+
+    if ((partition == NULL) || (out_handle == NULL)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    partition = esp_partition_verify(partition);
+    if (partition == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    if (!is_ota_partition(partition)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (partition == esp_ota_get_running_partition()) {
+        return ESP_ERR_OTA_PARTITION_CONFLICT;
+    }
+
+    // The sector after the written data may hold data of the interrupted update, it's erased before writing
+    if ((image_offset % SPI_FLASH_SEC_SIZE) != 0 || image_offset > partition->size) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    new_entry = (ota_ops_entry_t *) calloc(sizeof(ota_ops_entry_t), 1);
+    if (new_entry == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    LIST_INSERT_HEAD(&s_ota_ops_entries_head, new_entry, entries);
+
+    new_entry->erased_size = partition->size;
+    new_entry->need_erase = true;
+    new_entry->erased_end = image_offset;
+    new_entry->wrote_size = image_offset;
+    new_entry->part = partition;
+    new_entry->handle = ++s_ota_ops_last_handle;
+    *out_handle = new_entry->handle;
+    return ESP_OK;
+}
+
+/*
+ * Erases the sectors up to 'end' which are not erased yet. It keeps
+ * CONFIG_APP_UPDATE_ERASE_AHEAD_SECTORS sectors erased beyond, so that
+ * the following writes don't have to wait for an erase.
+ */
+static esp_err_t esp_ota_erase_to(ota_ops_entry_t *it, uint32_t end)
+{
+    esp_err_t ret;
+
+    if (end > it->part->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    end = OTA_MIN((end + SPI_FLASH_SEC_SIZE - 1) / SPI_FLASH_SEC_SIZE * SPI_FLASH_SEC_SIZE
+                  + CONFIG_APP_UPDATE_ERASE_AHEAD_SECTORS * SPI_FLASH_SEC_SIZE, it->part->size);
+    if (end <= it->erased_end) {
+        return ESP_OK;
+    }
+
+    ESP_LOGD(TAG, "erase 0x%x - 0x%x", it->erased_end, end);
+    ret = esp_partition_erase_range(it->part, it->erased_end, end - it->erased_end);
+    if (ret == ESP_OK) {
+        it->erased_end = end;
+    }
+    return ret;
+}
+
 esp_err_t esp_ota_write(esp_ota_handle_t handle, const void *data, size_t size)
 {
     const uint8_t *data_bytes = (const uint8_t *)data;
@@ -208,6 +285,13 @@ esp_err_t esp_ota_write(esp_ota_handle_t handle, const void *data, size_t size)
             }
 
 #endif
+            if (it->need_erase) {
+                ret = esp_ota_erase_to(it, it->wrote_size + size);
+                if (ret != ESP_OK) {
+                    return ret;
+                }
+            }
+
             ret = esp_partition_write(it->part, it->wrote_size, data_bytes, size);
             if(ret == ESP_OK){
                 it->wrote_size += size;
@@ -246,6 +330,12 @@ esp_err_t esp_ota_end(esp_ota_handle_t handle)
 
     if (it->partial_bytes > 0) {
         /* Write out last 16 bytes, if necessary */
+        if (it->need_erase) {
+            ret = esp_ota_erase_to(it, it->wrote_size + 16);
+            if (ret != ESP_OK) {
+                goto cleanup;
+            }
+        }
         ret = esp_partition_write(it->part, it->wrote_size, it->partial_data, 16);
         if (ret != ESP_OK) {
             ret = ESP_ERR_INVALID_STATE;
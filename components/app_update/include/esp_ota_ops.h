@@ -29,6 +29,7 @@ extern "C"
 #endif
 
 #define OTA_SIZE_UNKNOWN 0xffffffff /*!< Used for esp_ota_begin() if new image size is unknown */
+#define OTA_WITH_SEQUENTIAL_WRITES 0xfffffffe /*!< Used for esp_ota_begin() if new image size is unknown and erase can be done in incremental manner (assuming write operation is in continuous sequence) */
 
 #define ESP_ERR_OTA_BASE                         0x1500                     /*!< Base error code for ota_ops api */
 #define ESP_ERR_OTA_PARTITION_CONFLICT           (ESP_ERR_OTA_BASE + 0x01)  /*!< Error if request was to write or erase the current running partition */
@@ -51,11 +52,15 @@ typedef uint32_t esp_ota_handle_t;
  * If image size is not yet known, pass OTA_SIZE_UNKNOWN which will
  * cause the entire partition to be erased.
  *
+ * If the image is written sequentially, pass OTA_WITH_SEQUENTIAL_WRITES. Nothing
+ * is erased here then, esp_ota_write() erases each sector before it writes to it,
+ * keeping CONFIG_APP_UPDATE_ERASE_AHEAD_SECTORS sectors erased ahead of the data.
+ *
  * On success, this function allocates memory that remains in use
  * until esp_ota_end() is called with the returned handle.
  *
  * @param partition Pointer to info for partition which will receive the OTA update. Required.
- * @param image_size Size of new OTA app image. Partition will be erased in order to receive this size of image. If 0 or OTA_SIZE_UNKNOWN, the entire partition is erased.
+ * @param image_size Size of new OTA app image. Partition will be erased in order to receive this size of image. If 0 or OTA_SIZE_UNKNOWN, the entire partition is erased. If OTA_WITH_SEQUENTIAL_WRITES, sectors are erased while writing.
  * @param out_handle On success, returns a handle which should be used for subsequent esp_ota_write() and esp_ota_end() calls.
 
  * @return
@@ -71,6 +76,31 @@ typedef uint32_t esp_ota_handle_t;
 esp_err_t esp_ota_begin(const esp_partition_t* partition, size_t image_size, esp_ota_handle_t* out_handle);
 
 
+/**
+ * @brief   Resume an interrupted OTA update of the specified partition.
+ *
+ * The first image_offset bytes of the partition are kept as they were written
+ * by the interrupted update, the caller is responsible for checking that they
+ * are intact. Writing continues at image_offset, sectors are erased while
+ * writing like with OTA_WITH_SEQUENTIAL_WRITES.
+ *
+ * On success, this function allocates memory that remains in use
+ * until esp_ota_end() is called with the returned handle.
+ *
+ * @param partition Pointer to info for partition which receives the OTA update. Required.
+ * @param image_offset Size of the image already written, a multiple of SPI_FLASH_SEC_SIZE.
+ * @param out_handle On success, returns a handle which should be used for subsequent esp_ota_write() and esp_ota_end() calls.
+ *
+ * @return
+ *    - ESP_OK: OTA operation resumed successfully.
+ *    - ESP_ERR_INVALID_ARG: partition or out_handle arguments were NULL, partition doesn't point to an OTA app partition,
+ *                           or image_offset isn't sector aligned or exceeds the partition.
+ *    - ESP_ERR_NO_MEM: Cannot allocate memory for OTA operation.
+ *    - ESP_ERR_OTA_PARTITION_CONFLICT: Partition holds the currently running firmware, cannot update in place.
+ *    - ESP_ERR_NOT_FOUND: Partition argument not found in partition table.
+ */
+esp_err_t esp_ota_resume(const esp_partition_t* partition, size_t image_offset, esp_ota_handle_t* out_handle);
+
 uint8_t get_ota_partition_count(void);
 
 /**
@@ -88,6 +118,7 @@ uint8_t get_ota_partition_count(void);
  *    - ESP_OK: Data was written to flash successfully.
  *    - ESP_ERR_INVALID_ARG: handle is invalid.
  *    - ESP_ERR_OTA_VALIDATE_FAILED: First byte of image contains invalid app image magic byte.
+ *    - ESP_ERR_INVALID_SIZE: Data doesn't fit into the partition, if it was begun with OTA_WITH_SEQUENTIAL_WRITES.
  *    - ESP_ERR_FLASH_OP_TIMEOUT or ESP_ERR_FLASH_OP_FAIL: Flash write failed.
  *    - ESP_ERR_OTA_SELECT_INFO_INVALID: OTA data partition has invalid contents
  */
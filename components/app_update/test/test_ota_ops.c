@@ -8,6 +8,8 @@
 #include <unity.h>
 #include <test_utils.h>
 #include <esp_ota_ops.h>
+#include <esp_partition.h>
+#include <esp_spi_flash.h>
 
 
 /* These OTA tests currently don't assume an OTA partition exists
@@ -84,3 +86,36 @@ TEST_CASE("esp_ota_get_next_update_partition logic", "[ota]")
     TEST_ASSERT_EQUAL_PTR(ota_0, p);
 }
 
+
+TEST_CASE("esp_ota_write() erases sectors with OTA_WITH_SEQUENTIAL_WRITES", "[ota]")
+{
+    const esp_partition_t *p = esp_ota_get_next_update_partition(NULL);
+    esp_ota_handle_t handle = 0;
+    uint8_t data[256], old[256], buf[256];
+
+    TEST_ASSERT_NOT_NULL(p);
+    memset(data, 0xE9, sizeof(data));
+    memset(old, 0x55, sizeof(old));
+
+    /* leave data across the first sector boundary, which must be erased before it's written again */
+    TEST_ESP_OK(esp_partition_erase_range(p, 0, 2 * SPI_FLASH_SEC_SIZE));
+    TEST_ESP_OK(esp_partition_write(p, SPI_FLASH_SEC_SIZE - sizeof(old) / 2, old, sizeof(old)));
+
+    TEST_ESP_OK(esp_ota_begin(p, OTA_WITH_SEQUENTIAL_WRITES, &handle));
+
+    /* nothing is erased until data is written */
+    TEST_ESP_OK(esp_partition_read(p, SPI_FLASH_SEC_SIZE, buf, sizeof(buf) / 2));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(old, buf, sizeof(buf) / 2);
+
+    for (int off = 0; off < SPI_FLASH_SEC_SIZE + sizeof(data); off += sizeof(data)) {
+        TEST_ESP_OK(esp_ota_write(handle, data, sizeof(data)));
+    }
+
+    for (int off = 0; off < SPI_FLASH_SEC_SIZE + sizeof(data); off += sizeof(data)) {
+        TEST_ESP_OK(esp_partition_read(p, off, buf, sizeof(buf)));
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(data, buf, sizeof(buf));
+    }
+
+    /* this is not a valid app image */
+    TEST_ASSERT_NOT_EQUAL(ESP_OK, esp_ota_end(handle));
+}
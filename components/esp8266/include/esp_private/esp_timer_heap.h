@@ -0,0 +1,112 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Binary min-heap of armed timers ordered by alarm time, used by the hardware timer
+ * implementation of esp_timer. It does not depend on any OS or hardware, callers provide
+ * the current time and must protect the heap against concurrent access.
+ */
+
+#define ESP_TIMER_NODE_IDLE     (-1)
+
+/**
+ * @brief timer node which is linked into the heap
+ */
+typedef struct esp_timer_node {
+    uint64_t    alarm;      //!< absolute time of next expiration, in microseconds
+    uint64_t    period;     //!< period of periodic timer, 0 for one-shot timer
+    int         index;      //!< position in heap, ESP_TIMER_NODE_IDLE if not armed
+} esp_timer_node_t;
+
+/**
+ * @brief timer heap, nodes[0] expires first
+ */
+typedef struct esp_timer_heap {
+    esp_timer_node_t    **nodes;    //!< node array of "size" elements
+    size_t              num;        //!< number of armed nodes
+    size_t              size;       //!< capacity of node array
+} esp_timer_heap_t;
+
+/**
+ * @brief Initialize timer heap with node array
+ */
+static inline void esp_timer_heap_init(esp_timer_heap_t *heap, esp_timer_node_t **nodes, size_t size)
+{
+    heap->nodes = nodes;
+    heap->num = 0;
+    heap->size = size;
+}
+
+/**
+ * @brief Initialize timer node as not armed
+ */
+static inline void esp_timer_node_init(esp_timer_node_t *node)
+{
+    node->alarm = 0;
+    node->period = 0;
+    node->index = ESP_TIMER_NODE_IDLE;
+}
+
+/**
+ * @brief Check if timer node is in the heap
+ */
+static inline bool esp_timer_node_is_armed(const esp_timer_node_t *node)
+{
+    return node->index != ESP_TIMER_NODE_IDLE;
+}
+
+/**
+ * @brief Get the node which expires first, NULL if heap is empty
+ */
+static inline esp_timer_node_t *esp_timer_heap_top(const esp_timer_heap_t *heap)
+{
+    return heap->num ? heap->nodes[0] : NULL;
+}
+
+/**
+ * @brief Add timer node to heap, its "alarm" and "period" must be set
+ *
+ * @return 0 if success or -1 if the node array is full
+ */
+int esp_timer_heap_add(esp_timer_heap_t *heap, esp_timer_node_t *node);
+
+/**
+ * @brief Remove armed timer node from heap
+ */
+void esp_timer_heap_remove(esp_timer_heap_t *heap, esp_timer_node_t *node);
+
+/**
+ * @brief Remove the first node if it expires at "now"
+ *
+ * A periodic node is added back with next alarm time which is a whole number of periods
+ * after its previous alarm time, so that it does not drift. Periods which have already
+ * passed at "now" are skipped.
+ *
+ * @return expired node or NULL if no node expires
+ */
+esp_timer_node_t *esp_timer_heap_expire(esp_timer_heap_t *heap, uint64_t now);
+
+#ifdef __cplusplus
+}
+#endif
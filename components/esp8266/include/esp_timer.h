@@ -48,8 +48,10 @@ extern "C" {
 #endif
 
 /**
- * Important: This function is based on FreeRTOS timer not real time hard timer.
- *            Adding this just for some user passing compiling now.
+ * Important: By default this function is based on FreeRTOS timer not real time hard timer,
+ *            timeouts and periods must be multiples of the FreeRTOS tick.
+ *            Select CONFIG_ESP_TIMER_IMPL_FRC1 to drive timers by FRC1 hardware timer with
+ *            microsecond resolution, hw_timer driver cannot be used then.
  */
 
 /**
@@ -12,14 +12,29 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <string.h>
+#include <sys/param.h>
+
+#include "sdkconfig.h"
 #include "esp_timer.h"
 #include "esp_heap_caps.h"
+#include "esp_heap_pool.h"
 #include "esp_log.h"
 #include "FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/timers.h"
 #include "driver/soc.h"
 
+#ifdef CONFIG_ESP_TIMER_IMPL_FRC1
+#include "esp_attr.h"
+#include "esp_task.h"
+#include "esp8266/eagle_soc.h"
+#include "esp8266/timer_register.h"
+#include "esp8266/timer_struct.h"
+#include "driver/hw_timer.h"
+#include "esp_private/esp_timer_heap.h"
+#endif
+
 #define ESP_TIMER_HZ CONFIG_FREERTOS_HZ
 
 typedef enum {
@@ -31,7 +46,11 @@ typedef enum {
 } esp_timer_state_t;
 
 struct esp_timer {
+#ifdef CONFIG_ESP_TIMER_IMPL_FRC1
+    esp_timer_node_t    node;       //!< must be the first member
+#else
     TimerHandle_t       os_timer;
+#endif
 
     esp_timer_cb_t      cb;
 
@@ -40,13 +59,309 @@ struct esp_timer {
     esp_timer_state_t   state;
 };
 
+#ifdef CONFIG_ESP_TIMER_POOL
+static heap_caps_pool_handle_t s_timer_pool;
+#endif
+
+static struct esp_timer *alloc_timer(void)
+{
+#ifdef CONFIG_ESP_TIMER_POOL
+    if (s_timer_pool)
+        return heap_caps_pool_get(s_timer_pool);
+#endif
+
+    return heap_caps_malloc(sizeof(struct esp_timer), MALLOC_CAP_32BIT);
+}
+
+static void free_timer(struct esp_timer *timer)
+{
+#ifdef CONFIG_ESP_TIMER_POOL
+    if (s_timer_pool) {
+        heap_caps_pool_put(s_timer_pool, timer);
+        return;
+    }
+#endif
+
+    heap_caps_free(timer);
+}
+
+#ifdef CONFIG_ESP_TIMER_IMPL_FRC1
+/*
+ * FRC1 is a 23-bit countdown timer, with 1/16 divider it counts 5 ticks every microsecond
+ * and covers about 1.6 seconds. Alarms later than that are reached by several countdowns.
+ */
+#define FRC1_TICKS_PER_US       ((TIMER_BASE_CLK >> TIMER_CLKDIV_16) / 1000000)
+#define FRC1_MAX_DELAY_US       (FRC1_LOAD_DATA_MASK / FRC1_TICKS_PER_US)
+#define FRC1_MIN_DELAY_US       10
+
+#define ESP_TIMER_HEAP_MIN_SIZE 8
+
+#define ENTER_CRITICAL()        portENTER_CRITICAL()
+#define EXIT_CRITICAL()         portEXIT_CRITICAL()
+
+/* Armed timers ordered by alarm time, capacity is kept not less than the number of created timers */
+static esp_timer_heap_t s_timer_heap;
+static size_t s_timer_num;
+static TaskHandle_t s_timer_task;
+
+static void IRAM_ATTR esp_timer_isr(void *arg)
+{
+    BaseType_t woken = pdFALSE;
+
+    frc1.ctrl.en = 0;
+
+    vTaskNotifyGiveFromISR(s_timer_task, &woken);
+    if (woken == pdTRUE)
+        portYIELD_FROM_ISR();
+}
+
+/**
+ * @brief program FRC1 to interrupt at the alarm time of the first timer, must be called in critical section
+ */
+static void esp_timer_set_alarm(void)
+{
+    int64_t delay;
+    esp_timer_node_t *node = esp_timer_heap_top(&s_timer_heap);
+
+    frc1.ctrl.en = 0;
+
+    if (!node)
+        return;
+
+    delay = (int64_t)node->alarm - esp_timer_get_time();
+    if (delay < FRC1_MIN_DELAY_US)
+        delay = FRC1_MIN_DELAY_US;
+    else if (delay > FRC1_MAX_DELAY_US)
+        delay = FRC1_MAX_DELAY_US;
+
+    frc1.load.data = delay * FRC1_TICKS_PER_US;
+    frc1.ctrl.en = 1;
+}
+
+/**
+ * @brief make sure that timer heap can hold "num" timers
+ */
+static esp_err_t esp_timer_heap_reserve(size_t num)
+{
+    size_t size;
+    esp_timer_node_t **nodes, **old;
+
+    if (num <= s_timer_heap.size)
+        return ESP_OK;
+
+    size = MAX(num, MAX(s_timer_heap.size * 2, ESP_TIMER_HEAP_MIN_SIZE));
+    nodes = heap_caps_malloc(size * sizeof(esp_timer_node_t *), MALLOC_CAP_32BIT);
+    if (!nodes)
+        return ESP_ERR_NO_MEM;
+
+    ENTER_CRITICAL();
+    if (num <= s_timer_heap.size) {
+        /* other task has enlarged the heap */
+        old = nodes;
+    } else {
+        memcpy(nodes, s_timer_heap.nodes, s_timer_heap.num * sizeof(esp_timer_node_t *));
+        old = s_timer_heap.nodes;
+        s_timer_heap.nodes = nodes;
+        s_timer_heap.size = size;
+    }
+    EXIT_CRITICAL();
+
+    heap_caps_free(old);
+
+    return ESP_OK;
+}
+
+/**
+ * @brief call callbacks of all expired timers and program the next alarm
+ */
+static void esp_timer_dispatch(void)
+{
+    while (1) {
+        esp_timer_cb_t cb;
+        void *arg;
+        struct esp_timer *timer;
+
+        ENTER_CRITICAL();
+        timer = (struct esp_timer *)esp_timer_heap_expire(&s_timer_heap, esp_timer_get_time());
+        if (!timer) {
+            esp_timer_set_alarm();
+            EXIT_CRITICAL();
+            break;
+        }
+        cb = timer->cb;
+        arg = timer->arg;
+        EXIT_CRITICAL();
+
+        /* Timer may be stopped or deleted in its callback, so it is not accessed after the call */
+        cb(arg);
+    }
+}
+
+static void esp_timer_task(void *param)
+{
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        esp_timer_dispatch();
+    }
+}
+
+static esp_err_t esp_timer_frc1_init(void)
+{
+    esp_err_t ret;
+
+    if (s_timer_task)
+        return ESP_OK;
+
+    ret = esp_timer_heap_reserve(ESP_TIMER_HEAP_MIN_SIZE);
+    if (ret != ESP_OK)
+        return ret;
+
+    if (xTaskCreate(esp_timer_task, "esp_timer", ESP_TASK_TIMER_STACK, NULL, ESP_TASK_TIMER_PRIO, &s_timer_task) != pdPASS)
+        return ESP_ERR_NO_MEM;
+
+    frc1.ctrl.val = 0;
+    frc1.ctrl.div = TIMER_CLKDIV_16;
+    frc1.ctrl.intr_type = TIMER_EDGE_INT;
+
+    _xt_isr_attach(ETS_FRC_TIMER1_INUM, esp_timer_isr, NULL);
+    TM1_EDGE_INT_ENABLE();
+    _xt_isr_unmask(1 << ETS_FRC_TIMER1_INUM);
+
+    return ESP_OK;
+}
+
+static esp_err_t esp_timer_arm(esp_timer_handle_t timer, uint64_t timeout_us, uint64_t period)
+{
+    ENTER_CRITICAL();
+
+    /* Restart running timer like the FreeRTOS timer based implementation does */
+    if (esp_timer_node_is_armed(&timer->node))
+        esp_timer_heap_remove(&s_timer_heap, &timer->node);
+
+    timer->node.alarm = esp_timer_get_time() + timeout_us;
+    timer->node.period = period;
+    esp_timer_heap_add(&s_timer_heap, &timer->node);
+
+    if (esp_timer_heap_top(&s_timer_heap) == &timer->node)
+        esp_timer_set_alarm();
+
+    EXIT_CRITICAL();
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Create an esp_timer instance
+ */
+esp_err_t esp_timer_create(const esp_timer_create_args_t* create_args,
+                           esp_timer_handle_t* out_handle)
+{
+    assert(create_args);
+    assert(out_handle);
+
+    size_t num;
+    esp_timer_handle_t esp_timer;
+
+    esp_timer = alloc_timer();
+    if (!esp_timer)
+        return ESP_ERR_NO_MEM;
+
+    ENTER_CRITICAL();
+    num = ++s_timer_num;
+    EXIT_CRITICAL();
+
+    if (esp_timer_heap_reserve(num) != ESP_OK) {
+        ENTER_CRITICAL();
+        s_timer_num--;
+        EXIT_CRITICAL();
+
+        free_timer(esp_timer);
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_timer_node_init(&esp_timer->node);
+    esp_timer->cb = create_args->callback;
+    esp_timer->arg = create_args->arg;
+    esp_timer->state = ESP_TIMER_INIT;
+    *out_handle = esp_timer;
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Start one-shot timer
+ */
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    assert(timer);
+
+    return esp_timer_arm(timer, timeout_us, 0);
+}
+
+/**
+ * @brief Start a periodic timer
+ */
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period)
+{
+    assert(timer);
+
+    if (!period)
+        return ESP_ERR_INVALID_ARG;
+
+    return esp_timer_arm(timer, period, period);
+}
+
+/**
+ * @brief Stop the timer
+ */
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    assert(timer);
+
+    ENTER_CRITICAL();
+
+    if (!esp_timer_node_is_armed(&timer->node)) {
+        EXIT_CRITICAL();
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_timer_heap_remove(&s_timer_heap, &timer->node);
+    esp_timer_set_alarm();
+
+    EXIT_CRITICAL();
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Delete an esp_timer instance
+ */
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+    assert(timer);
+
+    ENTER_CRITICAL();
+
+    if (esp_timer_node_is_armed(&timer->node)) {
+        esp_timer_heap_remove(&s_timer_heap, &timer->node);
+        esp_timer_set_alarm();
+    }
+    s_timer_num--;
+
+    EXIT_CRITICAL();
+
+    free_timer(timer);
+
+    return ESP_OK;
+}
+#else
 static const char *TAG = "esp_timer";
 
 static esp_err_t delete_timer(esp_timer_handle_t timer)
 {
     BaseType_t ret = xTimerDelete(timer->os_timer, portMAX_DELAY);
     if (ret == pdPASS)
-        heap_caps_free(timer);
+        free_timer(timer);
 
     return ret == pdPASS ? ESP_OK : ESP_ERR_NO_MEM;
 }
@@ -98,22 +413,6 @@ static void esp_timer_callback(TimerHandle_t xTimer)
     }
 }
 
-/**
- * @brief Initialize esp_timer library
- */
-esp_err_t esp_timer_init(void)
-{
-    return ESP_OK;
-}
-
-/**
- * @brief De-initialize esp_timer library
- */
-esp_err_t esp_timer_deinit(void)
-{
-    return ESP_OK;
-}
-
 /**
  * @brief Create an esp_timer instance
  */
@@ -126,7 +425,7 @@ esp_err_t esp_timer_create(const esp_timer_create_args_t* create_args,
     TimerHandle_t os_timer;
     esp_timer_handle_t esp_timer;
 
-    esp_timer = heap_caps_malloc(sizeof(struct esp_timer), MALLOC_CAP_32BIT);
+    esp_timer = alloc_timer();
     if (!esp_timer)
         return ESP_ERR_NO_MEM;
 
@@ -142,7 +441,7 @@ esp_err_t esp_timer_create(const esp_timer_create_args_t* create_args,
         esp_timer->state = ESP_TIMER_INIT;
         *out_handle = (esp_timer_handle_t)esp_timer;
     } else {
-        heap_caps_free(esp_timer);
+        free_timer(esp_timer);
         return ESP_ERR_NO_MEM;
     }
 
@@ -244,6 +543,37 @@ esp_err_t esp_timer_delete(esp_timer_handle_t timer)
     return ret;
 }
 
+#endif /* CONFIG_ESP_TIMER_IMPL_FRC1 */
+
+/**
+ * @brief Initialize esp_timer library
+ */
+esp_err_t esp_timer_init(void)
+{
+#ifdef CONFIG_ESP_TIMER_POOL
+    /* Without the pool, timers are allocated from the heap */
+    if (!s_timer_pool) {
+        s_timer_pool = heap_caps_pool_create(sizeof(struct esp_timer), CONFIG_ESP_TIMER_POOL_SIZE, MALLOC_CAP_32BIT);
+        if (!s_timer_pool)
+            ESP_EARLY_LOGW("esp_timer", "no memory for the timer pool, timers are allocated from the heap");
+    }
+#endif
+
+#ifdef CONFIG_ESP_TIMER_IMPL_FRC1
+    return esp_timer_frc1_init();
+#else
+    return ESP_OK;
+#endif
+}
+
+/**
+ * @brief De-initialize esp_timer library
+ */
+esp_err_t esp_timer_deinit(void)
+{
+    return ESP_OK;
+}
+
 int64_t esp_timer_get_time(void)
 {
     extern uint64_t g_esp_os_us;
@@ -0,0 +1,118 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "esp_private/esp_timer_heap.h"
+
+static inline void heap_set(esp_timer_heap_t *heap, size_t index, esp_timer_node_t *node)
+{
+    heap->nodes[index] = node;
+    node->index = index;
+}
+
+static void heap_sift_up(esp_timer_heap_t *heap, size_t index)
+{
+    esp_timer_node_t *node = heap->nodes[index];
+
+    while (index) {
+        size_t parent = (index - 1) / 2;
+
+        if (heap->nodes[parent]->alarm <= node->alarm)
+            break;
+
+        heap_set(heap, index, heap->nodes[parent]);
+        index = parent;
+    }
+
+    heap_set(heap, index, node);
+}
+
+static void heap_sift_down(esp_timer_heap_t *heap, size_t index)
+{
+    esp_timer_node_t *node = heap->nodes[index];
+
+    while (1) {
+        size_t child = index * 2 + 1;
+
+        if (child >= heap->num)
+            break;
+
+        if (child + 1 < heap->num && heap->nodes[child + 1]->alarm < heap->nodes[child]->alarm)
+            child++;
+
+        if (node->alarm <= heap->nodes[child]->alarm)
+            break;
+
+        heap_set(heap, index, heap->nodes[child]);
+        index = child;
+    }
+
+    heap_set(heap, index, node);
+}
+
+/**
+ * @brief Add timer node to heap
+ */
+int esp_timer_heap_add(esp_timer_heap_t *heap, esp_timer_node_t *node)
+{
+    if (heap->num >= heap->size)
+        return -1;
+
+    heap_set(heap, heap->num++, node);
+    heap_sift_up(heap, node->index);
+
+    return 0;
+}
+
+/**
+ * @brief Remove armed timer node from heap
+ */
+void esp_timer_heap_remove(esp_timer_heap_t *heap, esp_timer_node_t *node)
+{
+    size_t index = node->index;
+    esp_timer_node_t *last = heap->nodes[--heap->num];
+
+    node->index = ESP_TIMER_NODE_IDLE;
+
+    if (last == node)
+        return;
+
+    heap_set(heap, index, last);
+    if (index && heap->nodes[(index - 1) / 2]->alarm > last->alarm)
+        heap_sift_up(heap, index);
+    else
+        heap_sift_down(heap, index);
+}
+
+/**
+ * @brief Remove the first node if it expires at "now"
+ */
+esp_timer_node_t *esp_timer_heap_expire(esp_timer_heap_t *heap, uint64_t now)
+{
+    esp_timer_node_t *node = esp_timer_heap_top(heap);
+
+    if (!node || node->alarm > now)
+        return NULL;
+
+    if (!node->period) {
+        esp_timer_heap_remove(heap, node);
+        return node;
+    }
+
+    node->alarm += node->period;
+    if (node->alarm <= now)
+        node->alarm += ((now - node->alarm) / node->period + 1) * node->period;
+    heap_sift_down(heap, 0);
+
+    return node;
+}
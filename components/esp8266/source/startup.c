@@ -15,6 +15,7 @@
 #include <stdint.h>
 #include <stddef.h>
 #include <stdarg.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "sdkconfig.h"
@@ -27,6 +28,7 @@
 #include "esp_phy_init.h"
 #include "esp_heap_caps_init.h"
 #include "esp_task_wdt.h"
+#include "esp_timer.h"
 #include "esp_private/wifi.h"
 #include "esp_private/esp_system_internal.h"
 #include "esp8266/eagle_soc.h"
@@ -85,6 +87,19 @@ static void user_init_entry(void *param)
 
     assert(esp_pthread_init() == 0);
 
+    esp_err_t timer_err = esp_timer_init();
+    if (timer_err != ESP_OK) {
+        /* No esp_timer would ever fire */
+        ESP_EARLY_LOGE("startup", "esp_timer init failed: %d", timer_err);
+        abort();
+    }
+
+#ifdef CONFIG_LOG_ASYNC
+    if (esp_log_async_init() != 0) {
+        ESP_EARLY_LOGE("startup", "no memory for asynchronous log output, lines are output directly");
+    }
+#endif
+
 #ifdef CONFIG_BOOTLOADER_FAST_BOOT
     REG_CLR_BIT(DPORT_CTL_REG, DPORT_CTL_DOUBLE_CLK);
 #endif
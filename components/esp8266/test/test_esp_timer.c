@@ -15,6 +15,7 @@
 #include <assert.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/param.h>
 
@@ -111,3 +112,65 @@ TEST_CASE("Test esp_timer create and delete once mode", "[log]")
 
     vSemaphoreDelete(sem);
 }
+
+#define ESP_TIMER_JITTER_PERIOD     (10 * 1000)
+#define ESP_TIMER_JITTER_SAMPLES    100
+
+typedef struct {
+    SemaphoreHandle_t   sem;
+    int                 num;
+    int64_t             time[ESP_TIMER_JITTER_SAMPLES];
+} test_jitter_t;
+
+static void test_jitter_cb(void *p)
+{
+    test_jitter_t *jitter = (test_jitter_t *)p;
+
+    if (jitter->num < ESP_TIMER_JITTER_SAMPLES) {
+        jitter->time[jitter->num++] = esp_timer_get_time();
+        if (jitter->num == ESP_TIMER_JITTER_SAMPLES)
+            xSemaphoreGive(jitter->sem);
+    }
+}
+
+TEST_CASE("Test esp_timer periodic jitter", "[esp_timer]")
+{
+    int64_t start;
+    int64_t dev, max_dev = 0, sum_dev = 0;
+    esp_timer_handle_t timer;
+    test_jitter_t *jitter;
+
+    jitter = calloc(1, sizeof(test_jitter_t));
+    TEST_ASSERT_NOT_NULL(jitter);
+    jitter->sem = xSemaphoreCreateBinary();
+    TEST_ASSERT_NOT_NULL(jitter->sem);
+
+    esp_timer_create_args_t timer_args = {
+        .callback = test_jitter_cb,
+        .arg = jitter,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "test_jitter",
+    };
+
+    TEST_ESP_OK(esp_timer_create(&timer_args, &timer));
+    start = esp_timer_get_time();
+    TEST_ESP_OK(esp_timer_start_periodic(timer, ESP_TIMER_JITTER_PERIOD));
+
+    TEST_ASSERT_EQUAL_HEX32(pdPASS, xSemaphoreTake(jitter->sem, portMAX_DELAY));
+    TEST_ESP_OK(esp_timer_delete(timer));
+
+    for (int i = 0; i < ESP_TIMER_JITTER_SAMPLES; i++) {
+        dev = jitter->time[i] - (start + (int64_t)(i + 1) * ESP_TIMER_JITTER_PERIOD);
+        if (dev < 0)
+            dev = -dev;
+        sum_dev += dev;
+        max_dev = MAX(max_dev, dev);
+    }
+
+    printf("%d callbacks of %d us period: average deviation %d us, max deviation %d us\n",
+           ESP_TIMER_JITTER_SAMPLES, ESP_TIMER_JITTER_PERIOD,
+           (int)(sum_dev / ESP_TIMER_JITTER_SAMPLES), (int)max_dev);
+
+    vSemaphoreDelete(jitter->sem);
+    free(jitter);
+}
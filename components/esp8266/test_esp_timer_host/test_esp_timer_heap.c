@@ -0,0 +1,183 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/*
+ * Runs the timer heap of the FRC1 esp_timer implementation against a simulated clock.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+
+#include "esp_private/esp_timer_heap.h"
+
+#define TEST_NODE_NUM   64
+
+#define TEST_ASSERT(cond)                                                           \
+    do {                                                                            \
+        if (!(cond)) {                                                              \
+            printf("%s:%d: assertion \"%s\" failed\n", __FILE__, __LINE__, #cond);  \
+            exit(1);                                                                \
+        }                                                                           \
+    } while (0)
+
+static esp_timer_node_t *s_nodes[TEST_NODE_NUM];
+static esp_timer_node_t s_timers[TEST_NODE_NUM + 1];
+static esp_timer_heap_t s_heap;
+
+static void test_reset(void)
+{
+    esp_timer_heap_init(&s_heap, s_nodes, TEST_NODE_NUM);
+    for (int i = 0; i < TEST_NODE_NUM + 1; i++)
+        esp_timer_node_init(&s_timers[i]);
+}
+
+static void test_arm(esp_timer_node_t *node, uint64_t alarm, uint64_t period)
+{
+    node->alarm = alarm;
+    node->period = period;
+    TEST_ASSERT(esp_timer_heap_add(&s_heap, node) == 0);
+    TEST_ASSERT(esp_timer_node_is_armed(node));
+}
+
+static void test_order(void)
+{
+    uint64_t last = 0;
+    esp_timer_node_t *node;
+
+    test_reset();
+    srand(1);
+    for (int i = 0; i < TEST_NODE_NUM; i++)
+        test_arm(&s_timers[i], rand() % 100000 + 1, 0);
+
+    s_timers[TEST_NODE_NUM].alarm = 1;
+    TEST_ASSERT(esp_timer_heap_add(&s_heap, &s_timers[TEST_NODE_NUM]) == -1);
+
+    for (int i = 0; i < TEST_NODE_NUM; i++) {
+        node = esp_timer_heap_expire(&s_heap, UINT64_MAX);
+        TEST_ASSERT(node);
+        TEST_ASSERT(node->alarm >= last);
+        TEST_ASSERT(!esp_timer_node_is_armed(node));
+        last = node->alarm;
+    }
+
+    TEST_ASSERT(!esp_timer_heap_expire(&s_heap, UINT64_MAX));
+    TEST_ASSERT(!esp_timer_heap_top(&s_heap));
+}
+
+static void test_remove(void)
+{
+    uint64_t last = 0;
+    int num = 0;
+    esp_timer_node_t *node;
+
+    test_reset();
+    srand(2);
+    for (int i = 0; i < TEST_NODE_NUM; i++)
+        test_arm(&s_timers[i], rand() % 100000 + 1, 0);
+
+    for (int i = 0; i < TEST_NODE_NUM; i += 3) {
+        esp_timer_heap_remove(&s_heap, &s_timers[i]);
+        TEST_ASSERT(!esp_timer_node_is_armed(&s_timers[i]));
+    }
+
+    while ((node = esp_timer_heap_expire(&s_heap, UINT64_MAX))) {
+        TEST_ASSERT((node - s_timers) % 3);
+        TEST_ASSERT(node->alarm >= last);
+        last = node->alarm;
+        num++;
+    }
+
+    TEST_ASSERT(num == TEST_NODE_NUM - (TEST_NODE_NUM + 2) / 3);
+}
+
+/*
+ * Advance the simulated clock by a varying dispatch latency at every expiration, periodic
+ * timers must still expire at whole multiples of their periods.
+ */
+static void test_no_drift(void)
+{
+    uint64_t now = 0;
+    uint64_t count[3] = {0};
+    const uint64_t period[3] = {1000, 1500, 10000};
+    esp_timer_node_t *node;
+
+    test_reset();
+    for (int i = 0; i < 3; i++)
+        test_arm(&s_timers[i], period[i], period[i]);
+
+    while (now < 10 * 1000 * 1000) {
+        node = esp_timer_heap_top(&s_heap);
+        TEST_ASSERT(node);
+        if (now < node->alarm)
+            now = node->alarm;
+        now += rand() % 200;
+
+        node = esp_timer_heap_expire(&s_heap, now);
+        TEST_ASSERT(node);
+        TEST_ASSERT(esp_timer_node_is_armed(node));
+
+        int i = node - s_timers;
+        count[i]++;
+        TEST_ASSERT(node->alarm == (count[i] + 1) * period[i]);
+    }
+
+    for (int i = 0; i < 3; i++)
+        TEST_ASSERT(count[i] >= now / period[i] - 1);
+}
+
+/*
+ * Periods which passed while callbacks were blocked are skipped instead of running
+ * the callback for each of them.
+ */
+static void test_catch_up(void)
+{
+    esp_timer_node_t *node;
+
+    test_reset();
+    test_arm(&s_timers[0], 1000, 1000);
+    test_arm(&s_timers[1], 50000, 0);
+
+    TEST_ASSERT(!esp_timer_heap_expire(&s_heap, 999));
+
+    node = esp_timer_heap_expire(&s_heap, 10500);
+    TEST_ASSERT(node == &s_timers[0]);
+    TEST_ASSERT(node->alarm == 11000);
+    TEST_ASSERT(!esp_timer_heap_expire(&s_heap, 10500));
+
+    node = esp_timer_heap_expire(&s_heap, 11000);
+    TEST_ASSERT(node == &s_timers[0]);
+    TEST_ASSERT(node->alarm == 12000);
+
+    node = esp_timer_heap_expire(&s_heap, 60000);
+    TEST_ASSERT(node == &s_timers[0]);
+    TEST_ASSERT(node->alarm == 61000);
+    node = esp_timer_heap_expire(&s_heap, 60000);
+    TEST_ASSERT(node == &s_timers[1]);
+    TEST_ASSERT(!esp_timer_node_is_armed(node));
+    TEST_ASSERT(!esp_timer_heap_expire(&s_heap, 60000));
+}
+
+int main(int argc, char *argv[])
+{
+    test_order();
+    test_remove();
+    test_no_drift();
+    test_catch_up();
+
+    printf("All esp_timer heap tests passed\n");
+
+    return 0;
+}
@@ -392,15 +392,37 @@ static void loop_node_remove_all_handler(esp_event_loop_node_t* loop_node)
     }
 }
 
-static void inline __attribute__((always_inline)) post_instance_delete(esp_event_post_instance_t* post)
+static void* post_data_alloc(esp_event_loop_instance_t* loop, size_t size)
+{
+#ifdef CONFIG_ESP_EVENT_POST_DATA_POOL
+    if (loop->data_pool && size <= CONFIG_ESP_EVENT_POST_DATA_POOL_OBJ_SIZE) {
+        return heap_caps_pool_get(loop->data_pool);
+    }
+#endif
+    return malloc(size);
+}
+
+static void post_data_free(esp_event_loop_instance_t* loop, void* data)
+{
+#ifdef CONFIG_ESP_EVENT_POST_DATA_POOL
+    if (loop->data_pool) {
+        // Data which was not got from the pool slab is freed to the heap by the pool
+        heap_caps_pool_put(loop->data_pool, data);
+        return;
+    }
+#endif
+    free(data);
+}
+
+static void inline __attribute__((always_inline)) post_instance_delete(esp_event_loop_instance_t* loop, esp_event_post_instance_t* post)
 {
 #if CONFIG_ESP_EVENT_POST_FROM_ISR
     if (post->data_allocated && post->data.ptr) {
-        free(post->data.ptr);
+        post_data_free(loop, post->data.ptr);
     }
 #else
     if (post->data) {
-        free(post->data);
+        post_data_free(loop, post->data);
     }
 #endif
     memset(post, 0, sizeof(*post));
@@ -441,6 +463,15 @@ esp_err_t esp_event_loop_create(const esp_event_loop_args_t* event_loop_args, es
     }
 #endif
 
+#ifdef CONFIG_ESP_EVENT_POST_DATA_POOL
+    loop->data_pool = heap_caps_pool_create(CONFIG_ESP_EVENT_POST_DATA_POOL_OBJ_SIZE, CONFIG_ESP_EVENT_POST_DATA_POOL_SIZE,
+                                            MALLOC_CAP_8BIT);
+    if (loop->data_pool == NULL) {
+        ESP_LOGE(TAG, "create event loop data pool failed");
+        goto on_err;
+    }
+#endif
+
     SLIST_INIT(&(loop->loop_nodes));
 
     // Create the loop task if requested
@@ -492,6 +523,12 @@ on_err:
     }
 #endif
 
+#ifdef CONFIG_ESP_EVENT_POST_DATA_POOL
+    if (loop->data_pool != NULL) {
+        heap_caps_pool_delete(loop->data_pool);
+    }
+#endif
+
     free(loop);
 
     return err;
@@ -564,7 +601,7 @@ esp_err_t esp_event_loop_run(esp_event_loop_handle_t event_loop, TickType_t tick
         esp_event_base_t base = post.base;
         int32_t id = post.id;
 
-        post_instance_delete(&post);
+        post_instance_delete(loop, &post);
 
         if (ticks_to_run != portMAX_DELAY) {
             end = xTaskGetTickCount();
@@ -626,11 +663,14 @@ esp_err_t esp_event_loop_delete(esp_event_loop_handle_t event_loop)
     // Drop existing posts on the queue
     esp_event_post_instance_t post;
     while(xQueueReceive(loop->queue, &post, 0) == pdTRUE) {
-        post_instance_delete(&post);
+        post_instance_delete(loop, &post);
     }
 
     // Cleanup loop
     vQueueDelete(loop->queue);
+#ifdef CONFIG_ESP_EVENT_POST_DATA_POOL
+    heap_caps_pool_delete(loop->data_pool);
+#endif
     free(loop);
     // Free loop mutex before deleting
     xSemaphoreGiveRecursive(loop_mutex);
@@ -761,7 +801,7 @@ esp_err_t esp_event_post_to(esp_event_loop_handle_t event_loop, esp_event_base_t
 
     if (event_data != NULL && event_data_size != 0) {
         // Make persistent copy of event data on heap.
-        void* event_data_copy = calloc(1, event_data_size);
+        void* event_data_copy = post_data_alloc(loop, event_data_size);
 
         if (event_data_copy == NULL) {
             return ESP_ERR_NO_MEM;
@@ -806,7 +846,7 @@ esp_err_t esp_event_post_to(esp_event_loop_handle_t event_loop, esp_event_base_t
     }
 
     if (result != pdTRUE) {
-        post_instance_delete(&post);
+        post_instance_delete(loop, &post);
 
 #ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
         atomic_fetch_add(&loop->events_dropped, 1);
@@ -854,7 +894,7 @@ esp_err_t esp_event_isr_post_to(esp_event_loop_handle_t event_loop, esp_event_ba
     result = xQueueSendToBackFromISR(loop->queue, &post, task_unblocked);
 
     if (result != pdTRUE) {
-        post_instance_delete(&post);
+        post_instance_delete(loop, &post);
 
 #ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
         atomic_fetch_add(&loop->events_dropped, 1);
@@ -18,6 +18,11 @@
 #include "esp_event.h"
 #include "stdatomic.h"
 
+#ifdef CONFIG_ESP_EVENT_POST_DATA_POOL
+#include "esp_heap_caps.h"
+#include "esp_heap_pool.h"
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -77,6 +82,9 @@ typedef struct esp_event_loop_instance {
     SemaphoreHandle_t mutex;                                        /**< mutex for updating the events linked list */
     esp_event_loop_nodes_t loop_nodes;                              /**< set of linked lists containing the
                                                                             registered handlers for the loop */
+#ifdef CONFIG_ESP_EVENT_POST_DATA_POOL
+    heap_caps_pool_handle_t data_pool;                              /**< object pool of posted event data */
+#endif
 #ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
     atomic_uint_least32_t events_recieved;                          /**< number of events successfully posted to the loop */
     atomic_uint_least32_t events_dropped;                           /**< number of events dropped due to queue being full */
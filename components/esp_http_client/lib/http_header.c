@@ -22,6 +22,11 @@
 #include "http_header.h"
 #include "http_utils.h"
 
+#ifdef CONFIG_ESP_HTTP_CLIENT_HEADER_ITEM_POOL
+#include "esp_heap_caps.h"
+#include "esp_heap_pool.h"
+#endif
+
 static const char *TAG = "HTTP_HEADER";
 #define HEADER_BUFFER (1024)
 
@@ -34,20 +39,65 @@ typedef struct http_header_item {
     STAILQ_ENTRY(http_header_item) next;   /*!< Point to next entry */
 } http_header_item_t;
 
-STAILQ_HEAD(http_header, http_header_item);
+STAILQ_HEAD(http_header_list, http_header_item);
+
+/**
+ * header list struct, with the object pool of its items
+ */
+struct http_header {
+    struct http_header_list items;      /*!< header items */
+#ifdef CONFIG_ESP_HTTP_CLIENT_HEADER_ITEM_POOL
+    heap_caps_pool_handle_t item_pool;  /*!< object pool of header items */
+#endif
+};
+
+static http_header_item_handle_t http_header_alloc_item(http_header_handle_t header)
+{
+    http_header_item_handle_t item;
+#ifdef CONFIG_ESP_HTTP_CLIENT_HEADER_ITEM_POOL
+    item = heap_caps_pool_get(header->item_pool);
+#else
+    item = malloc(sizeof(http_header_item_t));
+#endif
+    if (item) {
+        memset(item, 0, sizeof(http_header_item_t));
+    }
+    return item;
+}
 
+static void http_header_free_item(http_header_handle_t header, http_header_item_handle_t item)
+{
+    free(item->key);
+    free(item->value);
+#ifdef CONFIG_ESP_HTTP_CLIENT_HEADER_ITEM_POOL
+    heap_caps_pool_put(header->item_pool, item);
+#else
+    free(item);
+#endif
+}
 
 http_header_handle_t http_header_init(void)
 {
     http_header_handle_t header = calloc(1, sizeof(struct http_header));
     HTTP_MEM_CHECK(TAG, header, return NULL);
-    STAILQ_INIT(header);
+#ifdef CONFIG_ESP_HTTP_CLIENT_HEADER_ITEM_POOL
+    header->item_pool = heap_caps_pool_create(sizeof(http_header_item_t), CONFIG_ESP_HTTP_CLIENT_HEADER_ITEM_POOL_SIZE,
+                                              MALLOC_CAP_8BIT);
+    HTTP_MEM_CHECK(TAG, header->item_pool, {
+        free(header);
+        return NULL;
+    });
+#endif
+    STAILQ_INIT(&header->items);
     return header;
 }
 
 esp_err_t http_header_destroy(http_header_handle_t header)
 {
     esp_err_t err = http_header_clean(header);
+#ifdef CONFIG_ESP_HTTP_CLIENT_HEADER_ITEM_POOL
+    heap_caps_pool_delete(header->item_pool);
+#endif
     free(header);
     return err;
 }
@@ -58,7 +108,7 @@ http_header_item_handle_t http_header_get_item(http_header_handle_t header, cons
     if (header == NULL || key == NULL) {
         return NULL;
     }
-    STAILQ_FOREACH(item, header, next) {
+    STAILQ_FOREACH(item, &header->items, next) {
         if (strcasecmp(item->key, key) == 0) {
             return item;
         }
@@ -84,7 +134,7 @@ static esp_err_t http_header_new_item(http_header_handle_t header, const char *k
 {
     http_header_item_handle_t item;
 
-    item = calloc(1, sizeof(http_header_item_t));
+    item = http_header_alloc_item(header);
     HTTP_MEM_CHECK(TAG, item, return ESP_ERR_NO_MEM);
     http_utils_assign_string(&item->key, key, 0);
     HTTP_MEM_CHECK(TAG, item->key, goto _header_new_item_exit);
@@ -92,11 +142,10 @@ static esp_err_t http_header_new_item(http_header_handle_t header, const char *k
     http_utils_assign_string(&item->value, value, 0);
     HTTP_MEM_CHECK(TAG, item->value, goto _header_new_item_exit);
     http_utils_trim_whitespace(&item->value);
-    STAILQ_INSERT_TAIL(header, item, next);
+    STAILQ_INSERT_TAIL(&header->items, item, next);
     return ESP_OK;
 _header_new_item_exit:
-    free(item->key);
-    free(item->value);
+    http_header_free_item(header, item);
     return ESP_ERR_NO_MEM;
 }
 
@@ -143,10 +192,8 @@ esp_err_t http_header_delete(http_header_handle_t header, const char *key)
 {
     http_header_item_handle_t item = http_header_get_item(header, key);
     if (item) {
-        STAILQ_REMOVE(header, item, http_header_item, next);
-        free(item->key);
-        free(item->value);
-        free(item);
+        STAILQ_REMOVE(&header->items, item, http_header_item, next);
+        http_header_free_item(header, item);
     } else {
         return ESP_ERR_NOT_FOUND;
     }
@@ -180,7 +227,7 @@ int http_header_generate_string(http_header_handle_t header, int index, char *bu
     bool is_end = false;
 
     // iterate over the header entries to calculate buffer size and determine last item
-    STAILQ_FOREACH(item, header, next) {
+    STAILQ_FOREACH(item, &header->items, next) {
         if (item->value && idx >= index) {
             siz += strlen(item->key);
             siz += strlen(item->value);
@@ -208,7 +255,7 @@ int http_header_generate_string(http_header_handle_t header, int index, char *bu
     // iterate again over the header entries to write only the fitting indeces
     int str_len = 0;
     idx = 0;
-    STAILQ_FOREACH(item, header, next) {
+    STAILQ_FOREACH(item, &header->items, next) {
         if (item->value && idx >= index && idx < ret_idx) {
             str_len += snprintf(buffer + str_len, *buffer_len - str_len, "%s: %s\r\n", item->key, item->value);
         }
@@ -224,15 +271,13 @@ int http_header_generate_string(http_header_handle_t header, int index, char *bu
 
 esp_err_t http_header_clean(http_header_handle_t header)
 {
-    http_header_item_handle_t item = STAILQ_FIRST(header), tmp;
+    http_header_item_handle_t item = STAILQ_FIRST(&header->items), tmp;
     while (item != NULL) {
         tmp = STAILQ_NEXT(item, next);
-        free(item->key);
-        free(item->value);
-        free(item);
+        http_header_free_item(header, item);
         item = tmp;
     }
-    STAILQ_INIT(header);
+    STAILQ_INIT(&header->items);
     return ESP_OK;
 }
 
@@ -240,7 +285,7 @@ int http_header_count(http_header_handle_t header)
 {
     http_header_item_handle_t item;
     int count = 0;
-    STAILQ_FOREACH(item, header, next) {
+    STAILQ_FOREACH(item, &header->items, next) {
         count ++;
     }
     return count;
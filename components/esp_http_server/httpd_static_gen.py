@@ -0,0 +1,211 @@
+#!/usr/bin/env python
+#
+# httpd_static_gen is used to pack a directory into a partition image from which
+# esp_http_server serves static files (see httpd_register_static)
+#
+# Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http:#www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+from __future__ import print_function, division
+import argparse
+import gzip
+import hashlib
+import io
+import mimetypes
+import os
+import struct
+import sys
+
+__version__ = '1.0'
+
+# Must match src/httpd_static.c
+IMAGE_MAGIC = 0x46535448  # "HTSF"
+IMAGE_VERSION = 1
+HEADER_FORMAT = '<IHH8x'
+ENTRY_FORMAT = '<IIHHIIIII8s'
+TYPE_MAX_LEN = 63
+
+# Files which don't get smaller when compressed
+UNCOMPRESSED_TYPES = ('image/png', 'image/jpeg', 'image/gif', 'font/woff', 'font/woff2')
+
+quiet = False
+
+
+def status(msg):
+    if not quiet:
+        print(msg)
+
+
+def critical(msg):
+    sys.stderr.write(msg)
+    sys.stderr.write('\n')
+
+
+class InputError(RuntimeError):
+    def __init__(self, e):
+        super(InputError, self).__init__(e)
+
+
+def fnv1a(data):
+    h = 2166136261
+    for b in bytearray(data):
+        h = ((h ^ b) * 16777619) & 0xffffffff
+    return h
+
+
+def compress(data):
+    # Fixed mtime, so that the image only changes with the files
+    out = io.BytesIO()
+    with gzip.GzipFile(fileobj=out, mode='wb', compresslevel=9, mtime=0) as f:
+        f.write(data)
+    return out.getvalue()
+
+
+class StaticFile(object):
+    def __init__(self, path, data, content_type, gz):
+        self.path = path
+        self.data = data
+        self.content_type = content_type
+        self.gz = gz
+        self.etag = hashlib.sha1(data).digest()[:8]
+
+
+def collect_files(input_dir, index, use_gzip, gzip_min_size):
+    files = []
+    for root, dirs, names in os.walk(input_dir):
+        dirs.sort()
+        for name in sorted(names):
+            full = os.path.join(root, name)
+            rel = os.path.relpath(full, input_dir).replace(os.sep, '/')
+            # Precompressed variants are picked up with their file
+            if name.endswith('.gz') and os.path.exists(full[:-3]):
+                continue
+            with open(full, 'rb') as f:
+                data = f.read()
+
+            content_type = mimetypes.guess_type(name)[0] or 'application/octet-stream'
+            if content_type.startswith('text/') or content_type in ('application/javascript', 'application/json'):
+                content_type += '; charset=utf-8'
+            if len(content_type) > TYPE_MAX_LEN:
+                raise InputError('Content type of %s is too long' % rel)
+
+            gz = None
+            if os.path.exists(full + '.gz'):
+                with open(full + '.gz', 'rb') as f:
+                    gz = f.read()
+            elif use_gzip and len(data) >= gzip_min_size and content_type not in UNCOMPRESSED_TYPES:
+                gz = compress(data)
+                if len(gz) >= len(data):
+                    gz = None
+
+            path = '/' + rel
+            files.append(StaticFile(path, data, content_type, gz))
+            if name == index:
+                # Directories are served with their index file
+                files.append(StaticFile(path[:-len(index)], data, content_type, gz))
+    return files
+
+
+def align(offset):
+    return (offset + 3) & ~3
+
+
+def generate_image(files):
+    entries_size = struct.calcsize(HEADER_FORMAT) + len(files) * struct.calcsize(ENTRY_FORMAT)
+
+    # Strings follow the entries, contents follow the strings. Identical contents,
+    # such as the index file of a directory, are stored once
+    strings = bytearray()
+    string_offs = {}
+
+    def add_string(s):
+        s = s.encode('utf-8')
+        if s not in string_offs:
+            string_offs[s] = entries_size + len(strings)
+            strings.extend(s)
+        return string_offs[s], len(s)
+
+    for f in files:
+        f.path_off, f.path_len = add_string(f.path)
+        f.type_off, f.type_len = add_string(f.content_type)
+
+    contents = bytearray()
+    content_offs = {}
+    contents_start = align(entries_size + len(strings))
+
+    def add_content(data):
+        key = hashlib.sha1(data).digest()
+        if key not in content_offs:
+            contents.extend(b'\x00' * (align(len(contents)) - len(contents)))
+            content_offs[key] = contents_start + len(contents)
+            contents.extend(data)
+        return content_offs[key]
+
+    for f in files:
+        f.data_off = add_content(f.data)
+        f.gz_off = add_content(f.gz) if f.gz else 0
+
+    files = sorted(files, key=lambda f: (fnv1a(f.path.encode('utf-8')), f.path))
+
+    image = bytearray(struct.pack(HEADER_FORMAT, IMAGE_MAGIC, IMAGE_VERSION, len(files)))
+    for f in files:
+        image += struct.pack(ENTRY_FORMAT, fnv1a(f.path.encode('utf-8')), f.path_off, f.path_len, f.type_len,
+                             f.type_off, f.data_off, len(f.data), f.gz_off, len(f.gz) if f.gz else 0, f.etag)
+    image += strings
+    image += b'\x00' * (contents_start - len(image))
+    image += contents
+    return image
+
+
+def main():
+    global quiet
+
+    parser = argparse.ArgumentParser(description='ESP HTTP Server static files image generator utility',
+                                     prog='httpd_static_gen')
+    parser.add_argument('input_dir', help='Directory with the files to serve')
+    parser.add_argument('output', help='Path of the image to create')
+    parser.add_argument('--size', help='Size of the partition, the image is padded to it', type=lambda x: int(x, 0))
+    parser.add_argument('--index', help='Name of the file served for a directory', default='index.html')
+    parser.add_argument('--no-gzip', help='Do not compress files, precompressed .gz files are still used',
+                        action='store_true')
+    parser.add_argument('--gzip-min-size', help='Smallest file to compress', type=int, default=256)
+    parser.add_argument('--quiet', '-q', help='Do not print non-critical status messages', action='store_true')
+    args = parser.parse_args()
+
+    quiet = args.quiet
+
+    if not os.path.isdir(args.input_dir):
+        raise InputError('%s is not a directory' % args.input_dir)
+
+    files = collect_files(args.input_dir, args.index, not args.no_gzip, args.gzip_min_size)
+    if len(files) > 0xffff:
+        raise InputError('Too many files (%d)' % len(files))
+
+    image = generate_image(files)
+    if args.size:
+        if len(image) > args.size:
+            raise InputError('Image size 0x%x exceeds partition size 0x%x' % (len(image), args.size))
+        image += b'\xff' * (args.size - len(image))
+
+    with open(args.output, 'wb') as f:
+        f.write(image)
+
+    status('%d entries, image %d bytes' % (len(files), len(image)))
+
+
+if __name__ == '__main__':
+    try:
+        main()
+    except InputError as e:
+        critical(str(e))
+        sys.exit(2)
@@ -49,6 +49,8 @@ initializer that should be kept in sync
         .global_transport_ctx_free_fn = NULL,           \
         .open_fn = NULL,                                \
         .close_fn = NULL,                               \
+        .worker_count = 0,                              \
+        .worker_stack_size = 4096,                      \
 }
 
 #define ESP_ERR_HTTPD_BASE              (0x8000)                    /*!< Starting number of HTTPD error codes */
@@ -195,6 +197,19 @@ typedef struct httpd_config {
      * was closed by the network stack - that is, the file descriptor may not be valid anymore.
      */
     httpd_close_func_t close_fn;
+
+    /**
+     * Number of worker tasks which serve requests.
+     *
+     * By default (0) all requests are served by the server task, so a slow URI handler
+     * delays every other session. With workers, the server task keeps accepting and
+     * waiting for sessions, and hands a session with an incoming request to a free
+     * worker, which serves it with its own request data. A session is served by one
+     * worker at a time, but handlers for different sessions run concurrently, so data
+     * they share must be protected. Workers run with task_priority.
+     */
+    uint16_t    worker_count;
+    size_t      worker_stack_size;  /*!< The maximum stack size allowed for each worker task */
 } httpd_config_t;
 
 /**
@@ -330,7 +345,8 @@ typedef struct httpd_req {
  * @brief Structure for URI handler
  */
 typedef struct httpd_uri {
-    const char       *uri;    /*!< The URI to handle */
+    const char       *uri;    /*!< The URI to handle, segments like {name} match any
+                                   non-empty segment of a request URI */
     httpd_method_t    method; /*!< Method supported by the URI */
 
     /**
@@ -343,6 +359,24 @@ typedef struct httpd_uri {
      * Pointer to user context data which will be available to handler
      */
     void *user_ctx;
+
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+    /**
+     * Flag for indicating a WebSocket endpoint.
+     * If this flag is true, then method must be HTTP_GET. Otherwise the handshake will not be handled.
+     *
+     * The handler is invoked once with req->method HTTP_GET after the handshake is done,
+     * and then for every data frame received on the session, which it reads with
+     * httpd_ws_recv_frame(). PING frames are answered and CLOSE frames close the session.
+     */
+    bool is_websocket;
+
+    /**
+     * Flag indicating that control frames (PING, PONG, CLOSE) are also passed to the handler.
+     * This is used if a custom processing of the control frames is needed
+     */
+    bool handle_ws_control_frames;
+#endif
 } httpd_uri_t;
 
 /**
@@ -351,6 +385,12 @@ typedef struct httpd_uri {
  * @note    URI handlers can be registered in real time as long as the
  *          server handle is valid.
  *
+ * A segment of the URI of the form {name} matches any non-empty segment of
+ * a request URI, which the handler gets with httpd_req_get_uri_param(). A
+ * static segment is preferred over it when both match. Requests are routed
+ * through a tree which is updated on registration, so routing takes time
+ * linear with the length of the request URI whatever the count of handlers.
+ *
  * Example usage:
  * @code{c}
  *
@@ -392,7 +432,9 @@ typedef struct httpd_uri {
  *
  * @return
  *  - ESP_OK : On successfully registering the handler
- *  - ESP_ERR_INVALID_ARG : Null arguments
+ *  - ESP_ERR_INVALID_ARG : Null arguments, or {name} not taking up a whole segment of
+ *                          the URI, or more than 4 of them
+ *  - ESP_ERR_HTTPD_ALLOC_MEM : Failed to allocate memory
  *  - ESP_ERR_HTTPD_HANDLERS_FULL  : If no slots left for new handler
  *  - ESP_ERR_HTTPD_HANDLER_EXISTS : If handler with same URI and
  *                                   method is already registered
@@ -744,6 +786,32 @@ esp_err_t httpd_req_get_url_query_str(httpd_req_t *r, char *buf, size_t buf_len)
  */
 esp_err_t httpd_query_key_value(const char *qry, const char *key, char *val, size_t val_size);
 
+/**
+ * @brief   Get the value of a {name} segment of the registered URI
+ *          from the URI of the request
+ *
+ * For a handler registered for "/api/dev/{id}/cfg", a request for
+ * "/api/dev/12/cfg" gives "12" for "id".
+ *
+ * @note
+ *  - The value is not URLdecoded.
+ *  - If actual value size is greater than val_size, then the value is truncated,
+ *    accompanied by truncation error as return value.
+ *
+ * @param[in]  r         The request being responded to
+ * @param[in]  name      Name of the segment, without the braces
+ * @param[out] val       Pointer to the buffer into which the value will be copied if found
+ * @param[in]  val_size  Size of the user buffer "val"
+ *
+ * @return
+ *  - ESP_OK : Segment is found and copied to buffer
+ *  - ESP_ERR_NOT_FOUND          : Segment not found in the registered URI
+ *  - ESP_ERR_INVALID_ARG        : Null arguments
+ *  - ESP_ERR_HTTPD_INVALID_REQ  : Invalid HTTP request pointer
+ *  - ESP_ERR_HTTPD_RESULT_TRUNC : Value string truncated
+ */
+esp_err_t httpd_req_get_uri_param(httpd_req_t *r, const char *name, char *val, size_t val_size);
+
 /**
  * @brief   API to send a complete HTTP response.
  *
@@ -1181,6 +1249,211 @@ esp_err_t httpd_queue_work(httpd_handle_t handle, httpd_work_fn_t work, void *ar
  * @}
  */
 
+/* ************** Group: WebSocket ************** */
+/** @name WebSocket
+ * Functions and structs for WebSocket server
+ * @{
+ */
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+/**
+ * @brief Enum for WebSocket packet types (Opcode in the header)
+ * @note Please refer to RFC6455 Section 5.4 for more details
+ */
+typedef enum {
+    HTTPD_WS_TYPE_CONTINUE   = 0x0,
+    HTTPD_WS_TYPE_TEXT       = 0x1,
+    HTTPD_WS_TYPE_BINARY     = 0x2,
+    HTTPD_WS_TYPE_CLOSE      = 0x8,
+    HTTPD_WS_TYPE_PING       = 0x9,
+    HTTPD_WS_TYPE_PONG       = 0xA
+} httpd_ws_type_t;
+
+/**
+ * @brief Enum for client info description
+ */
+typedef enum {
+    HTTPD_WS_CLIENT_INVALID        = 0x0,
+    HTTPD_WS_CLIENT_HTTP           = 0x1,
+    HTTPD_WS_CLIENT_WEBSOCKET      = 0x2,
+} httpd_ws_client_info_t;
+
+/**
+ * @brief WebSocket frame format
+ */
+typedef struct httpd_ws_frame {
+    bool final;                 /*!< Final frame:
+                                     For received frames this field indicates whether the `FIN` flag was set.
+                                     For frames to be transmitted, this field is only used if the `fragmented`
+                                         option is set as well. If `fragmented` is false, the `FIN` flag is set
+                                         by default, marking the ws_frame as a complete/unfragmented message
+                                         (esp_http_server doesn't automatically fragment messages) */
+    bool fragmented;            /*!< Indication that the frame allocated for transmission is a message fragment,
+                                     so the `FIN` flag is set manually according to the `final` option.
+                                     This flag is never set for received messages */
+    httpd_ws_type_t type;       /*!< WebSocket frame type */
+    uint8_t *payload;           /*!< Pre-allocated data buffer */
+    size_t len;                 /*!< Length of the WebSocket data */
+} httpd_ws_frame_t;
+
+/**
+ * @brief Receive and parse a WebSocket frame
+ *
+ * The frame header has already been received by the server when the handler of the
+ * WebSocket URI is invoked, so this only receives (and unmasks) the payload. Payload
+ * which is larger than max_len can be received with further calls, payload which is
+ * not received by the handler is discarded when it returns.
+ *
+ * Fragmented messages are passed to the handler frame by frame: the first frame has
+ * type TEXT or BINARY and the following ones CONTINUE, `final` is set for the last one.
+ *
+ * @note    Calling httpd_ws_recv_frame() with max_len as 0 will give actual frame size in pkt->len.
+ *          The user can dynamically allocate space for pkt->payload as per this length and
+ *          call httpd_ws_recv_frame() again to get the actual data.
+ *
+ * @param[in]       req         Current request
+ * @param[in,out]   pkt         WebSocket packet
+ * @param[in]       max_len     Maximum length for receive
+ * @return
+ *  - ESP_OK                    : On successful
+ *  - ESP_FAIL                  : Socket errors occurs
+ *  - ESP_ERR_INVALID_STATE     : Handshake was not done beforehand
+ *  - ESP_ERR_INVALID_ARG       : Argument is invalid (null or non-WebSocket)
+ */
+esp_err_t httpd_ws_recv_frame(httpd_req_t *req, httpd_ws_frame_t *pkt, size_t max_len);
+
+/**
+ * @brief Construct and send a WebSocket frame
+ * @param[in]   req     Current request
+ * @param[in]   pkt     WebSocket frame
+ * @return
+ *  - ESP_OK                    : On successful
+ *  - ESP_FAIL                  : When socket errors occurs
+ *  - ESP_ERR_INVALID_STATE     : Handshake was not done beforehand
+ *  - ESP_ERR_INVALID_ARG       : Argument is invalid (null or non-WebSocket)
+ */
+esp_err_t httpd_ws_send_frame(httpd_req_t *req, httpd_ws_frame_t *pkt);
+
+/**
+ * @brief Send a WebSocket frame to a session outside of a request handler
+ *
+ * The frame is sent directly on the socket, so this must be called in the context
+ * of the server task, typically from a work function queued with httpd_queue_work().
+ * This is how other tasks push data to WebSocket clients:
+ *
+ * @code{c}
+ *
+ * static void ws_push(void *arg)
+ * {
+ *     struct telemetry *t = arg;
+ *     httpd_ws_frame_t frame = {
+ *         .type    = HTTPD_WS_TYPE_BINARY,
+ *         .payload = t->data,
+ *         .len     = t->len
+ *     };
+ *     httpd_ws_send_frame_async(t->hd, t->fd, &frame);
+ *     free(t);
+ * }
+ *
+ * // From any task
+ * httpd_queue_work(hd, ws_push, t);
+ *
+ * @endcode
+ *
+ * @param[in] hd      Server instance data
+ * @param[in] fd      Socket descriptor for sending data
+ * @param[in] frame   WebSocket frame
+ * @return
+ *  - ESP_OK                    : On successful
+ *  - ESP_FAIL                  : When socket errors occurs
+ *  - ESP_ERR_INVALID_STATE     : Handshake was not done beforehand
+ *  - ESP_ERR_INVALID_ARG       : Argument is invalid (null or non-WebSocket)
+ */
+esp_err_t httpd_ws_send_frame_async(httpd_handle_t hd, int fd, httpd_ws_frame_t *frame);
+
+/**
+ * @brief Checks the supplied socket descriptor if it belongs to any active client
+ * of this server instance and if the WebSocket protocol is active
+ *
+ * @param[in] hd      Server instance data
+ * @param[in] fd      Socket descriptor
+ * @return
+ *  - HTTPD_WS_CLIENT_INVALID   : This fd is not a client of this httpd
+ *  - HTTPD_WS_CLIENT_HTTP      : This fd is an active client, protocol is not WS
+ *  - HTTPD_WS_CLIENT_WEBSOCKET : This fd is an active client, protocol is WS
+ */
+httpd_ws_client_info_t httpd_ws_get_fd_info(httpd_handle_t hd, int fd);
+
+#endif /* CONFIG_HTTPD_WS_SUPPORT */
+/** End of WebSocket related stuff
+ * @}
+ */
+
+/* ************** Group: Static Files ************** */
+/** @name Static Files
+ * Serving static content from a partition
+ * @{
+ */
+#ifdef CONFIG_HTTPD_STATIC_SUPPORT
+/**
+ * @brief Configuration for serving static files
+ */
+typedef struct httpd_static_config {
+    const char *partition_label;    /*!< Label of the data partition with subtype esphttpd holding the files,
+                                         NULL for the first such partition. The partition image is created
+                                         from a directory by httpd_static_gen.py */
+    const char *cache_control;      /*!< Value of the Cache-Control header sent with the files, NULL to send none.
+                                         The string must remain valid until the files are unregistered */
+} httpd_static_config_t;
+
+/**
+ * @brief Serve GET requests for which no URI handler is registered from a partition
+ *
+ * The files are looked up by their path in the hashed index of the partition, so
+ * URI handlers registered by the application take precedence over them. Each file
+ * carries a hash of its content computed when the image was created, which is sent
+ * as ETag, so that a request with a matching If-None-Match header is answered with
+ * 304 Not Modified. If the image holds a gzip variant of a file and the client
+ * accepts gzip encoding, that variant is sent instead, with "-gz" appended to
+ * its ETag.
+ *
+ * @note    When CONFIG_ENABLE_FLASH_MMAP is set, the partition is mapped once on
+ *          registration and files are sent directly out of the mapping. Otherwise,
+ *          or if the partition can't be mapped, they are read from flash into the
+ *          scratch buffer of the request while being sent.
+ *
+ * @param[in] handle    Handle to server returned by httpd_start
+ * @param[in] config    Configuration for serving the files
+ *
+ * @return
+ *  - ESP_OK                : On successfully registering the files
+ *  - ESP_ERR_INVALID_ARG   : Null arguments
+ *  - ESP_ERR_NOT_FOUND     : Partition not found
+ *  - ESP_ERR_INVALID_STATE : Partition doesn't hold a valid image
+ *  - ESP_ERR_HTTPD_HANDLER_EXISTS : Files are already registered
+ *  - ESP_ERR_HTTPD_ALLOC_MEM : Failed to allocate memory
+ */
+esp_err_t httpd_register_static(httpd_handle_t handle, const httpd_static_config_t *config);
+
+/**
+ * @brief Stop serving static files from a partition
+ *
+ * @note    Requests already being served by workers are completed, the partition
+ *          is unmapped once the last of them is done.
+ *
+ * @param[in] handle    Handle to server returned by httpd_start
+ *
+ * @return
+ *  - ESP_OK                : On successfully unregistering the files
+ *  - ESP_ERR_INVALID_ARG   : Null arguments
+ *  - ESP_ERR_NOT_FOUND     : No files are registered
+ */
+esp_err_t httpd_unregister_static(httpd_handle_t handle);
+
+#endif /* CONFIG_HTTPD_STATIC_SUPPORT */
+/** End of Static Files
+ * @}
+ */
+
 #ifdef __cplusplus
 }
 #endif
@@ -41,6 +41,9 @@ extern "C" {
 /* Formats a log string to prepend context function name */
 #define LOG_FMT(x)      "%s: " x, __func__
 
+/* Maximum number of {param} segments in a registered URI */
+#define HTTPD_MAX_URI_PARAMS    4
+
 /**
  * @brief Thread related data for internal use
  */
@@ -112,6 +115,9 @@ typedef enum {
     HTTPD_XXX_UPGRADE_NOT_SUPPORTED
 } httpd_err_resp_t;
 
+struct httpd_worker;
+struct httpd_uri_node;
+
 /**
  * @brief A database of all the open sockets in the system.
  */
@@ -128,6 +134,14 @@ struct sock_db {
     uint64_t lru_counter;                   /*!< LRU Counter indicating when the socket was last used */
     char pending_data[PARSER_BLOCK_SIZE];   /*!< Buffer for pending data to be received */
     size_t pending_len;                     /*!< Length of pending data to be received */
+    struct httpd_worker *worker;            /*!< Worker which owns this session while serving it, NULL if none */
+    bool close_pending;                     /*!< Session is to be closed once the worker is done with it */
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+    bool ws_handshake_done;                 /*!< True if it has done WebSocket handshake (if this socket is a valid WS) */
+    esp_err_t (*ws_handler)(httpd_req_t *r); /*!< WebSocket handler, leave to null if it's not WebSocket */
+    bool ws_control_frames;                 /*!< WebSocket flag indicating that control frames should be passed to user handlers */
+    void *ws_user_ctx;                      /*!< Pointer to user context data which will be available to handler for websocket*/
+#endif
 };
 
 /**
@@ -148,6 +162,32 @@ struct httpd_req_aux {
         const char *value;
     } *resp_hdrs;                                   /*!< Additional headers in response packet */
     struct http_parser_url url_parse_res;           /*!< URL parsing result, used for retrieving URL elements */
+    const httpd_uri_t *uri_handler;                 /*!< Handler which the URI was routed to */
+    struct uri_param {
+        uint16_t off;
+        uint16_t len;
+    } uri_params[HTTPD_MAX_URI_PARAMS];             /*!< Position of the {param} segments in the URI */
+    unsigned        uri_params_count;               /*!< Count of {param} segments in the URI */
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+    bool ws_handshake_detect;                       /*!< WebSocket handshake detection flag */
+    httpd_ws_type_t ws_type;                        /*!< WebSocket frame type */
+    bool ws_final;                                  /*!< WebSocket FIN bit (final frame or not) */
+    uint8_t mask_key[4];                            /*!< WebSocket mask key for this payload */
+    size_t ws_payload_len;                          /*!< WebSocket payload length of this frame */
+#endif
+};
+
+/**
+ * @brief   Worker task, which serves a session handed over by the server
+ *          task with its own request data
+ */
+struct httpd_worker {
+    struct httpd_data *hd;                  /*!< Server instance */
+    struct thread_data td;                  /*!< Information for the worker task */
+    struct sock_db *sd;                     /*!< Session being served, NULL if the worker is free */
+    esp_err_t ret;                          /*!< Result of serving the session */
+    struct httpd_req req;                   /*!< The request served by this worker */
+    struct httpd_req_aux aux;               /*!< Additional data about the request kept unexposed */
 };
 
 /**
@@ -162,8 +202,13 @@ struct httpd_data {
     struct thread_data hd_td;               /*!< Information for the HTTPd thread */
     struct sock_db *hd_sd;                  /*!< The socket database */
     httpd_uri_t **hd_calls;                 /*!< Registered URI handlers */
+    struct httpd_uri_node *hd_routes;       /*!< Tree of the registered URIs for routing requests */
     struct httpd_req hd_req;                /*!< The current HTTPD request */
     struct httpd_req_aux hd_req_aux;        /*!< Additional data about the HTTPD request kept unexposed */
+    struct httpd_worker *hd_workers;        /*!< Worker tasks, NULL if requests are served by the server task */
+#ifdef CONFIG_HTTPD_STATIC_SUPPORT
+    struct httpd_static *hd_static;         /*!< Static files served for unregistered URIs, NULL if none */
+#endif
 };
 
 /******************* Group : Session Management ********************/
@@ -221,6 +266,20 @@ esp_err_t httpd_sess_new(struct httpd_data *hd, int newfd);
  */
 esp_err_t httpd_sess_process(struct httpd_data *hd, int clifd);
 
+/**
+ * @brief   Serves one request on a session with the given request data
+ *
+ * @param[in] hd    Server instance data
+ * @param[in] r     Request to be filled from the session
+ * @param[in] ra    Additional data of the request
+ * @param[in] sd    Session from which the request is received
+ *
+ * @return
+ *  - ESP_OK    : on successfully receiving, parsing and responding to a request
+ *  - ESP_FAIL  : in case of failure in any of the stages of processing
+ */
+esp_err_t httpd_sess_serve(struct httpd_data *hd, httpd_req_t *r, struct httpd_req_aux *ra, struct sock_db *sd);
+
 /**
  * @brief   Remove client descriptor from the session / socket database
  *          and close the connection for this client.
@@ -324,23 +383,101 @@ esp_err_t httpd_sess_close_lru(struct httpd_data *hd);
  * @}
  */
 
+/****************** Group : Workers ********************/
+/** @name Workers
+ * Functions related to worker tasks
+ * @{
+ */
+
+/**
+ * @brief   Launches the worker tasks of a server instance
+ *
+ * @param[in] hd    Server instance data
+ *
+ * @return
+ *  - ESP_OK             : if all workers were launched
+ *  - ESP_ERR_HTTPD_TASK : if a worker could not be launched, no worker is left running then
+ */
+esp_err_t httpd_workers_start(struct httpd_data *hd);
+
+/**
+ * @brief   Stops the worker tasks of a server instance, waiting for
+ *          the requests which are being served to finish
+ *
+ * @param[in] hd    Server instance data
+ */
+void httpd_workers_stop(struct httpd_data *hd);
+
+/**
+ * @brief   Checks if a worker is free to serve a session
+ *
+ * @param[in] hd    Server instance data
+ *
+ * @return
+ *  - true  : if a worker is free
+ *  - false : otherwise
+ */
+bool httpd_worker_available(struct httpd_data *hd);
+
+/**
+ * @brief   Hands over a session to a free worker
+ *
+ * The session is owned by the worker until it is handed back to the
+ * server task, which then closes it if serving the request failed.
+ *
+ * @param[in] hd    Server instance data
+ * @param[in] sd    Session with an incoming request
+ *
+ * @return
+ *  - ESP_OK            : if a worker took the session
+ *  - ESP_ERR_NOT_FOUND : if no worker is free
+ */
+esp_err_t httpd_worker_dispatch(struct httpd_data *hd, struct sock_db *sd);
+
+/** End of Group : Workers
+ * @}
+ */
+
 /****************** Group : URI Handling ********************/
 /** @name URI Handling
  * Methods for accessing URI handlers
  * @{
  */
 
+/**
+ * @brief   Finds the handler registered for a URI and method by walking the
+ *          tree of registered URIs, so in time linear with the URI length
+ *
+ * Static segments are preferred over {param} segments. The position of the
+ * {param} segments is stored in the request data for httpd_req_get_uri_param().
+ *
+ * @param[in]  hd       Server instance data
+ * @param[in]  ra       Request data for storing the {param} segments
+ * @param[in]  uri      Path of the URI, not NULL terminated
+ * @param[in]  uri_len  Length of the path
+ * @param[in]  method   Method of the request
+ * @param[out] err      HTTPD_404_NOT_FOUND or HTTPD_405_METHOD_NOT_ALLOWED if no handler is found
+ *
+ * @return
+ *  - Handler : if found
+ *  - NULL    : otherwise
+ */
+httpd_uri_t *httpd_route_uri(struct httpd_data *hd, struct httpd_req_aux *ra,
+                             const char *uri, size_t uri_len,
+                             httpd_method_t method, httpd_err_resp_t *err);
+
 /**
  * @brief   For an HTTP request, searches through all the registered URI handlers
  *          and invokes the appropriate one if found
  *
  * @param[in] hd  Server instance data for which handler needs to be invoked
+ * @param[in] r   Request for which handler needs to be invoked
  *
  * @return
  *  - ESP_OK    : if handler found and executed successfully
  *  - ESP_FAIL  : otherwise
  */
-esp_err_t httpd_uri(struct httpd_data *hd);
+esp_err_t httpd_uri(struct httpd_data *hd, httpd_req_t *r);
 
 /**
  * @brief   Deregister all URI handlers
@@ -389,25 +526,27 @@ bool httpd_validate_req_ptr(httpd_req_t *r);
  * http_recv() after this reads the body of the request.
  *
  * @param[in] hd  Server instance data
+ * @param[in] r   Request to be filled
+ * @param[in] ra  Additional data of the request
  * @param[in] sd  Pointer to socket which is needed for receiving TCP packets.
  *
  * @return
  *  - ESP_OK    : if request packet is valid
  *  - ESP_FAIL  : otherwise
  */
-esp_err_t httpd_req_new(struct httpd_data *hd, struct sock_db *sd);
+esp_err_t httpd_req_new(struct httpd_data *hd, httpd_req_t *r, struct httpd_req_aux *ra, struct sock_db *sd);
 
 /**
  * @brief   For an HTTP request, resets the resources allocated for it and
  *          purges any data left to be received
  *
- * @param[in] hd  Server instance data
+ * @param[in] r   Request to be deleted
  *
  * @return
  *  - ESP_OK    : if request packet deleted and resources cleaned.
  *  - ESP_FAIL  : otherwise.
  */
-esp_err_t httpd_req_delete(struct httpd_data *hd);
+esp_err_t httpd_req_delete(httpd_req_t *r);
 
 /** End of Group : Parsing
  * @}
@@ -444,6 +583,38 @@ esp_err_t httpd_resp_send_err(httpd_req_t *req, httpd_err_resp_t error);
  */
 int httpd_send(httpd_req_t *req, const char *buf, size_t buf_len);
 
+/**
+ * @brief   Sends all the data in the buffer, unlike httpd_send() which
+ *          may send only a part of it
+ *
+ * @param[in] req     Pointer to the HTTP request for which the data is sent
+ * @param[in] buf     Pointer to the data
+ * @param[in] buf_len Length of the data
+ *
+ * @return
+ *  - ESP_OK    : if all the data was sent
+ *  - ESP_FAIL  : if failed
+ */
+esp_err_t httpd_send_all(httpd_req_t *req, const char *buf, size_t buf_len);
+
+/**
+ * @brief   Sends the status line and headers of a response whose body of
+ *          known length is then sent with httpd_send_all()
+ *
+ * This is httpd_resp_send() without the body, for content which is not
+ * available in a single buffer.
+ *
+ * @param[in] req         Pointer to the HTTP request being responded
+ * @param[in] content_len Length of the body which follows
+ *
+ * @return
+ *  - ESP_OK                    : if the headers were sent
+ *  - ESP_ERR_HTTPD_RESP_HDR    : if essential headers are too large for internal buffer
+ *  - ESP_ERR_HTTPD_RESP_SEND   : if sending failed
+ *  - ESP_ERR_HTTPD_INVALID_REQ : if the request pointer is invalid
+ */
+esp_err_t httpd_resp_send_hdrs(httpd_req_t *req, size_t content_len);
+
 /**
  * @brief   For receiving HTTP request data
  *
@@ -524,6 +695,80 @@ int httpd_default_recv(httpd_handle_t hd, int sockfd, char *buf, size_t buf_len,
  * @}
  */
 
+/* ************** Group: WebSocket ************** */
+/** @name WebSocket
+ * Functions for WebSocket header parsing
+ * @{
+ */
+
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+
+/**
+ * @brief   This function is for responding a WebSocket handshake
+ *
+ * @param[in] req    Pointer to handshake request that will be handled
+ *
+ * @return
+ *  - ESP_OK                        : When handshake is sucessful
+ *  - ESP_ERR_NOT_FOUND             : When some headers (Sec-WebSocket-*) are not found
+ *  - ESP_ERR_INVALID_VERSION       : The WebSocket version is not "13"
+ *  - ESP_ERR_INVALID_STATE         : Handshake was done beforehand
+ *  - ESP_ERR_INVALID_ARG           : Argument is invalid (null or non-WebSocket)
+ *  - ESP_FAIL                      : Socket failures
+ */
+esp_err_t httpd_ws_respond_server_handshake(httpd_req_t *req);
+
+/**
+ * @brief   This function is for receiving the header of a WebSocket frame
+ *
+ * The frame type, FIN bit, payload length and mask key are stored in the request, and the
+ * remaining length of the request is set to the payload length.
+ *
+ * @param[in] req    Pointer to handshake request that will be handled
+ *
+ * @return
+ *  - ESP_OK                  : When the header is received
+ *  - ESP_ERR_INVALID_ARG     : Argument is invalid (null or non-WebSocket)
+ *  - ESP_FAIL                : Socket failures or protocol errors
+ */
+esp_err_t httpd_ws_get_frame_type(httpd_req_t *req);
+
+#endif /* CONFIG_HTTPD_WS_SUPPORT */
+
+/** End of WebSocket related functions
+ * @}
+ */
+
+/* ************** Group: Static Files ************** */
+/** @name Static Files
+ * Functions for serving static files
+ * @{
+ */
+
+#ifdef CONFIG_HTTPD_STATIC_SUPPORT
+
+/**
+ * @brief   Responds to a GET request with the static file at the requested path
+ *
+ * @param[in] hd    Server instance data
+ * @param[in] req   Request for which no URI handler is registered
+ * @param[in] path  Path of the requested URI, not NULL terminated
+ * @param[in] len   Length of the path
+ *
+ * @return
+ *  - ESP_OK            : if the file was sent
+ *  - ESP_ERR_NOT_FOUND : if there is no file at this path or no files are
+ *                        registered, nothing was sent then
+ *  - ESP_FAIL          : if reading or sending the file failed
+ */
+esp_err_t httpd_static_serve(struct httpd_data *hd, httpd_req_t *req, const char *path, size_t len);
+
+#endif /* CONFIG_HTTPD_STATIC_SUPPORT */
+
+/** End of Static Files
+ * @}
+ */
+
 #ifdef __cplusplus
 }
 #endif
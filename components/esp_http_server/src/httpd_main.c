@@ -226,6 +226,11 @@ static void httpd_thread(void *arg)
     }
 
     ESP_LOGD(TAG, LOG_FMT("web server exiting"));
+    if (hd->hd_workers) {
+        /* Let workers finish the requests they are serving before
+         * the sockets are closed under them */
+        httpd_workers_stop(hd);
+    }
     close(hd->msg_fd);
     cs_free_ctrl_sock(hd->ctrl_fd);
     httpd_close_all_sessions(hd);
@@ -329,6 +334,25 @@ static struct httpd_data *httpd_create(const httpd_config_t *config)
     return hd;
 }
 
+static esp_err_t httpd_create_workers(struct httpd_data *hd)
+{
+    if (hd->config.worker_count == 0) {
+        return ESP_OK;
+    }
+    hd->hd_workers = calloc(hd->config.worker_count, sizeof(struct httpd_worker));
+    if (hd->hd_workers == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    for (int i = 0; i < hd->config.worker_count; i++) {
+        struct httpd_req_aux *ra = &hd->hd_workers[i].aux;
+        ra->resp_hdrs = calloc(hd->config.max_resp_headers, sizeof(struct resp_hdr));
+        if (ra->resp_hdrs == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    return ESP_OK;
+}
+
 static void httpd_delete(struct httpd_data *hd)
 {
     struct httpd_req_aux *ra = &hd->hd_req_aux;
@@ -336,8 +360,18 @@ static void httpd_delete(struct httpd_data *hd)
     free(ra->resp_hdrs);
     free(hd->hd_sd);
 
+    if (hd->hd_workers) {
+        for (int i = 0; i < hd->config.worker_count; i++) {
+            free(hd->hd_workers[i].aux.resp_hdrs);
+        }
+        free(hd->hd_workers);
+    }
+
     /* Free registered URI handlers */
     httpd_unregister_all_uri_handlers(hd);
+#ifdef CONFIG_HTTPD_STATIC_SUPPORT
+    httpd_unregister_static(hd);
+#endif
     free(hd->hd_calls);
     free(hd);
 }
@@ -354,17 +388,30 @@ esp_err_t httpd_start(httpd_handle_t *handle, const httpd_config_t *config)
         return ESP_ERR_HTTPD_ALLOC_MEM;
     }
 
+    if (httpd_create_workers(hd) != ESP_OK) {
+        ESP_LOGE(TAG, LOG_FMT("failed to allocate workers"));
+        httpd_delete(hd);
+        return ESP_ERR_HTTPD_ALLOC_MEM;
+    }
+
     if (httpd_server_init(hd) != ESP_OK) {
         httpd_delete(hd);
         return ESP_FAIL;
     }
 
     httpd_sess_init(hd);
+    if (hd->hd_workers && httpd_workers_start(hd) != ESP_OK) {
+        httpd_delete(hd);
+        return ESP_ERR_HTTPD_TASK;
+    }
     if (httpd_os_thread_create(&hd->hd_td.handle, "httpd",
                                hd->config.stack_size,
                                hd->config.task_priority,
                                httpd_thread, hd) != ESP_OK) {
         /* Failed to launch task */
+        if (hd->hd_workers) {
+            httpd_workers_stop(hd);
+        }
         httpd_delete(hd);
         return ESP_ERR_HTTPD_TASK;
     }
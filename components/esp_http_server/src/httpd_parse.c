@@ -299,10 +299,22 @@ static esp_err_t cb_headers_complete(http_parser *parser)
     ESP_LOGD(TAG, LOG_FMT("content length = %zu"), r->content_len);
 
     if (parser->upgrade) {
-        ESP_LOGW(TAG, LOG_FMT("upgrade from HTTP not supported"));
-        parser_data->error = HTTPD_XXX_UPGRADE_NOT_SUPPORTED;
-        parser_data->status = PARSING_FAILED;
-        return ESP_FAIL;
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+        /* Only upgrade to WebSocket is supported, the handshake itself is
+         * done once the URI is known to belong to a WebSocket handler */
+        char ws_upgrade_hdr_val[] = "websocket";
+        if (httpd_req_get_hdr_value_str(r, "Upgrade", ws_upgrade_hdr_val, sizeof(ws_upgrade_hdr_val)) == ESP_OK &&
+            strcasecmp("websocket", ws_upgrade_hdr_val) == 0) {
+            ESP_LOGD(TAG, LOG_FMT("got WebSocket upgrade request"));
+            ra->ws_handshake_detect = true;
+        } else
+#endif
+        {
+            ESP_LOGW(TAG, LOG_FMT("upgrade from HTTP not supported"));
+            parser_data->error = HTTPD_XXX_UPGRADE_NOT_SUPPORTED;
+            parser_data->status = PARSING_FAILED;
+            return ESP_FAIL;
+        }
     }
 
     parser_data->status = PARSING_BODY;
@@ -493,9 +505,8 @@ static void parse_init(httpd_req_t *r, http_parser *parser, parser_data_t *data)
 
 /* Function that receives TCP data and runs parser on it
  */
-static esp_err_t httpd_parse_req(struct httpd_data *hd)
+static esp_err_t httpd_parse_req(struct httpd_data *hd, httpd_req_t *r)
 {
-    httpd_req_t *r = &hd->hd_req;
     int blk_len,  offset;
     http_parser   parser;
     parser_data_t parser_data;
@@ -524,7 +535,7 @@ static esp_err_t httpd_parse_req(struct httpd_data *hd)
     } while (parser_data.status != PARSING_COMPLETE);
 
     ESP_LOGD(TAG, LOG_FMT("parsing complete"));
-    return httpd_uri(hd);
+    return httpd_uri(hd, r);
 }
 
 static void init_req(httpd_req_t *r, httpd_config_t *config)
@@ -550,6 +561,14 @@ static void init_req_aux(struct httpd_req_aux *ra, httpd_config_t *config)
     ra->req_hdrs_count = 0;
     ra->resp_hdrs_count = 0;
     memset(ra->resp_hdrs, 0, config->max_resp_headers * sizeof(struct resp_hdr));
+    ra->uri_handler = NULL;
+    ra->uri_params_count = 0;
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+    ra->ws_handshake_detect = false;
+    ra->ws_type = HTTPD_WS_TYPE_CONTINUE;
+    ra->ws_final = false;
+    ra->ws_payload_len = 0;
+#endif
 }
 
 static void httpd_req_cleanup(httpd_req_t *r)
@@ -573,15 +592,69 @@ static void httpd_req_cleanup(httpd_req_t *r)
 /* Function that processes incoming TCP data and
  * updates the http request data httpd_req_t
  */
-esp_err_t httpd_req_new(struct httpd_data *hd, struct sock_db *sd)
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+/* Function that receives a WebSocket frame header and passes the frame to
+ * the handler of the session. Control frames are answered here, unless the
+ * handler asked for them.
+ */
+static esp_err_t httpd_ws_req_new(httpd_req_t *r, struct sock_db *sd)
+{
+    struct httpd_req_aux *ra = r->aux;
+    esp_err_t ret = ESP_OK;
+
+    r->user_ctx = sd->ws_user_ctx;
+
+    if (httpd_ws_get_frame_type(r) != ESP_OK) {
+        httpd_req_cleanup(r);
+        return ESP_FAIL;
+    }
+
+    if (ra->ws_type < HTTPD_WS_TYPE_CLOSE || sd->ws_control_frames) {
+        ret = sd->ws_handler(r);
+    } else if (ra->ws_type == HTTPD_WS_TYPE_PING) {
+        /* Answer with a PONG carrying the same application data */
+        uint8_t data[125];
+        httpd_ws_frame_t frame = {
+            .type    = HTTPD_WS_TYPE_PONG,
+            .payload = data,
+        };
+        ret = httpd_ws_recv_frame(r, &frame, sizeof(data));
+        if (ret == ESP_OK) {
+            frame.type = HTTPD_WS_TYPE_PONG;
+            ret = httpd_ws_send_frame(r, &frame);
+        }
+    } else if (ra->ws_type == HTTPD_WS_TYPE_CLOSE) {
+        /* Echo the status code, the session is closed below */
+        uint8_t data[2];
+        httpd_ws_frame_t frame = {
+            .payload = data,
+        };
+        if (httpd_ws_recv_frame(r, &frame, sizeof(data)) == ESP_OK) {
+            frame.type = HTTPD_WS_TYPE_CLOSE;
+            httpd_ws_send_frame(r, &frame);
+        }
+    }
+    /* PONG frames are ignored, as this is a server */
+
+    if (ra->ws_type == HTTPD_WS_TYPE_CLOSE) {
+        ESP_LOGD(TAG, LOG_FMT("WebSocket closed by client"));
+        ret = ESP_FAIL;
+    }
+
+    if (ret != ESP_OK) {
+        httpd_req_cleanup(r);
+    }
+    return ret;
+}
+#endif
+
+esp_err_t httpd_req_new(struct httpd_data *hd, httpd_req_t *r, struct httpd_req_aux *ra, struct sock_db *sd)
 {
-    httpd_req_t *r = &hd->hd_req;
     init_req(r, &hd->config);
-    init_req_aux(&hd->hd_req_aux, &hd->config);
+    init_req_aux(ra, &hd->config);
     r->handle = hd;
-    r->aux = &hd->hd_req_aux;
+    r->aux = ra;
     /* Associate the request to the socket */
-    struct httpd_req_aux *ra = r->aux;
     ra->sd = sd;
     /* Set defaults */
     ra->status = (char *)HTTPD_200;
@@ -590,8 +663,14 @@ esp_err_t httpd_req_new(struct httpd_data *hd, struct sock_db *sd)
     /* Copy session info to the request */
     r->sess_ctx = sd->ctx;
     r->free_ctx = sd->free_ctx;
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+    /* A WebSocket session carries frames instead of HTTP requests */
+    if (sd->ws_handshake_done && sd->ws_handler != NULL) {
+        return httpd_ws_req_new(r, sd);
+    }
+#endif
     /* Parse request */
-    esp_err_t err = httpd_parse_req(hd);
+    esp_err_t err = httpd_parse_req(hd, r);
     if (err != ESP_OK) {
         httpd_req_cleanup(r);
     }
@@ -600,9 +679,8 @@ esp_err_t httpd_req_new(struct httpd_data *hd, struct sock_db *sd)
 
 /* Function that resets the http request data
  */
-esp_err_t httpd_req_delete(struct httpd_data *hd)
+esp_err_t httpd_req_delete(httpd_req_t *r)
 {
-    httpd_req_t *r = &hd->hd_req;
     struct httpd_req_aux *ra = r->aux;
 
     /* Finish off reading any pending/leftover data */
@@ -636,9 +714,16 @@ bool httpd_validate_req_ptr(httpd_req_t *r)
         if (hd) {
             /* Check if this function is running in the context of
              * the correct httpd server thread */
-            if (httpd_os_thread_handle() == hd->hd_td.handle) {
+            othread_t thread = httpd_os_thread_handle();
+            if (thread == hd->hd_td.handle) {
                 return true;
             }
+            /* or of one of its workers */
+            for (int i = 0; hd->hd_workers && i < hd->config.worker_count; i++) {
+                if (thread == hd->hd_workers[i].td.handle) {
+                    return true;
+                }
+            }
         }
     }
     return false;
@@ -98,6 +98,18 @@ void httpd_sess_free_ctx(void *ctx, httpd_free_ctx_fn_t free_fn)
     }
 }
 
+/* Returns the request which is being served on a session, if any */
+static httpd_req_t *httpd_sess_get_req(struct httpd_data *hd, struct sock_db *sd)
+{
+    if (hd->hd_req_aux.sd == sd) {
+        return &hd->hd_req;
+    }
+    if (sd->worker && sd->worker->aux.sd == sd) {
+        return &sd->worker->req;
+    }
+    return NULL;
+}
+
 void *httpd_sess_get_ctx(httpd_handle_t handle, int sockfd)
 {
     struct sock_db *sd = httpd_sess_get(handle, sockfd);
@@ -108,9 +120,9 @@ void *httpd_sess_get_ctx(httpd_handle_t handle, int sockfd)
     /* Check if the function has been called from inside a
      * request handler, in which case fetch the context from
      * the httpd_req_t structure */
-    struct httpd_data *hd = (struct httpd_data *) handle;
-    if (hd->hd_req_aux.sd == sd) {
-        return hd->hd_req.sess_ctx;
+    httpd_req_t *r = httpd_sess_get_req((struct httpd_data *) handle, sd);
+    if (r) {
+        return r->sess_ctx;
     }
 
     return sd->ctx;
@@ -126,18 +138,18 @@ void httpd_sess_set_ctx(httpd_handle_t handle, int sockfd, void *ctx, httpd_free
     /* Check if the function has been called from inside a
      * request handler, in which case set the context inside
      * the httpd_req_t structure */
-    struct httpd_data *hd = (struct httpd_data *) handle;
-    if (hd->hd_req_aux.sd == sd) {
-        if (hd->hd_req.sess_ctx != ctx) {
+    httpd_req_t *r = httpd_sess_get_req((struct httpd_data *) handle, sd);
+    if (r) {
+        if (r->sess_ctx != ctx) {
             /* Don't free previous context if it is in sockdb
              * as it will be freed inside httpd_req_cleanup() */
-            if (sd->ctx != hd->hd_req.sess_ctx) {
+            if (sd->ctx != r->sess_ctx) {
                 /* Free previous context */
-                httpd_sess_free_ctx(hd->hd_req.sess_ctx, hd->hd_req.free_ctx);
+                httpd_sess_free_ctx(r->sess_ctx, r->free_ctx);
             }
-            hd->hd_req.sess_ctx = ctx;
+            r->sess_ctx = ctx;
         }
-        hd->hd_req.free_ctx = free_fn;
+        r->free_ctx = free_fn;
         return;
     }
 
@@ -180,8 +192,15 @@ void httpd_sess_set_descriptors(struct httpd_data *hd,
 {
     int i;
     *maxfd = -1;
+
+    /* Sessions are not waited for while no worker is free to serve them,
+     * and sessions owned by a worker are left to it */
+    if (hd->hd_workers && !httpd_worker_available(hd)) {
+        return;
+    }
+
     for (i = 0; i < hd->config.max_open_sockets; i++) {
-        if (hd->hd_sd[i].fd != -1) {
+        if (hd->hd_sd[i].fd != -1 && !hd->hd_sd[i].worker) {
             FD_SET(hd->hd_sd[i].fd, fdset);
             if (hd->hd_sd[i].fd > *maxfd) {
                 *maxfd = hd->hd_sd[i].fd;
@@ -205,7 +224,7 @@ static inline uint64_t httpd_sess_get_lru_counter()
 void httpd_sess_delete_invalid(struct httpd_data *hd)
 {
     for (int i = 0; i < hd->config.max_open_sockets; i++) {
-        if (hd->hd_sd[i].fd != -1 && !fd_is_valid(hd->hd_sd[i].fd)) {
+        if (hd->hd_sd[i].fd != -1 && !hd->hd_sd[i].worker && !fd_is_valid(hd->hd_sd[i].fd)) {
             ESP_LOGW(TAG, LOG_FMT("Closing invalid socket %d"), hd->hd_sd[i].fd);
             httpd_sess_delete(hd, hd->hd_sd[i].fd);
         }
@@ -275,6 +294,11 @@ bool httpd_sess_pending(struct httpd_data *hd, int fd)
         return ESP_FAIL;
     }
 
+    /* The worker which owns the session takes care of pending data */
+    if (sd->worker) {
+        return false;
+    }
+
     if (sd->pending_fn) {
         // test if there's any data to be read (besides read() function, which is handled by select() in the main httpd loop)
         // this should check e.g. for the SSL data buffer
@@ -288,6 +312,20 @@ bool httpd_sess_pending(struct httpd_data *hd, int fd)
  * value is returned, everything related to this socket will be
  * cleaned up and the socket will be closed.
  */
+esp_err_t httpd_sess_serve(struct httpd_data *hd, httpd_req_t *r, struct httpd_req_aux *ra, struct sock_db *sd)
+{
+    ESP_LOGD(TAG, LOG_FMT("httpd_req_new"));
+    if (httpd_req_new(hd, r, ra, sd) != ESP_OK) {
+        return ESP_FAIL;
+    }
+    ESP_LOGD(TAG, LOG_FMT("httpd_req_delete"));
+    if (httpd_req_delete(r) != ESP_OK) {
+        return ESP_FAIL;
+    }
+    ESP_LOGD(TAG, LOG_FMT("success"));
+    return ESP_OK;
+}
+
 esp_err_t httpd_sess_process(struct httpd_data *hd, int newfd)
 {
     struct sock_db *sd = httpd_sess_get(hd, newfd);
@@ -295,15 +333,18 @@ esp_err_t httpd_sess_process(struct httpd_data *hd, int newfd)
         return ESP_FAIL;
     }
 
-    ESP_LOGD(TAG, LOG_FMT("httpd_req_new"));
-    if (httpd_req_new(hd, sd) != ESP_OK) {
-        return ESP_FAIL;
+    if (hd->hd_workers) {
+        /* The worker hands the session back when done. If no worker
+         * is free, the request waits until one finishes */
+        if (!sd->worker) {
+            httpd_worker_dispatch(hd, sd);
+        }
+        return ESP_OK;
     }
-    ESP_LOGD(TAG, LOG_FMT("httpd_req_delete"));
-    if (httpd_req_delete(hd) != ESP_OK) {
+
+    if (httpd_sess_serve(hd, &hd->hd_req, &hd->hd_req_aux, sd) != ESP_OK) {
         return ESP_FAIL;
     }
-    ESP_LOGD(TAG, LOG_FMT("success"));
     sd->lru_counter = httpd_sess_get_lru_counter();
     return ESP_OK;
 }
@@ -339,6 +380,10 @@ esp_err_t httpd_sess_close_lru(struct httpd_data *hd)
         if (hd->hd_sd[i].fd == -1) {
             return ESP_OK;
         }
+        /* Sessions owned by a worker can't be closed now */
+        if (hd->hd_sd[i].worker) {
+            continue;
+        }
         if (hd->hd_sd[i].lru_counter < lru_counter) {
             lru_counter = hd->hd_sd[i].lru_counter;
             lru_fd = hd->hd_sd[i].fd;
@@ -375,6 +420,11 @@ static void httpd_sess_close(void *arg)
 {
     struct sock_db *sock_db = (struct sock_db *)arg;
     if (sock_db) {
+        /* Leave it to the worker which owns the session */
+        if (sock_db->worker) {
+            sock_db->close_pending = true;
+            return;
+        }
         int fd = sock_db->fd;
         struct httpd_data *hd = (struct httpd_data *) sock_db->handle;
         httpd_sess_delete(hd, fd);
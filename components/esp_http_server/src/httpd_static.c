@@ -0,0 +1,403 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/param.h>
+#include <esp_log.h>
+#include <esp_err.h>
+#include <esp_partition.h>
+
+#include <esp_http_server.h>
+#include "esp_httpd_priv.h"
+
+#ifdef CONFIG_HTTPD_STATIC_SUPPORT
+
+static const char *TAG = "httpd_static";
+
+/* Image layout, as created by httpd_static_gen.py (all values little endian):
+ *
+ *  header | entries sorted by hash, then path | paths and content types | contents
+ *
+ * Directories are listed with their index file, so that lookups don't have to
+ * care about them.
+ */
+#define HTTPD_STATIC_MAGIC      0x46535448  /* "HTSF" */
+#define HTTPD_STATIC_VERSION    1
+
+#define HTTPD_STATIC_TYPE_MAX   64          /* Including NULL */
+#define HTTPD_STATIC_CMP_SIZE   32          /* Size of the buffer for comparing paths */
+#define HTTPD_STATIC_GZ_SUFFIX  "-gz"       /* Appended to the ETag of gzip variants */
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;                         /* Number of entries */
+    uint32_t reserved[2];
+} httpd_static_hdr_t;
+
+typedef struct {
+    uint32_t hash;                          /* FNV-1a hash of the path */
+    uint32_t path_off;
+    uint16_t path_len;
+    uint16_t type_len;
+    uint32_t type_off;
+    uint32_t data_off;
+    uint32_t data_len;
+    uint32_t gz_off;
+    uint32_t gz_len;                        /* 0 if there is no gzip variant */
+    uint8_t  etag[8];                       /* Leading bytes of SHA-1 of the content */
+} httpd_static_entry_t;
+
+_Static_assert(sizeof(httpd_static_hdr_t) == 16, "static image header size must be 16 bytes");
+_Static_assert(sizeof(httpd_static_entry_t) == 40, "static image entry size must be 40 bytes");
+
+struct httpd_static {
+    const esp_partition_t *part;
+    const char *cache_control;
+    uint16_t count;
+    uint16_t refs;                          /* Held by the registration and by each request being served */
+#ifdef CONFIG_ENABLE_FLASH_MMAP
+    const uint8_t *base;                    /* Start of the mapped partition, NULL if it is read */
+    spi_flash_mmap_handle_t mmap;
+#endif
+};
+
+/* Workers may still be serving files when the image is unregistered,
+ * the last of them to finish frees it */
+static struct httpd_static *httpd_static_get(struct httpd_data *hd)
+{
+    httpd_os_enter_critical();
+    struct httpd_static *st = hd->hd_static;
+    if (st) {
+        st->refs++;
+    }
+    httpd_os_exit_critical();
+    return st;
+}
+
+static void httpd_static_put(struct httpd_static *st)
+{
+    httpd_os_enter_critical();
+    bool last = (--st->refs == 0);
+    httpd_os_exit_critical();
+
+    if (!last) {
+        return;
+    }
+#ifdef CONFIG_ENABLE_FLASH_MMAP
+    if (st->base) {
+        spi_flash_munmap(st->mmap);
+    }
+#endif
+    free(st);
+}
+
+static esp_err_t httpd_static_read(const struct httpd_static *st, size_t off, void *buf, size_t len)
+{
+#ifdef CONFIG_ENABLE_FLASH_MMAP
+    if (st->base) {
+        memcpy(buf, st->base + off, len);
+        return ESP_OK;
+    }
+#endif
+    return esp_partition_read(st->part, off, buf, len);
+}
+
+static uint32_t httpd_static_hash(const char *path, size_t len)
+{
+    uint32_t hash = 2166136261U;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ (uint8_t) path[i]) * 16777619U;
+    }
+    return hash;
+}
+
+static esp_err_t httpd_static_read_entry(const struct httpd_static *st, size_t index, httpd_static_entry_t *e)
+{
+    return httpd_static_read(st, sizeof(httpd_static_hdr_t) + index * sizeof(*e), e, sizeof(*e));
+}
+
+static bool httpd_static_path_matches(const struct httpd_static *st, const httpd_static_entry_t *e,
+                                      const char *path, size_t len)
+{
+    char buf[HTTPD_STATIC_CMP_SIZE];
+
+    if (e->path_len != len) {
+        return false;
+    }
+    for (size_t off = 0; off < len; off += sizeof(buf)) {
+        size_t n = MIN(sizeof(buf), len - off);
+        if (httpd_static_read(st, e->path_off + off, buf, n) != ESP_OK ||
+            memcmp(buf, path + off, n)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Binary search for the first entry with the hash of the path,
+ * followed by a scan of the entries sharing it */
+static esp_err_t httpd_static_find(const struct httpd_static *st, const char *path, size_t len,
+                                   httpd_static_entry_t *e)
+{
+    uint32_t hash = httpd_static_hash(path, len);
+    size_t lo = 0, hi = st->count;
+
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (httpd_static_read_entry(st, mid, e) != ESP_OK) {
+            return ESP_FAIL;
+        }
+        if (e->hash < hash) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    for (; lo < st->count; lo++) {
+        if (httpd_static_read_entry(st, lo, e) != ESP_OK) {
+            return ESP_FAIL;
+        }
+        if (e->hash != hash) {
+            break;
+        }
+        if (httpd_static_path_matches(st, e, path, len)) {
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+/* Checks for an entity tag in the If-None-Match header */
+static bool httpd_static_etag_matches(httpd_req_t *req, const char *etag)
+{
+    char val[64];
+    esp_err_t ret = httpd_req_get_hdr_value_str(req, "If-None-Match", val, sizeof(val));
+
+    /* Truncated values are checked as far as they go */
+    if (ret != ESP_OK && ret != ESP_ERR_HTTPD_RESULT_TRUNC) {
+        return false;
+    }
+    return strstr(val, etag) != NULL || strcmp(val, "*") == 0;
+}
+
+/* Checks whether Accept-Encoding allows gzip, codings with q=0 are not acceptable */
+static bool httpd_static_accepts_gzip(httpd_req_t *req)
+{
+    char val[64];
+    esp_err_t ret = httpd_req_get_hdr_value_str(req, "Accept-Encoding", val, sizeof(val));
+
+    if (ret != ESP_OK && ret != ESP_ERR_HTTPD_RESULT_TRUNC) {
+        return false;
+    }
+
+    bool any = false;
+    char *save;
+    for (char *coding = strtok_r(val, ",", &save); coding; coding = strtok_r(NULL, ",", &save)) {
+        char *params = strchr(coding, ';');
+        bool acceptable = true;
+        if (params) {
+            *params++ = '\0';
+            char *q = strstr(params, "q=");
+            acceptable = !q || strtod(q + 2, NULL) > 0;
+        }
+
+        coding += strspn(coding, " \t");
+        coding[strcspn(coding, " \t")] = '\0';
+        if (strcasecmp(coding, "gzip") == 0 || strcasecmp(coding, "x-gzip") == 0) {
+            return acceptable;
+        }
+        if (strcmp(coding, "*") == 0) {
+            any = acceptable;
+        }
+    }
+    return any;
+}
+
+static esp_err_t httpd_static_send_body(const struct httpd_static *st, httpd_req_t *req,
+                                        size_t off, size_t len)
+{
+#ifdef CONFIG_ENABLE_FLASH_MMAP
+    /* Large buffers go out without being copied */
+    if (st->base) {
+        return httpd_resp_send(req, (const char *) st->base + off, len);
+    }
+#endif
+
+    esp_err_t ret = httpd_resp_send_hdrs(req, len);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    /* The scratch buffer of the request is free once the headers are sent */
+    struct httpd_req_aux *ra = req->aux;
+    while (len > 0) {
+        size_t n = MIN(len, HTTPD_SCRATCH_BUF);
+        if (esp_partition_read(st->part, off, ra->scratch, n) != ESP_OK) {
+            ESP_LOGE(TAG, LOG_FMT("failed to read 0x%x"), off);
+            return ESP_FAIL;
+        }
+        if (httpd_send_all(req, ra->scratch, n) != ESP_OK) {
+            return ESP_ERR_HTTPD_RESP_SEND;
+        }
+        off += n;
+        len -= n;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t httpd_static_serve_file(const struct httpd_static *st, httpd_req_t *req,
+                                         const char *path, size_t len)
+{
+    httpd_static_entry_t e;
+
+    esp_err_t ret = httpd_static_find(st, path, len, &e);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    char type[HTTPD_STATIC_TYPE_MAX];
+    size_t type_len = MIN(e.type_len, sizeof(type) - 1);
+    if (httpd_static_read(st, e.type_off, type, type_len) != ESP_OK) {
+        return ESP_FAIL;
+    }
+    type[type_len] = '\0';
+
+    /* The request headers are no longer available once sending starts */
+    bool gzip = e.gz_len && httpd_static_accepts_gzip(req);
+
+    /* Quoted as entity tags are, the variants are different representations */
+    char etag[2 * sizeof(e.etag) + sizeof(HTTPD_STATIC_GZ_SUFFIX) + 2];
+    etag[0] = '"';
+    for (int i = 0; i < sizeof(e.etag); i++) {
+        sprintf(&etag[1 + 2 * i], "%02x", e.etag[i]);
+    }
+    strcpy(&etag[1 + 2 * sizeof(e.etag)], gzip ? HTTPD_STATIC_GZ_SUFFIX "\"" : "\"");
+
+    bool not_modified = httpd_static_etag_matches(req, etag);
+
+    httpd_resp_set_hdr(req, "ETag", etag);
+    if (st->cache_control) {
+        httpd_resp_set_hdr(req, "Cache-Control", st->cache_control);
+    }
+    if (e.gz_len) {
+        httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+    }
+
+    if (not_modified) {
+        ESP_LOGD(TAG, LOG_FMT("%s not modified"), req->uri);
+        httpd_resp_set_status(req, "304 Not Modified");
+        /* No body, the length is that of the variant a 200 would send */
+        ret = httpd_resp_send_hdrs(req, gzip ? e.gz_len : e.data_len);
+    } else if (gzip) {
+        ESP_LOGD(TAG, LOG_FMT("%s gzip (%d bytes)"), req->uri, e.gz_len);
+        httpd_resp_set_type(req, type);
+        httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+        ret = httpd_static_send_body(st, req, e.gz_off, e.gz_len);
+    } else {
+        ESP_LOGD(TAG, LOG_FMT("%s (%d bytes)"), req->uri, e.data_len);
+        httpd_resp_set_type(req, type);
+        ret = httpd_static_send_body(st, req, e.data_off, e.data_len);
+    }
+    return (ret == ESP_OK ? ESP_OK : ESP_FAIL);
+}
+
+esp_err_t httpd_static_serve(struct httpd_data *hd, httpd_req_t *req, const char *path, size_t len)
+{
+    struct httpd_static *st = httpd_static_get(hd);
+    if (st == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    esp_err_t ret = httpd_static_serve_file(st, req, path, len);
+    httpd_static_put(st);
+    return ret;
+}
+
+esp_err_t httpd_register_static(httpd_handle_t handle, const httpd_static_config_t *config)
+{
+    if (handle == NULL || config == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    struct httpd_data *hd = (struct httpd_data *) handle;
+    if (hd->hd_static) {
+        return ESP_ERR_HTTPD_HANDLER_EXISTS;
+    }
+
+    const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                                           ESP_PARTITION_SUBTYPE_DATA_ESPHTTPD,
+                                                           config->partition_label);
+    if (part == NULL) {
+        ESP_LOGE(TAG, LOG_FMT("partition not found"));
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    httpd_static_hdr_t hdr;
+    if (esp_partition_read(part, 0, &hdr, sizeof(hdr)) != ESP_OK ||
+        hdr.magic != HTTPD_STATIC_MAGIC || hdr.version != HTTPD_STATIC_VERSION ||
+        sizeof(hdr) + hdr.count * sizeof(httpd_static_entry_t) > part->size) {
+        ESP_LOGE(TAG, LOG_FMT("no valid image in partition %s"), part->label);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    struct httpd_static *st = calloc(1, sizeof(struct httpd_static));
+    if (st == NULL) {
+        return ESP_ERR_HTTPD_ALLOC_MEM;
+    }
+    st->part = part;
+    st->cache_control = config->cache_control;
+    st->count = hdr.count;
+    st->refs = 1;
+
+#ifdef CONFIG_ENABLE_FLASH_MMAP
+    /* Without a mapping, which needs free MMU pages, files are read while being sent */
+    const void *base;
+    if (esp_partition_mmap(part, 0, part->size, SPI_FLASH_MMAP_DATA, &base, &st->mmap) == ESP_OK) {
+        st->base = base;
+    } else {
+        ESP_LOGW(TAG, LOG_FMT("failed to map partition %s, reading it instead"), part->label);
+    }
+#endif
+
+    ESP_LOGI(TAG, LOG_FMT("serving %d files from partition %s"), st->count, part->label);
+    hd->hd_static = st;
+    return ESP_OK;
+}
+
+esp_err_t httpd_unregister_static(httpd_handle_t handle)
+{
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    struct httpd_data *hd = (struct httpd_data *) handle;
+    httpd_os_enter_critical();
+    struct httpd_static *st = hd->hd_static;
+    hd->hd_static = NULL;
+    httpd_os_exit_critical();
+
+    if (st == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    /* Freed now, or once the requests being served finish */
+    httpd_static_put(st);
+    return ESP_OK;
+}
+
+#endif /* CONFIG_HTTPD_STATIC_SUPPORT */
@@ -71,7 +71,7 @@ int httpd_send(httpd_req_t *r, const char *buf, size_t buf_len)
     return ret;
 }
 
-static esp_err_t httpd_send_all(httpd_req_t *r, const char *buf, size_t buf_len)
+esp_err_t httpd_send_all(httpd_req_t *r, const char *buf, size_t buf_len)
 {
     struct httpd_req_aux *ra = r->aux;
     int ret;
@@ -231,68 +231,153 @@ esp_err_t httpd_resp_set_type(httpd_req_t *r, const char *type)
     return ESP_OK;
 }
 
-esp_err_t httpd_resp_send(httpd_req_t *r, const char *buf, ssize_t buf_len)
+/* Response data is collected in the scratch buffer, which holds no request data anymore once
+ * the response is being sent. The buffer is sent when it's full or when the response (chunk)
+ * is complete, so that status line, headers and small content take one send call. */
+static esp_err_t httpd_tx_flush(httpd_req_t *r, size_t *tx_len)
 {
-    if (r == NULL) {
-        return ESP_ERR_INVALID_ARG;
+    struct httpd_req_aux *ra = r->aux;
+    size_t len = *tx_len;
+
+    *tx_len = 0;
+    if (len == 0) {
+        return ESP_OK;
     }
+    return httpd_send_all(r, ra->scratch, len);
+}
 
-    if (!httpd_valid_req(r)) {
-        return ESP_ERR_HTTPD_INVALID_REQ;
+static esp_err_t httpd_tx_append(httpd_req_t *r, size_t *tx_len, const char *buf, size_t buf_len)
+{
+    struct httpd_req_aux *ra = r->aux;
+    size_t room = sizeof(ra->scratch) - *tx_len;
+
+    if (buf_len > room) {
+        /* Fill up the buffer before sending it, so that no small segments are sent */
+        memcpy(ra->scratch + *tx_len, buf, room);
+        *tx_len += room;
+        buf     += room;
+        buf_len -= room;
+        if (httpd_tx_flush(r, tx_len) != ESP_OK) {
+            return ESP_FAIL;
+        }
+        /* Data larger than the buffer is sent without copying */
+        if (buf_len >= sizeof(ra->scratch)) {
+            return httpd_send_all(r, buf, buf_len);
+        }
     }
 
+    memcpy(ra->scratch + *tx_len, buf, buf_len);
+    *tx_len += buf_len;
+    return ESP_OK;
+}
+
+/* Appends additional headers and the end of header section
+ * after the essential headers, which are already in the buffer */
+static esp_err_t httpd_tx_append_hdrs(httpd_req_t *r, size_t *tx_len)
+{
     struct httpd_req_aux *ra = r->aux;
-    const char *httpd_hdr_str = "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %d\r\n";
     const char *colon_separator = ": ";
     const char *cr_lf_seperator = "\r\n";
 
-    if (buf_len == -1) buf_len = strlen(buf);
+    /* Additional headers based on set_header */
+    for (unsigned i = 0; i < ra->resp_hdrs_count; i++) {
+        if (httpd_tx_append(r, tx_len, ra->resp_hdrs[i].field, strlen(ra->resp_hdrs[i].field)) != ESP_OK ||
+            httpd_tx_append(r, tx_len, colon_separator, strlen(colon_separator)) != ESP_OK ||
+            httpd_tx_append(r, tx_len, ra->resp_hdrs[i].value, strlen(ra->resp_hdrs[i].value)) != ESP_OK ||
+            httpd_tx_append(r, tx_len, cr_lf_seperator, strlen(cr_lf_seperator)) != ESP_OK) {
+            return ESP_FAIL;
+        }
+    }
+
+    /* End header section */
+    return httpd_tx_append(r, tx_len, cr_lf_seperator, strlen(cr_lf_seperator));
+}
+
+/* Puts the status line and headers of a response with the given content
+ * length into the scratch buffer, flushing it as needed */
+static esp_err_t httpd_tx_start(httpd_req_t *r, size_t *tx_len, size_t content_len)
+{
+    struct httpd_req_aux *ra = r->aux;
+    const char *httpd_hdr_str = "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %d\r\n";
+    const char *httpd_304_hdr_str = "HTTP/1.1 %s\r\nContent-Length: %d\r\n";
+    int len;
 
     /* Request headers are no longer available */
     ra->req_hdrs_count = 0;
 
+    /* A 304 response only carries the validators of the representation,
+     * its Content-Length is that of the representation */
+    if (strncmp(ra->status, "304", 3) == 0) {
+        len = snprintf(ra->scratch, sizeof(ra->scratch), httpd_304_hdr_str,
+                       ra->status, content_len);
+    } else {
+        len = snprintf(ra->scratch, sizeof(ra->scratch), httpd_hdr_str,
+                       ra->status, ra->content_type, content_len);
+    }
+
     /* Size of essential headers is limited by scratch buffer size */
-    if (snprintf(ra->scratch, sizeof(ra->scratch), httpd_hdr_str,
-                 ra->status, ra->content_type, buf_len) >= sizeof(ra->scratch)) {
+    if (len >= sizeof(ra->scratch)) {
         return ESP_ERR_HTTPD_RESP_HDR;
     }
+    *tx_len = strlen(ra->scratch);
 
-    /* Sending essential headers */
-    if (httpd_send_all(r, ra->scratch, strlen(ra->scratch)) != ESP_OK) {
+    if (httpd_tx_append_hdrs(r, tx_len) != ESP_OK) {
         return ESP_ERR_HTTPD_RESP_SEND;
     }
+    return ESP_OK;
+}
 
-    /* Sending additional headers based on set_header */
-    for (unsigned i = 0; i < ra->resp_hdrs_count; i++) {
-        /* Send header field */
-        if (httpd_send_all(r, ra->resp_hdrs[i].field, strlen(ra->resp_hdrs[i].field)) != ESP_OK) {
-            return ESP_ERR_HTTPD_RESP_SEND;
-        }
-        /* Send ': ' */
-        if (httpd_send_all(r, colon_separator, strlen(colon_separator)) != ESP_OK) {
-            return ESP_ERR_HTTPD_RESP_SEND;
-        }
-        /* Send header value */
-        if (httpd_send_all(r, ra->resp_hdrs[i].value, strlen(ra->resp_hdrs[i].value)) != ESP_OK) {
-            return ESP_ERR_HTTPD_RESP_SEND;
-        }
-        /* Send CR + LF */
-        if (httpd_send_all(r, cr_lf_seperator, strlen(cr_lf_seperator)) != ESP_OK) {
-            return ESP_ERR_HTTPD_RESP_SEND;
-        }
+esp_err_t httpd_resp_send(httpd_req_t *r, const char *buf, ssize_t buf_len)
+{
+    if (r == NULL) {
+        return ESP_ERR_INVALID_ARG;
     }
 
-    /* End header section */
-    if (httpd_send_all(r, cr_lf_seperator, strlen(cr_lf_seperator)) != ESP_OK) {
-        return ESP_ERR_HTTPD_RESP_SEND;
+    if (!httpd_valid_req(r)) {
+        return ESP_ERR_HTTPD_INVALID_REQ;
     }
 
-    /* Sending content */
+    size_t tx_len;
+
+    if (buf_len == -1) buf_len = strlen(buf);
+
+    esp_err_t ret = httpd_tx_start(r, &tx_len, buf_len);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    /* Content */
     if (buf && buf_len) {
-        if (httpd_send_all(r, buf, buf_len) != ESP_OK) {
+        if (httpd_tx_append(r, &tx_len, buf, buf_len) != ESP_OK) {
             return ESP_ERR_HTTPD_RESP_SEND;
         }
     }
+
+    if (httpd_tx_flush(r, &tx_len) != ESP_OK) {
+        return ESP_ERR_HTTPD_RESP_SEND;
+    }
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send_hdrs(httpd_req_t *r, size_t content_len)
+{
+    if (r == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!httpd_valid_req(r)) {
+        return ESP_ERR_HTTPD_INVALID_REQ;
+    }
+
+    size_t tx_len;
+    esp_err_t ret = httpd_tx_start(r, &tx_len, content_len);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    if (httpd_tx_flush(r, &tx_len) != ESP_OK) {
+        return ESP_ERR_HTTPD_RESP_SEND;
+    }
     return ESP_OK;
 }
 
@@ -310,8 +395,7 @@ esp_err_t httpd_resp_send_chunk(httpd_req_t *r, const char *buf, ssize_t buf_len
 
     struct httpd_req_aux *ra = r->aux;
     const char *httpd_chunked_hdr_str = "HTTP/1.1 %s\r\nContent-Type: %s\r\nTransfer-Encoding: chunked\r\n";
-    const char *colon_separator = ": ";
-    const char *cr_lf_seperator = "\r\n";
+    size_t tx_len = 0;
 
     /* Request headers are no longer available */
     ra->req_hdrs_count = 0;
@@ -322,54 +406,30 @@ esp_err_t httpd_resp_send_chunk(httpd_req_t *r, const char *buf, ssize_t buf_len
                      ra->status, ra->content_type) >= sizeof(ra->scratch)) {
             return ESP_ERR_HTTPD_RESP_HDR;
         }
+        tx_len = strlen(ra->scratch);
 
-        /* Sending essential headers */
-        if (httpd_send_all(r, ra->scratch, strlen(ra->scratch)) != ESP_OK) {
-            return ESP_ERR_HTTPD_RESP_SEND;
-        }
-
-        /* Sending additional headers based on set_header */
-        for (unsigned i = 0; i < ra->resp_hdrs_count; i++) {
-            /* Send header field */
-            if (httpd_send_all(r, ra->resp_hdrs[i].field, strlen(ra->resp_hdrs[i].field)) != ESP_OK) {
-                return ESP_ERR_HTTPD_RESP_SEND;
-            }
-            /* Send ': ' */
-            if (httpd_send_all(r, colon_separator, strlen(colon_separator)) != ESP_OK) {
-                return ESP_ERR_HTTPD_RESP_SEND;
-            }
-            /* Send header value */
-            if (httpd_send_all(r, ra->resp_hdrs[i].value, strlen(ra->resp_hdrs[i].value)) != ESP_OK) {
-                return ESP_ERR_HTTPD_RESP_SEND;
-            }
-            /* Send CR + LF */
-            if (httpd_send_all(r, cr_lf_seperator, strlen(cr_lf_seperator)) != ESP_OK) {
-                return ESP_ERR_HTTPD_RESP_SEND;
-            }
-        }
-
-        /* End header section */
-        if (httpd_send_all(r, cr_lf_seperator, strlen(cr_lf_seperator)) != ESP_OK) {
+        if (httpd_tx_append_hdrs(r, &tx_len) != ESP_OK) {
             return ESP_ERR_HTTPD_RESP_SEND;
         }
         ra->first_chunk_sent = true;
     }
 
-    /* Sending chunked content */
+    /* Chunked content */
     char len_str[10];
     snprintf(len_str, sizeof(len_str), "%x\r\n", buf_len);
-    if (httpd_send_all(r, len_str, strlen(len_str)) != ESP_OK) {
+    if (httpd_tx_append(r, &tx_len, len_str, strlen(len_str)) != ESP_OK) {
         return ESP_ERR_HTTPD_RESP_SEND;
     }
 
     if (buf) {
-        if (httpd_send_all(r, buf, (size_t) buf_len) != ESP_OK) {
+        if (httpd_tx_append(r, &tx_len, buf, (size_t) buf_len) != ESP_OK) {
             return ESP_ERR_HTTPD_RESP_SEND;
         }
     }
 
     /* Indicate end of chunk */
-    if (httpd_send_all(r, "\r\n", strlen("\r\n")) != ESP_OK) {
+    if (httpd_tx_append(r, &tx_len, "\r\n", strlen("\r\n")) != ESP_OK ||
+        httpd_tx_flush(r, &tx_len) != ESP_OK) {
         return ESP_ERR_HTTPD_RESP_SEND;
     }
     return ESP_OK;
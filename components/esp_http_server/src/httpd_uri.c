@@ -23,6 +23,261 @@
 
 static const char *TAG = "httpd_uri";
 
+/* Registered URIs are kept in a radix tree for routing requests. Each node
+ * matches either a static part of the path or a whole {param} segment, and
+ * holds the handlers registered for the URI which ends at it. Siblings
+ * differ in their first character, so a request is routed by following a
+ * single path through the tree, apart from trying a {param} child when the
+ * static one doesn't lead to a handler.
+ */
+struct httpd_uri_route {
+    httpd_uri_t *call;
+    struct httpd_uri_route *next;
+};
+
+struct httpd_uri_node {
+    char *prefix;                           /* Static part of the path, NULL for a {param} segment */
+    size_t prefix_len;
+    struct httpd_uri_node *next;            /* Next sibling */
+    struct httpd_uri_node *children;        /* Children matching a static part */
+    struct httpd_uri_node *param;           /* Child matching a {param} segment */
+    struct httpd_uri_route *routes;         /* Handlers of the URI ending here */
+};
+
+/* Checks that {param} segments take up whole segments of the URI */
+static bool httpd_uri_is_valid(const char *uri)
+{
+    unsigned params = 0;
+    for (const char *p = uri; (p = strchr(p, '{')) != NULL; p++) {
+        const char *end = strchr(p, '}');
+        if ((p != uri && p[-1] != '/') || end == NULL || end == p + 1 ||
+            memchr(p + 1, '/', end - p - 1) || memchr(p + 1, '{', end - p - 1) ||
+            (end[1] != '\0' && end[1] != '/') || ++params > HTTPD_MAX_URI_PARAMS) {
+            return false;
+        }
+        p = end;
+    }
+    return true;
+}
+
+static struct httpd_uri_node *httpd_uri_node_new(const char *prefix, size_t len)
+{
+    struct httpd_uri_node *node = calloc(1, sizeof(struct httpd_uri_node));
+    if (node && prefix) {
+        node->prefix = malloc(len + 1);
+        if (node->prefix == NULL) {
+            free(node);
+            return NULL;
+        }
+        memcpy(node->prefix, prefix, len);
+        node->prefix[len] = '\0';
+        node->prefix_len = len;
+    }
+    return node;
+}
+
+static void httpd_uri_node_free(struct httpd_uri_node *node)
+{
+    while (node) {
+        struct httpd_uri_node *next = node->next;
+        httpd_uri_node_free(node->children);
+        httpd_uri_node_free(node->param);
+        while (node->routes) {
+            struct httpd_uri_route *route = node->routes;
+            node->routes = route->next;
+            free(route);
+        }
+        free(node->prefix);
+        free(node);
+        node = next;
+    }
+}
+
+/* Shortens the static part of a node to len characters,
+ * moving the rest of it into a new child */
+static esp_err_t httpd_uri_node_split(struct httpd_uri_node *node, size_t len)
+{
+    struct httpd_uri_node *child = httpd_uri_node_new(node->prefix + len, node->prefix_len - len);
+    if (child == NULL) {
+        return ESP_ERR_HTTPD_ALLOC_MEM;
+    }
+    child->children = node->children;
+    child->param = node->param;
+    child->routes = node->routes;
+    node->children = child;
+    node->param = NULL;
+    node->routes = NULL;
+    node->prefix[len] = '\0';
+    node->prefix_len = len;
+    return ESP_OK;
+}
+
+/* Returns the node at the end of a static part below node, adding nodes if asked to */
+static struct httpd_uri_node *httpd_uri_node_static(struct httpd_uri_node *node,
+                                                    const char *s, size_t len, bool add)
+{
+    while (len > 0) {
+        struct httpd_uri_node *child = node->children;
+        while (child && child->prefix[0] != s[0]) {
+            child = child->next;
+        }
+        if (child == NULL) {
+            if (!add || (child = httpd_uri_node_new(s, len)) == NULL) {
+                return NULL;
+            }
+            child->next = node->children;
+            node->children = child;
+            return child;
+        }
+
+        size_t common = 1;
+        while (common < len && common < child->prefix_len && child->prefix[common] == s[common]) {
+            common++;
+        }
+        if (common < child->prefix_len &&
+            (!add || httpd_uri_node_split(child, common) != ESP_OK)) {
+            return NULL;
+        }
+        node = child;
+        s += common;
+        len -= common;
+    }
+    return node;
+}
+
+/* Returns the node at which a registered URI ends, adding nodes if asked to */
+static struct httpd_uri_node *httpd_uri_node_get(struct httpd_uri_node *node, const char *uri, bool add)
+{
+    while (node && *uri) {
+        if (*uri == '{') {
+            const char *end = strchr(uri, '}');
+            if (end == NULL) {
+                return NULL;
+            }
+            if (node->param == NULL && add) {
+                node->param = httpd_uri_node_new(NULL, 0);
+            }
+            node = node->param;
+            uri = end + 1;
+        } else {
+            size_t len = strcspn(uri, "{");
+            node = httpd_uri_node_static(node, uri, len, add);
+            uri += len;
+        }
+    }
+    return node;
+}
+
+static esp_err_t httpd_uri_route_add(struct httpd_data *hd, httpd_uri_t *call)
+{
+    if (hd->hd_routes == NULL) {
+        hd->hd_routes = httpd_uri_node_new("", 0);
+        if (hd->hd_routes == NULL) {
+            return ESP_ERR_HTTPD_ALLOC_MEM;
+        }
+    }
+
+    struct httpd_uri_node *node = httpd_uri_node_get(hd->hd_routes, call->uri, true);
+    struct httpd_uri_route *route = node ? malloc(sizeof(struct httpd_uri_route)) : NULL;
+    if (route == NULL) {
+        /* Nodes added on the way are left for later registrations */
+        return ESP_ERR_HTTPD_ALLOC_MEM;
+    }
+    route->call = call;
+    route->next = node->routes;
+    node->routes = route;
+    return ESP_OK;
+}
+
+/* Nodes are kept, and reused if the URI is registered again */
+static void httpd_uri_route_remove(struct httpd_data *hd, httpd_uri_t *call)
+{
+    struct httpd_uri_node *node = hd->hd_routes ? httpd_uri_node_get(hd->hd_routes, call->uri, false) : NULL;
+    if (node == NULL) {
+        return;
+    }
+    for (struct httpd_uri_route **route = &node->routes; *route; route = &(*route)->next) {
+        if ((*route)->call == call) {
+            struct httpd_uri_route *found = *route;
+            *route = found->next;
+            free(found);
+            return;
+        }
+    }
+}
+
+/* Recursion is bounded by the depth of the tree, which is given by the registered URIs */
+static httpd_uri_t *httpd_uri_node_match(const struct httpd_uri_node *node, struct httpd_req_aux *ra,
+                                         const char *uri, size_t pos, size_t uri_len, unsigned params,
+                                         httpd_method_t method, httpd_err_resp_t *err)
+{
+    if (node->prefix) {
+        if (uri_len - pos < node->prefix_len ||
+            memcmp(uri + pos, node->prefix, node->prefix_len)) {
+            return NULL;
+        }
+        pos += node->prefix_len;
+    } else {
+        size_t len = 0;
+        while (pos + len < uri_len && uri[pos + len] != '/') {
+            len++;
+        }
+        if (len == 0) {
+            return NULL;
+        }
+        ra->uri_params[params].off = pos;
+        ra->uri_params[params].len = len;
+        params++;
+        pos += len;
+    }
+
+    if (pos == uri_len) {
+        for (const struct httpd_uri_route *route = node->routes; route; route = route->next) {
+            if (route->call->method == method) {
+                ra->uri_params_count = params;
+                return route->call;
+            }
+        }
+        /* URI found but method not allowed. If URI IS
+         * found later then this error is to be neglected */
+        if (node->routes) {
+            *err = HTTPD_405_METHOD_NOT_ALLOWED;
+        }
+        return NULL;
+    }
+
+    for (const struct httpd_uri_node *child = node->children; child; child = child->next) {
+        if (child->prefix[0] == uri[pos]) {
+            httpd_uri_t *call = httpd_uri_node_match(child, ra, uri, pos, uri_len, params, method, err);
+            if (call) {
+                return call;
+            }
+            break;
+        }
+    }
+    if (node->param) {
+        return httpd_uri_node_match(node->param, ra, uri, pos, uri_len, params, method, err);
+    }
+    return NULL;
+}
+
+httpd_uri_t *httpd_route_uri(struct httpd_data *hd, struct httpd_req_aux *ra,
+                             const char *uri, size_t uri_len,
+                             httpd_method_t method, httpd_err_resp_t *err)
+{
+    httpd_uri_t *call = NULL;
+
+    *err = 0;
+    ra->uri_params_count = 0;
+    if (hd->hd_routes) {
+        call = httpd_uri_node_match(hd->hd_routes, ra, uri, 0, uri_len, 0, method, err);
+    }
+    if (call == NULL && *err == 0) {
+        *err = HTTPD_404_NOT_FOUND;
+    }
+    return call;
+}
+
 static int httpd_find_uri_handler(struct httpd_data *hd,
                                   const char* uri,
                                   httpd_method_t method)
@@ -48,6 +303,11 @@ esp_err_t httpd_register_uri_handler(httpd_handle_t handle,
 
     struct httpd_data *hd = (struct httpd_data *) handle;
 
+    if (!httpd_uri_is_valid(uri_handler->uri)) {
+        ESP_LOGW(TAG, LOG_FMT("invalid {param} segments in %s"), uri_handler->uri);
+        return ESP_ERR_INVALID_ARG;
+    }
+
     /* Make sure another handler with same URI and method
      * is not already registered
      */
@@ -78,6 +338,16 @@ esp_err_t httpd_register_uri_handler(httpd_handle_t handle,
             hd->hd_calls[i]->method   = uri_handler->method;
             hd->hd_calls[i]->handler  = uri_handler->handler;
             hd->hd_calls[i]->user_ctx = uri_handler->user_ctx;
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+            hd->hd_calls[i]->is_websocket = uri_handler->is_websocket;
+            hd->hd_calls[i]->handle_ws_control_frames = uri_handler->handle_ws_control_frames;
+#endif
+            if (httpd_uri_route_add(hd, hd->hd_calls[i]) != ESP_OK) {
+                free((char*)hd->hd_calls[i]->uri);
+                free(hd->hd_calls[i]);
+                hd->hd_calls[i] = NULL;
+                return ESP_ERR_HTTPD_ALLOC_MEM;
+            }
             ESP_LOGD(TAG, LOG_FMT("[%d] installed %s"), i, uri_handler->uri);
             return ESP_OK;
         }
@@ -100,6 +370,7 @@ esp_err_t httpd_unregister_uri_handler(httpd_handle_t handle,
     if (i != -1) {
         ESP_LOGD(TAG, LOG_FMT("[%d] removing %s"), i, hd->hd_calls[i]->uri);
 
+        httpd_uri_route_remove(hd, hd->hd_calls[i]);
         free((char*)hd->hd_calls[i]->uri);
         free(hd->hd_calls[i]);
         hd->hd_calls[i] = NULL;
@@ -123,6 +394,7 @@ esp_err_t httpd_unregister_uri(httpd_handle_t handle, const char *uri)
             (strcmp(hd->hd_calls[i]->uri, uri) == 0)) {
             ESP_LOGD(TAG, LOG_FMT("[%d] removing %s"), i, uri);
 
+            httpd_uri_route_remove(hd, hd->hd_calls[i]);
             free((char*)hd->hd_calls[i]->uri);
             free(hd->hd_calls[i]);
             hd->hd_calls[i] = NULL;
@@ -145,45 +417,15 @@ void httpd_unregister_all_uri_handlers(struct httpd_data *hd)
             free(hd->hd_calls[i]);
         }
     }
+    httpd_uri_node_free(hd->hd_routes);
+    hd->hd_routes = NULL;
 }
 
-/* Alternate implmentation of httpd_find_uri_handler()
- * which takes a uri_len field. This is useful when the URI
- * string contains extra parameters that are not to be included
- * while matching with the registered URI_handler strings
- */
-static httpd_uri_t* httpd_find_uri_handler2(httpd_err_resp_t *err,
-                                            struct httpd_data *hd,
-                                            const char *uri, size_t uri_len,
-                                            httpd_method_t method)
-{
-    *err = 0;
-    for (int i = 0; i < hd->config.max_uri_handlers; i++) {
-        if (hd->hd_calls[i]) {
-            ESP_LOGD(TAG, LOG_FMT("[%d] = %s"), i, hd->hd_calls[i]->uri);
-            if ((strlen(hd->hd_calls[i]->uri) == uri_len) &&            // First match uri length
-                (strncmp(hd->hd_calls[i]->uri, uri, uri_len) == 0))  {  // Then match uri strings
-                if (hd->hd_calls[i]->method == method)  {               // Finally match methods
-                    return hd->hd_calls[i];
-                }
-                /* URI found but method not allowed.
-                 * If URI IS found later then this
-                 * error is to be neglected */
-                *err = HTTPD_405_METHOD_NOT_ALLOWED;
-            }
-        }
-    }
-    if (*err == 0) {
-        *err = HTTPD_404_NOT_FOUND;
-    }
-    return NULL;
-}
-
-esp_err_t httpd_uri(struct httpd_data *hd)
+esp_err_t httpd_uri(struct httpd_data *hd, httpd_req_t *req)
 {
     httpd_uri_t            *uri = NULL;
-    httpd_req_t            *req = &hd->hd_req;
-    struct http_parser_url *res = &hd->hd_req_aux.url_parse_res;
+    struct httpd_req_aux   *ra  = req->aux;
+    struct http_parser_url *res = &ra->url_parse_res;
 
     /* For conveying URI not found/method not allowed */
     httpd_err_resp_t err = 0;
@@ -191,11 +433,24 @@ esp_err_t httpd_uri(struct httpd_data *hd)
     ESP_LOGD(TAG, LOG_FMT("request for %s with type %d"), req->uri, req->method);
     /* URL parser result contains offset and length of path string */
     if (res->field_set & (1 << UF_PATH)) {
-        uri = httpd_find_uri_handler2(&err, hd,
-                                      req->uri + res->field_data[UF_PATH].off,
-                                      res->field_data[UF_PATH].len,
-                                      req->method);
+        uri = httpd_route_uri(hd, ra,
+                              req->uri + res->field_data[UF_PATH].off,
+                              res->field_data[UF_PATH].len,
+                              req->method, &err);
+    }
+
+#ifdef CONFIG_HTTPD_STATIC_SUPPORT
+    /* Registered URI handlers take precedence over static files */
+    if (uri == NULL && err == HTTPD_404_NOT_FOUND &&
+        req->method == HTTP_GET && hd->hd_static) {
+        esp_err_t ret = httpd_static_serve(hd, req,
+                                           req->uri + res->field_data[UF_PATH].off,
+                                           res->field_data[UF_PATH].len);
+        if (ret != ESP_ERR_NOT_FOUND) {
+            return ret;
+        }
     }
+#endif
 
     /* If URI with method not found, respond with error code */
     if (uri == NULL) {
@@ -213,6 +468,32 @@ esp_err_t httpd_uri(struct httpd_data *hd)
 
     /* Attach user context data (passed during URI registration) into request */
     req->user_ctx = uri->user_ctx;
+    ra->uri_handler = uri;
+
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+    if (uri->is_websocket != ra->ws_handshake_detect) {
+        ESP_LOGW(TAG, LOG_FMT("WebSocket upgrade mismatch for URI '%s'"), req->uri);
+        return httpd_resp_send_err(req, ra->ws_handshake_detect ?
+                                   HTTPD_XXX_UPGRADE_NOT_SUPPORTED : HTTPD_400_BAD_REQUEST);
+    }
+
+    /* Upgrade the session, the handler is invoked once for the handshake
+     * request and then for every frame received on this session */
+    if (uri->is_websocket) {
+        ESP_LOGD(TAG, LOG_FMT("responding WebSocket handshake to sock %d"), ra->sd->fd);
+        esp_err_t ret = httpd_ws_respond_server_handshake(req);
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, LOG_FMT("WebSocket handshake failed (0x%x)"), ret);
+            /* Socket errors close the session, invalid handshakes are refused */
+            return (ret == ESP_FAIL ? ESP_FAIL : httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST));
+        }
+
+        ra->sd->ws_handshake_done = true;
+        ra->sd->ws_handler = uri->handler;
+        ra->sd->ws_control_frames = uri->handle_ws_control_frames;
+        ra->sd->ws_user_ctx = uri->user_ctx;
+    }
+#endif
 
     /* Invoke handler */
     if (uri->handler(req) != ESP_OK) {
@@ -222,3 +503,37 @@ esp_err_t httpd_uri(struct httpd_data *hd)
     }
     return ESP_OK;
 }
+
+esp_err_t httpd_req_get_uri_param(httpd_req_t *r, const char *name, char *val, size_t val_size)
+{
+    if (r == NULL || name == NULL || val == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!httpd_valid_req(r)) {
+        return ESP_ERR_HTTPD_INVALID_REQ;
+    }
+
+    struct httpd_req_aux *ra = r->aux;
+    if (ra->uri_handler == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    /* The n-th {param} segment of the registered URI is the n-th one stored */
+    const char *path = r->uri + ra->url_parse_res.field_data[UF_PATH].off;
+    size_t name_len = strlen(name);
+    const char *p = ra->uri_handler->uri;
+    for (unsigned i = 0; i < ra->uri_params_count && (p = strchr(p, '{')) != NULL; i++) {
+        const char *end = strchr(++p, '}');
+        if (end - p == name_len && strncmp(p, name, name_len) == 0) {
+            const struct uri_param *param = &ra->uri_params[i];
+            strlcpy(val, path + param->off, MIN(val_size, param->len + 1));
+            if (val_size < param->len + 1) {
+                return ESP_ERR_HTTPD_RESULT_TRUNC;
+            }
+            return ESP_OK;
+        }
+        p = end;
+    }
+    return ESP_ERR_NOT_FOUND;
+}
@@ -0,0 +1,145 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <unistd.h>
+#include <esp_log.h>
+#include <esp_err.h>
+
+#include <esp_http_server.h>
+#include "esp_httpd_priv.h"
+
+static const char *TAG = "httpd_worker";
+
+/* Sessions are owned either by the server task or by one worker. The server task
+ * hands a session over by setting sd->worker and w->sd and notifying the worker.
+ * The worker hands it back by queueing httpd_worker_done(), so that the server task
+ * is the only one which modifies the session database, and wakes up to wait for the
+ * session again.
+ */
+static void httpd_worker_done(void *arg)
+{
+    struct httpd_worker *w = (struct httpd_worker *) arg;
+    struct sock_db *sd = w->sd;
+    int fd = sd->fd;
+
+    sd->worker = NULL;
+    w->sd = NULL;
+
+    if (w->ret != ESP_OK || sd->close_pending) {
+        ESP_LOGD(TAG, LOG_FMT("closing socket %d"), fd);
+        close(fd);
+        httpd_sess_delete(w->hd, fd);
+        return;
+    }
+    httpd_sess_update_lru_counter(w->hd, fd);
+}
+
+static void httpd_worker_task(void *arg)
+{
+    struct httpd_worker *w = (struct httpd_worker *) arg;
+
+    ESP_LOGD(TAG, LOG_FMT("worker started"));
+    while (1) {
+        httpd_os_thread_wait();
+        if (w->td.status == THREAD_STOPPING) {
+            break;
+        }
+        if (!w->sd) {
+            continue;
+        }
+
+        ESP_LOGD(TAG, LOG_FMT("serving socket %d"), w->sd->fd);
+        w->ret = httpd_sess_serve(w->hd, &w->req, &w->aux, w->sd);
+
+        /* The session stays owned by this worker until the server task
+         * takes it back, so retry as long as the server is running */
+        while (httpd_queue_work(w->hd, httpd_worker_done, w) != ESP_OK) {
+            if (w->td.status != THREAD_RUNNING) {
+                break;
+            }
+            ESP_LOGW(TAG, LOG_FMT("failed to hand back socket %d"), w->sd->fd);
+            httpd_os_thread_sleep(100);
+        }
+    }
+
+    ESP_LOGD(TAG, LOG_FMT("worker exiting"));
+    w->td.status = THREAD_STOPPED;
+    httpd_os_thread_delete();
+}
+
+esp_err_t httpd_workers_start(struct httpd_data *hd)
+{
+    for (int i = 0; i < hd->config.worker_count; i++) {
+        struct httpd_worker *w = &hd->hd_workers[i];
+
+        w->hd = hd;
+        w->sd = NULL;
+        w->td.status = THREAD_RUNNING;
+        if (httpd_os_thread_create(&w->td.handle, "httpd_worker",
+                                   hd->config.worker_stack_size,
+                                   hd->config.task_priority,
+                                   httpd_worker_task, w) != ESP_OK) {
+            ESP_LOGE(TAG, LOG_FMT("failed to launch worker %d"), i);
+            w->td.status = THREAD_IDLE;
+            httpd_workers_stop(hd);
+            return ESP_ERR_HTTPD_TASK;
+        }
+    }
+    return ESP_OK;
+}
+
+void httpd_workers_stop(struct httpd_data *hd)
+{
+    for (int i = 0; i < hd->config.worker_count; i++) {
+        struct httpd_worker *w = &hd->hd_workers[i];
+        if (w->td.status == THREAD_RUNNING) {
+            w->td.status = THREAD_STOPPING;
+            httpd_os_thread_notify(w->td.handle);
+        }
+    }
+
+    /* Workers which are serving a request finish it first */
+    for (int i = 0; i < hd->config.worker_count; i++) {
+        struct httpd_worker *w = &hd->hd_workers[i];
+        while (w->td.status == THREAD_STOPPING) {
+            httpd_os_thread_sleep(10);
+        }
+    }
+}
+
+bool httpd_worker_available(struct httpd_data *hd)
+{
+    for (int i = 0; i < hd->config.worker_count; i++) {
+        if (!hd->hd_workers[i].sd) {
+            return true;
+        }
+    }
+    return false;
+}
+
+esp_err_t httpd_worker_dispatch(struct httpd_data *hd, struct sock_db *sd)
+{
+    for (int i = 0; i < hd->config.worker_count; i++) {
+        struct httpd_worker *w = &hd->hd_workers[i];
+        if (!w->sd) {
+            ESP_LOGD(TAG, LOG_FMT("socket %d to worker %d"), sd->fd, i);
+            sd->worker = w;
+            w->sd = sd;
+            httpd_os_thread_notify(w->td.handle);
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NOT_FOUND;
+}
@@ -0,0 +1,347 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <stdlib.h>
+#include <sys/param.h>
+#include <esp_log.h>
+#include <esp_err.h>
+
+#include <esp_http_server.h>
+#include "esp_httpd_priv.h"
+
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+
+#include "esp_sha.h"
+#include "esp_base64.h"
+
+static const char *TAG = "httpd_ws";
+
+/*
+ * Bit masks for WebSocket frames.
+ * Please refer to RFC6455 Section 5.2 for more details.
+ */
+#define HTTPD_WS_FIN_BIT                0x80U
+#define HTTPD_WS_OPCODE_BITS            0x0fU
+#define HTTPD_WS_MASK_BIT               0x80U
+#define HTTPD_WS_LENGTH_BITS            0x7fU
+
+/* Largest header of a frame sent by the server, which doesn't mask its frames */
+#define HTTPD_WS_MAX_TX_HDR_LEN         10
+
+/* Frames up to this size are assembled into a single buffer and sent with one call */
+#define HTTPD_WS_TX_COALESCE_LEN        128
+
+/* Sec-WebSocket-Key is the base64 encoding of 16 random bytes */
+#define HTTPD_WS_CLIENT_KEY_LEN         24
+
+/* Sec-WebSocket-Accept is the base64 encoding of a SHA1 hash */
+#define HTTPD_WS_SERVER_KEY_LEN         28
+
+static const char ws_magic_uuid[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+static esp_err_t httpd_ws_send_all(struct sock_db *sd, const uint8_t *buf, size_t buf_len)
+{
+    while (buf_len > 0) {
+        int ret = sd->send_fn(sd->handle, sd->fd, (const char *)buf, buf_len, 0);
+        if (ret < 0) {
+            ESP_LOGD(TAG, LOG_FMT("error in send_fn"));
+            return ESP_FAIL;
+        }
+        buf     += ret;
+        buf_len -= ret;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t httpd_ws_recv_all(httpd_req_t *req, uint8_t *buf, size_t buf_len)
+{
+    while (buf_len > 0) {
+        int ret = httpd_recv_with_opt(req, (char *)buf, buf_len, false);
+        if (ret <= 0) {
+            ESP_LOGD(TAG, LOG_FMT("error in recv"));
+            return ESP_FAIL;
+        }
+        buf     += ret;
+        buf_len -= ret;
+    }
+    return ESP_OK;
+}
+
+esp_err_t httpd_ws_respond_server_handshake(httpd_req_t *req)
+{
+    /* Probe if input parameters are valid or not */
+    if (!req || !req->aux) {
+        ESP_LOGW(TAG, LOG_FMT("Argument is invalid"));
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    /* Detect handshake - reject if handshake was ALREADY performed */
+    struct httpd_req_aux *req_aux = req->aux;
+    if (req_aux->sd->ws_handshake_done) {
+        ESP_LOGW(TAG, LOG_FMT("State is invalid - Handshake has been performed"));
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    /* Detect WS version (must be 13) */
+    char version_val[3] = { '\0' };
+    if (httpd_req_get_hdr_value_str(req, "Sec-WebSocket-Version", version_val, sizeof(version_val)) != ESP_OK) {
+        ESP_LOGW(TAG, LOG_FMT("\"Sec-WebSocket-Version\" is not found"));
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    if (strcasecmp(version_val, "13") != 0) {
+        ESP_LOGW(TAG, LOG_FMT("\"Sec-WebSocket-Version\" is not \"13\", it is: %s"), version_val);
+        return ESP_ERR_INVALID_VERSION;
+    }
+
+    /* Grab Sec-WebSocket-Key (client key) from the header and append the magic string */
+    char server_raw_text[HTTPD_WS_CLIENT_KEY_LEN + sizeof(ws_magic_uuid)];
+    if (httpd_req_get_hdr_value_str(req, "Sec-WebSocket-Key", server_raw_text,
+                                    HTTPD_WS_CLIENT_KEY_LEN + 1) != ESP_OK ||
+        strlen(server_raw_text) != HTTPD_WS_CLIENT_KEY_LEN) {
+        ESP_LOGW(TAG, LOG_FMT("\"Sec-WebSocket-Key\" is not found or invalid"));
+        return ESP_ERR_NOT_FOUND;
+    }
+    memcpy(server_raw_text + HTTPD_WS_CLIENT_KEY_LEN, ws_magic_uuid, sizeof(ws_magic_uuid));
+
+    ESP_LOGD(TAG, LOG_FMT("Server key before encoding: %s"), server_raw_text);
+
+    /* Generate SHA-1 first and then encode to Base64 */
+    esp_sha1_t sha1;
+    uint8_t server_key_hash[20];
+    esp_sha1_init(&sha1);
+    esp_sha1_update(&sha1, server_raw_text, strlen(server_raw_text));
+    esp_sha1_finish(&sha1, server_key_hash);
+
+    char server_key_encoded[HTTPD_WS_SERVER_KEY_LEN + 1];
+    if (esp_base64_encode(server_key_hash, sizeof(server_key_hash),
+                          server_key_encoded, sizeof(server_key_encoded)) < 0) {
+        return ESP_FAIL;
+    }
+
+    ESP_LOGD(TAG, LOG_FMT("Generated server key: %s"), server_key_encoded);
+
+    /* Prepare the Switching Protocol response */
+    char tx_buf[160];
+    int len = snprintf(tx_buf, sizeof(tx_buf),
+                       "HTTP/1.1 101 Switching Protocols\r\n"
+                       "Upgrade: websocket\r\n"
+                       "Connection: Upgrade\r\n"
+                       "Sec-WebSocket-Accept: %s\r\n\r\n",
+                       server_key_encoded);
+    if (len < 0 || len >= sizeof(tx_buf)) {
+        return ESP_FAIL;
+    }
+
+    ESP_LOGD(TAG, LOG_FMT("Response header:\n%s"), tx_buf);
+
+    /* Send off the response */
+    return httpd_ws_send_all(req_aux->sd, (const uint8_t *)tx_buf, len);
+}
+
+esp_err_t httpd_ws_get_frame_type(httpd_req_t *req)
+{
+    if (!req || !req->aux) {
+        ESP_LOGW(TAG, LOG_FMT("Argument is invalid"));
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    struct httpd_req_aux *aux = req->aux;
+    uint8_t header[8];
+
+    /* First two bytes carry FIN bit, opcode, mask bit and 7-bit payload length */
+    if (httpd_ws_recv_all(req, header, 2) != ESP_OK) {
+        return ESP_FAIL;
+    }
+
+    aux->ws_final = (header[0] & HTTPD_WS_FIN_BIT) != 0;
+    aux->ws_type  = header[0] & HTTPD_WS_OPCODE_BITS;
+
+    /* Frames from the client must be masked */
+    if (!(header[1] & HTTPD_WS_MASK_BIT)) {
+        ESP_LOGW(TAG, LOG_FMT("WS frame is not masked"));
+        return ESP_FAIL;
+    }
+
+    uint64_t payload_len = header[1] & HTTPD_WS_LENGTH_BITS;
+    if (payload_len == 126) {
+        /* 16-bit extended length */
+        if (httpd_ws_recv_all(req, header, 2) != ESP_OK) {
+            return ESP_FAIL;
+        }
+        payload_len = (header[0] << 8) | header[1];
+    } else if (payload_len == 127) {
+        /* 64-bit extended length */
+        if (httpd_ws_recv_all(req, header, 8) != ESP_OK) {
+            return ESP_FAIL;
+        }
+        payload_len = 0;
+        for (int i = 0; i < 8; i++) {
+            payload_len = (payload_len << 8) | header[i];
+        }
+        if (payload_len > SIZE_MAX) {
+            ESP_LOGW(TAG, LOG_FMT("WS frame is too large"));
+            return ESP_FAIL;
+        }
+    }
+
+    /* Control frames must not be fragmented and carry at most 125 bytes */
+    if (aux->ws_type >= HTTPD_WS_TYPE_CLOSE && (!aux->ws_final || payload_len > 125)) {
+        ESP_LOGW(TAG, LOG_FMT("WS control frame is invalid"));
+        return ESP_FAIL;
+    }
+
+    if (httpd_ws_recv_all(req, aux->mask_key, sizeof(aux->mask_key)) != ESP_OK) {
+        return ESP_FAIL;
+    }
+
+    aux->ws_payload_len = payload_len;
+    aux->remaining_len = payload_len;
+    ESP_LOGD(TAG, LOG_FMT("frame type = %d, final = %d, length = %d"),
+             aux->ws_type, aux->ws_final, aux->ws_payload_len);
+    return ESP_OK;
+}
+
+esp_err_t httpd_ws_recv_frame(httpd_req_t *req, httpd_ws_frame_t *frame, size_t max_len)
+{
+    /* Validate the request and the frame pointers */
+    if (!req || !frame || !httpd_valid_req(req)) {
+        ESP_LOGW(TAG, LOG_FMT("Argument is invalid"));
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    struct httpd_req_aux *aux = req->aux;
+    if (!aux->sd->ws_handshake_done) {
+        ESP_LOGW(TAG, LOG_FMT("State is invalid - No handshake performed"));
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    frame->type = aux->ws_type;
+    frame->final = aux->ws_final;
+    frame->fragmented = false;
+
+    /* Only report the length of the payload which is left */
+    if (max_len == 0) {
+        frame->len = aux->remaining_len;
+        return ESP_OK;
+    }
+
+    if (!frame->payload) {
+        ESP_LOGW(TAG, LOG_FMT("No buffer for the payload"));
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    size_t offset = aux->ws_payload_len - aux->remaining_len;
+    size_t len = MIN(max_len, aux->remaining_len);
+    if (httpd_ws_recv_all(req, frame->payload, len) != ESP_OK) {
+        return ESP_FAIL;
+    }
+    aux->remaining_len -= len;
+
+    /* Unmask payload, the mask key index continues where the previous call stopped */
+    for (size_t i = 0; i < len; i++) {
+        frame->payload[i] ^= aux->mask_key[(offset + i) % 4];
+    }
+
+    frame->len = len;
+    return ESP_OK;
+}
+
+static esp_err_t httpd_ws_send_frame_sd(struct sock_db *sd, httpd_ws_frame_t *frame)
+{
+    if (!frame || (frame->len && !frame->payload)) {
+        ESP_LOGW(TAG, LOG_FMT("Argument is invalid"));
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!sd->ws_handshake_done) {
+        ESP_LOGW(TAG, LOG_FMT("State is invalid - No handshake performed"));
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    uint8_t buf[HTTPD_WS_MAX_TX_HDR_LEN + HTTPD_WS_TX_COALESCE_LEN];
+    size_t hdr_len;
+
+    /* Fill the header, server frames are not masked */
+    buf[0] = (frame->fragmented && !frame->final ? 0 : HTTPD_WS_FIN_BIT) | (frame->type & HTTPD_WS_OPCODE_BITS);
+    if (frame->len < 126) {
+        buf[1] = frame->len;
+        hdr_len = 2;
+    } else if (frame->len <= UINT16_MAX) {
+        buf[1] = 126;
+        buf[2] = (frame->len >> 8) & 0xff;
+        buf[3] = frame->len & 0xff;
+        hdr_len = 4;
+    } else {
+        uint64_t len = frame->len;
+        buf[1] = 127;
+        for (int i = 9; i >= 2; i--) {
+            buf[i] = len & 0xff;
+            len >>= 8;
+        }
+        hdr_len = 10;
+    }
+
+    /* Small frames, e.g. telemetry, leave in a single segment */
+    if (frame->len <= HTTPD_WS_TX_COALESCE_LEN) {
+        if (frame->len) {
+            memcpy(buf + hdr_len, frame->payload, frame->len);
+        }
+        return httpd_ws_send_all(sd, buf, hdr_len + frame->len);
+    }
+
+    if (httpd_ws_send_all(sd, buf, hdr_len) != ESP_OK) {
+        return ESP_FAIL;
+    }
+    return httpd_ws_send_all(sd, frame->payload, frame->len);
+}
+
+esp_err_t httpd_ws_send_frame(httpd_req_t *req, httpd_ws_frame_t *frame)
+{
+    if (!req || !httpd_valid_req(req)) {
+        ESP_LOGW(TAG, LOG_FMT("Argument is invalid"));
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    struct httpd_req_aux *aux = req->aux;
+    return httpd_ws_send_frame_sd(aux->sd, frame);
+}
+
+esp_err_t httpd_ws_send_frame_async(httpd_handle_t hd, int fd, httpd_ws_frame_t *frame)
+{
+    if (!hd) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    struct sock_db *sd = httpd_sess_get(hd, fd);
+    if (!sd) {
+        ESP_LOGW(TAG, LOG_FMT("no session for fd = %d"), fd);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    return httpd_ws_send_frame_sd(sd, frame);
+}
+
+httpd_ws_client_info_t httpd_ws_get_fd_info(httpd_handle_t hd, int fd)
+{
+    struct sock_db *sd = httpd_sess_get(hd, fd);
+
+    if (sd == NULL) {
+        return HTTPD_WS_CLIENT_INVALID;
+    }
+    return sd->ws_handshake_done ? HTTPD_WS_CLIENT_WEBSOCKET : HTTPD_WS_CLIENT_HTTP;
+}
+
+#endif /* CONFIG_HTTPD_WS_SUPPORT */
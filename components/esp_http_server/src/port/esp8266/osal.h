@@ -57,6 +57,28 @@ static inline othread_t httpd_os_thread_handle()
     return xTaskGetCurrentTaskHandle();
 }
 
+static inline void httpd_os_thread_notify(othread_t thread)
+{
+    xTaskNotifyGive(thread);
+}
+
+/* Waits for notification of the calling thread */
+static inline void httpd_os_thread_wait()
+{
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+}
+
+/* For short sections only, interrupts are disabled in between */
+static inline void httpd_os_enter_critical()
+{
+    portENTER_CRITICAL();
+}
+
+static inline void httpd_os_exit_critical()
+{
+    portEXIT_CRITICAL();
+}
+
 #ifdef __cplusplus
 }
 #endif
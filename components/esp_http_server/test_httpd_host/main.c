@@ -0,0 +1,31 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <stdint.h>
+
+#include "test_httpd.h"
+
+int64_t esp_timer_get_time(void)
+{
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    test_httpd_txrx();
+    test_httpd_uri();
+    test_httpd_ws();
+
+    printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,24 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+/* As the real header does */
+#include "sdkconfig.h"
+
+#define ESP_LOGE(tag, format, ...)    do { (void)(tag); } while (0)
+#define ESP_LOGW(tag, format, ...)    do { (void)(tag); } while (0)
+#define ESP_LOGI(tag, format, ...)    do { (void)(tag); } while (0)
+#define ESP_LOGD(tag, format, ...)    do { (void)(tag); } while (0)
+#define ESP_LOGV(tag, format, ...)    do { (void)(tag); } while (0)
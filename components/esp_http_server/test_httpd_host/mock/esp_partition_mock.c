@@ -0,0 +1,86 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string.h>
+
+#include "sdkconfig.h"
+
+#include "esp_partition.h"
+#include "esp_partition_mock.h"
+
+/* A single partition, backed by a buffer */
+static esp_partition_t s_partition;
+static const uint8_t *s_data;
+static bool s_mmap_fail;
+static int s_mapped;                    /* Updated by the server tasks too */
+
+void esp_partition_mock_set(esp_partition_subtype_t subtype, const char *label, const void *data, size_t size)
+{
+    s_partition.type = ESP_PARTITION_TYPE_DATA;
+    s_partition.subtype = subtype;
+    s_partition.size = size;
+    strncpy(s_partition.label, label, sizeof(s_partition.label) - 1);
+    s_data = data;
+}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type,
+                                                esp_partition_subtype_t subtype, const char *label)
+{
+    if (!s_data || type != s_partition.type ||
+        (subtype != ESP_PARTITION_SUBTYPE_ANY && subtype != s_partition.subtype) ||
+        (label && strcmp(label, s_partition.label))) {
+        return NULL;
+    }
+    return &s_partition;
+}
+
+void esp_partition_mock_set_mmap_fail(bool fail)
+{
+    s_mmap_fail = fail;
+}
+
+int esp_partition_mock_mapped(void)
+{
+    return __atomic_load_n(&s_mapped, __ATOMIC_SEQ_CST);
+}
+
+esp_err_t esp_partition_mmap(const esp_partition_t *partition, uint32_t offset, uint32_t size,
+                             spi_flash_mmap_memory_t memory,
+                             const void **out_ptr, spi_flash_mmap_handle_t *out_handle)
+{
+    if (s_mmap_fail) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (offset + size > partition->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    *out_ptr = s_data + offset;
+    *out_handle = __atomic_add_fetch(&s_mapped, 1, __ATOMIC_SEQ_CST);
+    return ESP_OK;
+}
+
+void spi_flash_munmap(spi_flash_mmap_handle_t handle)
+{
+    __atomic_sub_fetch(&s_mapped, 1, __ATOMIC_SEQ_CST);
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *partition,
+                             size_t src_offset, void *dst, size_t size)
+{
+    if (src_offset + size > partition->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(dst, s_data + src_offset, size);
+    return ESP_OK;
+}
@@ -0,0 +1,26 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "esp_partition.h"
+
+/* Makes esp_partition_find_first() return a data partition backed by the buffer */
+void esp_partition_mock_set(esp_partition_subtype_t subtype, const char *label, const void *data, size_t size);
+
+/* Makes esp_partition_mmap() fail, as when no MMU pages are free */
+void esp_partition_mock_set_mmap_fail(bool fail);
+
+/* Number of mappings which were not released */
+int esp_partition_mock_mapped(void);
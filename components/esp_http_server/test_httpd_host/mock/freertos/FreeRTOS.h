@@ -0,0 +1,45 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+/* Minimal FreeRTOS definitions needed to build esp_http_server sources on the host */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+/* Pulled in through the FreeRTOS and newlib headers on the target */
+#include <stdlib.h>
+#include <errno.h>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdPASS              1
+#define pdTRUE              1
+#define pdFALSE             0
+#define portMAX_DELAY       ((TickType_t) 0xffffffffUL)
+#define portTICK_RATE_MS    10
+#define tskIDLE_PRIORITY    0
+
+/* A single lock shared by all tasks, see task.c */
+void vPortEnterCritical(void);
+void vPortExitCritical(void);
+
+#define portENTER_CRITICAL()    vPortEnterCritical()
+#define portEXIT_CRITICAL()     vPortExitCritical()
+
+/* newlib provides it on the target, glibc does not */
+size_t strlcpy(char *dst, const char *src, size_t size);
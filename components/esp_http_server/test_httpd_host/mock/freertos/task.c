@@ -0,0 +1,123 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "freertos/task.h"
+
+struct host_task {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint32_t notify;
+    void (*fn)(void *);
+    void *arg;
+};
+
+static __thread struct host_task *s_current;
+
+static pthread_mutex_t s_critical = PTHREAD_MUTEX_INITIALIZER;
+
+static void *host_task_entry(void *arg)
+{
+    struct host_task *t = (struct host_task *) arg;
+    s_current = t;
+    t->fn(t->arg);
+    return NULL;
+}
+
+BaseType_t xTaskCreate(void (*fn)(void *), const char *name, uint16_t stack,
+                       void *arg, UBaseType_t prio, TaskHandle_t *handle)
+{
+    struct host_task *t = calloc(1, sizeof(struct host_task));
+    if (!t) {
+        return !pdPASS;
+    }
+    pthread_mutex_init(&t->lock, NULL);
+    pthread_cond_init(&t->cond, NULL);
+    t->fn = fn;
+    t->arg = arg;
+    if (handle) {
+        *handle = t;
+    }
+    if (pthread_create(&t->thread, NULL, host_task_entry, t) != 0) {
+        free(t);
+        return !pdPASS;
+    }
+    pthread_detach(t->thread);
+    return pdPASS;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return s_current;
+}
+
+/* Only self delete is supported. The task is not freed, as others may
+ * still hold its handle */
+void vTaskDelete(TaskHandle_t handle)
+{
+    pthread_exit(NULL);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    usleep(ticks * portTICK_RATE_MS * 1000);
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t handle)
+{
+    struct host_task *t = (struct host_task *) handle;
+    pthread_mutex_lock(&t->lock);
+    t->notify++;
+    pthread_cond_signal(&t->cond);
+    pthread_mutex_unlock(&t->lock);
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks)
+{
+    struct host_task *t = s_current;
+    pthread_mutex_lock(&t->lock);
+    while (t->notify == 0) {
+        pthread_cond_wait(&t->cond, &t->lock);
+    }
+    uint32_t notify = t->notify;
+    t->notify = clear ? 0 : notify - 1;
+    pthread_mutex_unlock(&t->lock);
+    return notify;
+}
+
+void vPortEnterCritical(void)
+{
+    pthread_mutex_lock(&s_critical);
+}
+
+void vPortExitCritical(void)
+{
+    pthread_mutex_unlock(&s_critical);
+}
+
+size_t strlcpy(char *dst, const char *src, size_t size)
+{
+    size_t len = strlen(src);
+    if (size) {
+        size_t n = len < size - 1 ? len : size - 1;
+        memcpy(dst, src, n);
+        dst[n] = '\0';
+    }
+    return len;
+}
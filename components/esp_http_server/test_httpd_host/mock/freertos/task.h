@@ -0,0 +1,34 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+/* Tasks are backed by pthreads, see task.c */
+
+typedef void *TaskHandle_t;
+
+BaseType_t xTaskCreate(void (*fn)(void *), const char *name, uint16_t stack,
+                       void *arg, UBaseType_t prio, TaskHandle_t *handle);
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+
+void vTaskDelete(TaskHandle_t handle);
+
+void vTaskDelay(TickType_t ticks);
+
+BaseType_t xTaskNotifyGive(TaskHandle_t handle);
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks);
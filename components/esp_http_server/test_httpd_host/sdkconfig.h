@@ -0,0 +1,5 @@
+#define CONFIG_HTTPD_MAX_REQ_HDR_LEN 512
+#define CONFIG_HTTPD_MAX_URI_LEN 512
+#define CONFIG_HTTPD_WS_SUPPORT 1
+#define CONFIG_HTTPD_STATIC_SUPPORT 1
+#define CONFIG_ENABLE_FLASH_MMAP 1
@@ -0,0 +1,41 @@
+// generated for the static files test, compresses well
+function handler_0(event) { return document.getElementById('item_0').value; }
+function handler_1(event) { return document.getElementById('item_1').value; }
+function handler_2(event) { return document.getElementById('item_2').value; }
+function handler_3(event) { return document.getElementById('item_3').value; }
+function handler_4(event) { return document.getElementById('item_4').value; }
+function handler_5(event) { return document.getElementById('item_5').value; }
+function handler_6(event) { return document.getElementById('item_6').value; }
+function handler_7(event) { return document.getElementById('item_7').value; }
+function handler_8(event) { return document.getElementById('item_8').value; }
+function handler_9(event) { return document.getElementById('item_9').value; }
+function handler_10(event) { return document.getElementById('item_10').value; }
+function handler_11(event) { return document.getElementById('item_11').value; }
+function handler_12(event) { return document.getElementById('item_12').value; }
+function handler_13(event) { return document.getElementById('item_13').value; }
+function handler_14(event) { return document.getElementById('item_14').value; }
+function handler_15(event) { return document.getElementById('item_15').value; }
+function handler_16(event) { return document.getElementById('item_16').value; }
+function handler_17(event) { return document.getElementById('item_17').value; }
+function handler_18(event) { return document.getElementById('item_18').value; }
+function handler_19(event) { return document.getElementById('item_19').value; }
+function handler_20(event) { return document.getElementById('item_20').value; }
+function handler_21(event) { return document.getElementById('item_21').value; }
+function handler_22(event) { return document.getElementById('item_22').value; }
+function handler_23(event) { return document.getElementById('item_23').value; }
+function handler_24(event) { return document.getElementById('item_24').value; }
+function handler_25(event) { return document.getElementById('item_25').value; }
+function handler_26(event) { return document.getElementById('item_26').value; }
+function handler_27(event) { return document.getElementById('item_27').value; }
+function handler_28(event) { return document.getElementById('item_28').value; }
+function handler_29(event) { return document.getElementById('item_29').value; }
+function handler_30(event) { return document.getElementById('item_30').value; }
+function handler_31(event) { return document.getElementById('item_31').value; }
+function handler_32(event) { return document.getElementById('item_32').value; }
+function handler_33(event) { return document.getElementById('item_33').value; }
+function handler_34(event) { return document.getElementById('item_34').value; }
+function handler_35(event) { return document.getElementById('item_35').value; }
+function handler_36(event) { return document.getElementById('item_36').value; }
+function handler_37(event) { return document.getElementById('item_37').value; }
+function handler_38(event) { return document.getElementById('item_38').value; }
+function handler_39(event) { return document.getElementById('item_39').value; }
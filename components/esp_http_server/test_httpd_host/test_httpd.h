@@ -0,0 +1,29 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TEST_ASSERT(cond)                                                           \
+    do {                                                                            \
+        if (!(cond)) {                                                              \
+            printf("%s:%d: assertion \"%s\" failed\n", __FILE__, __LINE__, #cond);  \
+            exit(1);                                                                \
+        }                                                                           \
+    } while (0)
+
+void test_httpd_txrx(void);
+void test_httpd_uri(void);
+void test_httpd_ws(void);
@@ -0,0 +1,161 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/* Load test of the full server over loopback: a few clients keep calling a slow
+ * handler while another one measures the latency of a fast handler. Without
+ * workers the fast requests wait behind the slow ones.
+ */
+
+#include <string.h>
+#include <signal.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <esp_http_server.h>
+#include "test_httpd.h"
+
+#define SLOW_HANDLER_MS     200
+#define SLOW_CLIENTS        2
+#define FAST_REQUESTS       40
+
+static uint16_t s_port;
+static volatile bool s_stop;
+
+int64_t esp_timer_get_time(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static esp_err_t slow_handler(httpd_req_t *req)
+{
+    usleep(SLOW_HANDLER_MS * 1000);
+    return httpd_resp_send(req, "done\n", 5);
+}
+
+static esp_err_t fast_handler(httpd_req_t *req)
+{
+    return httpd_resp_send(req, "done\n", 5);
+}
+
+/* Sends one request on a new connection and waits for the whole response */
+static void request(const char *uri)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    TEST_ASSERT(fd >= 0);
+
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(s_port),
+    };
+    inet_aton("127.0.0.1", &addr.sin_addr);
+    TEST_ASSERT(connect(fd, (struct sockaddr *) &addr, sizeof(addr)) == 0);
+
+    char buf[256];
+    int len = snprintf(buf, sizeof(buf), "GET %s HTTP/1.1\r\nHost: localhost\r\n\r\n", uri);
+    TEST_ASSERT(send(fd, buf, len, 0) == len);
+
+    len = 0;
+    while (len < sizeof(buf) - 1) {
+        int ret = recv(fd, buf + len, sizeof(buf) - 1 - len, 0);
+        TEST_ASSERT(ret > 0);
+        len += ret;
+        buf[len] = '\0';
+        if (strstr(buf, "\r\n\r\ndone\n")) {
+            break;
+        }
+    }
+    TEST_ASSERT(strstr(buf, "HTTP/1.1 200 OK"));
+    close(fd);
+}
+
+static void *slow_client(void *arg)
+{
+    while (!s_stop) {
+        request("/slow");
+    }
+    return NULL;
+}
+
+static int cmp_latency(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *) a, y = *(const int64_t *) b;
+    return (x > y) - (x < y);
+}
+
+static void run(uint16_t worker_count, int64_t *p50, int64_t *p99)
+{
+    static const httpd_uri_t slow = { .uri = "/slow", .method = HTTP_GET, .handler = slow_handler };
+    static const httpd_uri_t fast = { .uri = "/fast", .method = HTTP_GET, .handler = fast_handler };
+
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.server_port = s_port;
+    config.ctrl_port = s_port + 1;
+    config.worker_count = worker_count;
+
+    httpd_handle_t server;
+    TEST_ASSERT(httpd_start(&server, &config) == ESP_OK);
+    TEST_ASSERT(httpd_register_uri_handler(server, &slow) == ESP_OK);
+    TEST_ASSERT(httpd_register_uri_handler(server, &fast) == ESP_OK);
+
+    pthread_t clients[SLOW_CLIENTS];
+    s_stop = false;
+    for (int i = 0; i < SLOW_CLIENTS; i++) {
+        TEST_ASSERT(pthread_create(&clients[i], NULL, slow_client, NULL) == 0);
+    }
+    usleep(50 * 1000);
+
+    int64_t latency[FAST_REQUESTS];
+    for (int i = 0; i < FAST_REQUESTS; i++) {
+        int64_t start = esp_timer_get_time();
+        request("/fast");
+        latency[i] = esp_timer_get_time() - start;
+        usleep(20 * 1000);
+    }
+
+    s_stop = true;
+    for (int i = 0; i < SLOW_CLIENTS; i++) {
+        pthread_join(clients[i], NULL);
+    }
+    TEST_ASSERT(httpd_stop(server) == ESP_OK);
+
+    qsort(latency, FAST_REQUESTS, sizeof(latency[0]), cmp_latency);
+    *p50 = latency[FAST_REQUESTS / 2];
+    *p99 = latency[FAST_REQUESTS * 99 / 100];
+}
+
+int main(int argc, char **argv)
+{
+    int64_t p50, p99;
+
+    signal(SIGPIPE, SIG_IGN);
+    s_port = 20000 + getpid() % 20000;
+
+    run(0, &p50, &p99);
+    printf("fast request latency, no workers: p50 %lld us, p99 %lld us\n", (long long) p50, (long long) p99);
+
+    s_port += 2;
+    run(SLOW_CLIENTS + 1, &p50, &p99);
+    printf("fast request latency, %d workers: p50 %lld us, p99 %lld us\n", SLOW_CLIENTS + 1, (long long) p50, (long long) p99);
+    /* A free worker is left for the fast requests */
+    TEST_ASSERT(p99 < SLOW_HANDLER_MS * 1000 / 2);
+
+    printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,316 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/* Serves the image which httpd_static_gen.py created from static_files/
+ * over loopback and checks the responses.
+ */
+
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <esp_http_server.h>
+#include "esp_partition_mock.h"
+#include "test_httpd.h"
+
+static uint16_t s_port;
+static const char *s_app;
+static size_t s_app_len;
+static volatile bool s_stop;
+
+int64_t esp_timer_get_time(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static char *read_file(const char *path, size_t *len)
+{
+    FILE *f = fopen(path, "rb");
+    TEST_ASSERT(f);
+    fseek(f, 0, SEEK_END);
+    *len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *buf = malloc(*len + 1);
+    TEST_ASSERT(buf && fread(buf, 1, *len, f) == *len);
+    buf[*len] = '\0';
+    fclose(f);
+    return buf;
+}
+
+struct response {
+    char hdrs[1024];
+    char body[8192];
+    int content_len;
+};
+
+/* Sends one request on a new connection and receives the whole response */
+static void request(const char *uri, const char *extra_hdrs, struct response *resp)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    TEST_ASSERT(fd >= 0);
+
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(s_port),
+    };
+    inet_aton("127.0.0.1", &addr.sin_addr);
+    TEST_ASSERT(connect(fd, (struct sockaddr *) &addr, sizeof(addr)) == 0);
+
+    char buf[sizeof(resp->hdrs) + sizeof(resp->body)];
+    int len = snprintf(buf, sizeof(buf), "GET %s HTTP/1.1\r\nHost: localhost\r\n%s\r\n", uri, extra_hdrs);
+    TEST_ASSERT(send(fd, buf, len, 0) == len);
+
+    char *body = NULL;
+    len = 0;
+    while (1) {
+        int ret = recv(fd, buf + len, sizeof(buf) - 1 - len, 0);
+        TEST_ASSERT(ret > 0);
+        len += ret;
+        buf[len] = '\0';
+        if (!body && (body = strstr(buf, "\r\n\r\n"))) {
+            body += 4;
+            char *cl = strstr(buf, "Content-Length: ");
+            TEST_ASSERT(cl);
+            resp->content_len = atoi(cl + strlen("Content-Length: "));
+        }
+        /* A 304 has the Content-Length of the file, but no body */
+        if (body && (buf + len - body >= resp->content_len || strstr(buf, " 304 "))) {
+            break;
+        }
+    }
+    close(fd);
+
+    TEST_ASSERT(body - buf < sizeof(resp->hdrs));
+    memcpy(resp->hdrs, buf, body - buf);
+    resp->hdrs[body - buf] = '\0';
+    memcpy(resp->body, body, buf + len - body);
+}
+
+/* Copies the value of a response header */
+static void hdr_value(const struct response *resp, const char *field, char *val, size_t len)
+{
+    char *p = strstr(resp->hdrs, field);
+    TEST_ASSERT(p);
+    p += strlen(field) + strlen(": ");
+    size_t n = strcspn(p, "\r");
+    TEST_ASSERT(n < len);
+    memcpy(val, p, n);
+    val[n] = '\0';
+}
+
+static esp_err_t api_handler(httpd_req_t *req)
+{
+    return httpd_resp_send(req, "api", 3);
+}
+
+/* Requests a file while the main thread unregisters and registers the image */
+static void *client(void *arg)
+{
+    struct response resp;
+    int *served = (int *) arg;
+
+    while (!s_stop) {
+        request("/js/app.js", "", &resp);
+        if (strstr(resp.hdrs, "HTTP/1.1 200 OK")) {
+            TEST_ASSERT(resp.content_len == s_app_len && !memcmp(resp.body, s_app, s_app_len));
+            (*served)++;
+        } else {
+            TEST_ASSERT(strstr(resp.hdrs, "HTTP/1.1 404"));
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    TEST_ASSERT(argc == 2);
+
+    size_t image_len, index_len, app_len;
+    char *image = read_file(argv[1], &image_len);
+    char *index = read_file("static_files/index.html", &index_len);
+    char *app = read_file("static_files/js/app.js", &app_len);
+
+    signal(SIGPIPE, SIG_IGN);
+    s_port = 20000 + getpid() % 20000;
+
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.server_port = s_port;
+    config.ctrl_port = s_port + 1;
+
+    httpd_handle_t server;
+    TEST_ASSERT(httpd_start(&server, &config) == ESP_OK);
+
+    const httpd_static_config_t static_config = {
+        .partition_label = "www",
+        .cache_control = "no-cache",
+    };
+    TEST_ASSERT(httpd_register_static(server, &static_config) == ESP_ERR_NOT_FOUND);
+    esp_partition_mock_set(ESP_PARTITION_SUBTYPE_DATA_ESPHTTPD, "www", image, image_len);
+    TEST_ASSERT(httpd_register_static(server, &static_config) == ESP_OK);
+    TEST_ASSERT(httpd_register_static(server, &static_config) == ESP_ERR_HTTPD_HANDLER_EXISTS);
+    TEST_ASSERT(esp_partition_mock_mapped() == 1);
+
+    static const httpd_uri_t api = { .uri = "/api", .method = HTTP_GET, .handler = api_handler };
+    TEST_ASSERT(httpd_register_uri_handler(server, &api) == ESP_OK);
+
+    struct response resp;
+    char etag[32], gz_etag[32], val[128];
+
+    /* A file, and the index file for its directory */
+    const char *index_uris[] = { "/index.html", "/", "/?query=1" };
+    for (int i = 0; i < sizeof(index_uris) / sizeof(index_uris[0]); i++) {
+        request(index_uris[i], "", &resp);
+        TEST_ASSERT(strstr(resp.hdrs, "HTTP/1.1 200 OK"));
+        TEST_ASSERT(strstr(resp.hdrs, "Content-Type: text/html"));
+        TEST_ASSERT(strstr(resp.hdrs, "Cache-Control: no-cache"));
+        TEST_ASSERT(!strstr(resp.hdrs, "Content-Encoding"));
+        TEST_ASSERT(resp.content_len == index_len && !memcmp(resp.body, index, index_len));
+    }
+
+    /* Plain and gzip variants are different representations with their own ETag */
+    request("/js/app.js", "", &resp);
+    /* Python versions disagree on text/ or application/ */
+    TEST_ASSERT(strstr(resp.hdrs, "javascript; charset=utf-8"));
+    TEST_ASSERT(strstr(resp.hdrs, "Vary: Accept-Encoding"));
+    TEST_ASSERT(!strstr(resp.hdrs, "Content-Encoding"));
+    TEST_ASSERT(resp.content_len == app_len && !memcmp(resp.body, app, app_len));
+    hdr_value(&resp, "ETag", etag, sizeof(etag));
+    TEST_ASSERT(strlen(etag) == 18 && etag[0] == '"');
+
+    request("/js/app.js", "Accept-Encoding: deflate, gzip\r\n", &resp);
+    TEST_ASSERT(strstr(resp.hdrs, "HTTP/1.1 200 OK"));
+    TEST_ASSERT(strstr(resp.hdrs, "Content-Encoding: gzip"));
+    TEST_ASSERT(resp.content_len < app_len);
+    TEST_ASSERT((uint8_t) resp.body[0] == 0x1f && (uint8_t) resp.body[1] == 0x8b);
+    hdr_value(&resp, "ETag", gz_etag, sizeof(gz_etag));
+    int gz_len = resp.content_len;
+    TEST_ASSERT(strncmp(gz_etag, etag, 17) == 0 && strcmp(gz_etag + 17, "-gz\"") == 0);
+
+    /* Codings with q=0 are not acceptable */
+    const char *no_gzip[] = {
+        "Accept-Encoding: gzip;q=0\r\n",
+        "Accept-Encoding: deflate, gzip; q=0.0, *\r\n",
+        "Accept-Encoding: gzipped\r\n",
+        "Accept-Encoding: *;q=0\r\n",
+    };
+    for (int i = 0; i < sizeof(no_gzip) / sizeof(no_gzip[0]); i++) {
+        request("/js/app.js", no_gzip[i], &resp);
+        TEST_ASSERT(!strstr(resp.hdrs, "Content-Encoding"));
+        TEST_ASSERT(resp.content_len == app_len && !memcmp(resp.body, app, app_len));
+    }
+    request("/js/app.js", "Accept-Encoding: br;q=1, GZIP;q=0.5\r\n", &resp);
+    TEST_ASSERT(strstr(resp.hdrs, "Content-Encoding: gzip"));
+    request("/js/app.js", "Accept-Encoding: *\r\n", &resp);
+    TEST_ASSERT(strstr(resp.hdrs, "Content-Encoding: gzip"));
+
+    /* Only the ETag of the variant being served matches */
+    snprintf(val, sizeof(val), "If-None-Match: %s\r\n", etag);
+    request("/js/app.js", val, &resp);
+    TEST_ASSERT(strstr(resp.hdrs, "HTTP/1.1 304 Not Modified"));
+    TEST_ASSERT(resp.content_len == app_len);
+    TEST_ASSERT(!strstr(resp.hdrs, "Content-Type"));
+    hdr_value(&resp, "ETag", val, sizeof(val));
+    TEST_ASSERT(strcmp(val, etag) == 0);
+
+    snprintf(val, sizeof(val), "If-None-Match: %s\r\nAccept-Encoding: gzip\r\n", etag);
+    request("/js/app.js", val, &resp);
+    TEST_ASSERT(strstr(resp.hdrs, "HTTP/1.1 200 OK"));
+    TEST_ASSERT(strstr(resp.hdrs, "Content-Encoding: gzip"));
+
+    snprintf(val, sizeof(val), "If-None-Match: %s\r\nAccept-Encoding: gzip\r\n", gz_etag);
+    request("/js/app.js", val, &resp);
+    TEST_ASSERT(strstr(resp.hdrs, "HTTP/1.1 304 Not Modified"));
+    TEST_ASSERT(resp.content_len == gz_len);
+
+    snprintf(val, sizeof(val), "If-None-Match: %s\r\n", gz_etag);
+    request("/js/app.js", val, &resp);
+    TEST_ASSERT(strstr(resp.hdrs, "HTTP/1.1 200 OK"));
+    TEST_ASSERT(!strstr(resp.hdrs, "Content-Encoding"));
+
+    request("/js/app.js", "If-None-Match: \"0000000000000000\"\r\n", &resp);
+    TEST_ASSERT(strstr(resp.hdrs, "HTTP/1.1 200 OK"));
+
+    /* Registered URI handlers come first, unknown paths are not found */
+    request("/api", "", &resp);
+    TEST_ASSERT(resp.content_len == 3 && !memcmp(resp.body, "api", 3));
+    request("/js", "", &resp);
+    TEST_ASSERT(strstr(resp.hdrs, "HTTP/1.1 404"));
+    request("/index.htm", "", &resp);
+    TEST_ASSERT(strstr(resp.hdrs, "HTTP/1.1 404"));
+
+    TEST_ASSERT(httpd_unregister_static(server) == ESP_OK);
+    TEST_ASSERT(httpd_unregister_static(server) == ESP_ERR_NOT_FOUND);
+    TEST_ASSERT(esp_partition_mock_mapped() == 0);
+    request("/index.html", "", &resp);
+    TEST_ASSERT(strstr(resp.hdrs, "HTTP/1.1 404"));
+
+    /* Without a mapping, files are read from the partition */
+    esp_partition_mock_set_mmap_fail(true);
+    TEST_ASSERT(httpd_register_static(server, &static_config) == ESP_OK);
+    TEST_ASSERT(esp_partition_mock_mapped() == 0);
+    request("/", "", &resp);
+    TEST_ASSERT(resp.content_len == index_len && !memcmp(resp.body, index, index_len));
+    request("/js/app.js", "", &resp);
+    TEST_ASSERT(resp.content_len == app_len && !memcmp(resp.body, app, app_len));
+    request("/js/app.js", "Accept-Encoding: gzip\r\n", &resp);
+    TEST_ASSERT(strstr(resp.hdrs, "Content-Encoding: gzip"));
+    TEST_ASSERT(resp.content_len == gz_len);
+    TEST_ASSERT((uint8_t) resp.body[0] == 0x1f && (uint8_t) resp.body[1] == 0x8b);
+    TEST_ASSERT(httpd_unregister_static(server) == ESP_OK);
+    esp_partition_mock_set_mmap_fail(false);
+
+    TEST_ASSERT(httpd_register_static(server, &static_config) == ESP_OK);
+    TEST_ASSERT(httpd_stop(server) == ESP_OK);
+
+    /* Workers finish the files they are serving when the image is unregistered */
+    s_port += 2;
+    config.server_port = s_port;
+    config.ctrl_port = s_port + 1;
+    config.worker_count = 2;
+    TEST_ASSERT(httpd_start(&server, &config) == ESP_OK);
+    s_app = app;
+    s_app_len = app_len;
+
+    pthread_t clients[2];
+    int served[2] = { 0 };
+    for (int i = 0; i < 2; i++) {
+        TEST_ASSERT(pthread_create(&clients[i], NULL, client, &served[i]) == 0);
+    }
+    for (int i = 0; i < 200; i++) {
+        TEST_ASSERT(httpd_register_static(server, &static_config) == ESP_OK);
+        usleep(1000);
+        TEST_ASSERT(httpd_unregister_static(server) == ESP_OK);
+        usleep(100);
+    }
+    s_stop = true;
+    for (int i = 0; i < 2; i++) {
+        pthread_join(clients[i], NULL);
+        TEST_ASSERT(served[i] > 0);
+    }
+    TEST_ASSERT(esp_partition_mock_mapped() == 0);
+    TEST_ASSERT(httpd_stop(server) == ESP_OK);
+
+    free(image);
+    free(index);
+    free(app);
+    printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,171 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/*
+ * Sends responses through a counting send function, checks the bytes on the wire
+ * and reports send calls and TCP segments (TCP_NODELAY, 1460 byte MSS) per response.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_httpd_priv.h"
+#include "test_httpd.h"
+
+#define TEST_MSS        1460
+#define TEST_OUT_SIZE   8192
+
+static char s_out[TEST_OUT_SIZE];
+static size_t s_out_len;
+static unsigned s_send_calls;
+static unsigned s_segments;
+
+static struct httpd_data s_hd;
+static struct sock_db s_sd;
+static struct httpd_req_aux s_ra;
+static struct resp_hdr s_resp_hdrs[8];
+static httpd_req_t s_req;
+
+/* Accepts at most one segment per call, like a socket with a small send buffer would */
+static int test_send(httpd_handle_t hd, int sockfd, const char *buf, size_t buf_len, int flags)
+{
+    size_t len = buf_len < TEST_MSS ? buf_len : TEST_MSS;
+
+    TEST_ASSERT(s_out_len + len <= sizeof(s_out));
+    memcpy(s_out + s_out_len, buf, len);
+    s_out_len += len;
+    s_send_calls++;
+    s_segments++;
+    return len;
+}
+
+static httpd_req_t *test_req_init(void)
+{
+    memset(&s_ra, 0, sizeof(s_ra));
+    memset(&s_req, 0, sizeof(s_req));
+    s_hd.config.max_resp_headers = sizeof(s_resp_hdrs) / sizeof(s_resp_hdrs[0]);
+    s_sd.send_fn = test_send;
+    s_ra.sd = &s_sd;
+    s_ra.resp_hdrs = s_resp_hdrs;
+    s_ra.status = (char *)HTTPD_200;
+    s_ra.content_type = (char *)HTTPD_TYPE_TEXT;
+    s_req.handle = &s_hd;
+    s_req.aux = &s_ra;
+
+    s_out_len = 0;
+    s_send_calls = 0;
+    s_segments = 0;
+    return &s_req;
+}
+
+static void test_check_out(const char *expected, size_t expected_len)
+{
+    TEST_ASSERT(s_out_len == expected_len);
+    TEST_ASSERT(memcmp(s_out, expected, expected_len) == 0);
+}
+
+static void test_report(const char *name)
+{
+    printf("%-40s %6u bytes %3u send calls %3u segments\n", name, (unsigned)s_out_len, s_send_calls, s_segments);
+}
+
+static void test_set_hdrs(httpd_req_t *r, int count)
+{
+    static const char *fields[] = { "Cache-Control", "Connection", "X-Request-Id", "Access-Control-Allow-Origin", "Server" };
+    static const char *values[] = { "no-cache", "keep-alive", "0123456789abcdef", "*", "esp8266" };
+
+    for (int i = 0; i < count; i++) {
+        TEST_ASSERT(httpd_resp_set_hdr(r, fields[i], values[i]) == ESP_OK);
+    }
+}
+
+static void test_resp_send(const char *name, int hdr_count, size_t body_len)
+{
+    static char body[4096];
+    static char expected[TEST_OUT_SIZE];
+    httpd_req_t *r = test_req_init();
+
+    TEST_ASSERT(body_len <= sizeof(body));
+    for (size_t i = 0; i < body_len; i++) {
+        body[i] = 'a' + i % 26;
+    }
+    test_set_hdrs(r, hdr_count);
+    TEST_ASSERT(httpd_resp_send(r, body, body_len) == ESP_OK);
+
+    int len = sprintf(expected, "HTTP/1.1 200 OK\r\nContent-Type: text/html\r\nContent-Length: %d\r\n", (int)body_len);
+    for (unsigned i = 0; i < s_ra.resp_hdrs_count; i++) {
+        len += sprintf(expected + len, "%s: %s\r\n", s_resp_hdrs[i].field, s_resp_hdrs[i].value);
+    }
+    len += sprintf(expected + len, "\r\n");
+    memcpy(expected + len, body, body_len);
+    test_check_out(expected, len + body_len);
+    test_report(name);
+}
+
+static void test_resp_send_chunk(const char *name, int hdr_count, size_t chunk_len, int chunk_count)
+{
+    static char chunk[4096];
+    static char expected[TEST_OUT_SIZE];
+    httpd_req_t *r = test_req_init();
+
+    TEST_ASSERT(chunk_len <= sizeof(chunk));
+    memset(chunk, 'x', chunk_len);
+    test_set_hdrs(r, hdr_count);
+    for (int i = 0; i < chunk_count; i++) {
+        TEST_ASSERT(httpd_resp_send_chunk(r, chunk, chunk_len) == ESP_OK);
+    }
+    TEST_ASSERT(httpd_resp_send_chunk(r, NULL, 0) == ESP_OK);
+
+    int len = sprintf(expected, "HTTP/1.1 200 OK\r\nContent-Type: text/html\r\nTransfer-Encoding: chunked\r\n");
+    for (unsigned i = 0; i < s_ra.resp_hdrs_count; i++) {
+        len += sprintf(expected + len, "%s: %s\r\n", s_resp_hdrs[i].field, s_resp_hdrs[i].value);
+    }
+    len += sprintf(expected + len, "\r\n");
+    for (int i = 0; i < chunk_count; i++) {
+        len += sprintf(expected + len, "%x\r\n", (unsigned)chunk_len);
+        memcpy(expected + len, chunk, chunk_len);
+        len += chunk_len;
+        len += sprintf(expected + len, "\r\n");
+    }
+    len += sprintf(expected + len, "0\r\n\r\n");
+    test_check_out(expected, len);
+    test_report(name);
+}
+
+/* A 304 has no Content-Type, and the Content-Length of the representation */
+static void test_resp_not_modified(void)
+{
+    static char expected[TEST_OUT_SIZE];
+    httpd_req_t *r = test_req_init();
+
+    httpd_resp_set_status(r, "304 Not Modified");
+    test_set_hdrs(r, 1);
+    TEST_ASSERT(httpd_resp_send_hdrs(r, 1234) == ESP_OK);
+
+    int len = sprintf(expected, "HTTP/1.1 304 Not Modified\r\nContent-Length: 1234\r\nCache-Control: no-cache\r\n\r\n");
+    test_check_out(expected, len);
+    test_report("304, 1 header");
+}
+
+void test_httpd_txrx(void)
+{
+    test_resp_send("no headers, empty body", 0, 0);
+    test_resp_send("5 headers, 64 byte body", 5, 64);
+    test_resp_send("5 headers, 400 byte body", 5, 400);
+    test_resp_send("2 headers, 3000 byte body", 2, 3000);
+    test_resp_send_chunk("chunked, 2 headers, 4 x 100 bytes", 2, 100, 4);
+    test_resp_send_chunk("chunked, 0 headers, 2 x 1024 bytes", 0, 1024, 2);
+    test_resp_not_modified();
+}
@@ -0,0 +1,205 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/*
+ * Routes URIs through the tree of registered handlers, and compares the
+ * time per lookup with the scan of all handler slots it replaced.
+ */
+
+#include <string.h>
+#include <time.h>
+
+#include "esp_httpd_priv.h"
+#include "test_httpd.h"
+
+#define MAX_HANDLERS    80
+#define BENCH_LOOKUPS   200000
+
+static struct httpd_data s_hd;
+static struct httpd_req_aux s_ra;
+static httpd_req_t s_req;
+
+static esp_err_t dummy_handler(httpd_req_t *r)
+{
+    return ESP_OK;
+}
+
+static void reg(const char *uri, httpd_method_t method, esp_err_t expected)
+{
+    httpd_uri_t h = {
+        .uri = uri,
+        .method = method,
+        .handler = dummy_handler,
+    };
+    TEST_ASSERT(httpd_register_uri_handler(&s_hd, &h) == expected);
+}
+
+/* Routes the URI, returning the registered URI of the handler or NULL */
+static const char *route(const char *uri, httpd_method_t method, httpd_err_resp_t *err)
+{
+    strcpy((char *) s_req.uri, uri);
+    s_ra.url_parse_res.field_data[UF_PATH].off = 0;
+    s_ra.url_parse_res.field_data[UF_PATH].len = strlen(uri);
+    s_ra.uri_handler = httpd_route_uri(&s_hd, &s_ra, uri, strlen(uri), method, err);
+    return s_ra.uri_handler ? s_ra.uri_handler->uri : NULL;
+}
+
+static void check_route(const char *uri, httpd_method_t method, const char *expected)
+{
+    httpd_err_resp_t err;
+    const char *found = route(uri, method, &err);
+    TEST_ASSERT(found && strcmp(found, expected) == 0);
+}
+
+static void check_err(const char *uri, httpd_method_t method, httpd_err_resp_t expected)
+{
+    httpd_err_resp_t err;
+    TEST_ASSERT(route(uri, method, &err) == NULL && err == expected);
+}
+
+static void check_param(const char *name, const char *expected)
+{
+    char val[32];
+    TEST_ASSERT(httpd_req_get_uri_param(&s_req, name, val, sizeof(val)) == ESP_OK);
+    TEST_ASSERT(strcmp(val, expected) == 0);
+}
+
+/* Scan of all handler slots, as routing was done before */
+static httpd_uri_t *linear_find(const char *uri, size_t uri_len, httpd_method_t method)
+{
+    for (int i = 0; i < s_hd.config.max_uri_handlers; i++) {
+        if (s_hd.hd_calls[i] &&
+            strlen(s_hd.hd_calls[i]->uri) == uri_len &&
+            strncmp(s_hd.hd_calls[i]->uri, uri, uri_len) == 0 &&
+            s_hd.hd_calls[i]->method == method) {
+            return s_hd.hd_calls[i];
+        }
+    }
+    return NULL;
+}
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void bench(void)
+{
+    char uris[60][32];
+    for (int i = 0; i < 60; i++) {
+        snprintf(uris[i], sizeof(uris[i]), "/api/v1/resource%02d/status", i);
+        reg(uris[i], HTTP_GET, ESP_OK);
+    }
+
+    /* The last one registered is the worst case for the scan */
+    const char *uri = uris[59];
+    size_t len = strlen(uri);
+    httpd_err_resp_t err;
+    volatile uintptr_t sink = 0;
+
+    double start = now_ns();
+    for (int i = 0; i < BENCH_LOOKUPS; i++) {
+        sink += (uintptr_t) linear_find(uri, len, HTTP_GET);
+    }
+    double linear = (now_ns() - start) / BENCH_LOOKUPS;
+
+    start = now_ns();
+    for (int i = 0; i < BENCH_LOOKUPS; i++) {
+        sink += (uintptr_t) httpd_route_uri(&s_hd, &s_ra, uri, len, HTTP_GET, &err);
+    }
+    double tree = (now_ns() - start) / BENCH_LOOKUPS;
+
+    TEST_ASSERT(httpd_route_uri(&s_hd, &s_ra, uri, len, HTTP_GET, &err) == linear_find(uri, len, HTTP_GET));
+
+    int count = 0;
+    for (int i = 0; i < MAX_HANDLERS; i++) {
+        count += (s_hd.hd_calls[i] != NULL);
+    }
+    printf("%d handlers: scan %.0f ns, tree %.0f ns per lookup\n", count, linear, tree);
+}
+
+void test_httpd_uri(void)
+{
+    s_hd.config.max_uri_handlers = MAX_HANDLERS;
+    s_hd.hd_calls = calloc(MAX_HANDLERS, sizeof(httpd_uri_t *));
+    s_req.aux = &s_ra;
+
+    reg("/", HTTP_GET, ESP_OK);
+    reg("/api/dev", HTTP_GET, ESP_OK);
+    reg("/api/dev/list", HTTP_GET, ESP_OK);
+    reg("/api/dev/{id}", HTTP_GET, ESP_OK);
+    reg("/api/dev/{id}", HTTP_PUT, ESP_OK);
+    reg("/api/dev/{id}/cfg", HTTP_GET, ESP_OK);
+    reg("/api/{group}/{id}/cfg", HTTP_POST, ESP_OK);
+    reg("/api/devices", HTTP_GET, ESP_OK);
+    reg("/api/dev/{id}", HTTP_PUT, ESP_ERR_HTTPD_HANDLER_EXISTS);
+
+    reg("/api/x{id}", HTTP_GET, ESP_ERR_INVALID_ARG);
+    reg("/api/{id}x", HTTP_GET, ESP_ERR_INVALID_ARG);
+    reg("/api/{}", HTTP_GET, ESP_ERR_INVALID_ARG);
+    reg("/api/{id", HTTP_GET, ESP_ERR_INVALID_ARG);
+    reg("/{a}/{b}/{c}/{d}/{e}", HTTP_GET, ESP_ERR_INVALID_ARG);
+
+    check_route("/", HTTP_GET, "/");
+    check_route("/api/dev", HTTP_GET, "/api/dev");
+    check_route("/api/devices", HTTP_GET, "/api/devices");
+    check_route("/api/dev/list", HTTP_GET, "/api/dev/list");
+
+    /* Static segments first, {param} ones when they lead nowhere */
+    check_route("/api/dev/12", HTTP_GET, "/api/dev/{id}");
+    check_param("id", "12");
+    check_route("/api/dev/list", HTTP_PUT, "/api/dev/{id}");
+    check_param("id", "list");
+    check_route("/api/dev/12/cfg", HTTP_GET, "/api/dev/{id}/cfg");
+    check_param("id", "12");
+    check_route("/api/dev/list/cfg", HTTP_GET, "/api/dev/{id}/cfg");
+    check_param("id", "list");
+    check_route("/api/light/7/cfg", HTTP_POST, "/api/{group}/{id}/cfg");
+    check_param("group", "light");
+    check_param("id", "7");
+    check_route("/api/dev/7/cfg", HTTP_POST, "/api/{group}/{id}/cfg");
+    check_param("group", "dev");
+
+    char val[3];
+    check_route("/api/dev/12345", HTTP_GET, "/api/dev/{id}");
+    TEST_ASSERT(httpd_req_get_uri_param(&s_req, "id", val, sizeof(val)) == ESP_ERR_HTTPD_RESULT_TRUNC);
+    TEST_ASSERT(strcmp(val, "12") == 0);
+    TEST_ASSERT(httpd_req_get_uri_param(&s_req, "i", val, sizeof(val)) == ESP_ERR_NOT_FOUND);
+    TEST_ASSERT(httpd_req_get_uri_param(&s_req, "idx", val, sizeof(val)) == ESP_ERR_NOT_FOUND);
+
+    check_err("/api/dev/", HTTP_GET, HTTPD_404_NOT_FOUND);
+    check_err("/api/de", HTTP_GET, HTTPD_404_NOT_FOUND);
+    check_err("/api/dev/12/cfg/x", HTTP_GET, HTTPD_404_NOT_FOUND);
+    check_err("/api//7/cfg", HTTP_POST, HTTPD_404_NOT_FOUND);
+    check_err("/api/dev", HTTP_POST, HTTPD_405_METHOD_NOT_ALLOWED);
+    check_err("/api/dev/12/cfg", HTTP_PUT, HTTPD_405_METHOD_NOT_ALLOWED);
+
+    /* Unregistering leaves the rest of the tree working */
+    TEST_ASSERT(httpd_unregister_uri_handler(&s_hd, "/api/dev/{id}", HTTP_GET) == ESP_OK);
+    check_route("/api/dev/12", HTTP_PUT, "/api/dev/{id}");
+    check_err("/api/dev/12", HTTP_GET, HTTPD_405_METHOD_NOT_ALLOWED);
+    check_route("/api/dev/12/cfg", HTTP_GET, "/api/dev/{id}/cfg");
+    TEST_ASSERT(httpd_unregister_uri(&s_hd, "/api/dev/{id}") == ESP_OK);
+    check_err("/api/dev/12", HTTP_PUT, HTTPD_404_NOT_FOUND);
+    reg("/api/dev/{id}", HTTP_GET, ESP_OK);
+    check_route("/api/dev/12", HTTP_GET, "/api/dev/{id}");
+
+    bench();
+
+    httpd_unregister_all_uri_handlers(&s_hd);
+    TEST_ASSERT(s_hd.hd_routes == NULL);
+    free(s_hd.hd_calls);
+}
@@ -0,0 +1,245 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+/*
+ * Runs the WebSocket handshake and frame coding against in-memory sockets,
+ * using the examples of RFC6455 where available.
+ */
+
+#include <string.h>
+
+#include "esp_httpd_priv.h"
+#include "test_httpd.h"
+
+#define TEST_FD     7
+
+static uint8_t s_in[1024];
+static size_t s_in_len;
+static size_t s_in_pos;
+static uint8_t s_out[1024];
+static size_t s_out_len;
+static unsigned s_send_calls;
+
+static struct httpd_data s_hd;
+static struct sock_db s_sd;
+static struct httpd_req_aux s_ra;
+static httpd_req_t s_req;
+
+static const char *s_ws_key;
+static const char *s_ws_version;
+
+struct sock_db *httpd_sess_get(struct httpd_data *hd, int sockfd)
+{
+    return (hd == &s_hd && sockfd == TEST_FD) ? &s_sd : NULL;
+}
+
+esp_err_t httpd_req_get_hdr_value_str(httpd_req_t *r, const char *field, char *val, size_t val_size)
+{
+    const char *value = NULL;
+
+    if (strcmp(field, "Sec-WebSocket-Key") == 0) {
+        value = s_ws_key;
+    } else if (strcmp(field, "Sec-WebSocket-Version") == 0) {
+        value = s_ws_version;
+    }
+    if (!value) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    snprintf(val, val_size, "%s", value);
+    return strlen(value) < val_size ? ESP_OK : ESP_ERR_HTTPD_RESULT_TRUNC;
+}
+
+/* Returns at most 3 bytes per call, so that frames arrive in pieces */
+static int test_recv(httpd_handle_t hd, int sockfd, char *buf, size_t buf_len, int flags)
+{
+    size_t len = s_in_len - s_in_pos;
+
+    len = len < buf_len ? len : buf_len;
+    len = len < 3 ? len : 3;
+    memcpy(buf, s_in + s_in_pos, len);
+    s_in_pos += len;
+    return len;
+}
+
+static int test_send(httpd_handle_t hd, int sockfd, const char *buf, size_t buf_len, int flags)
+{
+    TEST_ASSERT(s_out_len + buf_len <= sizeof(s_out));
+    memcpy(s_out + s_out_len, buf, buf_len);
+    s_out_len += buf_len;
+    s_send_calls++;
+    return buf_len;
+}
+
+static httpd_req_t *test_ws_init(bool handshake_done, const void *in, size_t in_len)
+{
+    memset(&s_sd, 0, sizeof(s_sd));
+    memset(&s_ra, 0, sizeof(s_ra));
+    memset(&s_req, 0, sizeof(s_req));
+    s_sd.fd = TEST_FD;
+    s_sd.handle = &s_hd;
+    s_sd.send_fn = test_send;
+    s_sd.recv_fn = test_recv;
+    s_sd.ws_handshake_done = handshake_done;
+    s_ra.sd = &s_sd;
+    s_req.handle = &s_hd;
+    s_req.aux = &s_ra;
+
+    TEST_ASSERT(in_len <= sizeof(s_in));
+    memcpy(s_in, in, in_len);
+    s_in_len = in_len;
+    s_in_pos = 0;
+    s_out_len = 0;
+    s_send_calls = 0;
+    return &s_req;
+}
+
+static void test_ws_handshake(void)
+{
+    /* RFC6455 section 1.3 */
+    const char *expected = "HTTP/1.1 101 Switching Protocols\r\n"
+                           "Upgrade: websocket\r\n"
+                           "Connection: Upgrade\r\n"
+                           "Sec-WebSocket-Accept: s3pPLMBiTxaQ9kYGzzhZRbK+xOo=\r\n\r\n";
+    httpd_req_t *r = test_ws_init(false, NULL, 0);
+
+    s_ra.ws_handshake_detect = true;
+    s_ws_key = "dGhlIHNhbXBsZSBub25jZQ==";
+    s_ws_version = "13";
+    TEST_ASSERT(httpd_ws_respond_server_handshake(r) == ESP_OK);
+    TEST_ASSERT(s_out_len == strlen(expected));
+    TEST_ASSERT(memcmp(s_out, expected, s_out_len) == 0);
+    TEST_ASSERT(s_send_calls == 1);
+
+    r = test_ws_init(false, NULL, 0);
+    s_ws_version = "8";
+    TEST_ASSERT(httpd_ws_respond_server_handshake(r) == ESP_ERR_INVALID_VERSION);
+
+    r = test_ws_init(false, NULL, 0);
+    s_ws_version = "13";
+    s_ws_key = NULL;
+    TEST_ASSERT(httpd_ws_respond_server_handshake(r) == ESP_ERR_NOT_FOUND);
+    TEST_ASSERT(s_out_len == 0);
+
+    r = test_ws_init(true, NULL, 0);
+    TEST_ASSERT(httpd_ws_respond_server_handshake(r) == ESP_ERR_INVALID_STATE);
+}
+
+static void test_ws_recv(void)
+{
+    /* RFC6455 section 5.7, a single-frame masked text message */
+    const uint8_t hello[] = { 0x81, 0x85, 0x37, 0xfa, 0x21, 0x3d, 0x7f, 0x9f, 0x4d, 0x51, 0x58 };
+    uint8_t buf[512];
+    httpd_ws_frame_t frame = { .payload = buf };
+    httpd_req_t *r = test_ws_init(true, hello, sizeof(hello));
+
+    TEST_ASSERT(httpd_ws_get_frame_type(r) == ESP_OK);
+    TEST_ASSERT(httpd_ws_recv_frame(r, &frame, 0) == ESP_OK);
+    TEST_ASSERT(frame.type == HTTPD_WS_TYPE_TEXT && frame.final && frame.len == 5);
+
+    /* Payload received in parts must be unmasked with the right key bytes */
+    TEST_ASSERT(httpd_ws_recv_frame(r, &frame, 2) == ESP_OK);
+    TEST_ASSERT(frame.len == 2 && memcmp(buf, "He", 2) == 0);
+    TEST_ASSERT(httpd_ws_recv_frame(r, &frame, sizeof(buf)) == ESP_OK);
+    TEST_ASSERT(frame.len == 3 && memcmp(buf, "llo", 3) == 0);
+    TEST_ASSERT(s_ra.remaining_len == 0);
+
+    /* RFC6455 section 5.7, fragmented unmasked text message is refused as it comes from a client */
+    const uint8_t unmasked[] = { 0x01, 0x03, 0x48, 0x65, 0x6c };
+    r = test_ws_init(true, unmasked, sizeof(unmasked));
+    TEST_ASSERT(httpd_ws_get_frame_type(r) == ESP_FAIL);
+
+    /* 16-bit length, not final */
+    uint8_t in[4 + 4 + 300];
+    const uint8_t mask[4] = { 0x11, 0x22, 0x33, 0x44 };
+    in[0] = HTTPD_WS_TYPE_BINARY;
+    in[1] = 0x80 | 126;
+    in[2] = 300 >> 8;
+    in[3] = 300 & 0xff;
+    memcpy(in + 4, mask, 4);
+    for (int i = 0; i < 300; i++) {
+        in[8 + i] = (uint8_t)i ^ mask[i % 4];
+    }
+    r = test_ws_init(true, in, sizeof(in));
+    TEST_ASSERT(httpd_ws_get_frame_type(r) == ESP_OK);
+    TEST_ASSERT(httpd_ws_recv_frame(r, &frame, sizeof(buf)) == ESP_OK);
+    TEST_ASSERT(frame.type == HTTPD_WS_TYPE_BINARY && !frame.final && frame.len == 300);
+    for (int i = 0; i < 300; i++) {
+        TEST_ASSERT(buf[i] == (uint8_t)i);
+    }
+
+    /* Control frames must not be fragmented */
+    const uint8_t ping[] = { HTTPD_WS_TYPE_PING, 0x80, 0, 0, 0, 0 };
+    r = test_ws_init(true, ping, sizeof(ping));
+    TEST_ASSERT(httpd_ws_get_frame_type(r) == ESP_FAIL);
+
+    /* No frames before the handshake */
+    r = test_ws_init(false, hello, sizeof(hello));
+    TEST_ASSERT(httpd_ws_recv_frame(r, &frame, sizeof(buf)) == ESP_ERR_INVALID_STATE);
+}
+
+static void test_ws_send(void)
+{
+    uint8_t payload[300];
+    httpd_ws_frame_t frame = {
+        .type    = HTTPD_WS_TYPE_TEXT,
+        .payload = (uint8_t *)"Hello",
+        .len     = 5
+    };
+    httpd_req_t *r = test_ws_init(true, NULL, 0);
+
+    /* Small frames are sent in one call */
+    TEST_ASSERT(httpd_ws_send_frame(r, &frame) == ESP_OK);
+    TEST_ASSERT(s_out_len == 7 && memcmp(s_out, "\x81\x05Hello", 7) == 0);
+    TEST_ASSERT(s_send_calls == 1);
+
+    /* First fragment of a message */
+    r = test_ws_init(true, NULL, 0);
+    frame.fragmented = true;
+    frame.final = false;
+    TEST_ASSERT(httpd_ws_send_frame(r, &frame) == ESP_OK);
+    TEST_ASSERT(s_out[0] == HTTPD_WS_TYPE_TEXT);
+
+    /* 16-bit length */
+    for (int i = 0; i < sizeof(payload); i++) {
+        payload[i] = i;
+    }
+    frame.type = HTTPD_WS_TYPE_BINARY;
+    frame.fragmented = false;
+    frame.payload = payload;
+    frame.len = sizeof(payload);
+    r = test_ws_init(true, NULL, 0);
+    TEST_ASSERT(httpd_ws_send_frame(r, &frame) == ESP_OK);
+    TEST_ASSERT(s_out_len == 4 + sizeof(payload));
+    TEST_ASSERT(memcmp(s_out, "\x82\x7e\x01\x2c", 4) == 0);
+    TEST_ASSERT(memcmp(s_out + 4, payload, sizeof(payload)) == 0);
+
+    /* Asynchronous send looks up the session */
+    frame.len = 1;
+    test_ws_init(true, NULL, 0);
+    TEST_ASSERT(httpd_ws_send_frame_async(&s_hd, TEST_FD, &frame) == ESP_OK);
+    TEST_ASSERT(s_out_len == 3 && memcmp(s_out, "\x82\x01\x00", 3) == 0);
+    TEST_ASSERT(httpd_ws_send_frame_async(&s_hd, TEST_FD + 1, &frame) == ESP_ERR_INVALID_ARG);
+
+    TEST_ASSERT(httpd_ws_get_fd_info(&s_hd, TEST_FD) == HTTPD_WS_CLIENT_WEBSOCKET);
+    TEST_ASSERT(httpd_ws_get_fd_info(&s_hd, TEST_FD + 1) == HTTPD_WS_CLIENT_INVALID);
+    test_ws_init(false, NULL, 0);
+    TEST_ASSERT(httpd_ws_send_frame_async(&s_hd, TEST_FD, &frame) == ESP_ERR_INVALID_STATE);
+    TEST_ASSERT(httpd_ws_get_fd_info(&s_hd, TEST_FD) == HTTPD_WS_CLIENT_HTTP);
+}
+
+void test_httpd_ws(void)
+{
+    test_ws_handshake();
+    test_ws_recv();
+    test_ws_send();
+}
@@ -20,6 +20,32 @@
 extern "C" {
 #endif
 
+/**
+ * @brief    OTA progress callback
+ *
+ * Called after every buffer written to flash. In pipelined mode it runs in the
+ * OTA writer task.
+ *
+ * @param[in]  written      bytes of the image written so far
+ * @param[in]  total        size of the image, or 0 if the server didn't send Content-Length
+ * @param[in]  rate         average throughput since the start of the download, in bytes per second
+ * @param[in]  arg          progress_arg of esp_https_ota_config_t
+ */
+typedef void (*esp_https_ota_progress_cb_t)(size_t written, size_t total, uint32_t rate, void *arg);
+
+/**
+ * @brief    HTTPS OTA configuration
+ */
+typedef struct {
+    const esp_http_client_config_t *http_config;    /*!< esp_http_client configuration */
+    esp_https_ota_progress_cb_t progress_cb;        /*!< Progress callback, may be NULL */
+    void *progress_arg;                             /*!< Argument passed to progress_cb */
+    int buf_size;                                   /*!< Size of each download buffer, 0 for CONFIG_OTA_BUF_SIZE */
+    int buf_count;                                  /*!< Number of download buffers, 0 for CONFIG_OTA_BUF_NUM.
+                                                         With 2 or more, a writer task flashes filled buffers
+                                                         while the calling task downloads into the free ones */
+} esp_https_ota_config_t;
+
 /**
  * @brief    HTTPS OTA Firmware upgrade.
  *
@@ -40,6 +66,25 @@ extern "C" {
  */
 esp_err_t esp_https_ota(const esp_http_client_config_t *config);
 
+/**
+ * @brief    HTTPS OTA Firmware upgrade with OTA options.
+ *
+ * This function performs HTTPS OTA Firmware upgrade like esp_https_ota(),
+ * with the download buffers and the progress callback taken from `ota_config`.
+ *
+ * @param[in]  ota_config   pointer to esp_https_ota_config_t structure.
+ *
+ * @return
+ *    - ESP_OK: OTA data updated, next reboot will use specified partition.
+ *    - ESP_FAIL: For generic failure.
+ *    - ESP_ERR_INVALID_ARG: Invalid argument
+ *    - ESP_ERR_OTA_VALIDATE_FAILED: Invalid app image
+ *    - ESP_ERR_NO_MEM: Cannot allocate memory or the writer task for OTA operation.
+ *    - ESP_ERR_FLASH_OP_TIMEOUT or ESP_ERR_FLASH_OP_FAIL: Flash write failed.
+ *    - For other return codes, refer OTA documentation in esp-idf's app_update component.
+ */
+esp_err_t esp_https_ota_with_config(const esp_https_ota_config_t *ota_config);
+
 #ifdef __cplusplus
 }
 #endif
@@ -15,27 +15,459 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
 #include <esp_https_ota.h>
 #include <esp_ota_ops.h>
+#include <esp_timer.h>
 #include <esp_log.h>
 #include "sdkconfig.h"
 
+#ifdef CONFIG_OTA_RESUME
+#include <strings.h>
+#include <sys/param.h>
+#include <esp_spi_flash.h>
+#include <esp_sha.h>
+#include <nvs.h>
+#endif
+
 #define OTA_BUF_SIZE    CONFIG_OTA_BUF_SIZE
 static const char *TAG = "esp_https_ota";
 
+typedef struct {
+    char *data;
+    int len;                            /* 0 marks the end of the image */
+} ota_buf_t;
+
+#ifdef CONFIG_OTA_RESUME
+#define OTA_RESUME_NVS_NAMESPACE    "https_ota"
+#define OTA_RESUME_NVS_KEY          "resume"
+#define OTA_RESUME_SAVE_SIZE        (CONFIG_OTA_RESUME_SAVE_SECTORS * SPI_FLASH_SEC_SIZE)
+#define OTA_RESUME_VALIDATOR_LEN    64
+
+/*
+ * Progress of an interrupted update, saved every OTA_RESUME_SAVE_SIZE bytes.
+ * The digest of the written prefix is checked against the flash contents
+ * before the update is resumed.
+ */
+typedef struct {
+    uint32_t part_addr;                 /* Address of the partition being updated */
+    uint32_t total_len;                 /* Size of the image */
+    uint32_t offset;                    /* Size of the prefix which was written */
+    uint8_t url_digest[32];             /* SHA-256 of the URL the image comes from */
+    uint8_t prefix_digest[32];          /* SHA-256 of the prefix */
+    char validator[OTA_RESUME_VALIDATOR_LEN];   /* Strong ETag or Last-Modified of the image, for If-Range */
+} ota_resume_state_t;
+
+typedef struct {
+    bool enabled;                       /* The size and a validator of the image are known */
+    ota_resume_state_t state;
+    esp_sha256_t sha;                   /* Running hash of the image written so far */
+    size_t next_save;
+    const esp_http_client_config_t *http_config;    /* Event handler of the application */
+    char etag[OTA_RESUME_VALIDATOR_LEN];            /* Headers of the last response */
+    char last_modified[OTA_RESUME_VALIDATOR_LEN];
+    char content_range[48];
+} ota_resume_t;
+#endif
+
+typedef struct {
+    const esp_https_ota_config_t *config;
+    esp_ota_handle_t update_handle;
+    size_t total_len;                   /* 0 if the server didn't tell */
+    size_t written_len;
+    size_t start_len;                   /* Size of the resumed prefix */
+    int64_t start_time;
+    esp_err_t write_err;
+    QueueHandle_t free_bufs;
+    QueueHandle_t full_bufs;
+    SemaphoreHandle_t writer_done;
+#ifdef CONFIG_OTA_RESUME
+    ota_resume_t resume;
+#endif
+} ota_pipeline_t;
+
 static void http_cleanup(esp_http_client_handle_t client)
 {
     esp_http_client_close(client);
     esp_http_client_cleanup(client);
 }
 
+#ifdef CONFIG_OTA_RESUME
+static void ota_resume_copy_header(char *dst, size_t len, const char *value)
+{
+    /* A truncated value would not match, it is dropped */
+    if (snprintf(dst, len, "%s", value) >= len) {
+        dst[0] = '\0';
+    }
+}
+
+/*
+ * Response headers are only passed to the event handler. This one keeps those
+ * which tell whether a download continues the same image, then calls the one
+ * of the application.
+ */
+static esp_err_t ota_resume_http_event(esp_http_client_event_t *evt)
+{
+    ota_resume_t *resume = (ota_resume_t *)evt->user_data;
+
+    if (evt->event_id == HTTP_EVENT_HEADERS_SENT) {
+        resume->etag[0] = '\0';
+        resume->last_modified[0] = '\0';
+        resume->content_range[0] = '\0';
+    } else if (evt->event_id == HTTP_EVENT_ON_HEADER) {
+        /* Weak ETags can't be used with If-Range */
+        if (strcasecmp(evt->header_key, "ETag") == 0 && strncmp(evt->header_value, "W/", 2) != 0) {
+            ota_resume_copy_header(resume->etag, sizeof(resume->etag), evt->header_value);
+        } else if (strcasecmp(evt->header_key, "Last-Modified") == 0) {
+            ota_resume_copy_header(resume->last_modified, sizeof(resume->last_modified), evt->header_value);
+        } else if (strcasecmp(evt->header_key, "Content-Range") == 0) {
+            ota_resume_copy_header(resume->content_range, sizeof(resume->content_range), evt->header_value);
+        }
+    }
+
+    if (!resume->http_config->event_handler) {
+        return ESP_OK;
+    }
+    evt->user_data = resume->http_config->user_data;
+    return resume->http_config->event_handler(evt);
+}
+
+static void ota_resume_url_digest(esp_http_client_handle_t client, uint8_t *digest)
+{
+    char url[256];
+    esp_sha256_t sha;
+
+    memset(url, 0, sizeof(url));
+    esp_http_client_get_url(client, url, sizeof(url));
+    esp_sha256_init(&sha);
+    esp_sha256_update(&sha, url, strlen(url));
+    esp_sha256_finish(&sha, digest);
+}
+
+static esp_err_t ota_resume_store(const ota_resume_state_t *state)
+{
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(OTA_RESUME_NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    if (state) {
+        err = nvs_set_blob(handle, OTA_RESUME_NVS_KEY, state, sizeof(*state));
+    } else {
+        err = nvs_erase_key(handle, OTA_RESUME_NVS_KEY);
+        if (err == ESP_ERR_NVS_NOT_FOUND) {
+            err = ESP_OK;
+        }
+    }
+    if (err == ESP_OK) {
+        err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+    return err;
+}
+
+/* Saves the progress once the image is written up to the next save point */
+static void ota_resume_update(ota_pipeline_t *pl, const char *data, size_t len)
+{
+    ota_resume_t *resume = &pl->resume;
+
+    while (len > 0) {
+        size_t n = MIN(len, resume->next_save - pl->written_len);
+
+        esp_sha256_update(&resume->sha, data, n);
+        pl->written_len += n;
+        data += n;
+        len -= n;
+
+        if (pl->written_len == resume->next_save) {
+            esp_sha256_t sha = resume->sha;
+
+            esp_sha256_finish(&sha, resume->state.prefix_digest);
+            resume->state.offset = pl->written_len;
+            if (ota_resume_store(&resume->state) != ESP_OK) {
+                ESP_LOGW(TAG, "Failed to save OTA progress");
+            }
+            resume->next_save += OTA_RESUME_SAVE_SIZE;
+        }
+    }
+}
+
+/*
+ * Checks whether an interrupted update of the same image into the same partition
+ * can be resumed. The running hash is computed over the prefix read back from
+ * flash and must match the saved one.
+ *
+ * Returns the size of the prefix to resume after, 0 to start over.
+ */
+static size_t ota_resume_load(ota_pipeline_t *pl, esp_http_client_handle_t client,
+                              const esp_partition_t *part)
+{
+    ota_resume_t *resume = &pl->resume;
+    ota_resume_state_t saved;
+    uint8_t digest[32];
+    size_t len = sizeof(saved);
+    nvs_handle_t handle;
+    char *buf;
+
+    esp_sha256_init(&resume->sha);
+    memset(&resume->state, 0, sizeof(resume->state));
+    resume->state.part_addr = part->address;
+    ota_resume_url_digest(client, resume->state.url_digest);
+
+    if (nvs_open(OTA_RESUME_NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+        return 0;
+    }
+    esp_err_t err = nvs_get_blob(handle, OTA_RESUME_NVS_KEY, &saved, &len);
+    nvs_close(handle);
+    if (err != ESP_OK || len != sizeof(saved)) {
+        return 0;
+    }
+
+    if (saved.part_addr != part->address ||
+        memcmp(saved.url_digest, resume->state.url_digest, sizeof(saved.url_digest)) ||
+        saved.offset == 0 || saved.offset >= saved.total_len || saved.offset > part->size ||
+        saved.validator[0] == '\0' || saved.validator[sizeof(saved.validator) - 1] != '\0') {
+        ESP_LOGI(TAG, "Saved OTA progress is for another update");
+        return 0;
+    }
+
+    buf = malloc(OTA_BUF_SIZE);
+    if (!buf) {
+        return 0;
+    }
+    for (size_t off = 0; off < saved.offset; off += OTA_BUF_SIZE) {
+        size_t n = MIN(OTA_BUF_SIZE, saved.offset - off);
+        if (esp_partition_read(part, off, buf, n) != ESP_OK) {
+            break;
+        }
+        esp_sha256_update(&resume->sha, buf, n);
+    }
+    free(buf);
+
+    esp_sha256_t sha = resume->sha;
+    esp_sha256_finish(&sha, digest);
+    if (memcmp(digest, saved.prefix_digest, sizeof(digest))) {
+        ESP_LOGW(TAG, "Written OTA data doesn't match the saved progress, starting over");
+        esp_sha256_init(&resume->sha);
+        return 0;
+    }
+
+    resume->state = saved;
+    return saved.offset;
+}
+
+/*
+ * A resumed download must be the rest of the same image: a 206 response with
+ * "Content-Range: bytes <offset>-<total - 1>/<total>". If the image changed,
+ * If-Range makes the server send all of it with 200 instead.
+ */
+static bool ota_resume_response_matches(ota_pipeline_t *pl, esp_http_client_handle_t client,
+                                        size_t offset, int content_len)
+{
+    const ota_resume_t *resume = &pl->resume;
+    unsigned int first, last, total;
+    int end = 0;
+
+    if (esp_http_client_get_status_code(client) != 206 ||
+        sscanf(resume->content_range, "bytes %u-%u/%u%n", &first, &last, &total, &end) != 3 ||
+        resume->content_range[end] != '\0') {
+        return false;
+    }
+    return first == offset && total == resume->state.total_len && last == total - 1 &&
+           content_len == (int)(total - offset);
+}
+
+/* Called once the response tells whether the download starts at 'offset' */
+static void ota_resume_start(ota_pipeline_t *pl, size_t offset, size_t total_len)
+{
+    ota_resume_t *resume = &pl->resume;
+
+    if (offset == 0) {
+        esp_sha256_init(&resume->sha);
+        resume->state.total_len = total_len;
+        resume->state.offset = 0;
+        /* Only an image which the server can tell apart from another one is resumed */
+        strcpy(resume->state.validator, resume->etag[0] ? resume->etag : resume->last_modified);
+    }
+    resume->enabled = total_len > 0 && resume->state.validator[0];
+    resume->next_save = offset + OTA_RESUME_SAVE_SIZE;
+}
+#endif
+
+static esp_err_t ota_write(ota_pipeline_t *pl, const char *data, int len)
+{
+    esp_err_t err = esp_ota_write(pl->update_handle, (const void *)data, len);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+#ifdef CONFIG_OTA_RESUME
+    if (pl->resume.enabled) {
+        ota_resume_update(pl, data, len);
+    } else {
+        pl->written_len += len;
+    }
+#else
+    pl->written_len += len;
+#endif
+    ESP_LOGD(TAG, "Written image length %d", pl->written_len);
+
+    if (pl->config->progress_cb) {
+        int64_t elapsed = esp_timer_get_time() - pl->start_time;
+        uint32_t rate = elapsed > 0 ? (uint32_t)((int64_t)(pl->written_len - pl->start_len) * 1000000 / elapsed) : 0;
+        pl->config->progress_cb(pl->written_len, pl->total_len, rate, pl->config->progress_arg);
+    }
+    return ESP_OK;
+}
+
+/* Reads and writes one buffer after the other in the calling task */
+static esp_err_t ota_download(ota_pipeline_t *pl, esp_http_client_handle_t client, int buf_size)
+{
+    char *upgrade_data_buf = (char *)malloc(buf_size);
+    if (!upgrade_data_buf) {
+        ESP_LOGE(TAG, "Couldn't allocate memory to upgrade data buffer");
+        return ESP_ERR_NO_MEM;
+    }
+
+    while (1) {
+        int data_read = esp_http_client_read(client, upgrade_data_buf, buf_size);
+        if (data_read == 0) {
+            ESP_LOGI(TAG, "Connection closed,all data received");
+            break;
+        }
+        if (data_read < 0) {
+            ESP_LOGE(TAG, "Error: SSL data read error");
+            break;
+        }
+        pl->write_err = ota_write(pl, upgrade_data_buf, data_read);
+        if (pl->write_err != ESP_OK) {
+            break;
+        }
+    }
+    free(upgrade_data_buf);
+    return ESP_OK;
+}
+
+/*
+ * Writes the buffers filled by ota_download_pipelined() to flash. After a write
+ * error, buffers are only handed back, so that the reader sees the error.
+ */
+static void ota_writer_task(void *arg)
+{
+    ota_pipeline_t *pl = (ota_pipeline_t *)arg;
+    ota_buf_t *buf;
+
+    while (1) {
+        xQueueReceive(pl->full_bufs, &buf, portMAX_DELAY);
+        if (buf->len == 0) {
+            break;
+        }
+        if (pl->write_err == ESP_OK) {
+            pl->write_err = ota_write(pl, buf->data, buf->len);
+        }
+        xQueueSend(pl->free_bufs, &buf, portMAX_DELAY);
+    }
+
+    xSemaphoreGive(pl->writer_done);
+    vTaskDelete(NULL);
+}
+
+/*
+ * Reads into free buffers in the calling task, while a writer task flashes the
+ * filled ones, so that receiving and decrypting go on while flash is programmed
+ */
+static esp_err_t ota_download_pipelined(ota_pipeline_t *pl, esp_http_client_handle_t client,
+                                        int buf_size, int buf_count)
+{
+    esp_err_t err = ESP_ERR_NO_MEM;
+    ota_buf_t *bufs = calloc(buf_count, sizeof(ota_buf_t));
+    char *data = malloc(buf_count * buf_size);
+
+    pl->free_bufs = xQueueCreate(buf_count, sizeof(ota_buf_t *));
+    pl->full_bufs = xQueueCreate(buf_count, sizeof(ota_buf_t *));
+    pl->writer_done = xSemaphoreCreateBinary();
+    if (!bufs || !data || !pl->free_bufs || !pl->full_bufs || !pl->writer_done) {
+        ESP_LOGE(TAG, "Couldn't allocate memory to upgrade data buffers");
+        goto cleanup;
+    }
+
+    for (int i = 0; i < buf_count; i++) {
+        ota_buf_t *buf = &bufs[i];
+        buf->data = data + i * buf_size;
+        xQueueSend(pl->free_bufs, &buf, 0);
+    }
+
+    if (xTaskCreate(ota_writer_task, "ota_writer", CONFIG_OTA_WRITER_TASK_STACK_SIZE, pl,
+                    uxTaskPriorityGet(NULL), NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Couldn't create OTA writer task");
+        goto cleanup;
+    }
+
+    while (1) {
+        ota_buf_t *buf;
+        xQueueReceive(pl->free_bufs, &buf, portMAX_DELAY);
+
+        if (pl->write_err != ESP_OK) {
+            buf->len = 0;
+        } else {
+            buf->len = esp_http_client_read(client, buf->data, buf_size);
+            if (buf->len == 0) {
+                ESP_LOGI(TAG, "Connection closed,all data received");
+            } else if (buf->len < 0) {
+                ESP_LOGE(TAG, "Error: SSL data read error");
+                buf->len = 0;
+            }
+        }
+
+        xQueueSend(pl->full_bufs, &buf, portMAX_DELAY);
+        if (buf->len == 0) {
+            break;
+        }
+    }
+
+    /* The writer finishes the buffers queued before the end */
+    xSemaphoreTake(pl->writer_done, portMAX_DELAY);
+    err = ESP_OK;
+
+cleanup:
+    if (pl->writer_done) {
+        vSemaphoreDelete(pl->writer_done);
+    }
+    if (pl->full_bufs) {
+        vQueueDelete(pl->full_bufs);
+    }
+    if (pl->free_bufs) {
+        vQueueDelete(pl->free_bufs);
+    }
+    free(data);
+    free(bufs);
+    return err;
+}
+
 esp_err_t esp_https_ota(const esp_http_client_config_t *config)
 {
-    if (!config) {
+    esp_https_ota_config_t ota_config = {
+        .http_config = config,
+    };
+
+    return esp_https_ota_with_config(&ota_config);
+}
+
+esp_err_t esp_https_ota_with_config(const esp_https_ota_config_t *ota_config)
+{
+    if (!ota_config || !ota_config->http_config) {
         ESP_LOGE(TAG, "esp_http_client config not found");
         return ESP_ERR_INVALID_ARG;
     }
 
+    const esp_http_client_config_t *config = ota_config->http_config;
+    int buf_size = ota_config->buf_size ? ota_config->buf_size : OTA_BUF_SIZE;
+    int buf_count = ota_config->buf_count ? ota_config->buf_count : CONFIG_OTA_BUF_NUM;
+
 #if !CONFIG_OTA_ALLOW_HTTP
     if (!config->cert_pem) {
         ESP_LOGE(TAG, "Server certificate not found in esp_http_client config");
@@ -43,6 +475,20 @@ esp_err_t esp_https_ota(const esp_http_client_config_t *config)
     }
 #endif
 
+    ota_pipeline_t pl = {
+        .config = ota_config,
+        .write_err = ESP_OK,
+    };
+    size_t offset = 0;
+
+#ifdef CONFIG_OTA_RESUME
+    esp_http_client_config_t resume_config = *config;
+    resume_config.event_handler = ota_resume_http_event;
+    resume_config.user_data = &pl.resume;
+    pl.resume.http_config = config;
+    config = &resume_config;
+#endif
+
     esp_http_client_handle_t client = esp_http_client_init(config);
     if (client == NULL) {
         ESP_LOGE(TAG, "Failed to initialise HTTP connection");
@@ -56,27 +502,74 @@ esp_err_t esp_https_ota(const esp_http_client_config_t *config)
     }
 #endif
 
+    esp_ota_handle_t update_handle = 0;
+    const esp_partition_t *update_partition = NULL;
+    update_partition = esp_ota_get_next_update_partition(NULL);
+    if (update_partition == NULL) {
+        ESP_LOGE(TAG, "Passive OTA partition not found");
+        esp_http_client_cleanup(client);
+        return ESP_FAIL;
+    }
+
+#ifdef CONFIG_OTA_RESUME
+    offset = ota_resume_load(&pl, client, update_partition);
+    if (offset) {
+        char range[32];
+        snprintf(range, sizeof(range), "bytes=%u-", (unsigned int)offset);
+        esp_http_client_set_header(client, "Range", range);
+        esp_http_client_set_header(client, "If-Range", pl.resume.state.validator);
+    }
+#endif
+
+    int content_len = 0;
     esp_err_t err = esp_http_client_open(client, 0);
+    if (err == ESP_OK) {
+        esp_http_client_fetch_headers(client);
+        content_len = esp_http_client_get_content_length(client);
+    }
+#ifdef CONFIG_OTA_RESUME
+    if (err == ESP_OK && offset) {
+        if (ota_resume_response_matches(&pl, client, offset, content_len)) {
+            ESP_LOGI(TAG, "Resuming OTA at offset 0x%x", offset);
+            content_len = pl.resume.state.total_len;
+        } else {
+            ESP_LOGI(TAG, "Server didn't resume the image, starting over");
+            offset = 0;
+            /* Servers which don't support ranges, or whose image changed, send all of it */
+            if (esp_http_client_get_status_code(client) != 200) {
+                esp_http_client_close(client);
+                esp_http_client_delete_header(client, "Range");
+                esp_http_client_delete_header(client, "If-Range");
+                err = esp_http_client_open(client, 0);
+                if (err == ESP_OK) {
+                    esp_http_client_fetch_headers(client);
+                    content_len = esp_http_client_get_content_length(client);
+                }
+            }
+        }
+    }
+#endif
     if (err != ESP_OK) {
         esp_http_client_cleanup(client);
         ESP_LOGE(TAG, "Failed to open HTTP connection: %d", err);
         return err;
     }
-    esp_http_client_fetch_headers(client);
+#ifdef CONFIG_OTA_RESUME
+    ota_resume_start(&pl, offset, content_len > 0 ? content_len : 0);
+#endif
+    if (content_len > 0) {
+        pl.total_len = content_len;
+    }
 
-    esp_ota_handle_t update_handle = 0;
-    const esp_partition_t *update_partition = NULL;
     ESP_LOGI(TAG, "Starting OTA...");
-    update_partition = esp_ota_get_next_update_partition(NULL);
-    if (update_partition == NULL) {
-        ESP_LOGE(TAG, "Passive OTA partition not found");
-        http_cleanup(client);
-        return ESP_FAIL;
-    }
     ESP_LOGI(TAG, "Writing to partition subtype %d at offset 0x%x",
              update_partition->subtype, update_partition->address);
 
-    err = esp_ota_begin(update_partition, OTA_SIZE_UNKNOWN, &update_handle);
+    if (offset) {
+        err = esp_ota_resume(update_partition, offset, &update_handle);
+    } else {
+        err = esp_ota_begin(update_partition, OTA_WITH_SEQUENTIAL_WRITES, &update_handle);
+    }
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "esp_ota_begin failed, error=%d", err);
         http_cleanup(client);
@@ -85,39 +578,33 @@ esp_err_t esp_https_ota(const esp_http_client_config_t *config)
     ESP_LOGI(TAG, "esp_ota_begin succeeded");
     ESP_LOGI(TAG, "Please Wait. This may take time");
 
-    esp_err_t ota_write_err = ESP_OK;
-    char *upgrade_data_buf = (char *)malloc(OTA_BUF_SIZE);
-    if (!upgrade_data_buf) {
-        ESP_LOGE(TAG, "Couldn't allocate memory to upgrade data buffer");
-        return ESP_ERR_NO_MEM;
+    pl.update_handle = update_handle;
+    pl.written_len = offset;
+    pl.start_len = offset;
+    pl.start_time = esp_timer_get_time();
+
+    if (buf_count > 1) {
+        err = ota_download_pipelined(&pl, client, buf_size, buf_count);
+    } else {
+        err = ota_download(&pl, client, buf_size);
     }
-    int binary_file_len = 0;
-    while (1) {
-        int data_read = esp_http_client_read(client, upgrade_data_buf, OTA_BUF_SIZE);
-        if (data_read == 0) {
-            ESP_LOGI(TAG, "Connection closed,all data received");
-            break;
-        }
-        if (data_read < 0) {
-            ESP_LOGE(TAG, "Error: SSL data read error");
-            break;
-        }
-        if (data_read > 0) {
-            ota_write_err = esp_ota_write( update_handle, (const void *)upgrade_data_buf, data_read);
-            if (ota_write_err != ESP_OK) {
-                break;
-            }
-            binary_file_len += data_read;
-            ESP_LOGD(TAG, "Written image length %d", binary_file_len);
-        }
+    http_cleanup(client);
+    if (err != ESP_OK) {
+        esp_ota_end(update_handle);
+        return err;
     }
-    free(upgrade_data_buf);
-    http_cleanup(client); 
-    ESP_LOGD(TAG, "Total binary data length writen: %d", binary_file_len);
-    
+    ESP_LOGD(TAG, "Total binary data length writen: %d", pl.written_len);
+
+    esp_err_t ota_write_err = pl.write_err;
+#ifdef CONFIG_OTA_RESUME
+    /* An incomplete image keeps its progress for the next try */
+    if (ota_write_err == ESP_OK && pl.total_len && pl.written_len >= pl.total_len) {
+        ota_resume_store(NULL);
+    }
+#endif
     esp_err_t ota_end_err = esp_ota_end(update_handle);
     if (ota_write_err != ESP_OK) {
-        ESP_LOGE(TAG, "Error: esp_ota_write failed! err=0x%d", err);
+        ESP_LOGE(TAG, "Error: esp_ota_write failed! err=0x%d", ota_write_err);
         return ota_write_err;
     } else if (ota_end_err != ESP_OK) {
         ESP_LOGE(TAG, "Error: esp_ota_end failed! err=0x%d. Image is invalid", ota_end_err);
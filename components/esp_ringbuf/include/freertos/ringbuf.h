@@ -162,6 +162,28 @@ void *xRingbufferReceive(RingbufHandle_t xRingbuffer, size_t *pxItemSize, TickTy
  */
 void *xRingbufferReceiveFromISR(RingbufHandle_t xRingbuffer, size_t *pxItemSize);
 
+/**
+ * @brief   Retrieve an item from a no-split or allow-split ring buffer without locking
+ *
+ * For panic handlers and other code which runs when no task or interrupt can
+ * use the ring buffer any more. No critical section is entered and no semaphore
+ * is given, so tasks blocked on the ring buffer are not woken.
+ *
+ * @param[in]   xRingbuffer     Ring buffer to retrieve the item from
+ * @param[out]  pxItemSize      Pointer to a variable to which the size of the
+ *                              retrieved item will be written.
+ *
+ * @note    Retrieved items are never returned, the ring buffer must not be used
+ *          by other functions afterwards.
+ * @note    For allow-split buffers, the two parts of a split item are retrieved
+ *          as two items.
+ *
+ * @return
+ *      - Pointer to the retrieved item on success; *pxItemSize filled with the length of the item.
+ *      - NULL when the ring buffer is empty, *pxItemSize is untouched in that case.
+ */
+void *xRingbufferReceiveFromPanic(RingbufHandle_t xRingbuffer, size_t *pxItemSize);
+
 /**
  * @brief   Retrieve a split item from an allow-split ring buffer
  *
@@ -876,6 +876,26 @@ void *xRingbufferReceiveFromISR(RingbufHandle_t xRingbuffer, size_t *pxItemSize)
     }
 }
 
+void *xRingbufferReceiveFromPanic(RingbufHandle_t xRingbuffer, size_t *pxItemSize)
+{
+    //Check arguments
+    Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
+    configASSERT(pxRingbuffer);
+    configASSERT(!(pxRingbuffer->uxRingbufferFlags & rbBYTE_BUFFER_FLAG));
+
+    //Nothing else runs, so the buffer is accessed without critical section
+    if (prvCheckItemAvail(pxRingbuffer) != pdTRUE) {
+        return NULL;
+    }
+    BaseType_t xIsSplit;
+    size_t xTempSize;
+    void *pvTempItem = pxRingbuffer->pvGetItem(pxRingbuffer, &xIsSplit, 0, &xTempSize);
+    if (pxItemSize != NULL) {
+        *pxItemSize = xTempSize;
+    }
+    return pvTempItem;
+}
+
 BaseType_t xRingbufferReceiveSplit(RingbufHandle_t xRingbuffer, void **ppvHeadItem, void **ppvTailItem, size_t *pxHeadItemSize, size_t *pxTailItemSize, TickType_t xTicksToWait)
 {
     //Check arguments
@@ -12,12 +12,41 @@
 #include <time.h>
 #include <stdlib.h>
 #include <sys/time.h>
+#include <sys/param.h>
+#include <stdbool.h>
 #include "diskio_impl.h"
 #include "ffconf.h"
 #include "ff.h"
+#include "esp_log.h"
+
+static const char* TAG = "ff_diskio";
 
 static ff_diskio_impl_t * s_impls[FF_VOLUMES] = { NULL };
 
+/* Sectors around the last access, either read ahead or written but not
+ * passed to the driver yet (dirty). Reads which follow one of the previous
+ * two fill the whole run with one driver call, writes to adjacent sectors are
+ * collected until another sector is written or the drive is synced.
+ *
+ * FATFS goes back to the same FAT or directory sector between the sectors of
+ * a file, that sector is kept apart from the run in one more sector.
+ */
+typedef struct {
+    BYTE *buf;                  /* (sectors + 1) * sector_size bytes, the run then the other sector */
+    UINT sectors;               /* Size of the run in sectors */
+    WORD sector_size;
+    DWORD sector_count;         /* Sectors of the drive, also used for no sector */
+    DWORD first;                /* First sector of the run */
+    UINT count;                 /* Sectors in the run, 0 if empty */
+    bool dirty;                 /* Sectors of the run are to be written */
+    DWORD other;                /* Sector kept apart from the run */
+    bool other_dirty;
+    DWORD next[2];              /* Sectors after the last two reads */
+    bool gather_writes;         /* Otherwise writes are passed to the driver */
+} ff_diskio_batch_t;
+
+static ff_diskio_batch_t * s_batch[FF_VOLUMES] = { NULL };
+
 #if FF_MULTI_PARTITION		/* Multiple partition configuration */
 PARTITION VolToPart[] = {
     {0, 0},    /* Logical drive 0 ==> Physical drive 0, auto detection */
@@ -37,10 +66,288 @@ esp_err_t ff_diskio_get_drive(BYTE* out_pdrv)
     return ESP_ERR_NOT_FOUND;
 }
 
+static bool ff_diskio_batch_overlaps(const ff_diskio_batch_t *b, DWORD sector, UINT count)
+{
+    return b->count && sector < b->first + b->count && b->first < sector + count;
+}
+
+static bool ff_diskio_batch_other_in(const ff_diskio_batch_t *b, DWORD sector, UINT count)
+{
+    return b->other != b->sector_count && b->other >= sector && b->other < sector + count;
+}
+
+static BYTE *ff_diskio_batch_other_buf(const ff_diskio_batch_t *b)
+{
+    return b->buf + b->sectors * b->sector_size;
+}
+
+static DRESULT ff_diskio_batch_flush_run(BYTE pdrv, ff_diskio_batch_t *b)
+{
+    if (!b->dirty) {
+        return RES_OK;
+    }
+    DRESULT res = s_impls[pdrv]->write(pdrv, b->buf, b->first, b->count);
+    b->dirty = false;
+    if (res != RES_OK) {
+        /* The error is reported once, the sectors are not retried */
+        b->count = 0;
+    }
+    return res;
+}
+
+static DRESULT ff_diskio_batch_flush_other(BYTE pdrv, ff_diskio_batch_t *b)
+{
+    if (!b->other_dirty) {
+        return RES_OK;
+    }
+    DRESULT res = s_impls[pdrv]->write(pdrv, ff_diskio_batch_other_buf(b), b->other, 1);
+    b->other_dirty = false;
+    if (res != RES_OK) {
+        b->other = b->sector_count;
+    }
+    return res;
+}
+
+static DRESULT ff_diskio_batch_flush(BYTE pdrv, ff_diskio_batch_t *b)
+{
+    DRESULT res = ff_diskio_batch_flush_run(pdrv, b);
+    DRESULT res_other = ff_diskio_batch_flush_other(pdrv, b);
+    return res != RES_OK ? res : res_other;
+}
+
+/* Written sectors in the other sector are the start of a file. They become
+ * the run, the first sector of the run takes their place. */
+static DRESULT ff_diskio_batch_swap(BYTE pdrv, ff_diskio_batch_t *b)
+{
+    if (b->count > 1) {
+        DRESULT res = ff_diskio_batch_flush_run(pdrv, b);
+        if (res != RES_OK) {
+            return res;
+        }
+        b->count = 1;
+    }
+
+    BYTE *run = b->buf;
+    BYTE *other = ff_diskio_batch_other_buf(b);
+    for (WORD i = 0; i < b->sector_size; i++) {
+        BYTE t = run[i];
+        run[i] = other[i];
+        other[i] = t;
+    }
+
+    DWORD first = b->first;
+    bool dirty = b->dirty;
+    bool had_run = b->count != 0;
+    b->first = b->other;
+    b->count = 1;
+    b->dirty = true;
+    b->other = had_run ? first : b->sector_count;
+    b->other_dirty = had_run && dirty;
+    return RES_OK;
+}
+
+static DRESULT ff_diskio_batch_read(BYTE pdrv, ff_diskio_batch_t *b, BYTE* buff, DWORD sector, UINT count)
+{
+    if (count == 1 && sector == b->other) {
+        memcpy(buff, ff_diskio_batch_other_buf(b), b->sector_size);
+        return RES_OK;
+    }
+
+    bool sequential = true;
+    if (sector == b->next[0] || sector + count == b->next[0]) {
+        b->next[0] = sector + count;
+    } else if (sector == b->next[1] || sector + count == b->next[1]) {
+        b->next[1] = sector + count;
+    } else {
+        sequential = false;
+        b->next[1] = b->next[0];
+        b->next[0] = sector + count;
+    }
+
+    if (b->count && sector >= b->first && sector + count <= b->first + b->count) {
+        memcpy(buff, b->buf + (sector - b->first) * b->sector_size, count * b->sector_size);
+        return RES_OK;
+    }
+    if (b->dirty && ff_diskio_batch_overlaps(b, sector, count)) {
+        DRESULT res = ff_diskio_batch_flush_run(pdrv, b);
+        if (res != RES_OK) {
+            return res;
+        }
+    }
+
+    /* Reading ahead would flush the sectors being collected */
+    if (sequential && !b->dirty && count < b->sectors && sector + count <= b->sector_count) {
+        UINT n = MIN(b->sectors, b->sector_count - sector);
+        /* A sector is never kept twice */
+        if (ff_diskio_batch_other_in(b, sector, n)) {
+            DRESULT res = ff_diskio_batch_flush_other(pdrv, b);
+            if (res != RES_OK) {
+                return res;
+            }
+            b->other = b->sector_count;
+        }
+        b->count = 0;
+        DRESULT res = s_impls[pdrv]->read(pdrv, b->buf, sector, n);
+        if (res != RES_OK) {
+            return res;
+        }
+        b->first = sector;
+        b->count = n;
+        memcpy(buff, b->buf, count * b->sector_size);
+        return RES_OK;
+    }
+
+    if (count == 1) {
+        DRESULT res = ff_diskio_batch_flush_other(pdrv, b);
+        if (res != RES_OK) {
+            return res;
+        }
+        b->other = b->sector_count;
+        res = s_impls[pdrv]->read(pdrv, ff_diskio_batch_other_buf(b), sector, 1);
+        if (res != RES_OK) {
+            return res;
+        }
+        b->other = sector;
+        memcpy(buff, ff_diskio_batch_other_buf(b), b->sector_size);
+        return RES_OK;
+    }
+
+    if (b->other_dirty && ff_diskio_batch_other_in(b, sector, count)) {
+        DRESULT res = ff_diskio_batch_flush_other(pdrv, b);
+        if (res != RES_OK) {
+            return res;
+        }
+    }
+    return s_impls[pdrv]->read(pdrv, buff, sector, count);
+}
+
+static DRESULT ff_diskio_batch_write(BYTE pdrv, ff_diskio_batch_t *b, const BYTE* buff, DWORD sector, UINT count)
+{
+    if (!b->gather_writes) {
+        /* Nothing is dirty, the sectors read before are dropped */
+        if (ff_diskio_batch_overlaps(b, sector, count)) {
+            b->count = 0;
+        }
+        if (ff_diskio_batch_other_in(b, sector, count)) {
+            b->other = b->sector_count;
+        }
+        return s_impls[pdrv]->write(pdrv, buff, sector, count);
+    }
+
+    if (count == 1 && sector == b->other) {
+        memcpy(ff_diskio_batch_other_buf(b), buff, b->sector_size);
+        b->other_dirty = true;
+        return RES_OK;
+    }
+    if (count == 1 && b->other_dirty && sector == b->other + 1 &&
+        !(b->dirty && sector >= b->first && sector <= b->first + b->count)) {
+        DRESULT res = ff_diskio_batch_swap(pdrv, b);
+        if (res != RES_OK) {
+            return res;
+        }
+    }
+
+    /* Overwritten, including the first sector of a run just swapped */
+    if (ff_diskio_batch_other_in(b, sector, count)) {
+        b->other = b->sector_count;
+        b->other_dirty = false;
+    }
+
+    /* Overwrites or extends the sectors being collected */
+    if (b->dirty && sector >= b->first && sector <= b->first + b->count &&
+        sector + count <= b->first + b->sectors) {
+        memcpy(b->buf + (sector - b->first) * b->sector_size, buff, count * b->sector_size);
+        b->count = MAX(b->count, sector + count - b->first);
+        return RES_OK;
+    }
+
+    /* Kept apart, unless it follows the run which is full */
+    if (count == 1 && b->dirty && sector != b->first + b->count) {
+        DRESULT res = ff_diskio_batch_flush_other(pdrv, b);
+        if (res != RES_OK) {
+            return res;
+        }
+        memcpy(ff_diskio_batch_other_buf(b), buff, b->sector_size);
+        b->other = sector;
+        b->other_dirty = true;
+        return RES_OK;
+    }
+
+    DRESULT res = ff_diskio_batch_flush_run(pdrv, b);
+    if (res != RES_OK) {
+        return res;
+    }
+    if (count >= b->sectors) {
+        if (ff_diskio_batch_overlaps(b, sector, count)) {
+            b->count = 0;
+        }
+        return s_impls[pdrv]->write(pdrv, buff, sector, count);
+    }
+    memcpy(b->buf, buff, count * b->sector_size);
+    b->first = sector;
+    b->count = count;
+    b->dirty = true;
+    return RES_OK;
+}
+
+static void ff_diskio_batch_free(BYTE pdrv)
+{
+    ff_diskio_batch_t *b = s_batch[pdrv];
+    if (!b) {
+        return;
+    }
+    s_batch[pdrv] = NULL;
+    if (ff_diskio_batch_flush(pdrv, b) != RES_OK) {
+        ESP_LOGE(TAG, "failed to write buffered sectors of drive %u", pdrv);
+    }
+    free(b->buf);
+    free(b);
+}
+
+esp_err_t ff_diskio_set_batch(BYTE pdrv, UINT sectors, bool gather_writes)
+{
+    assert(pdrv < FF_VOLUMES);
+
+    ff_diskio_batch_free(pdrv);
+    if (sectors == 0) {
+        return ESP_OK;
+    }
+    if (!s_impls[pdrv]) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    WORD sector_size;
+    DWORD sector_count;
+    if (s_impls[pdrv]->ioctl(pdrv, GET_SECTOR_SIZE, &sector_size) != RES_OK ||
+        s_impls[pdrv]->ioctl(pdrv, GET_SECTOR_COUNT, &sector_count) != RES_OK) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    ff_diskio_batch_t *b = (ff_diskio_batch_t *)calloc(1, sizeof(ff_diskio_batch_t));
+    if (b == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    b->buf = (BYTE *)malloc((sectors + 1) * sector_size);
+    if (b->buf == NULL) {
+        free(b);
+        return ESP_ERR_NO_MEM;
+    }
+    b->sectors = sectors;
+    b->sector_size = sector_size;
+    b->sector_count = sector_count;
+    b->other = sector_count;
+    b->next[0] = sector_count;
+    b->next[1] = sector_count;
+    b->gather_writes = gather_writes;
+    s_batch[pdrv] = b;
+    return ESP_OK;
+}
+
 void ff_diskio_register(BYTE pdrv, const ff_diskio_impl_t* discio_impl)
 {
     assert(pdrv < FF_VOLUMES);
 
+    ff_diskio_batch_free(pdrv);
     if (s_impls[pdrv]) {
         ff_diskio_impl_t* im = s_impls[pdrv];
         s_impls[pdrv] = NULL;
@@ -67,14 +374,26 @@ DSTATUS ff_disk_status (BYTE pdrv)
 }
 DRESULT ff_disk_read (BYTE pdrv, BYTE* buff, DWORD sector, UINT count)
 {
+    if (s_batch[pdrv]) {
+        return ff_diskio_batch_read(pdrv, s_batch[pdrv], buff, sector, count);
+    }
     return s_impls[pdrv]->read(pdrv, buff, sector, count);
 }
 DRESULT ff_disk_write (BYTE pdrv, const BYTE* buff, DWORD sector, UINT count)
 {
+    if (s_batch[pdrv]) {
+        return ff_diskio_batch_write(pdrv, s_batch[pdrv], buff, sector, count);
+    }
     return s_impls[pdrv]->write(pdrv, buff, sector, count);
 }
 DRESULT ff_disk_ioctl (BYTE pdrv, BYTE cmd, void* buff)
 {
+    if (s_batch[pdrv] && cmd == CTRL_SYNC) {
+        DRESULT res = ff_diskio_batch_flush(pdrv, s_batch[pdrv]);
+        if (res != RES_OK) {
+            return res;
+        }
+    }
     return s_impls[pdrv]->ioctl(pdrv, cmd, buff);
 }
 
@@ -19,6 +19,7 @@ extern "C" {
 #endif
 
 #include <stdint.h>
+#include <stdbool.h>
 typedef unsigned int UINT;
 typedef unsigned char BYTE;
 typedef uint32_t DWORD;
@@ -53,6 +54,27 @@ void ff_diskio_register(BYTE pdrv, const ff_diskio_impl_t* discio_impl);
 
 #define ff_diskio_unregister(pdrv_) ff_diskio_register(pdrv_, NULL)
 
+/**
+ * Read ahead and gather writes of a registered drive in a buffer
+ *
+ * Reads of the sectors following the previous read fill the whole buffer with
+ * one call of the driver. If gather_writes is set, writes of adjacent sectors
+ * are collected in the buffer and passed to the driver in one call when another
+ * sector is written, or when FATFS syncs the drive. Otherwise writes are passed
+ * to the driver right away, so that its result is returned. One more sector is
+ * allocated for the FAT or directory sector accessed between those of a file.
+ * The buffer is flushed and freed when the drive is unregistered.
+ *
+ * @param pdrv          drive number
+ * @param sectors       size of the buffer in sectors, 0 to free the buffer
+ * @param gather_writes true to collect written sectors in the buffer, false to only read ahead
+ *
+ * @return  ESP_OK                  on success
+ *          ESP_ERR_NO_MEM          if the buffer can't be allocated
+ *          ESP_ERR_INVALID_STATE   if the drive is not registered, or its sector size is unknown
+ */
+esp_err_t ff_diskio_set_batch(BYTE pdrv, UINT sectors, bool gather_writes);
+
 
 /**
  * Get next available drive number
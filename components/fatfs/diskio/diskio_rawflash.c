@@ -89,6 +89,11 @@ esp_err_t ff_diskio_register_raw_partition(BYTE pdrv, const esp_partition_t* par
     };
     ff_diskio_register(pdrv, &raw_impl);
     ff_raw_handles[pdrv] = part_handle;
+#if defined(CONFIG_FATFS_DISKIO_BATCH_SECTORS) && CONFIG_FATFS_DISKIO_BATCH_SECTORS > 0
+    if (ff_diskio_set_batch(pdrv, CONFIG_FATFS_DISKIO_BATCH_SECTORS, false) != ESP_OK) {
+        ESP_LOGW(TAG, "no memory for %d buffered sectors, using the drive unbuffered", CONFIG_FATFS_DISKIO_BATCH_SECTORS);
+    }
+#endif
     return ESP_OK;
 
 }
@@ -76,6 +76,10 @@ DRESULT ff_wl_ioctl (BYTE pdrv, BYTE cmd, void *buff)
     assert(wl_handle + 1);
     switch (cmd) {
     case CTRL_SYNC:
+        if (unlikely(wl_flush(wl_handle) != ESP_OK)) {
+            ESP_LOGE(TAG, "wl_flush failed");
+            return RES_ERROR;
+        }
         return RES_OK;
     case GET_SECTOR_COUNT:
         *((DWORD *) buff) = wl_size(wl_handle) / wl_sector_size(wl_handle);
@@ -104,6 +108,11 @@ esp_err_t ff_diskio_register_wl_partition(BYTE pdrv, wl_handle_t flash_handle)
     };
     ff_wl_handles[pdrv] = flash_handle;
     ff_diskio_register(pdrv, &wl_impl);
+#if defined(CONFIG_FATFS_DISKIO_BATCH_SECTORS) && CONFIG_FATFS_DISKIO_BATCH_SECTORS > 0
+    if (ff_diskio_set_batch(pdrv, CONFIG_FATFS_DISKIO_BATCH_SECTORS, true) != ESP_OK) {
+        ESP_LOGW(TAG, "no memory for %d buffered sectors, using the drive unbuffered", CONFIG_FATFS_DISKIO_BATCH_SECTORS);
+    }
+#endif
     return ESP_OK;
 }
 
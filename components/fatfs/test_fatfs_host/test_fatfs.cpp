@@ -11,6 +11,14 @@
 
 extern "C" void _spi_flash_init(const char* chip_size, size_t block_size, size_t sector_size, size_t page_size, const char* partition_bin);
 
+extern "C" {
+DSTATUS ff_wl_initialize(BYTE pdrv);
+DSTATUS ff_wl_status(BYTE pdrv);
+DRESULT ff_wl_read(BYTE pdrv, BYTE *buff, DWORD sector, UINT count);
+DRESULT ff_wl_write(BYTE pdrv, const BYTE *buff, DWORD sector, UINT count);
+DRESULT ff_wl_ioctl(BYTE pdrv, BYTE cmd, void *buff);
+}
+
 TEST_CASE("create volume, open file, write and read back data", "[fatfs]")
 {
     _spi_flash_init(CONFIG_ESPTOOLPY_FLASHSIZE, CONFIG_WL_SECTOR_SIZE * 16, CONFIG_WL_SECTOR_SIZE, CONFIG_WL_SECTOR_SIZE, "partition_table.bin");
@@ -91,3 +99,114 @@ TEST_CASE("create volume, open file, write and read back data", "[fatfs]")
     free(read);
     free(data);
 }
+
+static int wl_reads, wl_writes;
+
+static DRESULT ff_counting_read(BYTE pdrv, BYTE *buff, DWORD sector, UINT count)
+{
+    wl_reads++;
+    return ff_wl_read(pdrv, buff, sector, count);
+}
+
+static DRESULT ff_counting_write(BYTE pdrv, const BYTE *buff, DWORD sector, UINT count)
+{
+    wl_writes++;
+    return ff_wl_write(pdrv, buff, sector, count);
+}
+
+TEST_CASE("buffered sectors batch reads and writes of a file", "[fatfs]")
+{
+    _spi_flash_init(CONFIG_ESPTOOLPY_FLASHSIZE, CONFIG_WL_SECTOR_SIZE * 16, CONFIG_WL_SECTOR_SIZE, CONFIG_WL_SECTOR_SIZE, "partition_table.bin");
+
+    FRESULT fr_result;
+    BYTE pdrv;
+    FATFS fs;
+    FIL file;
+    UINT bw;
+
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_FAT, "storage");
+
+    wl_handle_t wl_handle;
+    REQUIRE(wl_mount(partition, &wl_handle) == ESP_OK);
+    REQUIRE(ff_diskio_get_drive(&pdrv) == ESP_OK);
+    REQUIRE(ff_diskio_register_wl_partition(pdrv, wl_handle) == ESP_OK);
+
+    // Same driver, counting the calls
+    const ff_diskio_impl_t counting_impl = {
+        .init = &ff_wl_initialize,
+        .status = &ff_wl_status,
+        .read = &ff_counting_read,
+        .write = &ff_counting_write,
+        .ioctl = &ff_wl_ioctl
+    };
+    ff_diskio_register(pdrv, &counting_impl);
+
+    // Drive left registered by other tests may take the default volume
+    char drv[3] = {(char)('0' + pdrv), ':', 0};
+    char path[16];
+    snprintf(path, sizeof(path), "%sstream.bin", drv);
+
+    DWORD part_list[] = {100, 0, 0, 0};
+    BYTE work_area[FF_MAX_SS];
+    REQUIRE(f_fdisk(pdrv, part_list, work_area) == FR_OK);
+    REQUIRE(f_mkfs(drv, FM_ANY, 0, work_area, sizeof(work_area)) == FR_OK);
+
+    const uint32_t data_size = 256 * 1024;
+    const uint32_t chunk_size = 512;
+    char *data = (char*) malloc(data_size);
+    char *read = (char*) malloc(data_size);
+    for (uint32_t i = 0; i < data_size; i += sizeof(i)) {
+        *((uint32_t*)(data + i)) = i;
+    }
+
+    // Streamed in small chunks: without the buffer, with it, and with it only reading ahead
+    int reads[3], writes[3];
+    for (int batch = 0; batch < 3; batch++) {
+        REQUIRE(ff_diskio_set_batch(pdrv, batch ? 8 : 0, batch == 1) == ESP_OK);
+        REQUIRE(f_mount(&fs, drv, 0) == FR_OK);
+
+        wl_writes = 0;
+        REQUIRE(f_open(&file, path, FA_CREATE_ALWAYS | FA_WRITE) == FR_OK);
+        for (uint32_t off = 0; off < data_size; off += chunk_size) {
+            fr_result = f_write(&file, data + off, chunk_size, &bw);
+            REQUIRE(fr_result == FR_OK);
+            REQUIRE(bw == chunk_size);
+        }
+        REQUIRE(f_close(&file) == FR_OK);
+        writes[batch] = wl_writes;
+
+        // Not served from the buffer of the writes
+        REQUIRE(f_mount(0, drv, 0) == FR_OK);
+        REQUIRE(ff_diskio_set_batch(pdrv, batch ? 8 : 0, batch == 1) == ESP_OK);
+        REQUIRE(f_mount(&fs, drv, 0) == FR_OK);
+
+        wl_reads = 0;
+        memset(read, 0, data_size);
+        REQUIRE(f_open(&file, path, FA_READ) == FR_OK);
+        for (uint32_t off = 0; off < data_size; off += chunk_size) {
+            fr_result = f_read(&file, read + off, chunk_size, &bw);
+            REQUIRE(fr_result == FR_OK);
+            REQUIRE(bw == chunk_size);
+        }
+        REQUIRE(f_close(&file) == FR_OK);
+        reads[batch] = wl_reads;
+        REQUIRE(memcmp(data, read, data_size) == 0);
+
+        REQUIRE(f_unlink(path) == FR_OK);
+        REQUIRE(f_mount(0, drv, 0) == FR_OK);
+    }
+    printf("Streaming %d KB: %d writes, %d reads unbuffered; %d writes, %d reads with 8 sectors buffered\n",
+           data_size / 1024, writes[0], reads[0], writes[1], reads[1]);
+    CHECK(writes[1] * 4 < writes[0]);
+    CHECK(reads[1] * 4 < reads[0]);
+    // Writes pass straight to the driver, reads are still batched
+    CHECK(writes[2] == writes[0]);
+    CHECK(reads[2] * 4 < reads[0]);
+
+    ff_diskio_unregister(pdrv);
+    ff_diskio_clear_pdrv_wl(wl_handle);
+    wl_unmount(wl_handle);
+
+    free(read);
+    free(data);
+}
@@ -25,6 +25,7 @@
 #include "rom/ets_sys.h"
 #include "rom/uart.h"
 #include "esp_err.h"
+#include "esp_log.h"
 
 #include "FreeRTOS.h"
 #include "task.h"
@@ -161,6 +162,9 @@ void panicHandler(void *frame, int wdt)
     } while (REG_READ(INT_ENA_WDEV) != 0);
 
 #ifdef ESP_PANIC_PRINT
+    /* Lines logged before the panic come first */
+    esp_log_panic_flush();
+
     if (wdt) {
         PANIC("Task watchdog got triggered.\r\n\r\n");
     }
@@ -64,6 +64,17 @@ typedef struct mem_blk2 {
 typedef mem_blk_t mem2_blk_t;
 #endif
 
+#define HEAP_INFO_HISTOGRAM_NUM 8  ///< Number of free block size classes: <32, <64, <128, <256, <512, <1024, <2048 and >=2048 bytes
+
+/**
+ * Heap latency statistics.
+ */
+typedef struct heap_latency {
+    uint32_t count;             ///< Number of calls
+    uint32_t max_cycles;        ///< Maximum CPU cycles of one call
+    uint64_t cycles;            ///< Total CPU cycles of all calls
+} heap_latency_t;
+
 /**
  * User region information.
  */
@@ -78,6 +89,19 @@ typedef struct heap_region {
 	size_t free_bytes;      ///< Current free heap size by byte
 
 	size_t min_free_bytes;  ///< Minimum free heap size by byte ever
+
+#ifdef CONFIG_HEAP_LATENCY_STATS
+	heap_latency_t malloc_latency;  ///< Latency of allocating memory in the region
+	heap_latency_t free_latency;    ///< Latency of freeing memory to the region
+#endif
+
+#ifdef CONFIG_HEAP_SEGREGATED_FIT
+	uint32_t fl_bitmap;     ///< Bit N is set if any list in "free_list[N]" is not empty
+
+	uint32_t sl_bitmap[HEAP_SEG_FL_COUNT];  ///< Bit M of "sl_bitmap[N]" is set if "free_list[N][M]" is not empty
+
+	void *free_list[HEAP_SEG_FL_COUNT][1 << HEAP_SEG_SL_LOG2];  ///< Free memory block lists by size class
+#endif
 } heap_region_t;
 
 
@@ -105,6 +129,59 @@ size_t heap_caps_get_free_size(uint32_t caps);
  */
 size_t heap_caps_get_minimum_free_size(uint32_t caps);
 
+/**
+ * Region fragmentation and latency report.
+ */
+typedef struct heap_region_info {
+    void *start_addr;           ///< Heap region start address
+    size_t total_size;          ///< Heap region total size by byte
+    uint32_t caps;              ///< Heap capacity
+
+    size_t free_bytes;          ///< Current free heap size by byte
+    size_t min_free_bytes;      ///< Minimum free heap size by byte ever
+
+    size_t largest_free_block;  ///< Size of the largest memory which can be allocated by byte
+    size_t free_blocks;         ///< Number of free memory blocks
+    size_t free_histogram[HEAP_INFO_HISTOGRAM_NUM]; ///< Number of free memory blocks in every size class
+
+    heap_latency_t malloc_latency;  ///< Latency of allocating memory in the region, zero if HEAP_LATENCY_STATS is disabled
+    heap_latency_t free_latency;    ///< Latency of freeing memory to the region, zero if HEAP_LATENCY_STATS is disabled
+} heap_region_info_t;
+
+/**
+ * @brief Get the largest free block of memory able to be allocated with the given capabilities.
+ *
+ * The regions are walked as by heap_caps_get_region_info().
+ *
+ * @param caps Bitwise OR of MALLOC_CAP_* flags indicating the type of memory
+ *
+ * @return Size of largest free block in bytes.
+ */
+size_t heap_caps_get_largest_free_block(uint32_t caps);
+
+/**
+ * @brief Get the fragmentation and latency report of every region
+ *
+ * The region is walked with its lock held, i.e. with interrupts disabled. With
+ * CONFIG_HEAP_SEGREGATED_FIT only the free memory blocks are walked, so it is cheap
+ * enough to be called periodically. Otherwise every block from the first free one
+ * to the end of the region is visited, used ones included, which takes as long as
+ * a malloc that finds no block large enough.
+ *
+ * @param info Array of region reports to be filled
+ * @param max_num Number of entries of the array
+ *
+ * @return Number of regions reported
+ */
+size_t heap_caps_get_region_info(heap_region_info_t *info, size_t max_num);
+
+/**
+ * @brief Print the fragmentation and latency report of all the regions that have the given capabilities
+ *
+ * @param caps Bitwise OR of MALLOC_CAP_* flags indicating the type of memory
+ */
+void heap_caps_print_heap_info(uint32_t caps);
+
 /**
  * @brief Initialize regions of memory to the collection of heaps at runtime.
  *
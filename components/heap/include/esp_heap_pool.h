@@ -0,0 +1,93 @@
+// Copyright 2019-2020 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Fixed-size object pool handle.
+ */
+typedef struct heap_caps_pool *heap_caps_pool_handle_t;
+
+/**
+ * Object pool statistics.
+ */
+typedef struct heap_caps_pool_info {
+    size_t      obj_size;       ///< Size of every object by byte
+    size_t      count;          ///< Number of objects in the pool slab
+    size_t      free_count;     ///< Number of objects which are free in the pool slab
+    size_t      high_water;     ///< Maximum number of objects which were used in the pool slab at the same time
+    uint32_t    miss_count;     ///< Number of "get" which fell back to heap_caps_malloc because the slab is empty
+} heap_caps_pool_info_t;
+
+/**
+ * @brief Create a pool of fixed-size objects which are preallocated in one slab
+ *
+ * @param obj_size Size, in bytes, of every object
+ * @param count Number of objects in the slab
+ * @param caps Bitwise OR of MALLOC_CAP_* flags indicating the type of memory of the slab and of the fallback allocations
+ *
+ * @return Pool handle on success, NULL on failure
+ */
+heap_caps_pool_handle_t heap_caps_pool_create(size_t obj_size, size_t count, uint32_t caps);
+
+/**
+ * @brief Delete an object pool
+ *
+ * @note All objects got from the pool slab must be put back before the pool is deleted.
+ *
+ * @param pool Pool handle created by heap_caps_pool_create
+ */
+void heap_caps_pool_delete(heap_caps_pool_handle_t pool);
+
+/**
+ * @brief Get an object from the pool
+ *
+ * If the slab is empty, the object is allocated by heap_caps_malloc and a miss is counted.
+ * This function can be called from ISR.
+ *
+ * @param pool Pool handle created by heap_caps_pool_create
+ *
+ * @return A pointer to the object on success, NULL on failure
+ */
+void *heap_caps_pool_get(heap_caps_pool_handle_t pool);
+
+/**
+ * @brief Put an object back to the pool
+ *
+ * Objects which were allocated by heap_caps_malloc because of a miss are freed to the heap.
+ * This function can be called from ISR.
+ *
+ * @param pool Pool handle created by heap_caps_pool_create
+ * @param ptr Pointer returned by heap_caps_pool_get. Can be NULL.
+ */
+void heap_caps_pool_put(heap_caps_pool_handle_t pool, void *ptr);
+
+/**
+ * @brief Get the statistics of an object pool
+ *
+ * @param pool Pool handle created by heap_caps_pool_create
+ * @param info Pointer to the structure to be filled
+ */
+void heap_caps_pool_get_info(heap_caps_pool_handle_t pool, heap_caps_pool_info_t *info);
+
+#ifdef __cplusplus
+}
+#endif
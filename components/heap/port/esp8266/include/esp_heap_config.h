@@ -24,4 +24,11 @@
 #define HEAP_REGIONS_MAX 2
 #endif
 
+#ifdef CONFIG_HEAP_SEGREGATED_FIT
+#define MEM_BLK_MIN (sizeof(void *) * 2)    ///< A free block must be able to store its free list links
+
+#define HEAP_SEG_SL_LOG2 2                  ///< Every power-of-two class is split into 4 sub-classes
+#define HEAP_SEG_FL_COUNT 14                ///< Enough power-of-two classes to cover 128KB
+#else
 #define MEM_BLK_MIN 1
+#endif
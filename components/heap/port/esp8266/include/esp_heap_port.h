@@ -15,6 +15,7 @@
 #pragma once
 
 #include <stddef.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -32,6 +33,15 @@ extern "C" {
     vPortETSIntrUnlock();                   \
 }
 
+#define _heap_caps_get_cycles()             \
+({                                          \
+    uint32_t __ccount;                      \
+                                            \
+    __asm__ __volatile__("rsr %0, ccount"   \
+                         : "=a"(__ccount)); \
+    __ccount;                               \
+})
+
 #define _heap_caps_feed_wdt(_num)           \
 {                                           \
     extern void esp_task_wdt_reset(void);   \
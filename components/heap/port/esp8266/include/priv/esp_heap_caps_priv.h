@@ -171,6 +171,135 @@ static inline size_t mem2_blk_line(mem2_blk_t *mem2_blk)
 }
 #endif
 
+#ifdef CONFIG_HEAP_SEGREGATED_FIT
+#define HEAP_SEG_SL_COUNT       (1 << HEAP_SEG_SL_LOG2)
+#define HEAP_SEG_FL_SHIFT       (HEAP_SEG_SL_LOG2 + 2)
+#define HEAP_SEG_SMALL_SIZE     (1 << HEAP_SEG_FL_SHIFT)
+
+#define MEM_FREE_BLK_MIN        (MEM_HEAD_SIZE + MEM_BLK_MIN)   ///< Minimum size of a memory block which can be freed
+
+_Static_assert(HEAP_MAX_SIZE < (1 << (HEAP_SEG_FL_COUNT + HEAP_SEG_FL_SHIFT - 1)), "HEAP_SEG_FL_COUNT is too small");
+
+/**
+ * Free list links, stored in the payload of a free memory block.
+ */
+typedef struct mem_free_link {
+    mem_blk_t       *prev;  ///< Point to previous free memory block of the same size class
+    mem_blk_t       *next;  ///< Point to next free memory block of the same size class
+} mem_free_link_t;
+
+static inline mem_free_link_t *mem_blk_free_link(mem_blk_t *mem_blk)
+{
+    return (mem_free_link_t *)((uint8_t *)mem_blk + MEM_HEAD_SIZE);
+}
+
+/**
+ * @brief Map a memory block size to its first level(power of two) and second level(linear) size class.
+ */
+static inline void heap_seg_mapping(size_t size, int *fl, int *sl)
+{
+    if (size < HEAP_SEG_SMALL_SIZE) {
+        *fl = 0;
+        *sl = size / (HEAP_SEG_SMALL_SIZE / HEAP_SEG_SL_COUNT);
+    } else {
+        int f = 31 - __builtin_clz(size);
+
+        *fl = f - (HEAP_SEG_FL_SHIFT - 1);
+        *sl = (size >> (f - HEAP_SEG_SL_LOG2)) ^ HEAP_SEG_SL_COUNT;
+    }
+}
+
+/**
+ * @brief Insert a free memory block to the head of the list of its size class.
+ */
+static inline void heap_seg_insert(heap_region_t *region, mem_blk_t *mem_blk)
+{
+    int fl, sl;
+    mem_blk_t *head;
+    mem_free_link_t *link = mem_blk_free_link(mem_blk);
+
+    heap_seg_mapping(blk_link_size(mem_blk), &fl, &sl);
+
+    head = (mem_blk_t *)region->free_list[fl][sl];
+
+    link->prev = NULL;
+    link->next = head;
+    if (head)
+        mem_blk_free_link(head)->prev = mem_blk;
+
+    region->free_list[fl][sl] = mem_blk;
+    region->sl_bitmap[fl] |= 1 << sl;
+    region->fl_bitmap |= 1 << fl;
+}
+
+/**
+ * @brief Remove a free memory block from the list of its size class.
+ */
+static inline void heap_seg_remove(heap_region_t *region, mem_blk_t *mem_blk)
+{
+    int fl, sl;
+    mem_free_link_t *link = mem_blk_free_link(mem_blk);
+
+    heap_seg_mapping(blk_link_size(mem_blk), &fl, &sl);
+
+    if (link->prev)
+        mem_blk_free_link(link->prev)->next = link->next;
+    else
+        region->free_list[fl][sl] = link->next;
+
+    if (link->next)
+        mem_blk_free_link(link->next)->prev = link->prev;
+
+    if (!region->free_list[fl][sl]) {
+        region->sl_bitmap[fl] &= ~(1 << sl);
+        if (!region->sl_bitmap[fl])
+            region->fl_bitmap &= ~(1 << fl);
+    }
+}
+
+/**
+ * @brief Find a free memory block whose size is not less than "size".
+ *
+ * The size is rounded up to the next size class first, so that any block of the first non-empty
+ * list found by the bitmaps is large enough. If there is none, the list of the exact size class
+ * is walked, which lets the last large enough block of the region still be allocated.
+ */
+static inline mem_blk_t *heap_seg_find(heap_region_t *region, size_t size)
+{
+    int fl, sl;
+    uint32_t sl_map = 0;
+    mem_blk_t *mem_blk;
+    size_t round_size = size;
+
+    if (size >= HEAP_SEG_SMALL_SIZE)
+        round_size += (1 << (31 - __builtin_clz(size) - HEAP_SEG_SL_LOG2)) - 1;
+
+    heap_seg_mapping(round_size, &fl, &sl);
+    if (fl < HEAP_SEG_FL_COUNT) {
+        sl_map = region->sl_bitmap[fl] & (~0U << sl);
+        if (!sl_map) {
+            uint32_t fl_map = region->fl_bitmap & (~0U << (fl + 1));
+
+            if (fl_map) {
+                fl = __builtin_ctz(fl_map);
+                sl_map = region->sl_bitmap[fl];
+            }
+        }
+    }
+
+    if (sl_map)
+        return (mem_blk_t *)region->free_list[fl][__builtin_ctz(sl_map)];
+
+    heap_seg_mapping(size, &fl, &sl);
+    for (mem_blk = region->free_list[fl][sl]; mem_blk; mem_blk = mem_blk_free_link(mem_blk)->next) {
+        if (blk_link_size(mem_blk) >= size)
+            return mem_blk;
+    }
+
+    return NULL;
+}
+#endif /* CONFIG_HEAP_SEGREGATED_FIT */
+
 #ifdef __cplusplus
 }
 #endif
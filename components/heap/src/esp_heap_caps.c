@@ -12,6 +12,7 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <stdio.h>
 #include <string.h>
 #include <assert.h>
 #include <stdbool.h>
@@ -59,6 +60,19 @@ void esp_heap_caps_init_region(heap_region_t *region, size_t max_num)
 
         g_heap_region[num].free_blk = mem_start;
         g_heap_region[num].min_free_bytes = g_heap_region[num].free_bytes = blk_link_size(mem_start);
+
+#ifdef CONFIG_HEAP_LATENCY_STATS
+        memset(&g_heap_region[num].malloc_latency, 0, sizeof(heap_latency_t));
+        memset(&g_heap_region[num].free_latency, 0, sizeof(heap_latency_t));
+#endif
+
+#ifdef CONFIG_HEAP_SEGREGATED_FIT
+        g_heap_region[num].fl_bitmap = 0;
+        memset(g_heap_region[num].sl_bitmap, 0, sizeof(g_heap_region[num].sl_bitmap));
+        memset(g_heap_region[num].free_list, 0, sizeof(g_heap_region[num].free_list));
+
+        heap_seg_insert(&g_heap_region[num], mem_start);
+#endif
     }
     g_heap_region_num = max_num;
 }
@@ -91,6 +105,134 @@ size_t heap_caps_get_minimum_free_size(uint32_t caps)
     return bytes;
 }
 
+static inline void heap_caps_info_add_free_blk(heap_region_info_t *info, mem_blk_t *mem_blk)
+{
+    size_t size = blk_link_size(mem_blk) - MEM_HEAD_SIZE;
+    size_t class = size < 32 ? 0 : MIN(31 - __builtin_clz(size) - 4, HEAP_INFO_HISTOGRAM_NUM - 1);
+
+    info->free_blocks++;
+    info->free_histogram[class]++;
+    if (info->largest_free_block < size)
+        info->largest_free_block = size;
+}
+
+/**
+ * @brief Fill the report of a region by walking its free memory blocks.
+ *
+ * The first-fit chain links used and free blocks alike, so without the segregated
+ * lists this visits every block after free_blk with interrupts disabled.
+ */
+static void heap_caps_region_info(size_t num, heap_region_info_t *info)
+{
+    mem_blk_t *mem_blk;
+
+    memset(info, 0, sizeof(heap_region_info_t));
+
+    info->start_addr = g_heap_region[num].start_addr;
+    info->total_size = g_heap_region[num].total_size;
+    info->caps = g_heap_region[num].caps;
+
+    _heap_caps_lock(num);
+
+    info->free_bytes = g_heap_region[num].free_bytes;
+    info->min_free_bytes = g_heap_region[num].min_free_bytes;
+
+#ifdef CONFIG_HEAP_SEGREGATED_FIT
+    for (int fl = 0; fl < HEAP_SEG_FL_COUNT; fl++) {
+        for (int sl = 0; sl < HEAP_SEG_SL_COUNT; sl++) {
+            mem_blk = g_heap_region[num].free_list[fl][sl];
+            for (; mem_blk; mem_blk = mem_blk_free_link(mem_blk)->next)
+                heap_caps_info_add_free_blk(info, mem_blk);
+        }
+    }
+#else
+    mem_blk = g_heap_region[num].free_blk;
+    for (; mem_blk && !mem_blk_is_end(mem_blk); mem_blk = mem_blk_next(mem_blk)) {
+        if (!mem_blk_is_used(mem_blk))
+            heap_caps_info_add_free_blk(info, mem_blk);
+    }
+#endif
+
+#ifdef CONFIG_HEAP_LATENCY_STATS
+    info->malloc_latency = g_heap_region[num].malloc_latency;
+    info->free_latency = g_heap_region[num].free_latency;
+#endif
+
+    _heap_caps_unlock(num);
+}
+
+/**
+ * @brief Get the largest free block of memory able to be allocated with the given capabilities.
+ */
+size_t heap_caps_get_largest_free_block(uint32_t caps)
+{
+    size_t size = 0;
+    heap_region_info_t info;
+
+    for (int i = 0; i < g_heap_region_num; i++) {
+        if (caps == (caps & g_heap_region[i].caps)) {
+            heap_caps_region_info(i, &info);
+            size = MAX(size, info.largest_free_block);
+        }
+    }
+
+    return size;
+}
+
+/**
+ * @brief Get the fragmentation and latency report of every region
+ */
+size_t heap_caps_get_region_info(heap_region_info_t *info, size_t max_num)
+{
+    size_t num;
+
+    for (num = 0; num < g_heap_region_num && num < max_num; num++)
+        heap_caps_region_info(num, &info[num]);
+
+    return num;
+}
+
+/**
+ * @brief Print the fragmentation and latency report of all the regions that have the given capabilities
+ */
+void heap_caps_print_heap_info(uint32_t caps)
+{
+    heap_region_info_t info;
+
+    for (int i = 0; i < g_heap_region_num; i++) {
+        if (caps != (caps & g_heap_region[i].caps))
+            continue;
+
+        heap_caps_region_info(i, &info);
+
+        printf("region %d @ %p size %u caps 0x%x\n", i, info.start_addr, info.total_size, info.caps);
+        printf("  free %u min free %u largest free block %u free blocks %u\n", info.free_bytes, info.min_free_bytes,
+               info.largest_free_block, info.free_blocks);
+        printf("  free blocks by size:");
+        for (int j = 0; j < HEAP_INFO_HISTOGRAM_NUM; j++)
+            printf(" %u", info.free_histogram[j]);
+        printf("\n");
+#ifdef CONFIG_HEAP_LATENCY_STATS
+        printf("  malloc count %u cycles max %u avg %u\n", info.malloc_latency.count, info.malloc_latency.max_cycles,
+               info.malloc_latency.count ? (uint32_t)(info.malloc_latency.cycles / info.malloc_latency.count) : 0);
+        printf("  free count %u cycles max %u avg %u\n", info.free_latency.count, info.free_latency.max_cycles,
+               info.free_latency.count ? (uint32_t)(info.free_latency.cycles / info.free_latency.count) : 0);
+#endif
+    }
+}
+
+#ifdef CONFIG_HEAP_LATENCY_STATS
+static inline void heap_latency_update(heap_latency_t *latency, uint32_t start)
+{
+    uint32_t cycles = _heap_caps_get_cycles() - start;
+
+    latency->count++;
+    latency->cycles += cycles;
+    if (latency->max_cycles < cycles)
+        latency->max_cycles = cycles;
+}
+#endif
+
 /**
  * @brief Allocate a chunk of memory which has the given capabilities
  */
@@ -113,8 +255,11 @@ void IRAM_ATTR *_heap_caps_malloc(size_t size, uint32_t caps, const char *file,
     }
 
     for (num = 0; num < g_heap_region_num; num++) {
-        bool trace;
+        bool trace = false;
         size_t head_size;
+#ifdef CONFIG_HEAP_LATENCY_STATS
+        uint32_t start_cycles;
+#endif
 
         if ((g_heap_region[num].caps & caps) != caps) {
             ESP_EARLY_LOGV(TAG, "caps in %x, num %d region %x @ %p", caps, num, g_heap_region[num].caps, &g_heap_region[num]);
@@ -123,11 +268,19 @@ void IRAM_ATTR *_heap_caps_malloc(size_t size, uint32_t caps, const char *file,
 
         _heap_caps_lock(num);
 
+#ifdef CONFIG_HEAP_LATENCY_STATS
+        start_cycles = _heap_caps_get_cycles();
+#endif
+
 #ifdef CONFIG_HEAP_TRACING
         trace = __g_heap_trace_mode == HEAP_TRACE_LEAKS;
 #endif
 
         mem_blk_size = ptr2memblk_size(size, trace);
+#ifdef CONFIG_HEAP_SEGREGATED_FIT
+        if (mem_blk_size < MEM_FREE_BLK_MIN)
+            mem_blk_size = MEM_FREE_BLK_MIN;
+#endif
 
         ESP_EARLY_LOGV(TAG, "malloc size is %d(%x) blk size is %d(%x) region is %d", size, size,
                             mem_blk_size, mem_blk_size, num);
@@ -135,6 +288,13 @@ void IRAM_ATTR *_heap_caps_malloc(size_t size, uint32_t caps, const char *file,
         if (mem_blk_size > g_heap_region[num].free_bytes)
             goto next_region;
 
+#ifdef CONFIG_HEAP_SEGREGATED_FIT
+        mem_blk = heap_seg_find(&g_heap_region[num], mem_blk_size);
+        if (!mem_blk)
+            goto next_region;
+
+        heap_seg_remove(&g_heap_region[num], mem_blk);
+#else
         mem_blk = (mem_blk_t *)g_heap_region[num].free_blk;
 
         ESP_EARLY_LOGV(TAG, "malloc start %p", mem_blk);
@@ -149,6 +309,7 @@ void IRAM_ATTR *_heap_caps_malloc(size_t size, uint32_t caps, const char *file,
 
         if (!mem_blk || mem_blk_is_end(mem_blk))
             goto next_region;
+#endif
 
         ret_mem = blk2ptr(mem_blk, trace);
         ESP_EARLY_LOGV(TAG, "ret_mem is %p", ret_mem);
@@ -173,6 +334,10 @@ void IRAM_ATTR *_heap_caps_malloc(size_t size, uint32_t caps, const char *file,
 
             mem_blk_set_prev(mem_blk_next(mem_blk), next_mem_blk);
             mem_blk_set_next(mem_blk, next_mem_blk);
+
+#ifdef CONFIG_HEAP_SEGREGATED_FIT
+            heap_seg_insert(&g_heap_region[num], next_mem_blk);
+#endif
         }
 
         mem_blk_set_used(mem_blk);
@@ -181,6 +346,7 @@ void IRAM_ATTR *_heap_caps_malloc(size_t size, uint32_t caps, const char *file,
             ESP_EARLY_LOGV(TAG, "mem_blk1 %p set trace", mem_blk);
         }
 
+#ifndef CONFIG_HEAP_SEGREGATED_FIT
         if (g_heap_region[num].free_blk == mem_blk) {
             mem_blk_t *free_blk = mem_blk;
 
@@ -193,6 +359,7 @@ void IRAM_ATTR *_heap_caps_malloc(size_t size, uint32_t caps, const char *file,
         } else {
             ESP_EARLY_LOGV(TAG, "free_blk is %p", g_heap_region[num].free_blk);
         }
+#endif
 
         mem_blk_size = blk_link_size(mem_blk);
         g_heap_region[num].free_bytes -= mem_blk_size;
@@ -208,6 +375,9 @@ void IRAM_ATTR *_heap_caps_malloc(size_t size, uint32_t caps, const char *file,
                             mem_blk_prev(mem_blk_next(next_mem_blk)), mem_blk_next(next_mem_blk)->prev, mem_blk_next(mem_blk_next(next_mem_blk)), mem_blk_next(next_mem_blk)->next);
 
 next_region:
+#ifdef CONFIG_HEAP_LATENCY_STATS
+        heap_latency_update(&g_heap_region[num].malloc_latency, start_cycles);
+#endif
         _heap_caps_unlock(num);
 
         if (ret_mem)
@@ -227,6 +397,9 @@ void IRAM_ATTR _heap_caps_free(void *ptr, const char *file, size_t line)
     int num;
     mem_blk_t *mem_blk;
     mem_blk_t *tmp, *next, *prev, *last;
+#ifdef CONFIG_HEAP_LATENCY_STATS
+    uint32_t start_cycles;
+#endif
 
     if ((int)line == 0) {
         ESP_EARLY_LOGV(TAG, "caller func %p", file);
@@ -261,6 +434,10 @@ void IRAM_ATTR _heap_caps_free(void *ptr, const char *file, size_t line)
 
     _heap_caps_lock(num);
 
+#ifdef CONFIG_HEAP_LATENCY_STATS
+    start_cycles = _heap_caps_get_cycles();
+#endif
+
     g_heap_region[num].free_bytes += blk_link_size(mem_blk);
 
     ESP_EARLY_LOGV(TAG, "ptr prev=%p next=%p", mem_blk_prev(mem_blk), mem_blk_next(mem_blk));
@@ -275,6 +452,9 @@ void IRAM_ATTR _heap_caps_free(void *ptr, const char *file, size_t line)
     last = mem_blk_next(next);
 
     if (prev && !mem_blk_is_used(prev)) {
+#ifdef CONFIG_HEAP_SEGREGATED_FIT
+        heap_seg_remove(&g_heap_region[num], prev);
+#endif
         mem_blk_set_next(prev, next);
         mem_blk_set_prev(next, prev);
         tmp = prev;
@@ -282,6 +462,9 @@ void IRAM_ATTR _heap_caps_free(void *ptr, const char *file, size_t line)
         tmp = mem_blk;
 
     if (last && !mem_blk_is_used(next)) {
+#ifdef CONFIG_HEAP_SEGREGATED_FIT
+        heap_seg_remove(&g_heap_region[num], next);
+#endif
         mem_blk_set_next(tmp, last);
         mem_blk_set_prev(last, tmp);
     }
@@ -289,10 +472,18 @@ void IRAM_ATTR _heap_caps_free(void *ptr, const char *file, size_t line)
     ESP_EARLY_LOGV(TAG, "ptr2 prev->next=%p next->prev=%p", mem_blk_prev(mem_blk) ? mem_blk_next(mem_blk_prev(mem_blk)) : NULL,
                         mem_blk_prev(mem_blk_next(mem_blk)));
 
+#ifdef CONFIG_HEAP_SEGREGATED_FIT
+    heap_seg_insert(&g_heap_region[num], tmp);
+#else
     if ((uint8_t *)mem_blk < (uint8_t *)g_heap_region[num].free_blk) {
         ESP_EARLY_LOGV(TAG, "Free update free block from %p to %p", g_heap_region[num].free_blk, mem_blk);
         g_heap_region[num].free_blk = mem_blk;
     }
+#endif
+
+#ifdef CONFIG_HEAP_LATENCY_STATS
+    heap_latency_update(&g_heap_region[num].free_latency, start_cycles);
+#endif
 
     _heap_caps_unlock(num);
 }
@@ -316,13 +507,139 @@ void *_heap_caps_calloc(size_t count, size_t size, uint32_t caps, const char *fi
     return p;
 }
 
+/**
+ * @brief Split the tail of a used memory block from "size" as a new free memory block.
+ *
+ * The tail is merged into the next memory block if that one is free. Return the size of memory
+ * returned to the region.
+ */
+static size_t heap_caps_split_tail(size_t num, mem_blk_t *mem_blk, size_t size)
+{
+    mem_blk_t *next = mem_blk_next(mem_blk);
+    mem_blk_t *tail = (mem_blk_t *)((uint8_t *)mem_blk + size);
+    size_t tail_size = (uint8_t *)next - (uint8_t *)tail;
+
+    if (!tail_size)
+        return 0;
+
+    if (!mem_blk_is_end(next) && !mem_blk_is_used(next)) {
+        mem_blk_t *last = mem_blk_next(next);
+
+#ifdef CONFIG_HEAP_SEGREGATED_FIT
+        heap_seg_remove(&g_heap_region[num], next);
+#endif
+        tail->prev = tail->next = NULL;
+        mem_blk_set_prev(tail, mem_blk);
+        mem_blk_set_next(tail, last);
+        mem_blk_set_prev(last, tail);
+    } else if (tail_size >= MEM_HEAD_SIZE + MEM_BLK_MIN) {
+        tail->prev = tail->next = NULL;
+        mem_blk_set_prev(tail, mem_blk);
+        mem_blk_set_next(tail, next);
+        mem_blk_set_prev(next, tail);
+    } else
+        return 0;
+
+    mem_blk_set_next(mem_blk, tail);
+
+#ifdef CONFIG_HEAP_SEGREGATED_FIT
+    heap_seg_insert(&g_heap_region[num], tail);
+#else
+    if ((uint8_t *)tail < (uint8_t *)g_heap_region[num].free_blk)
+        g_heap_region[num].free_blk = tail;
+#endif
+
+    return tail_size;
+}
+
+/**
+ * @brief Resize a used memory block in place, by shrinking it or growing it into the next free memory block.
+ */
+static bool heap_caps_realloc_in_place(void *mem, size_t newsize, uint32_t caps, const char *file, size_t line)
+{
+    size_t num;
+    bool trace, ret = false;
+    mem_blk_t *mem_blk, *next;
+    size_t mem_blk_size, new_blk_size;
+
+    num = get_blk_region(mem);
+    if (num >= g_heap_region_num || (g_heap_region[num].caps & caps) != caps)
+        return false;
+
+    trace = ptr_is_traced(mem);
+    mem_blk = ptr2blk(mem, trace);
+
+    new_blk_size = ptr2memblk_size(newsize, trace);
+#ifdef CONFIG_HEAP_SEGREGATED_FIT
+    if (new_blk_size < MEM_FREE_BLK_MIN)
+        new_blk_size = MEM_FREE_BLK_MIN;
+#endif
+
+    _heap_caps_lock(num);
+
+    mem_blk_size = blk_link_size(mem_blk);
+    next = mem_blk_next(mem_blk);
+
+    if (new_blk_size <= mem_blk_size) {
+        g_heap_region[num].free_bytes += heap_caps_split_tail(num, mem_blk, new_blk_size);
+        ret = true;
+    } else if (!mem_blk_is_end(next) && !mem_blk_is_used(next)
+               && mem_blk_size + blk_link_size(next) >= new_blk_size) {
+        size_t free_size = mem_blk_size + blk_link_size(next) - new_blk_size;
+        mem_blk_t *last = mem_blk_next(next);
+
+#ifdef CONFIG_HEAP_SEGREGATED_FIT
+        heap_seg_remove(&g_heap_region[num], next);
+#endif
+
+        ESP_EARLY_LOGV(TAG, "realloc %p grow from %d to %d into %p", mem_blk, mem_blk_size, new_blk_size, next);
+
+        mem_blk_set_next(mem_blk, last);
+        mem_blk_set_prev(last, mem_blk);
+
+        if (free_size >= MEM_HEAD_SIZE + MEM_BLK_MIN)
+            heap_caps_split_tail(num, mem_blk, new_blk_size);
+
+#ifndef CONFIG_HEAP_SEGREGATED_FIT
+        if (g_heap_region[num].free_blk == next) {
+            mem_blk_t *free_blk = mem_blk_next(mem_blk);
+
+            while (free_blk && !mem_blk_is_end(free_blk) && mem_blk_is_used(free_blk))
+                free_blk = mem_blk_next(free_blk);
+
+            ESP_EARLY_LOGV(TAG, "reset free_blk from %p to %p", g_heap_region[num].free_blk, free_blk);
+            g_heap_region[num].free_blk = free_blk;
+        }
+#endif
+
+        g_heap_region[num].free_bytes -= blk_link_size(mem_blk) - mem_blk_size;
+        if (g_heap_region[num].min_free_bytes > g_heap_region[num].free_bytes)
+            g_heap_region[num].min_free_bytes = g_heap_region[num].free_bytes;
+
+        ret = true;
+    }
+
+    if (ret && trace)
+        mem_blk_set_traced((mem2_blk_t *)mem_blk, file, line);
+
+    _heap_caps_unlock(num);
+
+    return ret;
+}
+
 /**
  * @brief Reallocate memory previously allocated via heap_caps_(m/c/r/z)alloc().
+ *
+ * The memory block is resized in place if possible, otherwise new memory is allocated and the data is copied.
  */
 void *_heap_caps_realloc(void *mem, size_t newsize, uint32_t caps, const char *file, size_t line)
 {
     void *return_addr = (void *)__builtin_return_address(0);
 
+    if (mem && newsize <= (HEAP_MAX_SIZE - sizeof(mem2_blk_t) * 2)
+        && heap_caps_realloc_in_place(mem, newsize, caps, file, line))
+        return mem;
+
     void *p = _heap_caps_malloc(newsize, caps, file, line);
     if (p && mem) {
         size_t mem_size = ptr_size(mem);
@@ -0,0 +1,155 @@
+// Copyright 2019-2020 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "esp_heap_caps.h"
+#include "esp_heap_port.h"
+#include "esp_heap_pool.h"
+
+#include "esp_attr.h"
+
+/**
+ * The pool header is followed by the slab, free objects are linked by their first word.
+ */
+struct heap_caps_pool {
+    void        *free_obj;      ///< First free object in the slab
+
+    uint8_t     *start;         ///< Slab start address
+    uint8_t     *end;           ///< Slab end address
+
+    size_t      obj_size;       ///< Object size by byte
+    size_t      count;          ///< Number of objects in the slab
+
+    size_t      used;           ///< Number of used objects in the slab
+    size_t      high_water;     ///< Maximum number of used objects in the slab ever
+
+    uint32_t    miss;           ///< Number of fallback allocations
+    uint32_t    caps;           ///< Capabilities of the slab and fallback allocations
+};
+
+/**
+ * @brief Create a pool of fixed-size objects which are preallocated in one slab
+ */
+heap_caps_pool_handle_t heap_caps_pool_create(size_t obj_size, size_t count, uint32_t caps)
+{
+    struct heap_caps_pool *pool;
+    size_t head_size = HEAP_ALIGN(sizeof(struct heap_caps_pool));
+    size_t slab_size;
+
+    if (!obj_size || !count)
+        return NULL;
+
+    if (obj_size < sizeof(void *))
+        obj_size = sizeof(void *);
+    obj_size = HEAP_ALIGN(obj_size);
+
+    if (__builtin_mul_overflow(obj_size, count, &slab_size))
+        return NULL;
+
+    pool = heap_caps_malloc(head_size + slab_size, caps);
+    if (!pool)
+        return NULL;
+
+    pool->start = (uint8_t *)pool + head_size;
+    pool->end = pool->start + slab_size;
+    pool->obj_size = obj_size;
+    pool->count = count;
+    pool->used = 0;
+    pool->high_water = 0;
+    pool->miss = 0;
+    pool->caps = caps;
+
+    pool->free_obj = NULL;
+    for (size_t i = count; i > 0; i--) {
+        void **obj = (void **)(pool->start + (i - 1) * obj_size);
+
+        *obj = pool->free_obj;
+        pool->free_obj = obj;
+    }
+
+    return pool;
+}
+
+/**
+ * @brief Delete an object pool
+ */
+void heap_caps_pool_delete(heap_caps_pool_handle_t pool)
+{
+    heap_caps_free(pool);
+}
+
+/**
+ * @brief Get an object from the pool
+ */
+void IRAM_ATTR *heap_caps_pool_get(heap_caps_pool_handle_t pool)
+{
+    void *obj;
+
+    _heap_caps_lock(0);
+
+    obj = pool->free_obj;
+    if (obj) {
+        pool->free_obj = *(void **)obj;
+        if (++pool->used > pool->high_water)
+            pool->high_water = pool->used;
+    } else
+        pool->miss++;
+
+    _heap_caps_unlock(0);
+
+    if (!obj)
+        obj = _heap_caps_malloc(pool->obj_size, pool->caps, (const char *)__builtin_return_address(0), 0);
+
+    return obj;
+}
+
+/**
+ * @brief Put an object back to the pool
+ */
+void IRAM_ATTR heap_caps_pool_put(heap_caps_pool_handle_t pool, void *ptr)
+{
+    if (!ptr)
+        return;
+
+    if ((uint8_t *)ptr < pool->start || (uint8_t *)ptr >= pool->end) {
+        _heap_caps_free(ptr, (const char *)__builtin_return_address(0), 0);
+        return;
+    }
+
+    _heap_caps_lock(0);
+
+    *(void **)ptr = pool->free_obj;
+    pool->free_obj = ptr;
+    pool->used--;
+
+    _heap_caps_unlock(0);
+}
+
+/**
+ * @brief Get the statistics of an object pool
+ */
+void heap_caps_pool_get_info(heap_caps_pool_handle_t pool, heap_caps_pool_info_t *info)
+{
+    _heap_caps_lock(0);
+
+    info->obj_size = pool->obj_size;
+    info->count = pool->count;
+    info->free_count = pool->count - pool->used;
+    info->high_water = pool->high_water;
+    info->miss_count = pool->miss;
+
+    _heap_caps_unlock(0);
+}
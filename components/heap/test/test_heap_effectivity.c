@@ -117,3 +117,70 @@ TEST_CASE("Test Heap alloc/free effectivity", "[Heap]")
 
 // Enable Heap Trace  :  Each alloc costs time 27 us, each free costs time 5 us
 // Disable Heap Trace :  Each alloc costs time 18 us, each free costs time 4 us
+
+/**
+ * Alloc/free trace modeled on a HTTPS request: "slot" is the index of the live pointer, a "size" of 0 frees it.
+ */
+typedef struct {
+    uint8_t     slot;
+    uint16_t    size;
+} heap_trace_op_t;
+
+static const heap_trace_op_t s_https_trace[] = {
+    {0, 1580}, {1, 24}, {2, 40}, {3, 16}, {4, 1664}, {5, 96}, {3, 0}, {6, 320},
+    {7, 36}, {8, 536}, {7, 0}, {9, 16}, {10, 1544}, {11, 52}, {12, 128}, {9, 0},
+    {13, 4108}, {14, 24}, {15, 40}, {8, 0}, {16, 600}, {14, 0}, {17, 16}, {18, 16},
+    {15, 0}, {19, 1544}, {10, 0}, {20, 212}, {17, 0}, {21, 88}, {18, 0}, {22, 40},
+    {19, 0}, {23, 1580}, {20, 0}, {24, 16}, {21, 0}, {25, 536}, {22, 0}, {26, 24},
+    {16, 0}, {24, 0}, {27, 96}, {25, 0}, {26, 0}, {28, 1544}, {27, 0}, {29, 40},
+    {12, 0}, {28, 0}, {23, 0}, {29, 0}, {13, 0}, {11, 0}, {6, 0}, {5, 0},
+    {2, 0}, {1, 0}, {4, 0}, {0, 0},
+};
+
+#define HEAP_TRACE_SLOTS 30
+#define HEAP_TRACE_LOOPS 100
+
+static void IRAM_ATTR test_heap_trace_replay(uint32_t *time, uint32_t *count)
+{
+    void *slot[HEAP_TRACE_SLOTS] = { 0 };
+    uint32_t alloc_us = 0, free_us = 0;
+    uint32_t alloc_cnt = 0, free_cnt = 0;
+
+    for (int loop = 0; loop < HEAP_TRACE_LOOPS; loop++) {
+        for (size_t i = 0; i < sizeof(s_https_trace) / sizeof(s_https_trace[0]); i++) {
+            const heap_trace_op_t *op = &s_https_trace[i];
+
+            if (op->size) {
+                slot[op->slot] = test_alloc_time_in_us(op->size, &alloc_us);
+                TEST_ASSERT_NOT_NULL(slot[op->slot]);
+                alloc_cnt++;
+            } else {
+                test_free_time_in_us(slot[op->slot], &free_us);
+                slot[op->slot] = NULL;
+                free_cnt++;
+            }
+        }
+    }
+
+    time[0] = alloc_us;
+    time[1] = free_us;
+    count[0] = alloc_cnt;
+    count[1] = free_cnt;
+}
+
+TEST_CASE("Test Heap alloc/free effectivity with recorded trace", "[Heap]")
+{
+    uint32_t time_in_us[2], count[2];
+    uint32_t buf[MIXED_HEAP_LIST_NOTES];
+
+    test_heap_init(buf);
+
+    test_heap_trace_replay(time_in_us, count);
+
+    printf("Each alloc costs time %u us, each free costs time %u us\n", time_in_us[0] / count[0], time_in_us[1] / count[1]);
+
+    test_heap_deinit(buf);
+}
+
+// Comparing "HEAP_SEGREGATED_FIT" enabled and disabled shows the cost of walking the used blocks
+// in the first-fit allocator, which grows with the number of blocks in "test_heap_init".
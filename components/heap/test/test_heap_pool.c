@@ -0,0 +1,57 @@
+// Copyright 2019-2020 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdint.h>
+#include <string.h>
+
+#include <unity.h>
+
+#include "esp_heap_caps.h"
+#include "esp_heap_pool.h"
+
+#define TEST_POOL_OBJ_SIZE  10
+#define TEST_POOL_COUNT     4
+
+TEST_CASE("Test Heap pool get/put and statistics", "[Heap]")
+{
+    void *obj[TEST_POOL_COUNT + 2];
+    heap_caps_pool_info_t info;
+    size_t free_size = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+
+    heap_caps_pool_handle_t pool = heap_caps_pool_create(TEST_POOL_OBJ_SIZE, TEST_POOL_COUNT, MALLOC_CAP_8BIT);
+    TEST_ASSERT_NOT_NULL(pool);
+
+    for (int i = 0; i < TEST_POOL_COUNT + 2; i++) {
+        obj[i] = heap_caps_pool_get(pool);
+        TEST_ASSERT_NOT_NULL(obj[i]);
+        memset(obj[i], i, TEST_POOL_OBJ_SIZE);
+    }
+
+    heap_caps_pool_get_info(pool, &info);
+    TEST_ASSERT_EQUAL(HEAP_ALIGN(TEST_POOL_OBJ_SIZE), info.obj_size);
+    TEST_ASSERT_EQUAL(TEST_POOL_COUNT, info.count);
+    TEST_ASSERT_EQUAL(0, info.free_count);
+    TEST_ASSERT_EQUAL(TEST_POOL_COUNT, info.high_water);
+    TEST_ASSERT_EQUAL(2, info.miss_count);
+
+    for (int i = 0; i < TEST_POOL_COUNT + 2; i++)
+        heap_caps_pool_put(pool, obj[i]);
+
+    heap_caps_pool_get_info(pool, &info);
+    TEST_ASSERT_EQUAL(TEST_POOL_COUNT, info.free_count);
+
+    heap_caps_pool_delete(pool);
+
+    TEST_ASSERT_EQUAL(free_size, heap_caps_get_free_size(MALLOC_CAP_8BIT));
+}
@@ -0,0 +1,131 @@
+// Copyright 2019-2020 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdint.h>
+#include <string.h>
+
+#include <unity.h>
+
+#include "esp_heap_caps.h"
+#include "esp_heap_trace.h"
+
+static void test_fill(uint8_t *p, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        p[i] = (uint8_t)i;
+}
+
+static void test_check(const uint8_t *p, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        TEST_ASSERT_EQUAL_HEX8((uint8_t)i, p[i]);
+}
+
+static void test_realloc_in_place(void)
+{
+    uint8_t *p, *np;
+    size_t free_size;
+
+    p = heap_caps_malloc(400, MALLOC_CAP_8BIT);
+    TEST_ASSERT_NOT_NULL(p);
+    test_fill(p, 400);
+
+    /* Shrink in place gives the tail back to the region */
+    free_size = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    np = heap_caps_realloc(p, 64, MALLOC_CAP_8BIT);
+    TEST_ASSERT_EQUAL_PTR(p, np);
+    test_check(np, 64);
+    TEST_ASSERT(heap_caps_get_free_size(MALLOC_CAP_8BIT) > free_size);
+
+    /* Grow into the free tail which follows */
+    free_size = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    np = heap_caps_realloc(p, 200, MALLOC_CAP_8BIT);
+    TEST_ASSERT_EQUAL_PTR(p, np);
+    test_check(np, 64);
+    TEST_ASSERT(heap_caps_get_free_size(MALLOC_CAP_8BIT) < free_size);
+
+    /* Growing to the same block size changes nothing */
+    free_size = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    np = heap_caps_realloc(p, 199, MALLOC_CAP_8BIT);
+    TEST_ASSERT_EQUAL_PTR(p, np);
+    TEST_ASSERT_EQUAL(free_size, heap_caps_get_free_size(MALLOC_CAP_8BIT));
+
+    heap_caps_free(np);
+}
+
+static void test_realloc_move(void)
+{
+    uint8_t *p, *guard, *np;
+
+    p = heap_caps_malloc(64, MALLOC_CAP_8BIT);
+    guard = heap_caps_malloc(16, MALLOC_CAP_8BIT);
+    TEST_ASSERT_NOT_NULL(p);
+    TEST_ASSERT_NOT_NULL(guard);
+    test_fill(p, 64);
+
+    /* The data is kept no matter whether the block is grown in place or moved */
+    np = heap_caps_realloc(p, 1024, MALLOC_CAP_8BIT);
+    TEST_ASSERT_NOT_NULL(np);
+    test_check(np, 64);
+
+    heap_caps_free(np);
+    heap_caps_free(guard);
+}
+
+static void test_realloc_too_large(void)
+{
+    uint8_t *p, *np;
+    size_t free_size;
+
+    p = heap_caps_malloc(64, MALLOC_CAP_8BIT);
+    TEST_ASSERT_NOT_NULL(p);
+    test_fill(p, 64);
+
+    /* Larger than the region, the original block must be kept */
+    free_size = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    np = heap_caps_realloc(p, free_size + 1024, MALLOC_CAP_8BIT);
+    TEST_ASSERT_NULL(np);
+    test_check(p, 64);
+    TEST_ASSERT_EQUAL(free_size, heap_caps_get_free_size(MALLOC_CAP_8BIT));
+
+    heap_caps_free(p);
+}
+
+TEST_CASE("Test Heap realloc in place", "[Heap]")
+{
+    size_t free_size = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+
+    test_realloc_in_place();
+    test_realloc_move();
+    test_realloc_too_large();
+
+    TEST_ASSERT_EQUAL(free_size, heap_caps_get_free_size(MALLOC_CAP_8BIT));
+}
+
+#ifdef CONFIG_HEAP_TRACING
+TEST_CASE("Test Heap realloc in place with traced blocks", "[Heap]")
+{
+    size_t free_size = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+
+    heap_trace_start(HEAP_TRACE_LEAKS);
+
+    test_realloc_in_place();
+    test_realloc_move();
+    test_realloc_too_large();
+
+    heap_trace_stop();
+
+    TEST_ASSERT_EQUAL(free_size, heap_caps_get_free_size(MALLOC_CAP_8BIT));
+}
+#endif
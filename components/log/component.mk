@@ -1,2 +1,8 @@
 
+COMPONENT_PRIV_INCLUDEDIRS := private_include
 COMPONENT_ADD_LDFRAGMENTS += linker.lf
+
+ifdef CONFIG_LOG_ASYNC
+# esp_restart outputs buffered log lines first
+COMPONENT_ADD_LDFLAGS += -Wl,--wrap=esp_restart
+endif
@@ -16,6 +16,7 @@
 #define __ESP_LOG_H__
 
 #include <stdint.h>
+#include <stddef.h>
 #include <stdarg.h>
 #include "sdkconfig.h"
 #include "rom/ets_sys.h"
@@ -40,6 +41,7 @@ typedef enum {
 } esp_log_level_t;
 
 typedef int (*putchar_like_t)(int ch);
+typedef int (*log_write_like_t)(const char *buf, size_t len);
 
 #ifdef CONFIG_LOG_SET_LEVEL
 /**
@@ -54,6 +56,9 @@ typedef int (*putchar_like_t)(int ch);
  * LOG_LOCAL_LEVEL to one of the ESP_LOG_* values, before including
  * esp_log.h in this file.
  *
+ * Levels are cached by the address of the tag string, so the content of a tag string
+ * passed to ESP_LOGx must not change while the program runs.
+ *
  * @param tag Tag of the log entries to enable. Must be a non-NULL zero terminated string.
  *            Value "*" resets log level for all tags to the given value.
  *
@@ -78,6 +83,56 @@ void esp_log_level_set(const char* tag, esp_log_level_t level);
  */
 putchar_like_t esp_log_set_putchar(putchar_like_t func);
 
+/**
+ * @brief Set function used to output whole log lines
+ *
+ * Every log entry is formatted into one line, including color codes and the trailing
+ * new line, and then passed to this function by one call. By default, the line is
+ * written to stdout.
+ *
+ * Calling esp_log_set_putchar replaces this function with one which outputs the line
+ * character by character through the given putchar-like function.
+ *
+ * @param func new Function used for output, NULL means using the default one.
+ *
+ * @return func old Function used for output.
+ */
+log_write_like_t esp_log_set_write(log_write_like_t func);
+
+#ifdef CONFIG_LOG_ASYNC
+/**
+ * @brief Start asynchronous log output
+ *
+ * Create the ring buffer and the task which outputs buffered log lines. Before this
+ * function is called, log lines are output directly by the calling task.
+ *
+ * @note It is called by system startup code, users need not call it.
+ *
+ * @return 0 if success or -1 if no memory
+ */
+int esp_log_async_init(void);
+
+/**
+ * @brief Output all log lines in the ring buffer by the calling task
+ *
+ * This function should be called in situations when buffered log lines must not be
+ * lost, esp_restart calls it. It can not be called from an interrupt.
+ */
+void esp_log_flush(void);
+
+/**
+ * @brief Output all log lines in the ring buffer to UART without taking any lock
+ *
+ * It is called by the panic handler, and by esp_restart when the scheduler is not
+ * running, so that the lines logged just before are not lost. The ring buffer can't
+ * be used by the log task any more afterwards.
+ */
+void esp_log_panic_flush(void);
+#else
+#define esp_log_flush()
+#define esp_log_panic_flush()
+#endif /* CONFIG_LOG_ASYNC */
+
 /**
  * @brief Function which returns timestamp to be used in log output
  *
@@ -20,6 +20,7 @@
 #include <string.h>
 #include <sys/queue.h>
 #include <sys/lock.h>
+#include <sys/param.h>
 
 #include "esp_libc.h"
 #include "esp_attr.h"
@@ -29,14 +30,25 @@
 #include "esp_log.h"
 #include "esp_system.h"
 
+#ifdef CONFIG_LOG_COMPACT
+#include "esp_log_compact.h"
+#endif
+
 #ifndef BOOTLOADER_BUILD
 #include "FreeRTOS.h"
+
+#ifdef CONFIG_LOG_ASYNC
+#include "task.h"
+#include "esp_task.h"
+#include "freertos/ringbuf.h"
+#endif
 #endif
 
 #ifdef CONFIG_LOG_COLORS
 #define LOG_COLOR_HEAD      "\033[0;%dm"
 #define LOG_BOLD_HEAD       "\033[1;%dm"
 #define LOG_COLOR_END       "\033[0m"
+#define LOG_LINE_END        LOG_COLOR_END "\n"
 
 static const uint32_t s_log_color[ESP_LOG_MAX] = {
     0,  //  ESP_LOG_NONE
@@ -46,6 +58,8 @@ static const uint32_t s_log_color[ESP_LOG_MAX] = {
     0,  //  ESP_LOG_DEBUG
     0,  //  ESP_LOG_VERBOSE
 };
+#else
+#define LOG_LINE_END        "\n"
 #endif
 
 static const char s_log_prefix[ESP_LOG_MAX] = {
@@ -84,14 +98,42 @@ typedef struct uncached_tag_entry_{
     char tag[0];    // beginning of a zero-terminated string
 } uncached_tag_entry_t;
 
+/*
+ * Open addressing table which maps tag pointer to its level. Readers search it without
+ * s_lock, writers hold s_lock and make s_tag_cache_seq odd while they modify the table,
+ * readers retry by the slow path if the sequence is odd or changes during the search.
+ */
+#define TAG_CACHE_BITS      6
+#define TAG_CACHE_SIZE      (1 << TAG_CACHE_BITS)
+#define TAG_CACHE_PROBE     8
+
+typedef struct tag_cache_entry {
+    const char  *tag;
+    uint8_t     level;  // esp_log_level_t as uint8_t
+} tag_cache_entry_t;
+
 static esp_log_level_t s_global_tag_level = ESP_LOG_VERBOSE;
 static SLIST_HEAD(log_tags_head , uncached_tag_entry_) s_log_uncached_tags = SLIST_HEAD_INITIALIZER(s_log_uncached_tags);
-static uncached_tag_entry_t *s_uncached_tag_entry_prev;
+static tag_cache_entry_t s_tag_cache[TAG_CACHE_SIZE];
+static volatile uint32_t s_tag_cache_seq;
 #endif /* CONFIG_LOG_SET_LEVEL */
 
 static _lock_t s_lock;
 static putchar_like_t s_putchar_func = &putchar;
 
+static int esp_log_write_stdout(const char *buf, size_t len);
+static log_write_like_t s_write_func = &esp_log_write_stdout;
+
+/* One line is formatted here before it is sent to s_write_func, protected by s_lock */
+static char s_log_buf[CONFIG_LOG_BUFFER_SIZE];
+static bool s_log_busy;
+
+#ifdef CONFIG_LOG_ASYNC
+static RingbufHandle_t s_log_rb;
+static uint32_t s_log_dropped;  // lines dropped because ring buffer is full, protected by s_lock
+static _lock_t s_out_lock;      // serializes output of drain task and esp_log_flush
+#endif
+
 #ifdef CONFIG_LOG_SET_LEVEL
 /**
  * @brief get entry by inputting tag
@@ -114,14 +156,93 @@ static bool esp_log_get_tag_entry(const char *tag, uncached_tag_entry_t **entry)
 
 static void clear_log_level_list(void)
 {
-    uncached_tag_entry_t *it = NULL;
+    uncached_tag_entry_t *it;
 
-    SLIST_FOREACH(it, &s_log_uncached_tags, entries) {
-        SLIST_REMOVE(&s_log_uncached_tags, it, uncached_tag_entry_, entries);
+    while ((it = SLIST_FIRST(&s_log_uncached_tags)) != NULL) {
+        SLIST_REMOVE_HEAD(&s_log_uncached_tags, entries);
         free(it);
     }
 }
 
+static inline uint32_t tag_cache_hash(const char *tag)
+{
+    return ((uint32_t)(uintptr_t)tag * 2654435761u) >> (32 - TAG_CACHE_BITS);
+}
+
+static inline void tag_cache_barrier(void)
+{
+    __asm__ __volatile__("" : : : "memory");
+}
+
+/**
+ * @brief search level of tag pointer in the cache without lock
+ */
+static inline bool tag_cache_get(const char *tag, esp_log_level_t *level)
+{
+    bool found = false;
+    uint32_t seq = s_tag_cache_seq;
+    uint32_t idx = tag_cache_hash(tag);
+
+    if (seq & 1)
+        return false;
+    tag_cache_barrier();
+
+    for (int i = 0; i < TAG_CACHE_PROBE; i++) {
+        const tag_cache_entry_t *entry = &s_tag_cache[(idx + i) & (TAG_CACHE_SIZE - 1)];
+
+        if (entry->tag == tag) {
+            *level = (esp_log_level_t)entry->level;
+            found = true;
+            break;
+        } else if (!entry->tag)
+            break;
+    }
+
+    tag_cache_barrier();
+    return found && seq == s_tag_cache_seq;
+}
+
+/**
+ * @brief add level of tag pointer to the cache, must be called with s_lock
+ */
+static void tag_cache_put(const char *tag, esp_log_level_t level)
+{
+    tag_cache_entry_t *entry = NULL;
+    uint32_t idx = tag_cache_hash(tag);
+
+    for (int i = 0; i < TAG_CACHE_PROBE; i++) {
+        tag_cache_entry_t *it = &s_tag_cache[(idx + i) & (TAG_CACHE_SIZE - 1)];
+
+        if (!it->tag || it->tag == tag) {
+            entry = it;
+            break;
+        }
+    }
+
+    /* Probe sequence is full, replacing its first entry keeps the others reachable */
+    if (!entry)
+        entry = &s_tag_cache[idx];
+
+    s_tag_cache_seq++;
+    tag_cache_barrier();
+    entry->tag = tag;
+    entry->level = level;
+    tag_cache_barrier();
+    s_tag_cache_seq++;
+}
+
+/**
+ * @brief remove all entries of the cache, must be called with s_lock
+ */
+static void tag_cache_clear(void)
+{
+    s_tag_cache_seq++;
+    tag_cache_barrier();
+    memset(s_tag_cache, 0, sizeof(s_tag_cache));
+    tag_cache_barrier();
+    s_tag_cache_seq++;
+}
+
 /**
  * @brief get level by inputting tag
  */
@@ -130,21 +251,18 @@ static esp_log_level_t esp_log_get_level(const char *tag)
     esp_log_level_t out_level;
     uncached_tag_entry_t *entry;
 
-    _lock_acquire_recursive(&s_lock);
+    if (tag_cache_get(tag, &out_level))
+        return out_level;
 
-    if (s_uncached_tag_entry_prev && !strcmp(s_uncached_tag_entry_prev->tag, tag)) {
-        out_level = (esp_log_level_t)s_uncached_tag_entry_prev->level;
-        goto exit;
-    }
+    _lock_acquire_recursive(&s_lock);
 
-    if (esp_log_get_tag_entry(tag, &entry) == true) {
+    if (esp_log_get_tag_entry(tag, &entry) == true)
         out_level = (esp_log_level_t)entry->level;
-        s_uncached_tag_entry_prev = entry;
-        goto exit;
-    } else
+    else
         out_level = s_global_tag_level;
 
-exit:
+    tag_cache_put(tag, out_level);
+
     _lock_release_recursive(&s_lock);
     return out_level;
 }
@@ -167,6 +285,9 @@ void esp_log_level_set(const char *tag, esp_log_level_t level)
 
     _lock_acquire_recursive(&s_lock);
 
+    /* Levels of all cached tag pointers may change, they are looked up again at next use */
+    tag_cache_clear();
+
     if (!strcmp(tag, GLOBAL_TAG)) {
         s_global_tag_level = level;
         clear_log_level_list();
@@ -194,15 +315,233 @@ exit:
 }
 #endif /* CONFIG_LOG_SET_LEVEL */
 
-static int esp_log_write_str(const char *s)
+/**
+ * @brief default output function, send the whole line to stdout by one call
+ */
+static int esp_log_write_stdout(const char *buf, size_t len)
+{
+    return fwrite(buf, 1, len, stdout) == len ? len : EOF;
+}
+
+/**
+ * @brief output function used after esp_log_set_putchar, send the line character by character
+ */
+static int esp_log_write_putchar(const char *buf, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        if (s_putchar_func(buf[i]) == EOF)
+            return EOF;
+    }
+
+    return len;
+}
+
+#ifndef CONFIG_LOG_COMPACT
+/**
+ * @brief append formatted string to log buffer, the result is truncated at "end"
+ */
+static inline size_t esp_log_vformat(char *buf, size_t off, size_t end, const char *fmt, va_list va)
 {
     int ret;
 
-    do {
-        ret = s_putchar_func(*s);
-    } while (ret != EOF && *++s);
+    if (off >= end)
+        return off;
+
+    ret = vsnprintf(buf + off, end - off, fmt, va);
+    if (ret < 0)
+        return off;
+
+    return MIN(off + ret, end - 1);
+}
+
+static size_t esp_log_format(char *buf, size_t off, size_t end, const char *fmt, ...)
+{
+    va_list va;
+
+    va_start(va, fmt);
+    off = esp_log_vformat(buf, off, end, fmt, va);
+    va_end(va);
 
-    return ret;
+    return off;
+}
+
+/**
+ * @brief format one text log line into s_log_buf, return the line length
+ */
+static size_t esp_log_format_line(esp_log_level_t level, const char *tag, const char *fmt, va_list va)
+{
+    char prefix;
+    size_t off = 0;
+    /* keep room for color end and '\n' so that truncated lines are still terminated */
+    const size_t end = sizeof(s_log_buf) - sizeof(LOG_LINE_END) + 1;
+
+#ifdef CONFIG_LOG_COLORS
+    uint32_t color = level >= ESP_LOG_MAX ? 0 : s_log_color[level];
+
+    if (color)
+        off = esp_log_format(s_log_buf, off, end, LOG_COLOR_HEAD, color);
+#endif
+    prefix = level >= ESP_LOG_MAX ? 'N' : s_log_prefix[level];
+    off = esp_log_format(s_log_buf, off, end, "%c (%d) %s: ", prefix, esp_log_early_timestamp(), tag);
+
+    off = esp_log_vformat(s_log_buf, off, end, fmt, va);
+
+#ifdef CONFIG_LOG_COLORS
+    if (color) {
+        memcpy(s_log_buf + off, LOG_COLOR_END, sizeof(LOG_COLOR_END) - 1);
+        off += sizeof(LOG_COLOR_END) - 1;
+    }
+#endif
+    s_log_buf[off++] = '\n';
+
+    return off;
+}
+#endif /* !CONFIG_LOG_COMPACT */
+
+#ifdef CONFIG_LOG_ASYNC
+/**
+ * @brief output the number of dropped lines if there are some, must be called with s_out_lock
+ */
+static void esp_log_async_report_dropped(void)
+{
+    int len;
+    uint32_t dropped;
+    char buf[32];
+
+    _lock_acquire_recursive(&s_lock);
+    dropped = s_log_dropped;
+    s_log_dropped = 0;
+    _lock_release_recursive(&s_lock);
+
+    if (!dropped)
+        return;
+
+    len = snprintf(buf, sizeof(buf), "%u messages dropped\n", (unsigned int)dropped);
+    s_write_func(buf, len);
+}
+
+/**
+ * @brief output one line from ring buffer, return false if there is no line in "ticks"
+ */
+static bool esp_log_async_output(TickType_t ticks)
+{
+    size_t len;
+    char *item;
+    UBaseType_t waiting;
+
+    item = xRingbufferReceive(s_log_rb, &len, ticks);
+    if (!item)
+        return false;
+
+    _lock_acquire_recursive(&s_out_lock);
+    s_write_func(item, len);
+    vRingbufferReturnItem(s_log_rb, item);
+
+    /* Lines are dropped only after the buffered ones, so report them when buffer becomes empty */
+    vRingbufferGetInfo(s_log_rb, NULL, NULL, NULL, &waiting);
+    if (!waiting)
+        esp_log_async_report_dropped();
+    _lock_release_recursive(&s_out_lock);
+
+    return true;
+}
+
+static void esp_log_async_task(void *param)
+{
+    while (1)
+        esp_log_async_output(portMAX_DELAY);
+}
+
+/**
+ * @brief Start asynchronous log output
+ */
+int esp_log_async_init(void)
+{
+    RingbufHandle_t rb;
+
+    rb = xRingbufferCreate(CONFIG_LOG_ASYNC_BUFFER_SIZE, RINGBUF_TYPE_NOSPLIT);
+    if (!rb)
+        return -1;
+
+    s_log_rb = rb;
+
+    if (xTaskCreate(esp_log_async_task, "logT", ESP_TASKD_LOG_STACK, NULL, ESP_TASKD_LOG_PRIO, NULL) != pdPASS) {
+        s_log_rb = NULL;
+        vRingbufferDelete(rb);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Output all log lines in the ring buffer by the calling task
+ */
+void esp_log_flush(void)
+{
+    if (!s_log_rb)
+        return;
+
+    _lock_acquire_recursive(&s_out_lock);
+    while (esp_log_async_output(0))
+        ;
+    esp_log_async_report_dropped();
+    _lock_release_recursive(&s_out_lock);
+}
+
+/**
+ * @brief Output all log lines in the ring buffer to UART without locks, at panic or restart
+ */
+void esp_log_panic_flush(void)
+{
+    size_t len;
+    const char *item;
+
+    if (!s_log_rb)
+        return;
+
+    /* the output function may take locks, the ROM one doesn't */
+    while ((item = xRingbufferReceiveFromPanic(s_log_rb, &len)) != NULL) {
+        for (size_t i = 0; i < len; i++)
+            ets_putc(item[i]);
+    }
+
+    if (s_log_dropped) {
+        ets_printf("%u messages dropped\n", (unsigned int)s_log_dropped);
+        s_log_dropped = 0;
+    }
+}
+
+void __real_esp_restart(void) __attribute__ ((noreturn));
+
+/**
+ * @brief Output buffered log lines before restart, esp_restart is wrapped by the linker
+ */
+void __attribute__ ((noreturn)) __wrap_esp_restart(void)
+{
+    if (xTaskGetSchedulerState() == taskSCHEDULER_RUNNING)
+        esp_log_flush();
+    else
+        esp_log_panic_flush();
+
+    __real_esp_restart();
+}
+#endif /* CONFIG_LOG_ASYNC */
+
+/**
+ * @brief send one formatted line to ring buffer or output it directly, must be called with s_lock
+ */
+static inline void esp_log_output(const char *buf, size_t len)
+{
+#ifdef CONFIG_LOG_ASYNC
+    if (s_log_rb) {
+        if (xRingbufferSend(s_log_rb, buf, len, 0) != pdTRUE)
+            s_log_dropped++;
+        return;
+    }
+#endif
+
+    s_write_func(buf, len);
 }
 
 #endif
@@ -243,58 +582,32 @@ out:
  */
 void esp_log_write(esp_log_level_t level, const char *tag,  const char *fmt, ...)
 {
-    int ret;
     va_list va;
-    char *pbuf;
-    char prefix;
-
-    _lock_acquire_recursive(&s_lock);
+    size_t len;
 
 #ifdef CONFIG_LOG_SET_LEVEL
     if (!should_output(level, esp_log_get_level(tag)))
-        goto exit;
+        return;
 #endif
 
-#ifdef CONFIG_LOG_COLORS
-    static char buf[16];
-    uint32_t color = level >= ESP_LOG_MAX ? 0 : s_log_color[level];
+    _lock_acquire_recursive(&s_lock);
 
-    if (color) {
-        sprintf(buf, LOG_COLOR_HEAD, color);
-        ret = esp_log_write_str(buf);
-        if (ret == EOF)
-            goto exit;
-    }
-#endif
-    prefix = level >= ESP_LOG_MAX ? 'N' : s_log_prefix[level];
-    ret = asprintf(&pbuf, "%c (%d) %s: ", prefix, esp_log_early_timestamp(), tag);
-    if (ret < 0)
-        goto out;
-    ret = esp_log_write_str(pbuf);
-    free(pbuf);
-    if (ret == EOF)
+    /* Output function logs by itself, drop the message instead of overwriting the buffer in use */
+    if (s_log_busy)
         goto exit;
+    s_log_busy = true;
 
     va_start(va, fmt);
-    ret = vasprintf(&pbuf, fmt, va);
+#ifdef CONFIG_LOG_COMPACT
+    len = esp_log_compact_encode(s_log_buf, sizeof(s_log_buf), level, esp_log_early_timestamp(), tag, fmt, va);
+#else
+    len = esp_log_format_line(level, tag, fmt, va);
+#endif
     va_end(va);
-    if (ret < 0)
-        goto out;
-    ret = esp_log_write_str(pbuf);
-    free(pbuf);
-    if (ret == EOF)
-        goto exit;
 
-out:
-#ifdef CONFIG_LOG_COLORS
-    if (color) {
-        ret = esp_log_write_str(LOG_COLOR_END);
-        if (ret == EOF)
-            goto exit;
-    }
-#endif
-    if (ret > 0)
-        s_putchar_func('\n');
+    esp_log_output(s_log_buf, len);
+
+    s_log_busy = false;
 
 exit:
     _lock_release_recursive(&s_lock);
@@ -310,6 +623,22 @@ putchar_like_t esp_log_set_putchar(putchar_like_t func)
     _lock_acquire_recursive(&s_lock);
     tmp = s_putchar_func;
     s_putchar_func = func;
+    s_write_func = &esp_log_write_putchar;
+    _lock_release_recursive(&s_lock);
+
+    return tmp;
+}
+
+/**
+ * @brief Set function used to output whole log lines
+ */
+log_write_like_t esp_log_set_write(log_write_like_t func)
+{
+    log_write_like_t tmp;
+
+    _lock_acquire_recursive(&s_lock);
+    tmp = s_write_func;
+    s_write_func = func ? func : &esp_log_write_stdout;
     _lock_release_recursive(&s_lock);
 
     return tmp;
@@ -0,0 +1,209 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "esp_log_compact.h"
+
+typedef struct {
+    char        *buf;
+    size_t      off;
+    size_t      end;
+    bool        truncated;
+} log_frame_t;
+
+static bool frame_put(log_frame_t *frame, const void *data, size_t len)
+{
+    if (frame->truncated || frame->end - frame->off < len) {
+        frame->truncated = true;
+        return false;
+    }
+
+    memcpy(frame->buf + frame->off, data, len);
+    frame->off += len;
+
+    return true;
+}
+
+static inline bool frame_put_u32(log_frame_t *frame, uint32_t val)
+{
+    uint8_t data[4] = {val, val >> 8, val >> 16, val >> 24};
+
+    return frame_put(frame, data, sizeof(data));
+}
+
+static inline bool frame_put_u64(log_frame_t *frame, uint64_t val)
+{
+    return frame_put_u32(frame, val) && frame_put_u32(frame, val >> 32);
+}
+
+static bool frame_put_str(log_frame_t *frame, const char *s)
+{
+    size_t len;
+
+    if (!s)
+        s = "(null)";
+
+    len = strlen(s);
+    if (frame->end - frame->off < len + 1) {
+        /* keep the beginning of the string so that the message is still readable */
+        len = frame->end - frame->off > 0 ? frame->end - frame->off - 1 : 0;
+        frame_put(frame, s, len);
+        frame_put(frame, "", 1);
+        frame->truncated = true;
+        return false;
+    }
+
+    return frame_put(frame, s, len + 1);
+}
+
+/**
+ * @brief copy arguments of one conversion specification, return pointer to the next character
+ *        of the format string or NULL if the specification is not supported
+ */
+static const char *frame_put_arg(log_frame_t *frame, const char *fmt, va_list *va)
+{
+    int longs = 0;
+    bool long_double = false;
+
+    while (*fmt && strchr("-+ #0", *fmt))
+        fmt++;
+
+    if (*fmt == '*') {
+        frame_put_u32(frame, va_arg(*va, int));
+        fmt++;
+    } else {
+        while (*fmt >= '0' && *fmt <= '9')
+            fmt++;
+    }
+
+    if (*fmt == '.') {
+        fmt++;
+        if (*fmt == '*') {
+            frame_put_u32(frame, va_arg(*va, int));
+            fmt++;
+        } else {
+            while (*fmt >= '0' && *fmt <= '9')
+                fmt++;
+        }
+    }
+
+    while (*fmt && strchr("hlLjzt", *fmt)) {
+        if (*fmt == 'l' || *fmt == 'j')
+            longs += *fmt == 'j' ? 2 : 1;
+        else if (*fmt == 'z' || *fmt == 't')
+            longs = sizeof(size_t) > sizeof(uint32_t) ? 1 : 0;
+        else if (*fmt == 'L')
+            long_double = true;
+        fmt++;
+    }
+
+    switch (*fmt) {
+    case 'd':
+    case 'i':
+    case 'u':
+    case 'o':
+    case 'x':
+    case 'X':
+        if (longs >= 2)
+            frame_put_u64(frame, va_arg(*va, unsigned long long));
+        else if (longs == 1)
+            frame_put_u32(frame, va_arg(*va, unsigned long));
+        else
+            frame_put_u32(frame, va_arg(*va, unsigned int));
+        break;
+    case 'c':
+        frame_put_u32(frame, va_arg(*va, int));
+        break;
+    case 'p':
+        frame_put_u32(frame, (uintptr_t)va_arg(*va, void *));
+        break;
+    case 's':
+        frame_put_str(frame, va_arg(*va, const char *));
+        break;
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A': {
+        union {
+            double      d;
+            uint64_t    u;
+        } val;
+
+        if (long_double)
+            return NULL;
+
+        val.d = va_arg(*va, double);
+        frame_put_u64(frame, val.u);
+        break;
+    }
+    default:
+        return NULL;
+    }
+
+    return fmt + 1;
+}
+
+/**
+ * @brief Encode one log message into a compact log frame
+ */
+size_t esp_log_compact_encode(char *buf, size_t size, esp_log_level_t level, uint32_t timestamp,
+                              const char *tag, const char *fmt, va_list va)
+{
+    va_list args;
+    uint8_t sum = 0;
+    size_t len;
+    const char *p = fmt;
+    log_frame_t frame = {
+        .buf = buf,
+        .off = ESP_LOG_COMPACT_HEAD_SIZE,
+        .end = size - 1,
+    };
+
+    frame_put_u32(&frame, timestamp);
+    frame_put_u32(&frame, (uintptr_t)tag);
+    frame_put_u32(&frame, (uintptr_t)fmt);
+
+    va_copy(args, va);
+    while ((p = strchr(p, '%')) != NULL) {
+        if (p[1] == '%') {
+            p += 2;
+            continue;
+        }
+
+        p = frame_put_arg(&frame, p + 1, &args);
+        if (!p || frame.truncated)
+            break;
+    }
+    va_end(args);
+
+    len = frame.off - ESP_LOG_COMPACT_HEAD_SIZE;
+
+    buf[0] = ESP_LOG_COMPACT_SYNC;
+    buf[1] = level | (frame.truncated ? ESP_LOG_COMPACT_TRUNCATED : 0);
+    buf[2] = len;
+    buf[3] = len >> 8;
+
+    for (size_t i = 1; i < frame.off; i++)
+        sum += (uint8_t)buf[i];
+    buf[frame.off] = sum;
+
+    return frame.off + 1;
+}
@@ -0,0 +1,69 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+
+#include "esp_log.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Compact log frame, all fields are little endian:
+ *
+ *   0      1      2         4          8        12       16
+ *   +------+------+---------+----------+--------+--------+------------+----------+
+ *   | sync | info | length  | time(ms) | tag    | format | arguments  | checksum |
+ *   +------+------+---------+----------+--------+--------+------------+----------+
+ *
+ * - sync is ESP_LOG_COMPACT_SYNC
+ * - info is log level, bit ESP_LOG_COMPACT_TRUNCATED is set if arguments do not fit in the frame
+ * - length is the number of bytes from "time" to the end of "arguments"
+ * - tag and format are the addresses of the strings, host tool reads them from the ELF file
+ * - arguments are in the order of the format string:
+ *     - 4 bytes for integers, characters, pointers and "*" width or precision
+ *     - 8 bytes for "ll" and "j" integers and for floating point numbers (double)
+ *     - zero-terminated characters for "%s"
+ * - checksum is the low 8 bits of the sum of bytes from "info" to the end of "arguments"
+ */
+
+#define ESP_LOG_COMPACT_SYNC        0xA5
+#define ESP_LOG_COMPACT_TRUNCATED   0x80
+#define ESP_LOG_COMPACT_HEAD_SIZE   4
+#define ESP_LOG_COMPACT_MIN_SIZE    (ESP_LOG_COMPACT_HEAD_SIZE + 12 + 1)
+
+/**
+ * @brief Encode one log message into a compact log frame
+ *
+ * @param buf frame buffer
+ * @param size frame buffer size, it must be at least ESP_LOG_COMPACT_MIN_SIZE
+ * @param level log level
+ * @param timestamp timestamp in milliseconds
+ * @param tag tag string of the message
+ * @param fmt format string of the message
+ * @param va arguments of the format string
+ *
+ * @return frame length in bytes
+ */
+size_t esp_log_compact_encode(char *buf, size_t size, esp_log_level_t level, uint32_t timestamp,
+                              const char *tag, const char *fmt, va_list va);
+
+#ifdef __cplusplus
+}
+#endif
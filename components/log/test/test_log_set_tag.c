@@ -62,3 +62,55 @@ TEST_CASE("Test set tag level", "[log]")
         ESP_LOGV(TAG[tag_off], "Test TAG VERBOSE with global level %d", level);
     }
 }
+
+static int s_write_calls;
+
+static int test_log_count_write(const char *buf, size_t len)
+{
+    s_write_calls++;
+
+    return len;
+}
+
+TEST_CASE("Test set level of many tags", "[log]")
+{
+    char tags[48][8];
+    char copy[8];
+    log_write_like_t old;
+    const size_t tag_max = sizeof(tags) / sizeof(tags[0]);
+
+    esp_log_level_set("*", ESP_LOG_WARN);
+
+    for (size_t i = 0; i < tag_max; i++) {
+        sprintf(tags[i], "TAG-%u", (unsigned int)i);
+        if (i & 1)
+            esp_log_level_set(tags[i], ESP_LOG_DEBUG);
+    }
+
+    old = esp_log_set_write(test_log_count_write);
+
+    for (int loop = 0; loop < 4; loop++) {
+        for (size_t i = 0; i < tag_max; i++) {
+            s_write_calls = 0;
+            esp_log_write(ESP_LOG_INFO, tags[i], "Test TAG INFO");
+            esp_log_flush();
+            TEST_ASSERT_EQUAL(i & 1, s_write_calls);
+        }
+    }
+
+    /* Same tag at another address has the same level */
+    strcpy(copy, tags[1]);
+    s_write_calls = 0;
+    esp_log_write(ESP_LOG_DEBUG, copy, "Test TAG DEBUG");
+    esp_log_flush();
+    TEST_ASSERT_EQUAL(1, s_write_calls);
+
+    esp_log_level_set(tags[1], ESP_LOG_ERROR);
+    s_write_calls = 0;
+    esp_log_write(ESP_LOG_INFO, tags[1], "Test TAG INFO");
+    esp_log_flush();
+    TEST_ASSERT_EQUAL(0, s_write_calls);
+
+    esp_log_set_write(old);
+    esp_log_level_set("*", ESP_LOG_MAX);
+}
@@ -0,0 +1,103 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdio.h>
+#include <string.h>
+
+#include <unity.h>
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+
+static char s_line[CONFIG_LOG_BUFFER_SIZE + 1];
+static size_t s_line_len;
+static int s_write_calls;
+
+static int test_log_write(const char *buf, size_t len)
+{
+    memcpy(s_line, buf, len);
+    s_line[len] = '\0';
+    s_line_len = len;
+    s_write_calls++;
+
+    return len;
+}
+
+#ifndef CONFIG_LOG_COMPACT
+TEST_CASE("Test log line is written by one call", "[log]")
+{
+    log_write_like_t old = esp_log_set_write(test_log_write);
+
+    s_write_calls = 0;
+    esp_log_write(ESP_LOG_ERROR, "TAG", "value %d", 123);
+    esp_log_flush();
+    esp_log_set_write(old);
+
+    TEST_ASSERT_EQUAL(1, s_write_calls);
+    TEST_ASSERT_NOT_NULL(strstr(s_line, "TAG: value 123"));
+    TEST_ASSERT_EQUAL('\n', s_line[s_line_len - 1]);
+}
+
+TEST_CASE("Test long log line is truncated", "[log]")
+{
+    char msg[CONFIG_LOG_BUFFER_SIZE * 2];
+    log_write_like_t old;
+
+    memset(msg, 'x', sizeof(msg) - 1);
+    msg[sizeof(msg) - 1] = '\0';
+
+    old = esp_log_set_write(test_log_write);
+    s_write_calls = 0;
+    esp_log_write(ESP_LOG_ERROR, "TAG", "%s", msg);
+    esp_log_flush();
+    esp_log_set_write(old);
+
+    TEST_ASSERT_EQUAL(1, s_write_calls);
+    TEST_ASSERT_TRUE(s_line_len <= CONFIG_LOG_BUFFER_SIZE);
+    TEST_ASSERT_EQUAL('\n', s_line[s_line_len - 1]);
+}
+#endif /* !CONFIG_LOG_COMPACT */
+
+TEST_CASE("Test log write does not allocate memory", "[log]")
+{
+    log_write_like_t old = esp_log_set_write(test_log_write);
+    size_t before = heap_caps_get_free_size(MALLOC_CAP_32BIT);
+
+    for (int i = 0; i < 16; i++) {
+        esp_log_write(ESP_LOG_INFO, "TAG", "loop %d %s", i, "message");
+        esp_log_flush();
+        TEST_ASSERT_EQUAL(before, heap_caps_get_free_size(MALLOC_CAP_32BIT));
+    }
+
+    esp_log_set_write(old);
+}
+
+#ifdef CONFIG_LOG_ASYNC
+TEST_CASE("Test asynchronous log reports dropped lines", "[log]")
+{
+    log_write_like_t old;
+
+    esp_log_flush();
+    old = esp_log_set_write(test_log_write);
+
+    /* the drain task has lower priority, so the ring buffer must overflow */
+    s_write_calls = 0;
+    for (int i = 0; i < CONFIG_LOG_ASYNC_BUFFER_SIZE / 8; i++)
+        esp_log_write(ESP_LOG_ERROR, "TAG", "line %d", i);
+    esp_log_flush();
+    esp_log_set_write(old);
+
+    TEST_ASSERT_TRUE(s_write_calls < CONFIG_LOG_ASYNC_BUFFER_SIZE / 8);
+    TEST_ASSERT_NOT_NULL(strstr(s_line, "messages dropped"));
+}
+#endif
@@ -0,0 +1,2 @@
+#define CONFIG_LOG_DEFAULT_LEVEL 3
+#define CONFIG_LOG_COMPACT 1
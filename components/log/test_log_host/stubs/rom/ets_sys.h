@@ -0,0 +1,4 @@
+#pragma once
+
+/* esp_log.h only needs ets_printf, which is not used by the host test */
+int ets_printf(const char *fmt, ...);
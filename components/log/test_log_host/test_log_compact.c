@@ -0,0 +1,101 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/*
+ * Writes compact log frames of test messages to the frame file, and the same messages
+ * formatted by vsnprintf to the text file. tools/esp_log_decode.py must convert the frame
+ * file with this program's ELF file to exactly the text file.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <string.h>
+
+#include "esp_log_compact.h"
+
+static const char s_log_prefix[ESP_LOG_MAX] = {'N', 'E', 'W', 'I', 'D', 'V'};
+
+static FILE *s_frames;
+static FILE *s_text;
+static uint32_t s_timestamp;
+
+static void test_log(esp_log_level_t level, const char *tag, const char *fmt, ...)
+{
+    va_list va;
+    char buf[256];
+    size_t len;
+
+    va_start(va, fmt);
+    len = esp_log_compact_encode(buf, sizeof(buf), level, s_timestamp, tag, fmt, va);
+    va_end(va);
+    fwrite(buf, 1, len, s_frames);
+
+    fprintf(s_text, "%c (%u) %s: ", s_log_prefix[level], s_timestamp, tag);
+    va_start(va, fmt);
+    vfprintf(s_text, fmt, va);
+    va_end(va);
+    fputc('\n', s_text);
+
+    s_timestamp += 17;
+}
+
+/* Text between frames, such as bootloader output, must be passed through */
+static void test_text(const char *s)
+{
+    fputs(s, s_frames);
+    fputs(s, s_text);
+}
+
+int main(int argc, char **argv)
+{
+    static const char *TAG = "test";
+    char ram_str[32];
+
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s <frame file> <text file>\n", argv[0]);
+        return 1;
+    }
+
+    s_frames = fopen(argv[1], "wb");
+    s_text = fopen(argv[2], "wb");
+    if (!s_frames || !s_text)
+        return 1;
+
+    snprintf(ram_str, sizeof(ram_str), "built at %s", "runtime");
+
+    test_text("ets Jan  8 2013,rst cause:2, boot mode:(3,6)\n");
+    test_log(ESP_LOG_INFO, TAG, "no arguments");
+    test_log(ESP_LOG_ERROR, TAG, "int %d, negative %i, unsigned %u", 42, -7, 4000000000u);
+    test_log(ESP_LOG_WARN, "wifi", "hex %x %X %08x %#x octal %o", 0xbeef, 0xCAFE, 0x12, 255, 8);
+    test_log(ESP_LOG_DEBUG, TAG, "long %ld %lu, long long %lld %llu %llx", -100000L, 100000UL,
+             -1234567890123LL, 18446744073709551615ULL, 0x123456789abcULL);
+    test_log(ESP_LOG_VERBOSE, TAG, "short %hd %hu char %hhd %hhu", (short)-2, (unsigned short)65535, (signed char)-3, (unsigned char)200);
+    test_log(ESP_LOG_INFO, TAG, "size %zu %zd", (size_t)1024, (ssize_t)-1);
+    test_log(ESP_LOG_INFO, TAG, "string '%s' '%10s' '%-6s|' '%.3s'", ram_str, "right", "left", "truncate");
+    test_log(ESP_LOG_INFO, TAG, "char %c%c%c", 'a', 'b', 'c');
+    test_log(ESP_LOG_INFO, TAG, "width %*d|%-*d| precision %.*f", 6, 1, 4, 2, 2, 3.14159);
+    test_log(ESP_LOG_INFO, TAG, "float %f %.2f %e %g %G", 1.5, -0.125, 12345.678, 0.0001, 1e20);
+    test_log(ESP_LOG_INFO, TAG, "percent 100%% done");
+    test_log(ESP_LOG_INFO, TAG, "flags %+d % d %05d %-5d|", 3, 4, 5, 6);
+    test_text("plain printf output\n");
+    test_log(ESP_LOG_ERROR, "tcpip", "%s:%d %s", "a.c", 12, "");
+    test_text("\n");
+
+    fclose(s_frames);
+    fclose(s_text);
+
+    return 0;
+}
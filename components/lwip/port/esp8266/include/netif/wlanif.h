@@ -16,6 +16,31 @@
 #ifndef _WLAN_LWIP_IF_H_
 #define _WLAN_LWIP_IF_H_
 
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Statistics of the cache of TCP packets which Wi-Fi failed to send
+ */
+typedef struct {
+    uint32_t cached;        /**< Packets put into the cache */
+    uint32_t retried;       /**< Resend attempts from the cache */
+    uint32_t dropped;       /**< Packets given up after failed resends */
+    uint32_t overflow;      /**< Packets not cached because the cache was full */
+    uint16_t max_cached;    /**< Highest number of packets in the cache at once */
+    uint16_t pending;       /**< Packets currently in the cache */
+    uint16_t capacity;      /**< Number of packets the cache can hold */
+} wlanif_tx_cache_stats_t;
+
+/**
+ * @brief Get the statistics of the TCP TX cache
+ *
+ * @param stats filled with the current statistics
+ */
+void wlanif_get_tx_cache_stats(wlanif_tx_cache_stats_t *stats);
 
 #ifdef __cplusplus
 }
@@ -50,6 +50,7 @@
 #include "stdlib.h"
 
 #include "esp8266/eagle_soc.h"
+#include "netif/wlanif.h"
 
 int ieee80211_output_pbuf(esp_aio_t *aio);
 int8_t wifi_get_netif(uint8_t fd);
@@ -59,17 +60,30 @@ void wifi_station_set_default_hostname(uint8_t* hwaddr);
 #define IFNAME1 'n'
 
 #if ESP_TCP
+/*
+ * TCP packets which Wi-Fi failed to send are cached in a ring and resent from
+ * the head. The ring is preallocated, so that nothing is allocated in the TX
+ * path when memory is tight, and holds as many packets as all TCP PCBs can queue.
+ */
+#define PBUF_SEND_RING_SIZE     (TCP_SND_QUEUELEN * MEMP_NUM_TCP_PCB + MEMP_NUM_TCP_PCB)
+#define PBUF_SEND_RETRY_MAX     3
+
+/* Marks a pbuf which is in the ring, this flag is not used by the lwIP core */
+#define PBUF_FLAG_TX_CACHED     0x80U
+
 typedef struct pbuf_send_list {
-    struct pbuf_send_list* next;
     struct pbuf* p;
     int aiofd;
     int err_cnt;
 } pbuf_send_list_t;
 
-static pbuf_send_list_t* pbuf_list_head = NULL;
+static pbuf_send_list_t pbuf_send_ring[PBUF_SEND_RING_SIZE];
+static int pbuf_send_ring_head = 0;
 static int pbuf_send_list_num = 0;
+static wlanif_tx_cache_stats_t pbuf_send_stats;
 #endif
 static int low_level_send_cb(esp_aio_t* aio);
+static inline struct pbuf* ethernetif_transform_pbuf(struct pbuf* pbuf);
 
 #if ESP_TCP_TXRX_PBUF_DEBUG
 void tcp_print_status(int status, void* buf, uint32_t tmp1, uint32_t tmp2, uint32_t tmp3)
@@ -190,124 +204,277 @@ static inline bool check_pbuf_to_insert(struct pbuf* p)
     return false;
 }
 
-static void insert_to_list(int fd, struct pbuf* p)
+static inline pbuf_send_list_t* pbuf_send_ring_at(int index)
 {
-    pbuf_send_list_t* tmp_pbuf_list1;
-    pbuf_send_list_t* tmp_pbuf_list2;
+    return &pbuf_send_ring[(pbuf_send_ring_head + index) % PBUF_SEND_RING_SIZE];
+}
 
-    if (pbuf_send_list_num > (TCP_SND_QUEUELEN * MEMP_NUM_TCP_PCB + MEMP_NUM_TCP_PCB)) {
-        return;
-    }
+/*
+ * Removes the head of the ring, releasing its pbuf reference if free_pbuf is set.
+ * The caller clears PBUF_FLAG_TX_CACHED.
+ */
+static void pbuf_send_ring_pop(bool free_pbuf)
+{
+    pbuf_send_list_t* entry = pbuf_send_ring_at(0);
 
-    if (!check_pbuf_to_insert(p)) {
-        return;
+    LWIP_DEBUGF(PBUF_CACHE_DEBUG, ("Delete %p,%d\n", entry->p, pbuf_send_list_num));
+
+    if (free_pbuf) {
+        pbuf_free(entry->p);
     }
+    entry->p = NULL;
 
-    LWIP_DEBUGF(PBUF_CACHE_DEBUG, ("Insert %p,%d\n", p, pbuf_send_list_num));
+    pbuf_send_ring_head = (pbuf_send_ring_head + 1) % PBUF_SEND_RING_SIZE;
+    pbuf_send_list_num--;
+}
 
-    if (pbuf_list_head == NULL) {
-        tmp_pbuf_list1 = (pbuf_send_list_t*)malloc(sizeof(pbuf_send_list_t));
+static void insert_to_list(int fd, struct pbuf* p)
+{
+    pbuf_send_list_t* entry;
 
-        if (!tmp_pbuf_list1) {
-            LWIP_DEBUGF(PBUF_CACHE_DEBUG, ("no memory malloc pbuf list error\n"));
-            return;
+    /*
+     * The flag makes the common case, a packet which is not cached yet, O(1).
+     * A packet failing again before being resent counts against its retries.
+     */
+    if (p->flags & PBUF_FLAG_TX_CACHED) {
+        for (int i = 0; i < pbuf_send_list_num; i++) {
+            entry = pbuf_send_ring_at(i);
+            if (entry->p == p) {
+                entry->err_cnt++;
+                break;
+            }
         }
-
-        pbuf_ref(p);
-        tmp_pbuf_list1->aiofd = fd;
-        tmp_pbuf_list1->p = p;
-        tmp_pbuf_list1->next = NULL;
-        tmp_pbuf_list1->err_cnt = 0;
-        pbuf_list_head = tmp_pbuf_list1;
-        pbuf_send_list_num++;
         return;
     }
 
-    tmp_pbuf_list1 = pbuf_list_head;
-    tmp_pbuf_list2 = tmp_pbuf_list1;
-
-    while (tmp_pbuf_list1 != NULL) {
-        if (tmp_pbuf_list1->p == p) {
-            tmp_pbuf_list1->err_cnt ++;
-            return;
-        }
-
-        tmp_pbuf_list2 = tmp_pbuf_list1;
-        tmp_pbuf_list1 = tmp_pbuf_list2->next;
-    }
-
-    tmp_pbuf_list1 = (pbuf_send_list_t*)malloc(sizeof(pbuf_send_list_t));
-
-    if (!tmp_pbuf_list1) {
-        LWIP_DEBUGF(PBUF_CACHE_DEBUG, ("no memory malloc pbuf list error\n"));
+    if (pbuf_send_list_num >= PBUF_SEND_RING_SIZE) {
+        LWIP_DEBUGF(PBUF_CACHE_DEBUG, ("pbuf cache full, drop %p\n", p));
+        pbuf_send_stats.overflow++;
         return;
     }
 
+    LWIP_DEBUGF(PBUF_CACHE_DEBUG, ("Insert %p,%d\n", p, pbuf_send_list_num));
+
+    entry = pbuf_send_ring_at(pbuf_send_list_num);
     pbuf_ref(p);
-    tmp_pbuf_list1->aiofd = fd;
-    tmp_pbuf_list1->p = p;
-    tmp_pbuf_list1->next = NULL;
-    tmp_pbuf_list1->err_cnt = 0;
-    tmp_pbuf_list2->next = tmp_pbuf_list1;
+    p->flags |= PBUF_FLAG_TX_CACHED;
+    entry->aiofd = fd;
+    entry->p = p;
+    entry->err_cnt = 0;
     pbuf_send_list_num++;
+
+    pbuf_send_stats.cached++;
+    if (pbuf_send_list_num > pbuf_send_stats.max_cached) {
+        pbuf_send_stats.max_cached = pbuf_send_list_num;
+    }
 }
 
 void send_from_list()
 {
-    pbuf_send_list_t* tmp_pbuf_list1;
-
-    while (pbuf_list_head != NULL) {
-        if (pbuf_list_head->p->ref == 1) {
-            tmp_pbuf_list1 = pbuf_list_head->next;
-            LWIP_DEBUGF(PBUF_CACHE_DEBUG, ("Delete %p,%d\n", pbuf_list_head->p, pbuf_send_list_num));
-            pbuf_free(pbuf_list_head->p);
-            free(pbuf_list_head);
-            pbuf_send_list_num--;
-            pbuf_list_head = tmp_pbuf_list1;
+    pbuf_send_list_t* entry;
+
+    while (pbuf_send_list_num > 0) {
+        entry = pbuf_send_ring_at(0);
+
+        if (entry->p->ref == 1) {
+            /* Acknowledged meanwhile, only the cache still holds it */
+            entry->p->flags &= ~PBUF_FLAG_TX_CACHED;
+            pbuf_send_ring_pop(true);
         } else {
             esp_aio_t aio;
-            esp_err_t err;
-            aio.fd = (int)pbuf_list_head->aiofd;
-            aio.pbuf = pbuf_list_head->p->payload;
-            aio.len = pbuf_list_head->p->len;
-            aio.cb = low_level_send_cb;
-            aio.arg = pbuf_list_head->p;
-            aio.ret = 0;
-
-            err = ieee80211_output_pbuf(aio);
+            esp_err_t err = ERR_MEM;
+            /* A chained or custom packet is flattened again, like in low_level_output */
+            struct pbuf* p = ethernetif_transform_pbuf(entry->p);
+
+            /*
+             * The packet leaves the ring unless it stays for another retry. Clear
+             * the flag first, so that a failure of this resend can cache it again.
+             */
+            entry->p->flags &= ~PBUF_FLAG_TX_CACHED;
+
+            if (p) {
+                aio.fd = (int)entry->aiofd;
+                aio.pbuf = p->payload;
+                aio.len = p->len;
+                aio.cb = low_level_send_cb;
+                aio.arg = p;
+                aio.ret = 0;
+
+                err = ieee80211_output_pbuf(&aio);
+                if (err != ERR_OK) {
+                    pbuf_free(p);
+                }
 
 #if ESP_TCP_TXRX_PBUF_DEBUG
-            tcp_print_status(LWIP_RESEND_DATA_TO_WIFI_WHEN_WIFI_SEND_FAILED, (void*)pbuf_list_head->p, 0 ,0, 0);
+                tcp_print_status(LWIP_RESEND_DATA_TO_WIFI_WHEN_WIFI_SEND_FAILED, (void*)entry->p, 0 ,0, 0);
 #endif
-            tmp_pbuf_list1 = pbuf_list_head->next;
+                pbuf_send_stats.retried++;
+            }
 
             if (err == ERR_MEM) {
-                pbuf_list_head->err_cnt++;
-
-                if (pbuf_list_head->err_cnt >= 3) {
-                    LWIP_DEBUGF(PBUF_CACHE_DEBUG, ("Delete %p,%d\n", pbuf_list_head->p, pbuf_send_list_num));
-                    pbuf_free(pbuf_list_head->p);
-                    free(pbuf_list_head);
-                    pbuf_send_list_num--;
-                    pbuf_list_head = tmp_pbuf_list1;
+                entry->err_cnt++;
+
+                if (entry->err_cnt >= PBUF_SEND_RETRY_MAX) {
+                    pbuf_send_stats.dropped++;
+                    pbuf_send_ring_pop(true);
+                } else {
+                    entry->p->flags |= PBUF_FLAG_TX_CACHED;
                 }
 
                 return;
             } else if (err == ERR_OK) {
-                LWIP_DEBUGF(PBUF_CACHE_DEBUG, ("Delete %p,%d\n", pbuf_list_head->p, pbuf_send_list_num));
-                free(pbuf_list_head);
-                pbuf_send_list_num--;
-                pbuf_list_head = tmp_pbuf_list1;
+                /* The packet sent holds its own reference, released by low_level_send_cb */
+                pbuf_send_ring_pop(true);
             } else {
-                LWIP_DEBUGF(PBUF_CACHE_DEBUG, ("Delete %p,%d\n", pbuf_list_head->p, pbuf_send_list_num));
-                pbuf_free(pbuf_list_head->p);
-                free(pbuf_list_head);
-                pbuf_send_list_num--;
-                pbuf_list_head = tmp_pbuf_list1;
+                pbuf_send_stats.dropped++;
+                pbuf_send_ring_pop(true);
             }
         }
     }
 }
+
+void wlanif_get_tx_cache_stats(wlanif_tx_cache_stats_t* stats)
+{
+    *stats = pbuf_send_stats;
+    stats->capacity = PBUF_SEND_RING_SIZE;
+    stats->pending = pbuf_send_list_num;
+}
+#endif
+
+/*
+ * A packet flattened for the Wi-Fi driver. It holds a reference to the packet
+ * it was copied from: that is the one lwIP releases when TCP data is acknowledged,
+ * so the TX cache keeps and resends it instead of the copy.
+ */
+typedef struct wlanif_tx_copy {
+    struct pbuf_custom pbuf;
+    struct pbuf* orig;
+} wlanif_tx_copy_t;
+
+static void wlanif_tx_copy_free(struct pbuf* p)
+{
+    wlanif_tx_copy_t* copy = (wlanif_tx_copy_t*)p;
+
+    pbuf_free(copy->orig);
+    mem_free(copy);
+}
+
+static struct pbuf* wlanif_tx_copy_alloc(struct pbuf* orig)
+{
+    wlanif_tx_copy_t* copy = mem_malloc(sizeof(wlanif_tx_copy_t) + PBUF_LINK_ENCAPSULATION_HLEN + orig->tot_len);
+
+    if (!copy) {
+        return NULL;
+    }
+
+    if (IS_IRAM(copy)) {
+        LWIP_DEBUGF(NETIF_DEBUG, ("low_level_output: data in IRAM\n"));
+        mem_free(copy);
+        return NULL;
+    }
+
+    pbuf_ref(orig);
+    copy->orig = orig;
+    copy->pbuf.custom_free_function = wlanif_tx_copy_free;
+    return pbuf_alloced_custom(PBUF_RAW, orig->tot_len, PBUF_REF, &copy->pbuf,
+                               (uint8_t*)(copy + 1) + PBUF_LINK_ENCAPSULATION_HLEN, orig->tot_len);
+}
+
+#if CONFIG_LWIP_WLANIF_TX_BUF_POOL
+/*
+ * Buffers which packets are flattened into for the Wi-Fi driver. The headroom
+ * in front of the packet is where the driver builds the 802.11 header.
+ */
+#define WLANIF_TX_BUF_SIZE      (1500 + SIZEOF_ETH_HDR)
+
+typedef struct wlanif_tx_buf {
+    wlanif_tx_copy_t copy;
+    struct wlanif_tx_buf* next;
+    uint8_t buf[PBUF_LINK_ENCAPSULATION_HLEN + WLANIF_TX_BUF_SIZE] __attribute__((aligned(4)));
+} wlanif_tx_buf_t;
+
+static wlanif_tx_buf_t wlanif_tx_bufs[CONFIG_LWIP_WLANIF_TX_BUF_NUM];
+static wlanif_tx_buf_t* wlanif_tx_buf_free_list;
+static bool wlanif_tx_buf_inited;
+
+/* The buffers are shared by the station and the soft-AP interface */
+static void wlanif_tx_buf_init(void)
+{
+    SYS_ARCH_DECL_PROTECT(lev);
+
+    SYS_ARCH_PROTECT(lev);
+    if (!wlanif_tx_buf_inited) {
+        wlanif_tx_buf_inited = true;
+        for (int i = 0; i < CONFIG_LWIP_WLANIF_TX_BUF_NUM; i++) {
+            wlanif_tx_bufs[i].next = wlanif_tx_buf_free_list;
+            wlanif_tx_buf_free_list = &wlanif_tx_bufs[i];
+        }
+    }
+    SYS_ARCH_UNPROTECT(lev);
+}
+
+/* Called by pbuf_free() when the driver and the TX cache are done with the packet */
+static void wlanif_tx_buf_free(struct pbuf* p)
+{
+    wlanif_tx_buf_t* tx_buf = (wlanif_tx_buf_t*)p;
+    SYS_ARCH_DECL_PROTECT(lev);
+
+    pbuf_free(tx_buf->copy.orig);
+
+    SYS_ARCH_PROTECT(lev);
+    tx_buf->next = wlanif_tx_buf_free_list;
+    wlanif_tx_buf_free_list = tx_buf;
+    SYS_ARCH_UNPROTECT(lev);
+}
+
+static struct pbuf* wlanif_tx_buf_alloc(struct pbuf* orig)
+{
+    wlanif_tx_buf_t* tx_buf;
+    SYS_ARCH_DECL_PROTECT(lev);
+
+    if (orig->tot_len > WLANIF_TX_BUF_SIZE) {
+        return NULL;
+    }
+
+    SYS_ARCH_PROTECT(lev);
+    tx_buf = wlanif_tx_buf_free_list;
+    if (tx_buf) {
+        wlanif_tx_buf_free_list = tx_buf->next;
+    }
+    SYS_ARCH_UNPROTECT(lev);
+
+    if (!tx_buf) {
+        return NULL;
+    }
+
+    pbuf_ref(orig);
+    tx_buf->copy.orig = orig;
+    tx_buf->copy.pbuf.custom_free_function = wlanif_tx_buf_free;
+    return pbuf_alloced_custom(PBUF_RAW, orig->tot_len, PBUF_REF, &tx_buf->copy.pbuf,
+                               tx_buf->buf + PBUF_LINK_ENCAPSULATION_HLEN, WLANIF_TX_BUF_SIZE);
+}
+#endif
+
+#if ESP_TCP
+/* Returns the packet which a flattened copy was made from, NULL for any other pbuf */
+static inline struct pbuf* wlanif_tx_copy_orig(struct pbuf* p)
+{
+    if (!(p->flags & PBUF_FLAG_IS_CUSTOM)) {
+        return NULL;
+    }
+
+#if CONFIG_LWIP_WLANIF_TX_BUF_POOL
+    if (((struct pbuf_custom*)p)->custom_free_function == wlanif_tx_buf_free) {
+        return ((wlanif_tx_copy_t*)p)->orig;
+    }
+#endif
+
+    if (((struct pbuf_custom*)p)->custom_free_function == wlanif_tx_copy_free) {
+        return ((wlanif_tx_copy_t*)p)->orig;
+    }
+
+    return NULL;
+}
 #endif
 
 /**
@@ -330,6 +497,10 @@ static void low_level_init(struct netif* netif)
     /* maximum transfer unit */
     netif->mtu = 1500;
 
+#if CONFIG_LWIP_WLANIF_TX_BUF_POOL
+    wlanif_tx_buf_init();
+#endif
+
     /* device capabilities */
     /* don't set NETIF_FLAG_ETHARP if this device is not an ethernet one */
     netif->flags = NETIF_FLAG_BROADCAST | NETIF_FLAG_ETHARP | NETIF_FLAG_LINK_UP;
@@ -374,7 +545,14 @@ static int low_level_send_cb(esp_aio_t* aio)
 #if ESP_TCP
     wifi_tx_status_t* status = (wifi_tx_status_t*) & (aio->ret);
 
-    if ((TX_STATUS_SUCCESS != status->wifi_tx_result) && check_pbuf_to_insert(pbuf)) {
+    struct pbuf* orig = wlanif_tx_copy_orig(pbuf);
+
+    if ((TX_STATUS_SUCCESS != status->wifi_tx_result) && orig && check_pbuf_to_insert(pbuf)) {
+        /* The copy is released below, the packet it was made from is what lwIP keeps */
+        LWIP_DEBUGF(PBUF_CACHE_DEBUG, ("Send packet fail: result:%d, LRC:%d, SRC:%d, RATE:%d",
+                                       status->wifi_tx_result, status->wifi_tx_lrc, status->wifi_tx_src, status->wifi_tx_rate));
+        insert_to_list(aio->fd, orig);
+    } else if ((TX_STATUS_SUCCESS != status->wifi_tx_result) && !orig && check_pbuf_to_insert(pbuf)) {
         uint8_t* buf = (uint8_t*)pbuf->payload;
         struct eth_hdr ethhdr;
 
@@ -405,15 +583,18 @@ static int low_level_send_cb(esp_aio_t* aio)
  * @brief transform custom pbuf to LWIP core pbuf, LWIP may use input custom pbuf
  *        to send ARP data directly
  *
+ * A pbuf chain is flattened into one buffer, as the driver sends only one.
+ * The copy keeps a reference to the input pbuf, see wlanif_tx_copy_t.
+ *
  * @param pbuf LWIP pbuf pointer
  *
- * @return LWIP pbuf pointer which it not "PBUF_FLAG_IS_CUSTOM" attribute
+ * @return LWIP pbuf pointer which is not a custom pbuf received from the driver
  */
 static inline struct pbuf* ethernetif_transform_pbuf(struct pbuf* pbuf)
 {
-    struct pbuf* p;
+    struct pbuf* p = NULL;
 
-    if (!(pbuf->flags & PBUF_FLAG_IS_CUSTOM) && IS_DRAM(pbuf->payload)) {
+    if (!pbuf->next && !(pbuf->flags & PBUF_FLAG_IS_CUSTOM) && IS_DRAM(pbuf->payload)) {
         /*
          * Add ref to pbuf to avoid it to be freed by upper layer.
          */
@@ -421,23 +602,23 @@ static inline struct pbuf* ethernetif_transform_pbuf(struct pbuf* pbuf)
         return pbuf;
     }
 
-    p = pbuf_alloc(PBUF_RAW, pbuf->len, PBUF_RAM);
+#if CONFIG_LWIP_WLANIF_TX_BUF_POOL
+    p = wlanif_tx_buf_alloc(pbuf);
+#endif
 
     if (!p) {
-        return NULL;
-    }
+        p = wlanif_tx_copy_alloc(pbuf);
 
-    if (IS_IRAM(p->payload)) {
-        LWIP_DEBUGF(NETIF_DEBUG, ("low_level_output: data in IRAM\n"));
-        pbuf_free(p);
-        return NULL;
+        if (!p) {
+            return NULL;
+        }
     }
 
-    memcpy(p->payload, pbuf->payload, pbuf->len);
+    pbuf_copy_partial(pbuf, p->payload, pbuf->tot_len, 0);
 
     /*
      * The input pbuf(named "pbuf") should not be freed, becasue it will be
-     * freed by upper layer.
+     * freed by upper layer. The copy holds a reference to it until it is freed.
      *
      * The output pbuf(named "p") should not be freed either, becasue it will
      * be freed at callback function "low_level_send_cb".
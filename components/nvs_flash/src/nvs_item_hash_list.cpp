@@ -26,6 +26,13 @@ void HashList::clear()
     for (auto it = mBlockList.begin(); it != mBlockList.end();) {
         auto tmp = it;
         ++it;
+        if (mItemIndex) {
+            for (size_t i = 0; i < tmp->mCount; ++i) {
+                if (tmp->mNodes[i].mIndex != 0xff) {
+                    mItemIndex->erase(tmp->mNodes[i].mHash, mPage, tmp->mNodes[i].mIndex);
+                }
+            }
+        }
         mBlockList.erase(tmp);
         delete static_cast<HashListBlock*>(tmp);
     }
@@ -45,6 +52,12 @@ HashList::HashListBlock::HashListBlock()
 esp_err_t HashList::insert(const Item& item, size_t index)
 {
     const uint32_t hash_24 = item.calculateCrc32WithoutValue() & 0xffffff;
+    if (mItemIndex) {
+        esp_err_t err = mItemIndex->insert(hash_24, mPage, index);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
     // add entry to the end of last block if possible
     if (mBlockList.size()) {
         auto& block = mBlockList.back();
@@ -56,7 +69,12 @@ esp_err_t HashList::insert(const Item& item, size_t index)
     // if the above failed, create a new block and add entry to it
     HashListBlock* newBlock = new (std::nothrow) HashListBlock;
 
-    if (!newBlock) return ESP_ERR_NO_MEM;
+    if (!newBlock) {
+        if (mItemIndex) {
+            mItemIndex->erase(hash_24, mPage, index);
+        }
+        return ESP_ERR_NO_MEM;
+    }
 
     mBlockList.push_back(newBlock);
     newBlock->mNodes[0] = HashListNode(hash_24, index);
@@ -72,6 +90,9 @@ bool HashList::erase(size_t index)
         bool foundIndex = false;
         for (size_t i = 0; i < it->mCount; ++i) {
             if (it->mNodes[i].mIndex == index) {
+                if (mItemIndex) {
+                    mItemIndex->erase(it->mNodes[i].mHash, mPage, index);
+                }
                 it->mNodes[i].mIndex = 0xff;
                 foundIndex = true;
                 /* found the item and removed it */
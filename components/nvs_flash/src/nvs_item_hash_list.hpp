@@ -18,6 +18,7 @@
 #include "nvs.h"
 #include "nvs_types.hpp"
 #include "intrusive_list.h"
+#include "nvs_item_index.hpp"
 
 namespace nvs
 {
@@ -33,6 +34,16 @@ public:
     size_t find(size_t start, const Item& item);
     void clear();
 
+    /**
+     * Mirror all entries of this list, which belongs to "page", in the partition wide "index".
+     * Must be called while the list is empty.
+     */
+    void setItemIndex(ItemIndex* index, Page* page)
+    {
+        mItemIndex = index;
+        mPage = page;
+    }
+
 private:
     HashList(const HashList& other);
     const HashList& operator= (const HashList& rhs);
@@ -66,6 +77,8 @@ protected:
 
     typedef intrusive_list<HashListBlock> TBlockList;
     TBlockList mBlockList;
+    ItemIndex* mItemIndex = nullptr;
+    Page* mPage = nullptr;
 }; // class HashList
 
 } // namespace nvs
@@ -0,0 +1,143 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nvs_item_index.hpp"
+#include <new>
+
+namespace nvs
+{
+
+ItemIndex::ItemIndex()
+{
+}
+
+ItemIndex::~ItemIndex()
+{
+    clear();
+}
+
+void ItemIndex::clear()
+{
+    delete[] mSlots;
+    mSlots = nullptr;
+    mSlotCount = 0;
+    mCount = 0;
+    mDeletedCount = 0;
+}
+
+esp_err_t ItemIndex::resize(size_t slotCount)
+{
+    Slot* slots = new (std::nothrow) Slot[slotCount];
+
+    if (!slots) return ESP_ERR_NO_MEM;
+
+    // slot count is a power of two, so the start of probing is the low bits of the hash
+    for (size_t i = 0; i < mSlotCount; ++i) {
+        if (mSlots[i].mPage == nullptr) {
+            continue;
+        }
+        size_t pos = mSlots[i].mHash & (slotCount - 1);
+        while (slots[pos].mPage != nullptr) {
+            pos = (pos + 1) & (slotCount - 1);
+        }
+        slots[pos] = mSlots[i];
+    }
+
+    delete[] mSlots;
+    mSlots = slots;
+    mSlotCount = slotCount;
+    mDeletedCount = 0;
+
+    return ESP_OK;
+}
+
+esp_err_t ItemIndex::insert(uint32_t hash, Page* page, size_t index)
+{
+    // keep at least a quarter of slots empty, so that probing stops early
+    if ((mCount + mDeletedCount + 1) * 4 > mSlotCount * 3) {
+        size_t slotCount = mSlotCount ? mSlotCount : MIN_SLOT_COUNT;
+        if ((mCount + 1) * 2 > slotCount) {
+            slotCount *= 2;
+        }
+        esp_err_t err = resize(slotCount);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+
+    size_t pos = hash & (mSlotCount - 1);
+    while (mSlots[pos].mPage != nullptr) {
+        pos = (pos + 1) & (mSlotCount - 1);
+    }
+
+    if (mSlots[pos].mIndex == DELETED) {
+        --mDeletedCount;
+    }
+    mSlots[pos].mPage = page;
+    mSlots[pos].mIndex = index;
+    mSlots[pos].mHash = hash;
+    ++mCount;
+
+    return ESP_OK;
+}
+
+void ItemIndex::erase(uint32_t hash, const Page* page, size_t index)
+{
+    if (!mSlotCount) {
+        return;
+    }
+
+    for (size_t i = 0, pos = hash & (mSlotCount - 1); i < mSlotCount; ++i, pos = (pos + 1) & (mSlotCount - 1)) {
+        Slot& s = mSlots[pos];
+        if (s.mPage == nullptr && s.mIndex == EMPTY) {
+            break;
+        }
+        if (s.mPage == page && s.mIndex == index && s.mHash == hash) {
+            s.mPage = nullptr;
+            s.mIndex = DELETED;
+            --mCount;
+            ++mDeletedCount;
+            break;
+        }
+    }
+
+    if (!mCount && mDeletedCount) {
+        for (size_t i = 0; i < mSlotCount; ++i) {
+            mSlots[i] = Slot();
+        }
+        mDeletedCount = 0;
+    }
+}
+
+Page* ItemIndex::find(const Item& item, size_t& pos) const
+{
+    const uint32_t hash_24 = item.calculateCrc32WithoutValue() & 0xffffff;
+    const size_t start = hash_24 & (mSlotCount - 1);
+
+    for (; pos < mSlotCount; ++pos) {
+        const Slot& s = mSlots[(start + pos) & (mSlotCount - 1)];
+        if (s.mPage == nullptr && s.mIndex == EMPTY) {
+            break;
+        }
+        if (s.mPage != nullptr && s.mHash == hash_24) {
+            ++pos;
+            return s.mPage;
+        }
+    }
+
+    pos = mSlotCount;
+    return nullptr;
+}
+
+} // namespace nvs
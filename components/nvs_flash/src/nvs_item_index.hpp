@@ -0,0 +1,86 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef nvs_item_index_h
+#define nvs_item_index_h
+
+#include "nvs.h"
+#include "nvs_types.hpp"
+
+namespace nvs
+{
+
+class Page;
+
+/**
+ * Index of items of all pages of a partition.
+ *
+ * It maps the same hash of namespace index, key and chunk index which is stored in the hash list
+ * of each page to the pages which hold an item with this hash. Hash lists of pages keep the index
+ * up to date, so a storage lookup only has to search the pages returned by the index instead of
+ * all pages. Different items may have the same hash, the caller must check the item on the page.
+ */
+class ItemIndex
+{
+public:
+    ItemIndex();
+    ~ItemIndex();
+
+    esp_err_t insert(uint32_t hash, Page* page, size_t index);
+    void erase(uint32_t hash, const Page* page, size_t index);
+
+    /**
+     * Return the next page which holds an item with the hash of "item", or nullptr if there are no more.
+     * "pos" is search state, it must be 0 for the first call.
+     */
+    Page* find(const Item& item, size_t& pos) const;
+
+    void clear();
+
+    size_t size() const
+    {
+        return mCount;
+    }
+
+private:
+    ItemIndex(const ItemIndex& other);
+    const ItemIndex& operator= (const ItemIndex& rhs);
+
+protected:
+    struct Slot {
+        Slot() :
+            mPage(nullptr), mIndex(EMPTY), mHash(0)
+        {
+        }
+
+        Page* mPage;
+        uint32_t mIndex : 8;
+        uint32_t mHash  : 24;
+    };
+
+    static const uint32_t EMPTY = 0xff;
+    static const uint32_t DELETED = 0xfe;
+    static const size_t MIN_SLOT_COUNT = 32;
+
+    esp_err_t resize(size_t slotCount);
+
+    Slot* mSlots = nullptr;
+    size_t mSlotCount = 0;
+    size_t mCount = 0;
+    size_t mDeletedCount = 0;
+}; // class ItemIndex
+
+} // namespace nvs
+
+#endif /* nvs_item_index_h */
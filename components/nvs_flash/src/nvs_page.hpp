@@ -87,6 +87,11 @@ public:
 
     esp_err_t load(Partition *partition, uint32_t sectorNumber);
 
+    void setItemIndex(ItemIndex* index)
+    {
+        mHashList.setItemIndex(index, this);
+    }
+
     esp_err_t getSeqNumber(uint32_t& seqNumber) const;
 
     esp_err_t setSeqNumber(uint32_t seqNumber);
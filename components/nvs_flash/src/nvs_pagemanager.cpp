@@ -26,10 +26,14 @@ esp_err_t PageManager::load(Partition *partition, uint32_t baseSector, uint32_t
     mPageList.clear();
     mFreePageList.clear();
     mPages.reset(new (nothrow) Page[sectorCount]);
+    mItemIndex.clear();
 
     if (!mPages) return ESP_ERR_NO_MEM;
 
     for (uint32_t i = 0; i < sectorCount; ++i) {
+        if (mUseItemIndex) {
+            mPages[i].setItemIndex(&mItemIndex);
+        }
         auto err = mPages[i].load(partition, baseSector + i);
         if (err != ESP_OK) {
             return err;
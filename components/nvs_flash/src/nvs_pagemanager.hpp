@@ -16,8 +16,10 @@
 
 #include <memory>
 #include <list>
+#include "sdkconfig.h"
 #include "nvs_types.hpp"
 #include "nvs_page.hpp"
+#include "nvs_item_index.hpp"
 #include "partition.hpp"
 #include "intrusive_list.h"
 
@@ -54,6 +56,19 @@ public:
 
     esp_err_t requestNewPage();
 
+    /**
+     * Enable or disable the partition wide item index, must be called before load()
+     */
+    void enableItemIndex(bool enable)
+    {
+        mUseItemIndex = enable;
+    }
+
+    ItemIndex* getItemIndex()
+    {
+        return mUseItemIndex ? &mItemIndex : nullptr;
+    }
+
     esp_err_t fillStats(nvs_stats_t& nvsStats);
 
     uint32_t getBaseSector()
@@ -68,6 +83,12 @@ protected:
 
     TPageList mPageList;
     TPageList mFreePageList;
+    ItemIndex mItemIndex;   // declared before mPages, pages remove their items from it when destroyed
+#ifdef CONFIG_NVS_ITEM_INDEX
+    bool mUseItemIndex = true;
+#else
+    bool mUseItemIndex = false;
+#endif
     std::unique_ptr<Page[]> mPages;
     uint32_t mBaseSector;
     uint32_t mPageCount;
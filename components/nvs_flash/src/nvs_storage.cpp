@@ -155,6 +155,33 @@ bool Storage::isValid() const
 
 esp_err_t Storage::findItem(uint8_t nsIndex, ItemType datatype, const char* key, Page* &page, Item& item, uint8_t chunkIdx, VerOffset chunkStart)
 {
+    ItemIndex* index = mPageManager.getItemIndex();
+
+    // the index holds the same hashes as page hash lists, which are only used for full matches
+    if (index && nsIndex != Page::NS_ANY && datatype != ItemType::ANY && key != nullptr) {
+        const Item hashItem(nsIndex, datatype, 0, key, chunkIdx);
+        Item found;
+        uint32_t foundSeqNumber = UINT32_MAX;
+        size_t pos = 0;
+        Page* p;
+
+        page = nullptr;
+        while ((p = index->find(hashItem, pos)) != nullptr) {
+            size_t itemIndex = 0;
+            uint32_t seqNumber;
+            if (p == page || p->getSeqNumber(seqNumber) != ESP_OK || seqNumber > foundSeqNumber) {
+                continue;
+            }
+            if (p->findItem(nsIndex, datatype, key, itemIndex, found, chunkIdx, chunkStart) == ESP_OK) {
+                // like the scan below, prefer the oldest page if the item is duplicated
+                page = p;
+                item = found;
+                foundSeqNumber = seqNumber;
+            }
+        }
+        return page ? ESP_OK : ESP_ERR_NVS_NOT_FOUND;
+    }
+
     for (auto it = std::begin(mPageManager); it != std::end(mPageManager); ++it) {
         size_t itemIndex = 0;
         auto err = it->findItem(nsIndex, datatype, key, itemIndex, item, chunkIdx, chunkStart);
@@ -691,6 +718,16 @@ void Storage::debugCheck()
                 assert(0);
             }
             keys.insert(std::make_pair(keystr, static_cast<Page*>(p)));
+            if (mPageManager.getItemIndex()) {
+                size_t pos = 0;
+                Page* indexed;
+                while ((indexed = mPageManager.getItemIndex()->find(item, pos)) != nullptr && indexed != p) {
+                }
+                if (indexed != p) {
+                    printf("Item not indexed: %s\n", keystr.c_str());
+                    assert(0);
+                }
+            }
             itemIndex += item.span;
             usedCount += item.span;
         }
@@ -69,6 +69,15 @@ public:
 
     esp_err_t init(uint32_t baseSector, uint32_t sectorCount);
 
+    /**
+     * Enable or disable the in-RAM index of items of all pages, which makes lookups independent
+     * of the number of pages. Must be called before init(). Default is CONFIG_NVS_ITEM_INDEX.
+     */
+    void enableItemIndex(bool enable)
+    {
+        mPageManager.enableItemIndex(enable);
+    }
+
     bool isValid() const;
 
     esp_err_t createOrOpenNamespace(const char* nsName, bool canCreate, uint8_t& nsIndex);
@@ -21,6 +21,7 @@
 #include "test_fixtures.hpp"
 
 #include <iostream>
+#include <chrono>
 
 using namespace std;
 using namespace nvs;
@@ -58,3 +59,91 @@ TEST_CASE("Storage iterator recognizes blob with VerOffset::VER_1_OFFSET", "[nvs
 
     REQUIRE(NVSPartitionManager::get_instance()->deinit_partition("test") == ESP_OK);
 }
+
+static void benchmarkItemIndex(uint32_t pageCount, bool useIndex, uint32_t& checksum)
+{
+    // strings of 12 entries, so that about 8 items are stored on each page
+    const size_t keyCount = pageCount * 8;
+    const size_t valueSize = 12 * Page::ENTRY_SIZE;
+    char key[16];
+    char value[valueSize];
+    uint8_t nsIndex;
+    PartitionEmulationFixture f(0, pageCount, "test");
+    Storage storage(&f.part);
+
+    storage.enableItemIndex(useIndex);
+    REQUIRE(storage.init(0, pageCount) == ESP_OK);
+    REQUIRE(storage.createOrOpenNamespace("bench", true, nsIndex) == ESP_OK);
+
+    auto setValue = [&](size_t i) {
+        snprintf(key, sizeof(key), "key_%u", (unsigned) i);
+        memset(value, 'a' + i % 26, sizeof(value) - 1);
+        value[sizeof(value) - 1] = 0;
+    };
+
+    // on host every modifying write is followed by a consistency check of all items (DEBUG_STORAGE),
+    // which dominates the time of writing new items
+    auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < keyCount; ++i) {
+        setValue(i);
+        REQUIRE(storage.writeItem(nsIndex, ItemType::SZ, key, value, sizeof(value)) == ESP_OK);
+    }
+    auto writeTime = chrono::steady_clock::now() - start;
+
+    // writing the same value only looks the item up and compares it
+    start = chrono::steady_clock::now();
+    for (size_t i = 0; i < keyCount; ++i) {
+        setValue(i);
+        REQUIRE(storage.writeItem(nsIndex, ItemType::SZ, key, value, sizeof(value)) == ESP_OK);
+    }
+    auto sameWriteTime = chrono::steady_clock::now() - start;
+
+    start = chrono::steady_clock::now();
+    for (size_t i = 0; i < keyCount; ++i) {
+        snprintf(key, sizeof(key), "key_%u", (unsigned) i);
+        REQUIRE(storage.readItem(nsIndex, ItemType::SZ, key, value, sizeof(value)) == ESP_OK);
+        checksum += value[0];
+    }
+    auto hitTime = chrono::steady_clock::now() - start;
+
+    start = chrono::steady_clock::now();
+    for (size_t i = 0; i < keyCount; ++i) {
+        snprintf(key, sizeof(key), "none_%u", (unsigned) i);
+        REQUIRE(storage.readItem(nsIndex, ItemType::SZ, key, value, sizeof(value)) == ESP_ERR_NVS_NOT_FOUND);
+    }
+    auto missTime = chrono::steady_clock::now() - start;
+
+    // modify some items, so that pages are reclaimed and items move between pages
+    for (size_t i = 0; i < keyCount; i += 3) {
+        setValue(i + 1);
+        snprintf(key, sizeof(key), "key_%u", (unsigned) i);
+        REQUIRE(storage.writeItem(nsIndex, ItemType::SZ, key, value, sizeof(value)) == ESP_OK);
+    }
+    for (size_t i = 0; i < keyCount; ++i) {
+        snprintf(key, sizeof(key), "key_%u", (unsigned) i);
+        REQUIRE(storage.readItem(nsIndex, ItemType::SZ, key, value, sizeof(value)) == ESP_OK);
+        checksum += value[0];
+    }
+
+    auto us = [keyCount](chrono::steady_clock::duration d) {
+        return chrono::duration_cast<chrono::nanoseconds>(d).count() / 1000.0 / keyCount;
+    };
+    cout << pageCount << " pages, " << keyCount << " items, " << (useIndex ? "with" : "without") << " item index, us per item: "
+         << "write " << us(writeTime) << ", "
+         << "write same value " << us(sameWriteTime) << ", "
+         << "read " << us(hitTime) << ", "
+         << "read missing " << us(missTime) << endl;
+}
+
+TEST_CASE("Storage lookup and write latency with and without item index", "[nvs_storage][long]")
+{
+    for (uint32_t pageCount : {64, 256}) {
+        uint32_t checksum = 0;
+        uint32_t checksumIndexed = 0;
+
+        benchmarkItemIndex(pageCount, false, checksum);
+        benchmarkItemIndex(pageCount, true, checksumIndexed);
+
+        CHECK(checksum == checksumIndexed);
+    }
+}
@@ -74,6 +74,38 @@ static time_t vfs_spiffs_get_mtime(const spiffs_stat* s);
 
 static esp_spiffs_t * _efs[CONFIG_SPIFFS_MAX_PARTITIONS];
 
+#ifdef CONFIG_SPIFFS_GC_TASK
+/* Erases deleted pages one block at a time once the filesystem hasn't been
+ * used for CONFIG_SPIFFS_GC_TASK_IDLE_MS, so that writes find free blocks
+ * instead of collecting garbage themselves. The lock is taken directly, so
+ * that the task doesn't count as an access.
+ */
+static void esp_spiffs_gc_task(void *arg)
+{
+    esp_spiffs_t * efs = (esp_spiffs_t *)arg;
+    const TickType_t idle = pdMS_TO_TICKS(CONFIG_SPIFFS_GC_TASK_IDLE_MS);
+    TickType_t delay = idle;
+
+    while (1) {
+        vTaskDelay(delay);
+        delay = idle;
+        if (xTaskGetTickCount() - efs->last_access < idle) {
+            continue;
+        }
+
+        xSemaphoreTake(efs->lock, portMAX_DELAY);
+        s32_t res = spiffs_api_gc(efs->fs, CONFIG_SPIFFS_GC_TASK_FREE_BLOCKS);
+        xSemaphoreGive(efs->lock);
+        if (res > 0) {
+            /* More may be needed, let other tasks at the filesystem first */
+            delay = 1;
+        } else if (res < 0) {
+            ESP_LOGE(TAG, "gc failed, %i", res);
+        }
+    }
+}
+#endif
+
 static void esp_spiffs_free(esp_spiffs_t ** efs)
 {
     esp_spiffs_t * e = *efs;
@@ -82,10 +114,22 @@ static void esp_spiffs_free(esp_spiffs_t ** efs)
     }
     *efs = NULL;
 
+#ifdef CONFIG_SPIFFS_GC_TASK
+    if (e->gc_task) {
+        /* Not in the middle of collecting garbage while the lock is held */
+        xSemaphoreTake(e->lock, portMAX_DELAY);
+        vTaskDelete(e->gc_task);
+        xSemaphoreGive(e->lock);
+    }
+#endif
+
     if (e->fs) {
         SPIFFS_unmount(e->fs);
         free(e->fs);
     }
+#ifdef CONFIG_SPIFFS_NAME_INDEX
+    spiffs_index_reset(&e->index);
+#endif
     vSemaphoreDelete(e->lock);
     free(e->fds);
     free(e->cache);
@@ -246,6 +290,15 @@ static esp_err_t esp_spiffs_init(const esp_vfs_spiffs_conf_t* conf)
         esp_spiffs_free(&efs);
         return ESP_FAIL;
     }
+#ifdef CONFIG_SPIFFS_GC_TASK
+    efs->last_access = xTaskGetTickCount();
+    if (xTaskCreate(esp_spiffs_gc_task, "spiffs_gc", CONFIG_SPIFFS_GC_TASK_STACK_SIZE, efs,
+                    CONFIG_SPIFFS_GC_TASK_PRIORITY, &efs->gc_task) != pdPASS) {
+        ESP_LOGE(TAG, "gc task could not be created");
+        esp_spiffs_free(&efs);
+        return ESP_ERR_NO_MEM;
+    }
+#endif
     _efs[index] = efs;
     return ESP_OK;
 }
@@ -295,6 +348,9 @@ esp_err_t esp_spiffs_format(const char* partition_label)
     }
 
     SPIFFS_unmount(_efs[index]->fs);
+#ifdef CONFIG_SPIFFS_NAME_INDEX
+    spiffs_index_reset(&_efs[index]->index);
+#endif
 
     s32_t res = SPIFFS_format(_efs[index]->fs);
     if (res != SPIFFS_OK) {
@@ -448,7 +504,11 @@ static int vfs_spiffs_open(void* ctx, const char * path, int flags, int mode)
     assert(path);
     esp_spiffs_t * efs = (esp_spiffs_t *)ctx;
     int spiffs_flags = spiffs_mode_conv(flags);
+#ifdef CONFIG_SPIFFS_NAME_INDEX
+    int fd = spiffs_index_open(efs->fs, &efs->index, path, spiffs_flags, mode);
+#else
     int fd = SPIFFS_open(efs->fs, path, spiffs_flags, mode);
+#endif
     if (fd < 0) {
         errno = spiffs_res_to_errno(SPIFFS_errno(efs->fs));
         SPIFFS_clearerr(efs->fs);
@@ -533,7 +593,11 @@ static int vfs_spiffs_stat(void* ctx, const char * path, struct stat * st)
     assert(st);
     spiffs_stat s;
     esp_spiffs_t * efs = (esp_spiffs_t *)ctx;
+#ifdef CONFIG_SPIFFS_NAME_INDEX
+    off_t res = spiffs_index_stat(efs->fs, &efs->index, path, &s);
+#else
     off_t res = SPIFFS_stat(efs->fs, path, &s);
+#endif
     if (res < 0) {
         errno = spiffs_res_to_errno(SPIFFS_errno(efs->fs));
         SPIFFS_clearerr(efs->fs);
@@ -554,7 +618,11 @@ static int vfs_spiffs_rename(void* ctx, const char *src, const char *dst)
     assert(src);
     assert(dst);
     esp_spiffs_t * efs = (esp_spiffs_t *)ctx;
+#ifdef CONFIG_SPIFFS_NAME_INDEX
+    int res = spiffs_index_rename(efs->fs, &efs->index, src, dst);
+#else
     int res = SPIFFS_rename(efs->fs, src, dst);
+#endif
     if (res < 0) {
         errno = spiffs_res_to_errno(SPIFFS_errno(efs->fs));
         SPIFFS_clearerr(efs->fs);
@@ -567,7 +635,11 @@ static int vfs_spiffs_unlink(void* ctx, const char *path)
 {
     assert(path);
     esp_spiffs_t * efs = (esp_spiffs_t *)ctx;
+#ifdef CONFIG_SPIFFS_NAME_INDEX
+    int res = spiffs_index_remove(efs->fs, &efs->index, path);
+#else
     int res = SPIFFS_remove(efs->fs, path);
+#endif
     if (res < 0) {
         errno = spiffs_res_to_errno(SPIFFS_errno(efs->fs));
         SPIFFS_clearerr(efs->fs);
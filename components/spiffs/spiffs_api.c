@@ -18,12 +18,16 @@
 #include "esp_spiffs.h"
 #include "esp_vfs.h"
 #include "spiffs_api.h"
+#include "spiffs_nucleus.h"
 
 static const char* TAG = "SPIFFS";
 
 void spiffs_api_lock(spiffs *fs)
 {
     (void) xSemaphoreTake(((esp_spiffs_t *)(fs->user_data))->lock, portMAX_DELAY);
+#ifdef CONFIG_SPIFFS_GC_TASK
+    ((esp_spiffs_t *)(fs->user_data))->last_access = xTaskGetTickCount();
+#endif
 }
 
 void spiffs_api_unlock(spiffs *fs)
@@ -91,3 +95,24 @@ void spiffs_api_check(spiffs *fs, spiffs_check_type type,
                               spiffs_check_report_str[report], arg1, arg2);
     }
 }
+
+s32_t spiffs_api_gc(spiffs *fs, uint32_t free_blocks)
+{
+    if (!SPIFFS_mounted(fs) || fs->free_blocks >= free_blocks || fs->stats_p_deleted == 0) {
+        return 0;
+    }
+
+    u32_t deleted = fs->stats_p_deleted;
+    s32_t res = spiffs_gc_quick(fs, 0);
+    if (res == SPIFFS_ERR_NO_DELETED_BLOCKS) {
+        /* Asking for as much space as is free makes it clean a single block,
+         * instead of up to CONFIG_SPIFFS_GC_MAX_RUNS of them */
+        s32_t free_pages = (SPIFFS_PAGES_PER_BLOCK(fs) - SPIFFS_OBJ_LOOKUP_PAGES(fs)) * (fs->block_count - 2)
+                - fs->stats_p_allocated - fs->stats_p_deleted;
+        res = spiffs_gc_check(fs, free_pages > 0 ? free_pages * SPIFFS_DATA_PAGE_SIZE(fs) : 0);
+    }
+    if (res != SPIFFS_OK && res != SPIFFS_ERR_FULL) {
+        return res;
+    }
+    return fs->stats_p_deleted < deleted ? 1 : 0;
+}
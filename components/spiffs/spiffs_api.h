@@ -21,6 +21,7 @@
 #include "freertos/semphr.h"
 #include "spiffs.h"
 #include "esp_vfs.h"
+#include "spiffs_index.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -41,6 +42,13 @@ typedef struct {
     uint32_t fds_sz;                        /*!< File Descriptor Buffer Length */
     uint8_t *cache;                         /*!< Cache Buffer */
     uint32_t cache_sz;                      /*!< Cache Buffer Length */
+#ifdef CONFIG_SPIFFS_NAME_INDEX
+    spiffs_index_t index;                   /*!< Index of file names */
+#endif
+#ifdef CONFIG_SPIFFS_GC_TASK
+    TaskHandle_t gc_task;                   /*!< Background garbage collection task */
+    volatile TickType_t last_access;        /*!< Tick count when the FS lock was last taken by the API */
+#endif
 } esp_spiffs_t;
 
 s32_t spiffs_api_read(spiffs *fs, uint32_t addr, uint32_t size, uint8_t *dst);
@@ -52,6 +60,20 @@ s32_t spiffs_api_erase(spiffs *fs, uint32_t addr, uint32_t size);
 void spiffs_api_check(spiffs *fs, spiffs_check_type type,
                             spiffs_check_report report, uint32_t arg1, uint32_t arg2);
 
+/**
+ * @brief Erase one block worth of deleted pages, with the FS lock held
+ *
+ * Blocks which only hold deleted pages are erased first. Otherwise the pages
+ * still in use of one block are moved, as the garbage collection of a write
+ * does.
+ *
+ * @param fs          mounted filesystem
+ * @param free_blocks nothing is done while at least this number of blocks is erased
+ *
+ * @return 1 if deleted pages were erased, 0 if there was nothing to do, or negative error
+ */
+s32_t spiffs_api_gc(spiffs *fs, uint32_t free_blocks);
+
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
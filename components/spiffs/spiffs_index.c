@@ -0,0 +1,444 @@
+// Copyright 2015-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "spiffs.h"
+#include "spiffs_nucleus.h"
+#include "spiffs_index.h"
+
+static const char* TAG = "SPIFFS";
+
+#define SPIFFS_INDEX_MIN_SIZE   16
+
+/* SPIFFS finds a file by reading the index header of every file until the name
+ * matches. The index maps the hash of the name to the object id and the page
+ * where its index header was last seen, so that a lookup reads one header, and
+ * a name which is not in the index is known not to exist.
+ *
+ * Lookups and updates of the index happen under the SPIFFS lock together with
+ * the operation on the file. Whenever the index can't be used, the operation
+ * falls back to the SPIFFS API, which looks for the name.
+ */
+
+static uint32_t spiffs_index_hash(const char *path)
+{
+    uint32_t hash = 2166136261U;
+    while (*path) {
+        hash = (hash ^ (uint8_t) *path++) * 16777619U;
+    }
+    return hash;
+}
+
+static int spiffs_index_cmp(const void *a, const void *b)
+{
+    uint32_t ha = ((const spiffs_index_entry_t *) a)->hash;
+    uint32_t hb = ((const spiffs_index_entry_t *) b)->hash;
+    return (ha > hb) - (ha < hb);
+}
+
+/* First entry with the hash, or where it is to be inserted */
+static uint32_t spiffs_index_bsearch(const spiffs_index_t *index, uint32_t hash)
+{
+    uint32_t lo = 0, hi = index->count;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        if (index->entries[mid].hash < hash) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static bool spiffs_index_grow(spiffs_index_t *index)
+{
+    if (index->count < index->size) {
+        return true;
+    }
+    uint32_t size = index->size ? index->size * 2 : SPIFFS_INDEX_MIN_SIZE;
+    spiffs_index_entry_t *entries = realloc(index->entries, size * sizeof(spiffs_index_entry_t));
+    if (entries == NULL) {
+        ESP_LOGW(TAG, "no memory for the name index of %d files", index->count + 1);
+        return false;
+    }
+    index->entries = entries;
+    index->size = size;
+    return true;
+}
+
+void spiffs_index_reset(spiffs_index_t *index)
+{
+    free(index->entries);
+    index->entries = NULL;
+    index->count = 0;
+    index->size = 0;
+    index->valid = false;
+}
+
+static void spiffs_index_insert(spiffs_index_t *index, const char *path, spiffs_obj_id obj_id, spiffs_page_ix pix)
+{
+    if (!spiffs_index_grow(index)) {
+        /* A missing file would be reported as not existing */
+        spiffs_index_reset(index);
+        return;
+    }
+
+    uint32_t hash = spiffs_index_hash(path);
+    uint32_t i = spiffs_index_bsearch(index, hash);
+    memmove(&index->entries[i + 1], &index->entries[i], (index->count - i) * sizeof(spiffs_index_entry_t));
+    index->entries[i].hash = hash;
+    index->entries[i].obj_id = obj_id & ~SPIFFS_OBJ_ID_IX_FLAG;
+    index->entries[i].pix = pix;
+    index->count++;
+}
+
+static void spiffs_index_erase(spiffs_index_t *index, spiffs_index_entry_t *entry)
+{
+    uint32_t i = entry - index->entries;
+    index->count--;
+    memmove(&index->entries[i], &index->entries[i + 1], (index->count - i) * sizeof(spiffs_index_entry_t));
+}
+
+/* Same checks as SPIFFS does when listing the files */
+static bool spiffs_index_hdr_valid(const spiffs_page_object_ix_header *hdr)
+{
+    return hdr->p_hdr.span_ix == 0 &&
+           (hdr->p_hdr.flags & (SPIFFS_PH_FLAG_DELET | SPIFFS_PH_FLAG_FINAL | SPIFFS_PH_FLAG_IXDELE)) ==
+               (SPIFFS_PH_FLAG_DELET | SPIFFS_PH_FLAG_IXDELE);
+}
+
+static s32_t spiffs_index_build_v(spiffs *fs, spiffs_obj_id obj_id, spiffs_block_ix bix, int ix_entry,
+                                  const void *user_const_p, void *user_var_p)
+{
+    spiffs_index_t *index = (spiffs_index_t *) user_var_p;
+    spiffs_page_object_ix_header hdr;
+
+    if (obj_id == SPIFFS_OBJ_ID_FREE || obj_id == SPIFFS_OBJ_ID_DELETED ||
+        (obj_id & SPIFFS_OBJ_ID_IX_FLAG) == 0) {
+        return SPIFFS_VIS_COUNTINUE;
+    }
+
+    spiffs_page_ix pix = SPIFFS_OBJ_LOOKUP_ENTRY_TO_PIX(fs, bix, ix_entry);
+    s32_t res = _spiffs_rd(fs, SPIFFS_OP_T_OBJ_LU2 | SPIFFS_OP_C_READ, 0,
+            SPIFFS_PAGE_TO_PADDR(fs, pix), sizeof(spiffs_page_object_ix_header), (u8_t *) &hdr);
+    if (res != SPIFFS_OK) {
+        return res;
+    }
+    if (spiffs_index_hdr_valid(&hdr)) {
+        if (!spiffs_index_grow(index)) {
+            return SPIFFS_ERR_INTERNAL;
+        }
+        spiffs_index_entry_t *entry = &index->entries[index->count++];
+        entry->hash = spiffs_index_hash((const char *) hdr.name);
+        entry->obj_id = obj_id & ~SPIFFS_OBJ_ID_IX_FLAG;
+        entry->pix = pix;
+    }
+    return SPIFFS_VIS_COUNTINUE;
+}
+
+static s32_t spiffs_index_build(spiffs *fs, spiffs_index_t *index)
+{
+    spiffs_block_ix bix;
+    int entry;
+
+    spiffs_index_reset(index);
+    s32_t res = spiffs_obj_lu_find_entry_visitor(fs, 0, 0, SPIFFS_VIS_NO_WRAP, 0,
+            spiffs_index_build_v, 0, index, &bix, &entry);
+    if (res != SPIFFS_VIS_END) {
+        spiffs_index_reset(index);
+        return res;
+    }
+
+    qsort(index->entries, index->count, sizeof(spiffs_index_entry_t), spiffs_index_cmp);
+    index->valid = true;
+    ESP_LOGD(TAG, "name index of %d files", index->count);
+    return SPIFFS_OK;
+}
+
+/* Reads the index header at the page, if it still belongs to the object */
+static s32_t spiffs_index_read_hdr(spiffs *fs, spiffs_obj_id obj_id, spiffs_page_ix pix,
+                                   spiffs_page_object_ix_header *hdr)
+{
+    spiffs_obj_id lu_obj_id;
+
+    if (pix >= SPIFFS_MAX_PAGES(fs) || SPIFFS_IS_LOOKUP_PAGE(fs, pix)) {
+        return SPIFFS_ERR_NOT_FOUND;
+    }
+    u32_t lu_addr = SPIFFS_BLOCK_TO_PADDR(fs, SPIFFS_BLOCK_FOR_PAGE(fs, pix)) +
+            SPIFFS_OBJ_LOOKUP_ENTRY_FOR_PAGE(fs, pix) * sizeof(spiffs_obj_id);
+    s32_t res = _spiffs_rd(fs, SPIFFS_OP_T_OBJ_LU | SPIFFS_OP_C_READ, 0,
+            lu_addr, sizeof(spiffs_obj_id), (u8_t *) &lu_obj_id);
+    if (res != SPIFFS_OK) {
+        return res;
+    }
+    if (lu_obj_id != (obj_id | SPIFFS_OBJ_ID_IX_FLAG)) {
+        return SPIFFS_ERR_NOT_FOUND;
+    }
+    res = _spiffs_rd(fs, SPIFFS_OP_T_OBJ_IX | SPIFFS_OP_C_READ, 0,
+            SPIFFS_PAGE_TO_PADDR(fs, pix), sizeof(spiffs_page_object_ix_header), (u8_t *) hdr);
+    if (res != SPIFFS_OK) {
+        return res;
+    }
+    return spiffs_index_hdr_valid(hdr) ? SPIFFS_OK : SPIFFS_ERR_NOT_FOUND;
+}
+
+static s32_t spiffs_index_locate(spiffs *fs, spiffs_index_entry_t *entry, spiffs_page_object_ix_header *hdr)
+{
+    spiffs_page_ix pix = entry->pix;
+
+    s32_t res = spiffs_index_read_hdr(fs, entry->obj_id, pix, hdr);
+    if (res == SPIFFS_ERR_NOT_FOUND) {
+        /* The header has moved, look for the object id in the lookup pages */
+        res = spiffs_obj_lu_find_id_and_span(fs, entry->obj_id | SPIFFS_OBJ_ID_IX_FLAG, 0, 0, &pix);
+        if (res == SPIFFS_OK) {
+            res = spiffs_index_read_hdr(fs, entry->obj_id, pix, hdr);
+        }
+    }
+    if (res == SPIFFS_OK) {
+        entry->pix = pix;
+    }
+    return res;
+}
+
+/* Called with the SPIFFS lock held. SPIFFS_ERR_NOT_FOUND is returned only when
+ * the name doesn't exist, any other error means the index can't be used. */
+static s32_t spiffs_index_find(spiffs *fs, spiffs_index_t *index, const char *path,
+                               spiffs_index_entry_t **entry, spiffs_page_object_ix_header *hdr)
+{
+    if (!index->valid) {
+        s32_t res = spiffs_index_build(fs, index);
+        if (res != SPIFFS_OK) {
+            return res == SPIFFS_ERR_NOT_FOUND ? SPIFFS_ERR_INTERNAL : res;
+        }
+    }
+
+    uint32_t hash = spiffs_index_hash(path);
+    for (uint32_t i = spiffs_index_bsearch(index, hash); i < index->count && index->entries[i].hash == hash; i++) {
+        s32_t res = spiffs_index_locate(fs, &index->entries[i], hdr);
+        if (res == SPIFFS_ERR_NOT_FOUND) {
+            /* Only if the filesystem was changed without the index */
+            ESP_LOGW(TAG, "object %04x not found, dropping the name index", index->entries[i].obj_id);
+            spiffs_index_reset(index);
+            return SPIFFS_ERR_INTERNAL;
+        }
+        if (res != SPIFFS_OK) {
+            return res;
+        }
+        if (strncmp((const char *) hdr->name, path, SPIFFS_OBJ_NAME_LEN) == 0) {
+            *entry = &index->entries[i];
+            return SPIFFS_OK;
+        }
+    }
+    *entry = NULL;
+    return SPIFFS_ERR_NOT_FOUND;
+}
+
+static bool spiffs_index_usable(spiffs *fs, const char *path)
+{
+    /* Otherwise the SPIFFS API reports the error */
+    return SPIFFS_CHECK_CFG(fs) && SPIFFS_CHECK_MOUNT(fs) && strlen(path) <= SPIFFS_OBJ_NAME_LEN - 1;
+}
+
+spiffs_file spiffs_index_open(spiffs *fs, spiffs_index_t *index, const char *path,
+                              spiffs_flags flags, spiffs_mode mode)
+{
+    spiffs_index_entry_t *entry;
+    spiffs_page_object_ix_header hdr;
+    spiffs_page_ix pix;
+    spiffs_fd *fd;
+
+    if (!spiffs_index_usable(fs, path)) {
+        return SPIFFS_open(fs, path, flags, mode);
+    }
+
+    SPIFFS_LOCK(fs);
+    s32_t res = spiffs_index_find(fs, index, path, &entry, &hdr);
+    if (res != SPIFFS_OK && res != SPIFFS_ERR_NOT_FOUND) {
+        SPIFFS_UNLOCK(fs);
+        return SPIFFS_open(fs, path, flags, mode);
+    }
+    if (res == SPIFFS_OK && (flags & (SPIFFS_O_CREAT | SPIFFS_O_EXCL)) == (SPIFFS_O_CREAT | SPIFFS_O_EXCL)) {
+        res = SPIFFS_ERR_FILE_EXISTS;
+    } else if (res == SPIFFS_ERR_NOT_FOUND && (flags & SPIFFS_O_CREAT)) {
+        res = SPIFFS_OK;
+    }
+    if (res == SPIFFS_OK) {
+        res = spiffs_fd_find_new(fs, &fd, path);
+    }
+    if (res != SPIFFS_OK) {
+        goto fail;
+    }
+
+    /* As SPIFFS_open does once it has looked for the name */
+    if (entry) {
+        pix = entry->pix;
+    } else {
+        spiffs_obj_id obj_id;
+        res = spiffs_obj_lu_find_free_obj_id(fs, &obj_id, 0);
+        if (res == SPIFFS_OK) {
+            res = spiffs_object_create(fs, obj_id, (const u8_t *) path, 0, SPIFFS_TYPE_FILE, &pix);
+        }
+        if (res == SPIFFS_OK) {
+            spiffs_index_insert(index, path, obj_id, pix);
+            flags &= ~SPIFFS_O_TRUNC;
+        }
+    }
+    if (res == SPIFFS_OK) {
+        res = spiffs_object_open_by_page(fs, pix, fd, flags, mode);
+    }
+    if (res == SPIFFS_OK && (flags & SPIFFS_O_TRUNC)) {
+        res = spiffs_object_truncate(fd, 0, 0);
+    }
+    if (res != SPIFFS_OK) {
+        spiffs_fd_return(fs, fd->file_nbr);
+        goto fail;
+    }
+    fd->fdoffset = 0;
+    SPIFFS_UNLOCK(fs);
+    return SPIFFS_FH_OFFS(fs, fd->file_nbr);
+
+fail:
+    fs->err_code = res;
+    SPIFFS_UNLOCK(fs);
+    return res;
+}
+
+s32_t spiffs_index_stat(spiffs *fs, spiffs_index_t *index, const char *path, spiffs_stat *s)
+{
+    spiffs_index_entry_t *entry;
+    spiffs_page_object_ix_header hdr;
+
+    if (!spiffs_index_usable(fs, path)) {
+        return SPIFFS_stat(fs, path, s);
+    }
+
+    SPIFFS_LOCK(fs);
+    s32_t res = spiffs_index_find(fs, index, path, &entry, &hdr);
+    if (res != SPIFFS_OK && res != SPIFFS_ERR_NOT_FOUND) {
+        SPIFFS_UNLOCK(fs);
+        return SPIFFS_stat(fs, path, s);
+    }
+    if (res == SPIFFS_OK) {
+        s->obj_id = entry->obj_id;
+        s->type = hdr.type;
+        s->size = hdr.size == SPIFFS_UNDEFINED_LEN ? 0 : hdr.size;
+        s->pix = entry->pix;
+        strncpy((char *) s->name, (char *) hdr.name, SPIFFS_OBJ_NAME_LEN);
+#if SPIFFS_OBJ_META_LEN
+        memcpy(s->meta, hdr.meta, SPIFFS_OBJ_META_LEN);
+#endif
+    } else {
+        fs->err_code = res;
+    }
+    SPIFFS_UNLOCK(fs);
+    return res;
+}
+
+s32_t spiffs_index_remove(spiffs *fs, spiffs_index_t *index, const char *path)
+{
+    spiffs_index_entry_t *entry;
+    spiffs_page_object_ix_header hdr;
+    spiffs_fd *fd;
+
+    if (!spiffs_index_usable(fs, path)) {
+        return SPIFFS_remove(fs, path);
+    }
+
+    SPIFFS_LOCK(fs);
+    s32_t res = spiffs_index_find(fs, index, path, &entry, &hdr);
+    if (res != SPIFFS_OK && res != SPIFFS_ERR_NOT_FOUND) {
+        SPIFFS_UNLOCK(fs);
+        return SPIFFS_remove(fs, path);
+    }
+
+    /* As SPIFFS_remove does once it has looked for the name */
+    if (res == SPIFFS_OK) {
+        res = spiffs_fd_find_new(fs, &fd, 0);
+        if (res == SPIFFS_OK) {
+            res = spiffs_object_open_by_page(fs, entry->pix, fd, 0, 0);
+            if (res == SPIFFS_OK) {
+                res = spiffs_object_truncate(fd, 0, 1);
+            }
+            if (res != SPIFFS_OK) {
+                spiffs_fd_return(fs, fd->file_nbr);
+            }
+        }
+    }
+    if (res == SPIFFS_OK) {
+        spiffs_index_erase(index, entry);
+    } else {
+        fs->err_code = res;
+    }
+    SPIFFS_UNLOCK(fs);
+    return res;
+}
+
+s32_t spiffs_index_rename(spiffs *fs, spiffs_index_t *index, const char *old_path, const char *new_path)
+{
+    spiffs_index_entry_t *entry, *existing;
+    spiffs_page_object_ix_header hdr;
+    spiffs_page_ix pix;
+    spiffs_fd *fd;
+
+    if (!spiffs_index_usable(fs, old_path) || !spiffs_index_usable(fs, new_path)) {
+        return SPIFFS_rename(fs, old_path, new_path);
+    }
+
+    SPIFFS_LOCK(fs);
+    s32_t res = spiffs_index_find(fs, index, old_path, &entry, &hdr);
+    if (res == SPIFFS_OK) {
+        res = spiffs_index_find(fs, index, new_path, &existing, &hdr);
+        if (res == SPIFFS_OK) {
+            res = SPIFFS_ERR_CONFLICTING_NAME;
+        } else if (res == SPIFFS_ERR_NOT_FOUND) {
+            res = SPIFFS_OK;
+        } else {
+            SPIFFS_UNLOCK(fs);
+            return SPIFFS_rename(fs, old_path, new_path);
+        }
+    } else if (res != SPIFFS_ERR_NOT_FOUND) {
+        SPIFFS_UNLOCK(fs);
+        return SPIFFS_rename(fs, old_path, new_path);
+    }
+
+    /* As SPIFFS_rename does once it has looked for the names */
+    if (res == SPIFFS_OK) {
+        res = spiffs_fd_find_new(fs, &fd, 0);
+        if (res == SPIFFS_OK) {
+            res = spiffs_object_open_by_page(fs, entry->pix, fd, 0, 0);
+            if (res == SPIFFS_OK) {
+                res = spiffs_object_update_index_hdr(fs, fd, fd->obj_id, fd->objix_hdr_pix, 0,
+                        (const u8_t *) new_path, 0, 0, &pix);
+            }
+#if SPIFFS_TEMPORAL_FD_CACHE
+            if (res == SPIFFS_OK) {
+                spiffs_fd_temporal_cache_rehash(fs, old_path, new_path);
+            }
+#endif
+            spiffs_fd_return(fs, fd->file_nbr);
+        }
+    }
+    if (res == SPIFFS_OK) {
+        spiffs_obj_id obj_id = entry->obj_id;
+        spiffs_index_erase(index, entry);
+        spiffs_index_insert(index, new_path, obj_id, pix);
+    } else {
+        fs->err_code = res;
+    }
+    SPIFFS_UNLOCK(fs);
+    return res;
+}
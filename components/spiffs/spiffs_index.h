@@ -0,0 +1,81 @@
+// Copyright 2015-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "spiffs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief File known to the name index
+ */
+typedef struct {
+    uint32_t hash;                          /*!< FNV-1a hash of the name */
+    spiffs_obj_id obj_id;                   /*!< Object id, without SPIFFS_OBJ_ID_IX_FLAG */
+    spiffs_page_ix pix;                     /*!< Page where the index header was last seen */
+} spiffs_index_entry_t;
+
+/**
+ * @brief Name to object index of a mounted filesystem
+ *
+ * Object ids don't change while a file exists, its index header page moves
+ * whenever the file is modified or garbage collected. The page is used as a
+ * hint which is checked on every lookup.
+ *
+ * The index is built on first use and kept up to date by the functions below,
+ * so all files must be created, renamed and removed through them.
+ */
+typedef struct {
+    spiffs_index_entry_t *entries;          /*!< Entries sorted by hash */
+    uint32_t count;                         /*!< Number of entries */
+    uint32_t size;                          /*!< Number of allocated entries */
+    bool valid;                             /*!< Index holds every file of the filesystem */
+} spiffs_index_t;
+
+/**
+ * @brief Drop all entries, the index is built again on next use
+ *
+ * Must be called when the filesystem is formatted or unmounted.
+ */
+void spiffs_index_reset(spiffs_index_t *index);
+
+/**
+ * @brief Same as SPIFFS_open, finding the file with the index
+ */
+spiffs_file spiffs_index_open(spiffs *fs, spiffs_index_t *index, const char *path,
+                              spiffs_flags flags, spiffs_mode mode);
+
+/**
+ * @brief Same as SPIFFS_stat, finding the file with the index
+ */
+s32_t spiffs_index_stat(spiffs *fs, spiffs_index_t *index, const char *path, spiffs_stat *s);
+
+/**
+ * @brief Same as SPIFFS_remove, finding the file with the index
+ */
+s32_t spiffs_index_remove(spiffs *fs, spiffs_index_t *index, const char *path);
+
+/**
+ * @brief Same as SPIFFS_rename, finding the files with the index
+ */
+s32_t spiffs_index_rename(spiffs *fs, spiffs_index_t *index, const char *old_path, const char *new_path);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,11 +1,15 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdint.h>
+#include <time.h>
+#include <algorithm>
+#include <vector>
 
 #include "esp_partition.h"
 #include "spiffs.h"
 #include "spiffs_nucleus.h"
 #include "spiffs_api.h"
+#include "spiffs_index.h"
 
 #include "catch.hpp"
 
@@ -105,3 +109,275 @@ TEST_CASE("format disk, open file, write and read file", "[spiffs]")
     free(read);
     free(data);
 }
+
+static size_t hal_reads;
+
+static s32_t spiffs_count_read(spiffs *fs, uint32_t addr, uint32_t size, uint8_t *dst)
+{
+    hal_reads++;
+    return spiffs_api_read(fs, addr, size, dst);
+}
+
+TEST_CASE("name index finds files with a few reads", "[spiffs][index]")
+{
+    init_spi_flash(CONFIG_ESPTOOLPY_FLASHSIZE, CONFIG_WL_SECTOR_SIZE * 16, CONFIG_WL_SECTOR_SIZE, CONFIG_WL_SECTOR_SIZE, "partition_table.bin");
+
+    spiffs fs;
+    spiffs_config cfg;
+
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_SPIFFS, "storage");
+
+    esp_spiffs_t esp_user_data;
+    esp_user_data.partition = partition;
+    fs.user_data = (void*)&esp_user_data;
+
+    cfg.hal_erase_f = spiffs_api_erase;
+    cfg.hal_read_f = spiffs_count_read;
+    cfg.hal_write_f = spiffs_api_write;
+    cfg.log_block_size = CONFIG_WL_SECTOR_SIZE;
+    cfg.log_page_size = CONFIG_SPIFFS_PAGE_SIZE;
+    cfg.phys_addr = 0;
+    cfg.phys_erase_block = CONFIG_WL_SECTOR_SIZE;
+    cfg.phys_size = partition->size;
+
+    uint32_t max_files = 5;
+
+    uint32_t fds_sz = max_files * sizeof(spiffs_fd);
+    uint32_t work_sz = cfg.log_page_size * 2;
+    uint32_t cache_sz = sizeof(spiffs_cache) + max_files * (sizeof(spiffs_cache_page)
+                          + cfg.log_page_size);
+
+    uint8_t *work = (uint8_t*) malloc(work_sz);
+    uint8_t *fds = (uint8_t*) malloc(fds_sz);
+    uint8_t *cache = (uint8_t*) malloc(cache_sz);
+
+    s32_t spiffs_res;
+
+    SPIFFS_mount(&fs, &cfg, work, fds, fds_sz, cache, cache_sz, spiffs_api_check);
+    spiffs_res = SPIFFS_format(&fs);
+    REQUIRE(spiffs_res >= SPIFFS_OK);
+    spiffs_res = SPIFFS_mount(&fs, &cfg, work, fds, fds_sz,
+                            cache, cache_sz, spiffs_api_check);
+    REQUIRE(spiffs_res >= SPIFFS_OK);
+
+    // Files created without the index are found when it is built
+    const int file_count = 2000;
+    char name[CONFIG_SPIFFS_OBJ_NAME_LEN];
+    for (int i = 0; i < file_count; i++) {
+        snprintf(name, sizeof(name), "/dir/file%d.txt", i);
+        spiffs_file file = SPIFFS_open(&fs, name, SPIFFS_O_CREAT | SPIFFS_O_EXCL | SPIFFS_O_WRONLY, 0);
+        REQUIRE(file >= SPIFFS_OK);
+        REQUIRE(SPIFFS_write(&fs, file, &i, sizeof(i)) == sizeof(i));
+        REQUIRE(SPIFFS_close(&fs, file) >= SPIFFS_OK);
+    }
+
+    spiffs_index_t index = {};
+    spiffs_stat s;
+    hal_reads = 0;
+    REQUIRE(spiffs_index_stat(&fs, &index, "/dir/file0.txt", &s) == SPIFFS_OK);
+    printf("Building the index of %d files: %d reads\n", file_count, (int) hal_reads);
+
+    // Files in random order, by name and with the index
+    const int lookups = 100;
+    size_t reads[2] = {};
+    clock_t ticks[2] = {};
+    for (int pass = 0; pass < 2; pass++) {
+        srand(0);
+        hal_reads = 0;
+        clock_t start = clock();
+        for (int n = 0; n < lookups; n++) {
+            int i = rand() % file_count;
+            snprintf(name, sizeof(name), "/dir/file%d.txt", i);
+            spiffs_res = pass ? spiffs_index_stat(&fs, &index, name, &s) : SPIFFS_stat(&fs, name, &s);
+            REQUIRE(spiffs_res == SPIFFS_OK);
+            REQUIRE(strcmp((const char*) s.name, name) == 0);
+            REQUIRE(s.size == sizeof(i));
+        }
+        ticks[pass] = clock() - start;
+        reads[pass] = hal_reads;
+    }
+    printf("stat of %d files: %d reads, %d us by name; %d reads, %d us with the index\n", lookups,
+           (int) reads[0], (int) (ticks[0] * 1000000 / CLOCKS_PER_SEC),
+           (int) reads[1], (int) (ticks[1] * 1000000 / CLOCKS_PER_SEC));
+    CHECK(reads[1] <= lookups * 2);
+    CHECK(reads[1] * 100 < reads[0]);
+
+    // Names which don't exist are known without reading
+    hal_reads = 0;
+    spiffs_res = spiffs_index_open(&fs, &index, "/dir/missing.txt", SPIFFS_O_RDONLY, 0);
+    REQUIRE(spiffs_res == SPIFFS_ERR_NOT_FOUND);
+    REQUIRE(SPIFFS_errno(&fs) == SPIFFS_ERR_NOT_FOUND);
+    SPIFFS_clearerr(&fs);
+    CHECK(hal_reads == 0);
+
+    spiffs_res = spiffs_index_open(&fs, &index, "/dir/file1.txt", SPIFFS_O_CREAT | SPIFFS_O_EXCL | SPIFFS_O_RDWR, 0);
+    REQUIRE(spiffs_res == SPIFFS_ERR_FILE_EXISTS);
+    SPIFFS_clearerr(&fs);
+
+    // Files keep being found as their index headers move
+    for (int i = 0; i < file_count; i += 100) {
+        snprintf(name, sizeof(name), "/dir/file%d.txt", i);
+        spiffs_file file = spiffs_index_open(&fs, &index, name, SPIFFS_O_TRUNC | SPIFFS_O_RDWR, 0);
+        REQUIRE(file >= SPIFFS_OK);
+        REQUIRE(SPIFFS_write(&fs, file, name, strlen(name)) == strlen(name));
+        REQUIRE(SPIFFS_close(&fs, file) >= SPIFFS_OK);
+    }
+    for (int i = 0; i < file_count; i += 100) {
+        snprintf(name, sizeof(name), "/dir/file%d.txt", i);
+        REQUIRE(spiffs_index_stat(&fs, &index, name, &s) == SPIFFS_OK);
+        REQUIRE(s.size == strlen(name));
+    }
+
+    // Renamed, removed and created files
+    REQUIRE(spiffs_index_rename(&fs, &index, "/dir/file0.txt", "/dir/file1.txt") == SPIFFS_ERR_CONFLICTING_NAME);
+    SPIFFS_clearerr(&fs);
+    REQUIRE(spiffs_index_rename(&fs, &index, "/dir/file0.txt", "/dir/renamed.txt") == SPIFFS_OK);
+    REQUIRE(spiffs_index_stat(&fs, &index, "/dir/file0.txt", &s) == SPIFFS_ERR_NOT_FOUND);
+    SPIFFS_clearerr(&fs);
+    REQUIRE(spiffs_index_stat(&fs, &index, "/dir/renamed.txt", &s) == SPIFFS_OK);
+    REQUIRE(SPIFFS_stat(&fs, "/dir/renamed.txt", &s) == SPIFFS_OK);
+
+    REQUIRE(spiffs_index_remove(&fs, &index, "/dir/renamed.txt") == SPIFFS_OK);
+    REQUIRE(spiffs_index_remove(&fs, &index, "/dir/renamed.txt") == SPIFFS_ERR_NOT_FOUND);
+    SPIFFS_clearerr(&fs);
+    REQUIRE(SPIFFS_stat(&fs, "/dir/renamed.txt", &s) == SPIFFS_ERR_NOT_FOUND);
+    SPIFFS_clearerr(&fs);
+
+    spiffs_file file = spiffs_index_open(&fs, &index, "/dir/new.txt", SPIFFS_O_CREAT | SPIFFS_O_RDWR, 0);
+    REQUIRE(file >= SPIFFS_OK);
+    REQUIRE(SPIFFS_close(&fs, file) >= SPIFFS_OK);
+    REQUIRE(SPIFFS_stat(&fs, "/dir/new.txt", &s) == SPIFFS_OK);
+    REQUIRE(spiffs_index_stat(&fs, &index, "/dir/new.txt", &s) == SPIFFS_OK);
+
+    // The index is the same as the one built from scratch
+    spiffs_index_t rebuilt = {};
+    REQUIRE(spiffs_index_stat(&fs, &rebuilt, "/dir/new.txt", &s) == SPIFFS_OK);
+    REQUIRE(rebuilt.count == index.count);
+    REQUIRE(index.count == file_count);
+
+    spiffs_index_reset(&rebuilt);
+    spiffs_index_reset(&index);
+    SPIFFS_unmount(&fs);
+
+    free(work);
+    free(fds);
+    free(cache);
+}
+
+// Flash time of the operations, with the typical timings of SPI NOR flash
+static uint32_t flash_us;
+
+static s32_t spiffs_timed_read(spiffs *fs, uint32_t addr, uint32_t size, uint8_t *dst)
+{
+    flash_us += 2 + size / 20;
+    return spiffs_api_read(fs, addr, size, dst);
+}
+
+static s32_t spiffs_timed_write(spiffs *fs, uint32_t addr, uint32_t size, uint8_t *src)
+{
+    flash_us += 2 + size * 3;
+    return spiffs_api_write(fs, addr, size, src);
+}
+
+static s32_t spiffs_timed_erase(spiffs *fs, uint32_t addr, uint32_t size)
+{
+    flash_us += size / CONFIG_WL_SECTOR_SIZE * 45000;
+    return spiffs_api_erase(fs, addr, size);
+}
+
+static uint32_t log_write_p99(bool background_gc)
+{
+    init_spi_flash(CONFIG_ESPTOOLPY_FLASHSIZE, CONFIG_WL_SECTOR_SIZE * 16, CONFIG_WL_SECTOR_SIZE, CONFIG_WL_SECTOR_SIZE, "partition_table.bin");
+
+    spiffs fs;
+    spiffs_config cfg;
+
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_SPIFFS, "storage");
+
+    esp_spiffs_t esp_user_data;
+    esp_user_data.partition = partition;
+    fs.user_data = (void*)&esp_user_data;
+
+    // A small partition, so that garbage has to be collected often
+    cfg.hal_erase_f = spiffs_timed_erase;
+    cfg.hal_read_f = spiffs_timed_read;
+    cfg.hal_write_f = spiffs_timed_write;
+    cfg.log_block_size = CONFIG_WL_SECTOR_SIZE;
+    cfg.log_page_size = CONFIG_SPIFFS_PAGE_SIZE;
+    cfg.phys_addr = 0;
+    cfg.phys_erase_block = CONFIG_WL_SECTOR_SIZE;
+    cfg.phys_size = 64 * CONFIG_WL_SECTOR_SIZE;
+
+    uint32_t max_files = 5;
+
+    uint32_t fds_sz = max_files * sizeof(spiffs_fd);
+    uint32_t work_sz = cfg.log_page_size * 2;
+    uint32_t cache_sz = sizeof(spiffs_cache) + max_files * (sizeof(spiffs_cache_page)
+                          + cfg.log_page_size);
+
+    uint8_t *work = (uint8_t*) malloc(work_sz);
+    uint8_t *fds = (uint8_t*) malloc(fds_sz);
+    uint8_t *cache = (uint8_t*) malloc(cache_sz);
+
+    SPIFFS_mount(&fs, &cfg, work, fds, fds_sz, cache, cache_sz, spiffs_api_check);
+    REQUIRE(SPIFFS_format(&fs) >= SPIFFS_OK);
+    REQUIRE(SPIFFS_mount(&fs, &cfg, work, fds, fds_sz, cache, cache_sz, spiffs_api_check) >= SPIFFS_OK);
+
+    // 40% of the space holds files which don't change
+    char data[1024];
+    char name[CONFIG_SPIFFS_OBJ_NAME_LEN];
+    memset(data, 0x5a, sizeof(data));
+    for (int i = 0; i < 12; i++) {
+        snprintf(name, sizeof(name), "static%d", i);
+        spiffs_file file = SPIFFS_open(&fs, name, SPIFFS_O_CREAT | SPIFFS_O_WRONLY, 0);
+        REQUIRE(file >= SPIFFS_OK);
+        for (int j = 0; j < 8; j++) {
+            REQUIRE(SPIFFS_write(&fs, file, data, sizeof(data)) == sizeof(data));
+        }
+        REQUIRE(SPIFFS_close(&fs, file) >= SPIFFS_OK);
+    }
+
+    // Lines appended to logs which are rotated
+    std::vector<uint32_t> latency;
+    for (int i = 0; i < 4000; i++) {
+        snprintf(name, sizeof(name), "log%d", i % 4);
+        flash_us = 0;
+        spiffs_file file = SPIFFS_open(&fs, name, SPIFFS_O_CREAT | SPIFFS_O_APPEND | SPIFFS_O_WRONLY, 0);
+        REQUIRE(file >= SPIFFS_OK);
+        REQUIRE(SPIFFS_write(&fs, file, data, 100) == 100);
+        REQUIRE(SPIFFS_close(&fs, file) >= SPIFFS_OK);
+        latency.push_back(flash_us);
+
+        if (i % 400 >= 396) {
+            REQUIRE(SPIFFS_remove(&fs, name) >= SPIFFS_OK);
+        }
+        // Idle time between the lines, as the background task sees it
+        if (background_gc) {
+            for (int quantum = 0; quantum < 4; quantum++) {
+                s32_t res = spiffs_api_gc(&fs, 8);
+                REQUIRE(res >= 0);
+                if (res == 0) {
+                    break;
+                }
+            }
+        }
+    }
+    SPIFFS_unmount(&fs);
+
+    free(work);
+    free(fds);
+    free(cache);
+
+    std::sort(latency.begin(), latency.end());
+    uint32_t p99 = latency[latency.size() * 99 / 100];
+    printf("Log writes %s background gc: median %d us, p99 %d us, max %d us\n", background_gc ? "with" : "without",
+           latency[latency.size() / 2], p99, latency.back());
+    return p99;
+}
+
+TEST_CASE("background gc keeps garbage collection out of writes", "[spiffs][gc]")
+{
+    uint32_t p99_inline = log_write_p99(false);
+    uint32_t p99_background = log_write_p99(true);
+    CHECK(p99_background * 10 < p99_inline);
+}
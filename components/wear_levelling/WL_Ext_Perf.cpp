@@ -13,6 +13,7 @@
 
 #include "WL_Ext_Perf.h"
 #include <stdlib.h>
+#include <string.h>
 #include "esp_log.h"
 
 static const char *TAG = "wl_ext_perf";
@@ -23,14 +24,31 @@ static const char *TAG = "wl_ext_perf";
         return (result); \
     }
 
+#ifndef FLASH_ERASE_VALUE
+#define FLASH_ERASE_VALUE 0xffffffff
+#endif // FLASH_ERASE_VALUE
+
+#ifndef WL_EXT_CACHE_EMPTY
+#define WL_EXT_CACHE_EMPTY 0xffffffff
+#endif // WL_EXT_CACHE_EMPTY
+
 WL_Ext_Perf::WL_Ext_Perf(): WL_Flash()
 {
     this->sector_buffer = NULL;
+    this->cache_count = 0;
+    this->cache_clock = 0;
+    this->cache = NULL;
 }
 
 WL_Ext_Perf::~WL_Ext_Perf()
 {
     free(this->sector_buffer);
+    if (this->cache != NULL) {
+        for (uint32_t i = 0; i < this->cache_count; i++) {
+            free(this->cache[i].data);
+        }
+        free(this->cache);
+    }
 }
 
 esp_err_t WL_Ext_Perf::config(WL_Config_s *cfg, Flash_Access *flash_drv)
@@ -50,6 +68,21 @@ esp_err_t WL_Ext_Perf::config(WL_Config_s *cfg, Flash_Access *flash_drv)
         return ESP_ERR_INVALID_ARG;
     }
 
+    if (config->cache_sectors > 0) {
+        this->cache = (cache_entry_t *)calloc(config->cache_sectors, sizeof(cache_entry_t));
+        if (this->cache == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+        this->cache_count = config->cache_sectors;
+        for (uint32_t i = 0; i < this->cache_count; i++) {
+            this->cache[i].sector = WL_EXT_CACHE_EMPTY;
+            this->cache[i].data = (uint32_t *)malloc(this->flash_sector_size);
+            if (this->cache[i].data == NULL) {
+                return ESP_ERR_NO_MEM;
+            }
+        }
+    }
+
     return WL_Flash::config(cfg, flash_drv);
 }
 
@@ -69,6 +102,9 @@ size_t WL_Ext_Perf::sector_size()
 
 esp_err_t WL_Ext_Perf::erase_sector(size_t sector)
 {
+    if (this->cache_count > 0) {
+        return this->cache_erase_range(sector * this->fat_sector_size, this->fat_sector_size);
+    }
     return this->erase_sector_fit(sector, 1);
 }
 
@@ -83,7 +119,7 @@ esp_err_t WL_Ext_Perf::erase_sector_fit(uint32_t start_sector, uint32_t count)
 
     for (int i = 0; i < this->size_factor; i++) {
         if ((i < pre_check_start) || (i >= count + pre_check_start)) {
-            result = this->read(start_sector / this->size_factor * this->flash_sector_size + i * this->fat_sector_size, &this->sector_buffer[i * this->fat_sector_size / sizeof(uint32_t)], this->fat_sector_size);
+            result = WL_Flash::read(start_sector / this->size_factor * this->flash_sector_size + i * this->fat_sector_size, &this->sector_buffer[i * this->fat_sector_size / sizeof(uint32_t)], this->fat_sector_size);
             WL_EXT_RESULT_CHECK(result);
         }
     }
@@ -93,7 +129,7 @@ esp_err_t WL_Ext_Perf::erase_sector_fit(uint32_t start_sector, uint32_t count)
     // And write back only data that should not be erased...
     for (int i = 0; i < this->size_factor; i++) {
         if ((i < pre_check_start) || (i >= count + pre_check_start)) {
-            result = this->write(start_sector / this->size_factor * this->flash_sector_size + i * this->fat_sector_size, &this->sector_buffer[i * this->fat_sector_size / sizeof(uint32_t)], this->fat_sector_size);
+            result = WL_Flash::write(start_sector / this->size_factor * this->flash_sector_size + i * this->fat_sector_size, &this->sector_buffer[i * this->fat_sector_size / sizeof(uint32_t)], this->fat_sector_size);
             WL_EXT_RESULT_CHECK(result);
         }
     }
@@ -111,6 +147,10 @@ esp_err_t WL_Ext_Perf::erase_range(size_t start_address, size_t size)
     }
     WL_EXT_RESULT_CHECK(result);
 
+    if (this->cache_count > 0) {
+        return this->cache_erase_range(start_address, size);
+    }
+
     // The range to erase could be allocated in any possible way
     // ---------------------------------------------------------
     // |       |       |       |       |
@@ -166,3 +206,202 @@ esp_err_t WL_Ext_Perf::erase_range(size_t start_address, size_t size)
     }
     return ESP_OK;
 }
+
+esp_err_t WL_Ext_Perf::write(size_t dest_addr, const void *src, size_t size)
+{
+    if (this->cache_count == 0) {
+        return WL_Flash::write(dest_addr, src, size);
+    }
+    esp_err_t result = ESP_OK;
+    if (dest_addr + size > this->chip_size()) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // Parts of the range in cached sectors are programmed to the cache,
+    // the runs between them go to the flash in one call
+    const uint8_t *src_bytes = (const uint8_t *)src;
+    size_t run_start = 0;
+    size_t offset = 0;
+    while (offset < size) {
+        size_t addr = dest_addr + offset;
+        size_t sector_offset = addr % this->flash_sector_size;
+        size_t len = this->flash_sector_size - sector_offset;
+        if (len > size - offset) {
+            len = size - offset;
+        }
+        cache_entry_t *entry = this->cache_find(addr / this->flash_sector_size);
+        if (entry != NULL) {
+            if (run_start < offset) {
+                result = WL_Flash::write(dest_addr + run_start, &src_bytes[run_start], offset - run_start);
+                WL_EXT_RESULT_CHECK(result);
+            }
+            // Same as programming the flash: bits can only be cleared
+            uint8_t *data = (uint8_t *)entry->data + sector_offset;
+            for (size_t i = 0; i < len; i++) {
+                data[i] &= src_bytes[offset + i];
+            }
+            entry->dirty = true;
+            entry->last_use = ++this->cache_clock;
+            run_start = offset + len;
+        }
+        offset += len;
+    }
+    if (run_start < size) {
+        result = WL_Flash::write(dest_addr + run_start, &src_bytes[run_start], size - run_start);
+        WL_EXT_RESULT_CHECK(result);
+    }
+    return ESP_OK;
+}
+
+esp_err_t WL_Ext_Perf::read(size_t src_addr, void *dest, size_t size)
+{
+    if (this->cache_count == 0) {
+        return WL_Flash::read(src_addr, dest, size);
+    }
+    esp_err_t result = ESP_OK;
+    if (src_addr + size > this->chip_size()) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    uint8_t *dest_bytes = (uint8_t *)dest;
+    size_t run_start = 0;
+    size_t offset = 0;
+    while (offset < size) {
+        size_t addr = src_addr + offset;
+        size_t sector_offset = addr % this->flash_sector_size;
+        size_t len = this->flash_sector_size - sector_offset;
+        if (len > size - offset) {
+            len = size - offset;
+        }
+        cache_entry_t *entry = this->cache_find(addr / this->flash_sector_size);
+        if (entry != NULL) {
+            if (run_start < offset) {
+                result = WL_Flash::read(src_addr + run_start, &dest_bytes[run_start], offset - run_start);
+                WL_EXT_RESULT_CHECK(result);
+            }
+            memcpy(&dest_bytes[offset], (uint8_t *)entry->data + sector_offset, len);
+            run_start = offset + len;
+        }
+        offset += len;
+    }
+    if (run_start < size) {
+        result = WL_Flash::read(src_addr + run_start, &dest_bytes[run_start], size - run_start);
+        WL_EXT_RESULT_CHECK(result);
+    }
+    return ESP_OK;
+}
+
+esp_err_t WL_Ext_Perf::sync()
+{
+    esp_err_t result = ESP_OK;
+    for (uint32_t i = 0; i < this->cache_count; i++) {
+        if (this->cache[i].dirty) {
+            result = this->cache_write_back(&this->cache[i]);
+            WL_EXT_RESULT_CHECK(result);
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t WL_Ext_Perf::flush()
+{
+    esp_err_t result = this->sync();
+    WL_EXT_RESULT_CHECK(result);
+    return WL_Flash::flush();
+}
+
+WL_Ext_Perf::cache_entry_t *WL_Ext_Perf::cache_find(uint32_t sector)
+{
+    for (uint32_t i = 0; i < this->cache_count; i++) {
+        if (this->cache[i].sector == sector) {
+            return &this->cache[i];
+        }
+    }
+    return NULL;
+}
+
+esp_err_t WL_Ext_Perf::cache_get(uint32_t sector, cache_entry_t **entry)
+{
+    esp_err_t result = ESP_OK;
+    cache_entry_t *found = this->cache_find(sector);
+    if (found == NULL) {
+        // Take an unused entry, or the least recently used one
+        found = &this->cache[0];
+        for (uint32_t i = 0; i < this->cache_count; i++) {
+            if (this->cache[i].sector == WL_EXT_CACHE_EMPTY) {
+                found = &this->cache[i];
+                break;
+            }
+            if (this->cache[i].last_use < found->last_use) {
+                found = &this->cache[i];
+            }
+        }
+        if (found->dirty) {
+            ESP_LOGV(TAG, "%s evict sector 0x%08x", __func__, found->sector);
+            result = this->cache_write_back(found);
+            WL_EXT_RESULT_CHECK(result);
+        }
+        found->sector = WL_EXT_CACHE_EMPTY;
+        result = WL_Flash::read(sector * this->flash_sector_size, found->data, this->flash_sector_size);
+        WL_EXT_RESULT_CHECK(result);
+        found->sector = sector;
+    }
+    found->last_use = ++this->cache_clock;
+    *entry = found;
+    return ESP_OK;
+}
+
+esp_err_t WL_Ext_Perf::cache_erase_range(size_t start_address, size_t size)
+{
+    esp_err_t result = ESP_OK;
+    if (start_address + size > this->chip_size()) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    ESP_LOGV(TAG, "%s begin, addr = 0x%08x, size = %i", __func__, start_address, size);
+
+    // Complete flash sectors are erased on the flash, and a cached copy is not needed anymore.
+    // Parts of flash sectors are erased in the cache and written back later, together with
+    // the data written to them meanwhile.
+    size_t offset = 0;
+    while (offset < size) {
+        size_t addr = start_address + offset;
+        uint32_t sector = addr / this->flash_sector_size;
+        size_t sector_offset = addr % this->flash_sector_size;
+        size_t len = this->flash_sector_size - sector_offset;
+        if (len > size - offset) {
+            len = size - offset;
+        }
+        if (len == this->flash_sector_size) {
+            cache_entry_t *entry = this->cache_find(sector);
+            if (entry != NULL) {
+                entry->sector = WL_EXT_CACHE_EMPTY;
+                entry->dirty = false;
+            }
+            result = WL_Flash::erase_sector(sector);
+            WL_EXT_RESULT_CHECK(result);
+        } else {
+            cache_entry_t *entry;
+            result = this->cache_get(sector, &entry);
+            WL_EXT_RESULT_CHECK(result);
+            memset((uint8_t *)entry->data + sector_offset, FLASH_ERASE_VALUE & 0xff, len);
+            entry->dirty = true;
+        }
+        offset += len;
+    }
+    return ESP_OK;
+}
+
+esp_err_t WL_Ext_Perf::cache_write_back(cache_entry_t *entry)
+{
+    esp_err_t result = this->write_sector(entry->sector, entry->data);
+    WL_EXT_RESULT_CHECK(result);
+    entry->dirty = false;
+    return ESP_OK;
+}
+
+esp_err_t WL_Ext_Perf::write_sector(uint32_t sector, const uint32_t *data)
+{
+    esp_err_t result = WL_Flash::erase_sector(sector);
+    WL_EXT_RESULT_CHECK(result);
+    return WL_Flash::write(sector * this->flash_sector_size, data, this->flash_sector_size);
+}
@@ -94,7 +94,7 @@ esp_err_t WL_Ext_Safe::recover()
     // check if we have transaction
     if (state.erase_begin == WL_EXT_SAFE_OK) {
 
-        result = this->read(this->dump_addr, this->sector_buffer, this->flash_sector_size);
+        result = WL_Flash::read(this->dump_addr, this->sector_buffer, this->flash_sector_size);
         WL_EXT_RESULT_CHECK(result);
 
         result = WL_Flash::erase_sector(state.local_addr_base); // erase comlete flash sector
@@ -103,7 +103,7 @@ esp_err_t WL_Ext_Safe::recover()
         // And write back...
         for (int i = 0; i < this->size_factor; i++) {
             if ((i < state.local_addr_shift) || (i >= state.count + state.local_addr_shift)) {
-                result = this->write(state.local_addr_base * this->flash_sector_size + i * this->fat_sector_size, &this->sector_buffer[i * this->fat_sector_size / sizeof(uint32_t)], this->fat_sector_size);
+                result = WL_Flash::write(state.local_addr_base * this->flash_sector_size + i * this->fat_sector_size, &this->sector_buffer[i * this->fat_sector_size / sizeof(uint32_t)], this->fat_sector_size);
                 WL_EXT_RESULT_CHECK(result);
             }
         }
@@ -122,7 +122,7 @@ esp_err_t WL_Ext_Safe::erase_sector_fit(uint32_t start_sector, uint32_t count)
     ESP_LOGV(TAG, "%s start_sector=0x%08x, count = %i", __func__, start_sector, count);
     for (int i = 0; i < this->size_factor; i++) {
         if ((i < pre_check_start) || (i >= count + pre_check_start)) {
-            result = this->read(start_sector / this->size_factor * this->flash_sector_size + i * this->fat_sector_size, &this->sector_buffer[i * this->fat_sector_size / sizeof(uint32_t)], this->fat_sector_size);
+            result = WL_Flash::read(start_sector / this->size_factor * this->flash_sector_size + i * this->fat_sector_size, &this->sector_buffer[i * this->fat_sector_size / sizeof(uint32_t)], this->fat_sector_size);
             WL_EXT_RESULT_CHECK(result);
         }
     }
@@ -149,7 +149,7 @@ esp_err_t WL_Ext_Safe::erase_sector_fit(uint32_t start_sector, uint32_t count)
     // And write back...
     for (int i = 0; i < this->size_factor; i++) {
         if ((i < pre_check_start) || (i >= count + pre_check_start)) {
-            result = this->write(local_addr_base * this->flash_sector_size + i * this->fat_sector_size, &this->sector_buffer[i * this->fat_sector_size / sizeof(uint32_t)], this->fat_sector_size);
+            result = WL_Flash::write(local_addr_base * this->flash_sector_size + i * this->fat_sector_size, &this->sector_buffer[i * this->fat_sector_size / sizeof(uint32_t)], this->fat_sector_size);
             WL_EXT_RESULT_CHECK(result);
         }
     }
@@ -159,3 +159,35 @@ esp_err_t WL_Ext_Safe::erase_sector_fit(uint32_t start_sector, uint32_t count)
 
     return ESP_OK;
 }
+
+esp_err_t WL_Ext_Safe::write_sector(uint32_t sector, const uint32_t *data)
+{
+    esp_err_t result = ESP_OK;
+    ESP_LOGV(TAG, "%s sector=0x%08x", __func__, sector);
+
+    // Same transaction as erase_sector_fit, with nothing erased: if the power is lost,
+    // recover() writes the complete sector back from the dump
+    result = WL_Flash::erase_sector(this->dump_addr / this->flash_sector_size);
+    WL_EXT_RESULT_CHECK(result);
+    result = WL_Flash::write(this->dump_addr, data, this->flash_sector_size);
+    WL_EXT_RESULT_CHECK(result);
+
+    WL_Ext_Safe_State state;
+    state.erase_begin = WL_EXT_SAFE_OK;
+    state.local_addr_base = sector;
+    state.local_addr_shift = 0;
+    state.count = 0;
+
+    result = WL_Flash::erase_sector(this->state_addr / this->flash_sector_size);
+    WL_EXT_RESULT_CHECK(result);
+    result = WL_Flash::write(this->state_addr + 0, &state, sizeof(WL_Ext_Safe_State));
+    WL_EXT_RESULT_CHECK(result);
+
+    result = WL_Ext_Perf::write_sector(sector, data);
+    WL_EXT_RESULT_CHECK(result);
+
+    result = WL_Flash::erase_sector(this->state_addr / this->flash_sector_size);
+    WL_EXT_RESULT_CHECK(result);
+
+    return ESP_OK;
+}
@@ -526,6 +526,30 @@ size_t WL_Flash::calcAddr(size_t addr)
     return result;
 }
 
+/*
+ * The mapping shifts addresses by move_count pages, wrapping at flash_size, and
+ * skips the dummy page. Between the wrap and the dummy page, consecutive
+ * addresses stay physically consecutive, so one driver call covers them.
+ */
+size_t WL_Flash::calcExtent(size_t addr, size_t size, size_t *real_addr)
+{
+    size_t result = (this->flash_size - this->state.move_count * this->cfg.page_size + addr) % this->flash_size;
+    size_t dummy_addr = this->state.pos * this->cfg.page_size;
+    size_t len = this->flash_size - result;
+    if (result < dummy_addr) {
+        if (dummy_addr - result < len) {
+            len = dummy_addr - result;
+        }
+        *real_addr = result;
+    } else {
+        *real_addr = result + this->cfg.page_size;
+    }
+    if (size < len) {
+        len = size;
+    }
+    ESP_LOGV(TAG, "%s - addr= 0x%08x -> result= 0x%08x, len= 0x%08x", __func__, (uint32_t) addr, (uint32_t) *real_addr, (uint32_t) len);
+    return len;
+}
 
 size_t WL_Flash::chip_size()
 {
@@ -581,15 +605,14 @@ esp_err_t WL_Flash::write(size_t dest_addr, const void *src, size_t size)
         return ESP_ERR_INVALID_STATE;
     }
     ESP_LOGD(TAG, "%s - dest_addr= 0x%08x, size= 0x%08x", __func__, (uint32_t) dest_addr, (uint32_t) size);
-    uint32_t count = (size - 1) / this->cfg.page_size;
-    for (size_t i = 0; i < count; i++) {
-        size_t virt_addr = this->calcAddr(dest_addr + i * this->cfg.page_size);
-        result = this->flash_drv->write(this->cfg.start_addr + virt_addr, &((uint8_t *)src)[i * this->cfg.page_size], this->cfg.page_size);
+    size_t offset = 0;
+    while (offset < size) {
+        size_t real_addr;
+        size_t len = this->calcExtent(dest_addr + offset, size - offset, &real_addr);
+        result = this->flash_drv->write(this->cfg.start_addr + real_addr, &((uint8_t *)src)[offset], len);
         WL_RESULT_CHECK(result);
+        offset += len;
     }
-    size_t virt_addr_last = this->calcAddr(dest_addr + count * this->cfg.page_size);
-    result = this->flash_drv->write(this->cfg.start_addr + virt_addr_last, &((uint8_t *)src)[count * this->cfg.page_size], size - count * this->cfg.page_size);
-    WL_RESULT_CHECK(result);
     return result;
 }
 
@@ -600,16 +623,15 @@ esp_err_t WL_Flash::read(size_t src_addr, void *dest, size_t size)
         return ESP_ERR_INVALID_STATE;
     }
     ESP_LOGD(TAG, "%s - src_addr= 0x%08x, size= 0x%08x", __func__, (uint32_t) src_addr, (uint32_t) size);
-    uint32_t count = (size - 1) / this->cfg.page_size;
-    for (size_t i = 0; i < count; i++) {
-        size_t virt_addr = this->calcAddr(src_addr + i * this->cfg.page_size);
-        ESP_LOGV(TAG, "%s - real_addr= 0x%08x, size= 0x%08x", __func__, (uint32_t) (this->cfg.start_addr + virt_addr), (uint32_t) size);
-        result = this->flash_drv->read(this->cfg.start_addr + virt_addr, &((uint8_t *)dest)[i * this->cfg.page_size], this->cfg.page_size);
+    size_t offset = 0;
+    while (offset < size) {
+        size_t real_addr;
+        size_t len = this->calcExtent(src_addr + offset, size - offset, &real_addr);
+        ESP_LOGV(TAG, "%s - real_addr= 0x%08x, size= 0x%08x", __func__, (uint32_t) (this->cfg.start_addr + real_addr), (uint32_t) len);
+        result = this->flash_drv->read(this->cfg.start_addr + real_addr, &((uint8_t *)dest)[offset], len);
         WL_RESULT_CHECK(result);
+        offset += len;
     }
-    size_t virt_addr_last = this->calcAddr(src_addr + count * this->cfg.page_size);
-    result = this->flash_drv->read(this->cfg.start_addr + virt_addr_last, &((uint8_t *)dest)[count * this->cfg.page_size], size - count * this->cfg.page_size);
-    WL_RESULT_CHECK(result);
     return result;
 }
 
@@ -630,3 +652,9 @@ esp_err_t WL_Flash::flush()
     ESP_LOGD(TAG, "%s - result= 0x%08x, move_count= 0x%08x", __func__, result, this->state.move_count);
     return result;
 }
+
+esp_err_t WL_Flash::sync()
+{
+    // Nothing is held in RAM, data is on flash as soon as write() returns
+    return ESP_OK;
+}
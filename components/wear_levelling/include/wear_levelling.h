@@ -112,6 +112,22 @@ esp_err_t wl_write(wl_handle_t handle, size_t dest_addr, const void *src, size_t
 */
 esp_err_t wl_read(wl_handle_t handle, size_t src_addr, void *dest, size_t size);
 
+/**
+* @brief Write data cached in RAM back to the WL storage
+*
+* With CONFIG_WL_SECTOR_CACHE_NUM set, erases and writes of parts of a flash sector
+* are collected in RAM, and the flash sector is updated when it is evicted from the
+* cache, on wl_flush and on wl_unmount. Data which is not flushed is lost on power off.
+* Without the cache this function does nothing.
+*
+* @param handle WL module handle that was initialized before
+*
+* @return
+*       - ESP_OK, if the cached data was written successfully;
+*       - or one of error codes from lower-level flash driver.
+*/
+esp_err_t wl_flush(wl_handle_t handle);
+
 /**
 * @brief Get size of the WL storage
 *
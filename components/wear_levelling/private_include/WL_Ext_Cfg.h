@@ -17,6 +17,7 @@
 
 typedef struct WL_Ext_Cfg_s : public WL_Config_s {
     uint32_t fat_sector_size;   /*!< virtual sector size*/
+    uint32_t cache_sectors;     /*!< number of flash sectors cached in RAM, 0 to write through*/
 } wl_ext_cfg_t;
 
 #endif // _WL_Ext_Cfg_H_
\ No newline at end of file
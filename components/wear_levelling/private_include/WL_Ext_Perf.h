@@ -33,6 +33,12 @@ public:
     esp_err_t erase_sector(size_t sector) override;
     esp_err_t erase_range(size_t start_address, size_t size) override;
 
+    esp_err_t write(size_t dest_addr, const void *src, size_t size) override;
+    esp_err_t read(size_t src_addr, void *dest, size_t size) override;
+
+    esp_err_t sync() override;
+    esp_err_t flush() override;
+
 protected:
     uint32_t flash_sector_size;
     uint32_t fat_sector_size;
@@ -41,6 +47,30 @@ protected:
 
     virtual esp_err_t erase_sector_fit(uint32_t start_sector, uint32_t count);
 
+    /**
+    * @brief Flash sector held in RAM. Partial erases and the writes that follow them
+    *        are applied here, and the flash sector is erased and programmed once,
+    *        when the entry is evicted or the cache is synced.
+    */
+    typedef struct {
+        uint32_t sector;    /*!< flash sector, WL_EXT_CACHE_EMPTY if the entry is unused*/
+        uint32_t last_use;  /*!< LRU stamp*/
+        bool dirty;         /*!< content differs from flash*/
+        uint32_t *data;     /*!< content of the flash sector*/
+    } cache_entry_t;
+
+    uint32_t cache_count;
+    uint32_t cache_clock;
+    cache_entry_t *cache;
+
+    cache_entry_t *cache_find(uint32_t sector);
+    esp_err_t cache_get(uint32_t sector, cache_entry_t **entry);
+    esp_err_t cache_erase_range(size_t start_address, size_t size);
+    esp_err_t cache_write_back(cache_entry_t *entry);
+
+    // Replaces complete flash sector with the data
+    virtual esp_err_t write_sector(uint32_t sector, const uint32_t *data);
+
 };
 
 #endif // _WL_Ext_Perf_H_
\ No newline at end of file
@@ -43,6 +43,7 @@ public :
     esp_err_t read(size_t src_addr, void *dest, size_t size) override;
 
     esp_err_t flush() override;
+    virtual esp_err_t sync();
 
     Flash_Access *get_drv();
     wl_config_t *get_cfg();
@@ -71,6 +72,7 @@ protected:
     esp_err_t updateWL();
     esp_err_t recoverPos();
     size_t calcAddr(size_t addr);
+    size_t calcExtent(size_t addr, size_t size, size_t *real_addr);
 
     esp_err_t updateVersion();
     esp_err_t updateV1_V2();
@@ -1,11 +1,15 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <chrono>
 
 #include "esp_spi_flash.h"
 #include "esp_partition.h"
 #include "wear_levelling.h"
 #include "WL_Flash.h"
+#include "WL_Ext_Perf.h"
+#include "WL_Ext_Safe.h"
+#include "Partition.h"
 #include "SpiFlash.h"
 
 #include "catch.hpp"
@@ -207,4 +211,177 @@ TEST_CASE("power down test", "[wear_levelling]")
     // Unmount
     result = wl_unmount(wl_handle);
     REQUIRE(result == ESP_OK);
-}
\ No newline at end of file
+}
+
+// Counts the driver calls made by the wear levelling layer
+class Counting_Partition : public Partition
+{
+public:
+    Counting_Partition(const esp_partition_t *partition) : Partition(partition) {}
+
+    esp_err_t write(size_t dest_addr, const void *src, size_t size) override
+    {
+        writes++;
+        return Partition::write(dest_addr, src, size);
+    }
+
+    esp_err_t read(size_t src_addr, void *dest, size_t size) override
+    {
+        reads++;
+        return Partition::read(src_addr, dest, size);
+    }
+
+    esp_err_t erase_sector(size_t sector) override
+    {
+        erases++;
+        return Partition::erase_sector(sector);
+    }
+
+    size_t reads = 0;
+    size_t writes = 0;
+    size_t erases = 0;
+};
+
+TEST_CASE("read and write throughput", "[wear_levelling][benchmark]")
+{
+    _spi_flash_init(CONFIG_ESPTOOLPY_FLASHSIZE, CONFIG_WL_SECTOR_SIZE * 16, CONFIG_WL_SECTOR_SIZE, CONFIG_WL_SECTOR_SIZE, "partition_table.bin");
+
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "storage");
+    REQUIRE(partition != NULL);
+
+    // Same configuration as wl_mount uses
+    wl_config_t cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.full_mem_size = partition->size;
+    cfg.start_addr = 0;
+    cfg.version = 2;
+    cfg.sector_size = SPI_FLASH_SEC_SIZE;
+    cfg.page_size = SPI_FLASH_SEC_SIZE;
+    cfg.updaterate = 16;
+    cfg.temp_buff_size = 32;
+    cfg.wr_size = 16;
+
+    Counting_Partition part(partition);
+    WL_Flash wl_flash;
+    REQUIRE(wl_flash.config(&cfg, &part) == ESP_OK);
+    REQUIRE(wl_flash.init() == ESP_OK);
+
+    size_t size = wl_flash.chip_size();
+    size_t sectors = size / SPI_FLASH_SEC_SIZE;
+    uint8_t *data = (uint8_t *) malloc(size);
+    uint8_t *read = (uint8_t *) malloc(size);
+    for (size_t i = 0; i < size; i++) {
+        data[i] = i * 31 + 7;
+    }
+
+    // Move the data, so that the dummy sector is in the middle of the partition
+    for (size_t i = 0; i < sectors * cfg.updaterate / 2; i++) {
+        REQUIRE(wl_flash.erase_sector(i % sectors) == ESP_OK);
+    }
+    REQUIRE(wl_flash.erase_range(0, size) == ESP_OK);
+
+    part.writes = 0;
+    auto start = std::chrono::steady_clock::now();
+    REQUIRE(wl_flash.write(0, data, size) == ESP_OK);
+    auto write_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    part.reads = 0;
+    start = std::chrono::steady_clock::now();
+    REQUIRE(wl_flash.read(0, read, size) == ESP_OK);
+    auto read_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    REQUIRE(memcmp(data, read, size) == 0);
+
+    printf("%d sectors: write %d driver calls, %.1f MB/s; read %d driver calls, %.1f MB/s\n",
+           (int) sectors, (int) part.writes, size / write_time / 1e6, (int) part.reads, size / read_time / 1e6);
+
+    // Contiguous extents: at most one split at the wrap and one at the dummy sector
+    REQUIRE(part.writes <= 3);
+    REQUIRE(part.reads <= 3);
+
+    free(data);
+    free(read);
+}
+
+// Updates 512 byte sectors the way FAT does: erase and write one sector at a time,
+// with the hot spots (FAT table, directory) rewritten over and over
+template <typename WL_Ext>
+static void test_sector_cache(uint32_t cache_sectors, size_t *erases, double *time)
+{
+    _spi_flash_init(CONFIG_ESPTOOLPY_FLASHSIZE, CONFIG_WL_SECTOR_SIZE * 16, CONFIG_WL_SECTOR_SIZE, CONFIG_WL_SECTOR_SIZE, "partition_table.bin");
+
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "storage");
+    REQUIRE(partition != NULL);
+
+    wl_ext_cfg_t cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.full_mem_size = partition->size;
+    cfg.start_addr = 0;
+    cfg.version = 2;
+    cfg.sector_size = SPI_FLASH_SEC_SIZE;
+    cfg.page_size = SPI_FLASH_SEC_SIZE;
+    cfg.updaterate = 16;
+    cfg.temp_buff_size = 32;
+    cfg.wr_size = 16;
+    cfg.fat_sector_size = 512;
+    cfg.cache_sectors = cache_sectors;
+
+    const size_t fat_sectors = 3 * SPI_FLASH_SEC_SIZE / cfg.fat_sector_size;
+    uint8_t *expected = (uint8_t *) malloc(fat_sectors * cfg.fat_sector_size);
+    uint8_t buf[512];
+
+    Counting_Partition part(partition);
+    {
+        WL_Ext wl_flash;
+        REQUIRE(wl_flash.config(&cfg, &part) == ESP_OK);
+        REQUIRE(wl_flash.init() == ESP_OK);
+        REQUIRE(wl_flash.erase_range(0, fat_sectors * cfg.fat_sector_size) == ESP_OK);
+        memset(expected, 0xff, fat_sectors * cfg.fat_sector_size);
+
+        part.erases = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < 200; i++) {
+            size_t sector = (i * 7) % fat_sectors;
+            memset(buf, i, sizeof(buf));
+            memcpy(&expected[sector * cfg.fat_sector_size], buf, sizeof(buf));
+            REQUIRE(wl_flash.erase_range(sector * cfg.fat_sector_size, cfg.fat_sector_size) == ESP_OK);
+            REQUIRE(wl_flash.write(sector * cfg.fat_sector_size, buf, sizeof(buf)) == ESP_OK);
+
+            // Reads see the data before it is flushed
+            REQUIRE(wl_flash.read(sector * cfg.fat_sector_size, buf, sizeof(buf)) == ESP_OK);
+            REQUIRE(memcmp(buf, &expected[sector * cfg.fat_sector_size], sizeof(buf)) == 0);
+        }
+        REQUIRE(wl_flash.sync() == ESP_OK);
+        *time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        *erases = part.erases;
+    }
+
+    // Everything is on flash after the sync
+    WL_Ext wl_check;
+    cfg.cache_sectors = 0;
+    REQUIRE(wl_check.config(&cfg, &part) == ESP_OK);
+    REQUIRE(wl_check.init() == ESP_OK);
+    for (size_t sector = 0; sector < fat_sectors; sector++) {
+        REQUIRE(wl_check.read(sector * cfg.fat_sector_size, buf, sizeof(buf)) == ESP_OK);
+        REQUIRE(memcmp(buf, &expected[sector * cfg.fat_sector_size], sizeof(buf)) == 0);
+    }
+    free(expected);
+}
+
+TEST_CASE("sector cache coalesces 512 byte sector updates", "[wear_levelling][benchmark]")
+{
+    size_t erases_uncached, erases_cached;
+    double time_uncached, time_cached;
+
+    test_sector_cache<WL_Ext_Perf>(0, &erases_uncached, &time_uncached);
+    test_sector_cache<WL_Ext_Perf>(4, &erases_cached, &time_cached);
+    printf("performance mode: %d erases, %.3f s without cache; %d erases, %.3f s with 4 sectors cached\n",
+           (int) erases_uncached, time_uncached, (int) erases_cached, time_cached);
+    CHECK(erases_cached * 10 < erases_uncached);
+
+    test_sector_cache<WL_Ext_Safe>(0, &erases_uncached, &time_uncached);
+    test_sector_cache<WL_Ext_Safe>(4, &erases_cached, &time_cached);
+    printf("safety mode: %d erases, %.3f s without cache; %d erases, %.3f s with 4 sectors cached\n",
+           (int) erases_uncached, time_uncached, (int) erases_cached, time_cached);
+    CHECK(erases_cached * 10 < erases_uncached);
+}
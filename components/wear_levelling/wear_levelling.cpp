@@ -88,6 +88,11 @@ esp_err_t wl_mount(const esp_partition_t *partition, wl_handle_t *out_handle)
     cfg.wr_size = WL_DEFAULT_WRITE_SIZE;
     // FAT sector size by default will be 512
     cfg.fat_sector_size = CONFIG_WL_SECTOR_SIZE;
+#ifdef CONFIG_WL_SECTOR_CACHE_NUM
+    cfg.cache_sectors = CONFIG_WL_SECTOR_CACHE_NUM;
+#else
+    cfg.cache_sectors = 0;
+#endif
 
     if (*out_handle == WL_INVALID_HANDLE) {
         ESP_LOGE(TAG, "MAX_WL_HANDLES=%d instances already allocated", MAX_WL_HANDLES);
@@ -225,6 +230,18 @@ esp_err_t wl_read(wl_handle_t handle, size_t src_addr, void *dest, size_t size)
     return result;
 }
 
+esp_err_t wl_flush(wl_handle_t handle)
+{
+    esp_err_t result = check_handle(handle, __func__);
+    if (result != ESP_OK) {
+        return result;
+    }
+    _lock_acquire(&s_instances[handle].lock);
+    result = s_instances[handle].instance->sync();
+    _lock_release(&s_instances[handle].lock);
+    return result;
+}
+
 size_t wl_size(wl_handle_t handle)
 {
     esp_err_t err = check_handle(handle, __func__);
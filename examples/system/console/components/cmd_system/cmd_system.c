@@ -32,6 +32,7 @@ static const char *TAG = "cmd_system";
 
 static void register_free();
 static void register_heap();
+static void register_heap_info();
 static void register_version();
 static void register_restart();
 static void register_make();
@@ -43,6 +44,7 @@ void register_system()
 {
     register_free();
     register_heap();
+    register_heap_info();
     register_version();
     register_restart();
     register_make();
@@ -139,6 +141,25 @@ static void register_heap()
 
 }
 
+/* 'heap_info' command prints fragmentation and latency report of heap regions */
+static int heap_info(int argc, char **argv)
+{
+    heap_caps_print_heap_info(MALLOC_CAP_32BIT);
+    return 0;
+}
+
+static void register_heap_info()
+{
+    const esp_console_cmd_t cmd = {
+        .command = "heap_info",
+        .help = "Get free block count, largest free block, free block size histogram "
+                "and allocation latency of every heap region",
+        .hint = NULL,
+        .func = &heap_info,
+    };
+    ESP_ERROR_CHECK( esp_console_cmd_register(&cmd) );
+}
+
 /** 'tasks' command prints the list of tasks and related information */
 #if WITH_TASKS_INFO
 
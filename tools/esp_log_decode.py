@@ -0,0 +1,321 @@
+#!/usr/bin/env python
+#
+# Decoder of compact log output (CONFIG_LOG_COMPACT). Converts binary log frames back to
+# text by reading tag and format strings from the application ELF file. Text which is not
+# in a frame, for example bootloader and early log output, is passed through unchanged.
+#
+# Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+from __future__ import print_function, division
+import argparse
+import re
+import struct
+import sys
+
+# Keep in sync with components/log/private_include/esp_log_compact.h
+FRAME_SYNC = 0xA5
+FRAME_TRUNCATED = 0x80
+FRAME_HEAD_SIZE = 4
+FRAME_FIXED_SIZE = 12       # timestamp, tag and format
+FRAME_MAX_SIZE = 4096
+
+LOG_LEVELS = "NEWIDV"
+LOG_COLORS = {"E": "\033[0;31m", "W": "\033[0;33m", "I": "\033[0;32m"}
+LOG_RESET_COLOR = "\033[0m"
+
+SHF_ALLOC = 0x2
+SHT_NOBITS = 8
+
+# same parsing rules as frame_put_arg() in components/log/log_compact.c
+RE_CONVERSION = re.compile(r"%(?P<flags>[-+ #0]*)(?P<width>\*|\d+)?(?:\.(?P<prec>\*|\d*))?(?P<length>[hlLjzt]*)(?P<conv>.?)", re.S)
+
+
+class ElfFile(object):
+    """ Minimal ELF reader which returns the content of loadable sections by address """
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            data = f.read()
+
+        if data[:4] != b"\x7fELF":
+            raise ValueError("%s is not an ELF file" % path)
+
+        elf_class = bytearray(data[4:5])[0]
+        endian = "<" if bytearray(data[5:6])[0] == 1 else ">"
+        if elf_class == 1:
+            shoff, = struct.unpack_from(endian + "I", data, 0x20)
+            shentsize, shnum = struct.unpack_from(endian + "HH", data, 0x2E)
+            shfmt = endian + "IIIIII"
+        else:
+            shoff, = struct.unpack_from(endian + "Q", data, 0x28)
+            shentsize, shnum = struct.unpack_from(endian + "HH", data, 0x3A)
+            shfmt = endian + "IIQQQQ"
+
+        self.sections = []
+        for i in range(shnum):
+            _, sh_type, flags, addr, offset, size = struct.unpack_from(shfmt, data, shoff + i * shentsize)
+            if flags & SHF_ALLOC and sh_type != SHT_NOBITS and size:
+                self.sections.append((addr, data[offset:offset + size]))
+
+    def read_string(self, addr):
+        """ Return the zero-terminated string at "addr" or None if it is not in the file """
+        for start, content in self.sections:
+            if start <= addr < start + len(content):
+                off = addr - start
+                end = content.find(b"\0", off)
+                if end < 0:
+                    end = len(content)
+                return content[off:end].decode("utf-8", "replace")
+        return None
+
+
+class FrameReader(object):
+    """ Reads little endian arguments from frame payload """
+
+    def __init__(self, payload):
+        self.payload = payload
+        self.off = 0
+
+    def u32(self):
+        if self.off + 4 > len(self.payload):
+            raise IndexError()
+        val, = struct.unpack_from("<I", self.payload, self.off)
+        self.off += 4
+        return val
+
+    def u64(self):
+        if self.off + 8 > len(self.payload):
+            raise IndexError()
+        val, = struct.unpack_from("<Q", self.payload, self.off)
+        self.off += 8
+        return val
+
+    def string(self):
+        end = self.payload.find(b"\0", self.off)
+        if end < 0:
+            raise IndexError()
+        val = self.payload[self.off:end].decode("utf-8", "replace")
+        self.off = end + 1
+        return val
+
+
+def _signed(val, bits):
+    val &= (1 << bits) - 1
+    return val - (1 << bits) if val >> (bits - 1) else val
+
+
+def _format_one(match, args):
+    """ Format one conversion specification, return the text or None if it is not supported """
+    flags = match.group("flags")
+    width = match.group("width")
+    prec = match.group("prec")
+    length = match.group("length")
+    conv = match.group("conv")
+
+    if width == "*":
+        width = _signed(args.u32(), 32)
+        if width < 0:
+            flags += "-"
+            width = -width
+        width = str(width)
+    if prec == "*":
+        prec = _signed(args.u32(), 32)
+        prec = str(prec) if prec >= 0 else None
+
+    longs = 0
+    for c in length:
+        if c == "l":
+            longs += 1
+        elif c == "j":
+            longs += 2
+        elif c in "zt":
+            longs = 0
+    bits = 64 if longs >= 2 else 32
+    if length == "hh":
+        bits = 8
+    elif length == "h":
+        bits = 16
+
+    spec = "%" + flags + (width or "") + ("." + prec if prec is not None else "")
+
+    if not conv:
+        return None
+    if conv in "di":
+        val = args.u64() if longs >= 2 else args.u32()
+        return (spec + "d") % _signed(val, bits)
+    if conv in "uoxX":
+        val = args.u64() if longs >= 2 else args.u32()
+        return (spec + ("d" if conv == "u" else conv)) % (val & ((1 << bits) - 1))
+    if conv == "c":
+        return (spec + "c") % chr(args.u32() & 0xFF)
+    if conv == "p":
+        return (spec.replace("#", "") + "s") % ("0x%x" % args.u32())
+    if conv == "s":
+        return (spec + "s") % args.string()
+    if conv in "fFeEgGaA":
+        if "L" in length:
+            return None
+        val, = struct.unpack("<d", struct.pack("<Q", args.u64()))
+        if conv in "aA":
+            return float.hex(val) if conv == "a" else float.hex(val).upper()
+        return (spec + conv) % val
+    return None
+
+
+def format_message(fmt, args, truncated=False):
+    """ Format "fmt" like printf with arguments read from FrameReader "args" """
+    out = []
+    pos = 0
+    while True:
+        start = fmt.find("%", pos)
+        if start < 0:
+            out.append(fmt[pos:])
+            break
+        out.append(fmt[pos:start])
+        if fmt[start + 1:start + 2] == "%":
+            out.append("%")
+            pos = start + 2
+            continue
+
+        match = RE_CONVERSION.match(fmt, start)
+        try:
+            text = _format_one(match, args)
+        except IndexError:
+            out.append("..." if truncated else "<missing argument>")
+            break
+        if text is None:
+            out.append(fmt[start:])
+            break
+        out.append(text)
+        pos = match.end()
+
+    return "".join(out)
+
+
+class CompactLogDecoder(object):
+    """
+    Incremental decoder, feed it with raw bytes from the serial port and it returns
+    text with all complete frames decoded.
+    """
+
+    def __init__(self, elf, colors=True):
+        self.elf = elf
+        self.colors = colors
+        self.buf = bytearray()
+
+    def _frame_size(self, buf):
+        """ Return frame size, 0 if more data is needed or -1 if "buf" does not start a frame """
+        if len(buf) < FRAME_HEAD_SIZE:
+            return 0
+        level = buf[1] & ~FRAME_TRUNCATED
+        length = buf[2] | buf[3] << 8
+        if level == 0 or level >= len(LOG_LEVELS) or length < FRAME_FIXED_SIZE or length > FRAME_MAX_SIZE:
+            return -1
+        size = FRAME_HEAD_SIZE + length + 1
+        if len(buf) < size:
+            return 0
+        if sum(buf[1:size - 1]) & 0xFF != buf[size - 1]:
+            return -1
+        return size
+
+    def _string(self, addr):
+        s = self.elf.read_string(addr)
+        return s if s is not None else "0x%08x" % addr
+
+    def decode_frame(self, frame):
+        """ Decode one complete frame to a text line """
+        info = frame[1]
+        level = LOG_LEVELS[info & ~FRAME_TRUNCATED]
+        payload = bytes(frame[FRAME_HEAD_SIZE:-1])
+        args = FrameReader(payload)
+        timestamp = args.u32()
+        tag = self._string(args.u32())
+        fmt_addr = args.u32()
+        fmt = self.elf.read_string(fmt_addr)
+        if fmt is None:
+            msg = "<unknown format 0x%08x> %s" % (fmt_addr, " ".join("%02x" % b for b in bytearray(payload[args.off:])))
+        else:
+            msg = format_message(fmt, args, info & FRAME_TRUNCATED)
+
+        line = "%s (%d) %s: %s" % (level, timestamp, tag, msg)
+        if self.colors and level in LOG_COLORS:
+            line = LOG_COLORS[level] + line + LOG_RESET_COLOR
+        return line + "\n"
+
+    def feed(self, data):
+        """ Add raw bytes, return decoded bytes which are ready for output """
+        self.buf += bytearray(data)
+        out = bytearray()
+        while self.buf:
+            sync = self.buf.find(bytearray([FRAME_SYNC]))
+            if sync < 0:
+                out += self.buf
+                self.buf = bytearray()
+                break
+            out += self.buf[:sync]
+            del self.buf[:sync]
+
+            size = self._frame_size(self.buf)
+            if size == 0:
+                break
+            if size < 0:
+                out += self.buf[:1]
+                del self.buf[:1]
+                continue
+            out += self.decode_frame(self.buf[:size]).encode("utf-8")
+            del self.buf[:size]
+        return bytes(out)
+
+    def flush(self):
+        """ Return remaining bytes which do not form a complete frame """
+        out = bytes(self.buf)
+        self.buf = bytearray()
+        return out
+
+
+def main():
+    parser = argparse.ArgumentParser("esp_log_decode - decoder of compact log output")
+    parser.add_argument("--port", "-p", help="Serial port device, read from the port instead of input file")
+    parser.add_argument("--baud", "-b", help="Serial port baud rate", type=int, default=74880)
+    parser.add_argument("--input", "-i", help="File of raw log output, default is stdin", type=argparse.FileType("rb"))
+    parser.add_argument("--no-color", help="Do not add ANSI color codes to decoded lines", action="store_true")
+    parser.add_argument("elf_file", help="ELF file of application")
+    args = parser.parse_args()
+
+    decoder = CompactLogDecoder(ElfFile(args.elf_file), colors=not args.no_color)
+    output = getattr(sys.stdout, "buffer", sys.stdout)
+
+    if args.port:
+        import serial
+        source = serial.serial_for_url(args.port, args.baud)
+        read = lambda: source.read(source.in_waiting or 1)
+    else:
+        source = args.input or getattr(sys.stdin, "buffer", sys.stdin)
+        read = lambda: source.read(4096)
+
+    try:
+        while True:
+            data = read()
+            if not data:
+                break
+            output.write(decoder.feed(data))
+            output.flush()
+    except KeyboardInterrupt:
+        pass
+    output.write(decoder.flush())
+
+
+if __name__ == "__main__":
+    main()
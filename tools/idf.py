@@ -389,6 +389,8 @@ def monitor(action, ctx, args, print_filter):
     if args.port is not None:
         monitor_args += ["-p", args.port]
     monitor_args += ["-b", project_desc["monitor_baud"]]
+    if project_desc.get("monitor_compact_log"):
+        monitor_args += ["--decode-compact-log"]
     if print_filter is not None:
         monitor_args += ["--print_filter", print_filter]
     monitor_args += [elf_file]
@@ -47,6 +47,7 @@ import time
 import sys
 import serial
 import serial.tools.miniterm as miniterm
+import esp_log_decode
 import threading
 import ctypes
 import types
@@ -310,7 +311,8 @@ class Monitor(object):
 
     Main difference is that all event processing happens in the main thread, not the worker threads.
     """
-    def __init__(self, serial_instance, elf_file, print_filter, make="make", toolchain_prefix=DEFAULT_TOOLCHAIN_PREFIX, eol="CRLF"):
+    def __init__(self, serial_instance, elf_file, print_filter, make="make", toolchain_prefix=DEFAULT_TOOLCHAIN_PREFIX, eol="CRLF",
+                 decode_compact_log=False):
         super(Monitor, self).__init__()
         self.event_queue = queue.Queue()
         self.console = miniterm.Console()
@@ -359,6 +361,9 @@ class Monitor(object):
         self._output_enabled = True
         self._serial_check_exit = socket_mode
         self._log_file = None
+        self._log_decoder = None
+        if decode_compact_log:
+            self._log_decoder = esp_log_decode.CompactLogDecoder(esp_log_decode.ElfFile(elf_file))
 
     def invoke_processing_last_line(self):
         self.event_queue.put((TAG_SERIAL_FLUSH, b''), False)
@@ -372,6 +377,8 @@ class Monitor(object):
                 if event_tag == TAG_KEY:
                     self.handle_key(data)
                 elif event_tag == TAG_SERIAL:
+                    if self._log_decoder:
+                        data = self._log_decoder.feed(data)
                     self.handle_serial_input(data)
                     if self._invoke_processing_last_line_timer is not None:
                         self._invoke_processing_last_line_timer.cancel()
@@ -718,6 +725,11 @@ def main():
         help="Filtering string",
         default=DEFAULT_PRINT_FILTER)
 
+    parser.add_argument(
+        '--decode-compact-log',
+        help="Decode compact log frames (CONFIG_LOG_COMPACT) with the ELF file",
+        action='store_true')
+
     args = parser.parse_args()
 
     if args.port.startswith("/dev/tty."):
@@ -743,7 +755,8 @@ def main():
     except KeyError:
         pass  # not running a make jobserver
 
-    monitor = Monitor(serial_instance, args.elf_file.name, args.print_filter, args.make, args.toolchain_prefix, args.eol)
+    monitor = Monitor(serial_instance, args.elf_file.name, args.print_filter, args.make, args.toolchain_prefix, args.eol,
+                      args.decode_compact_log)
 
     yellow_print('--- idf_monitor on {p.name} {p.baudrate} ---'.format(
         p=serial_instance))